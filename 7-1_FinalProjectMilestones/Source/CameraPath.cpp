@@ -0,0 +1,214 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.cpp
+// ============
+// scripted camera movement through the 3D scene, so that rendered frames
+// can be reproduced exactly from one run to the next
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraPath.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// number of keys used for a full orbit
+	const int ORBIT_KEYS = 36;
+
+	const float PI = 3.14159265358979f;
+}
+
+/***********************************************************
+ *  CameraPath()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraPath::CameraPath()
+{
+}
+
+/***********************************************************
+ *  ~CameraPath()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraPath::~CameraPath()
+{
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the keys.
+ ***********************************************************/
+void CameraPath::Clear()
+{
+	m_keys.clear();
+}
+
+/***********************************************************
+ *  AddKey()
+ *
+ *  This method is used for adding a camera pose at a time
+ *  along the path.
+ ***********************************************************/
+void CameraPath::AddKey(float time, const glm::vec3& position, const glm::vec3& target)
+{
+	CAMERA_KEY key;
+	key.time = time;
+	key.position = position;
+	key.target = target;
+
+	int index = (int)m_keys.size();
+	while ((index > 0) && (m_keys[index - 1].time > time))
+	{
+		index--;
+	}
+	m_keys.insert(m_keys.begin() + index, key);
+}
+
+/***********************************************************
+ *  LoadFromFile()
+ *
+ *  This method is used for reading the keys of a camera
+ *  path file. Each line holds the time, the position and
+ *  the point looked at, and lines starting with # are
+ *  comments. It returns false when the file cannot be read
+ *  or holds no keys.
+ ***********************************************************/
+bool CameraPath::LoadFromFile(const std::string& filename)
+{
+	std::ifstream file(filename.c_str());
+	if (!file)
+	{
+		std::cout << "Could not open camera path " << filename << std::endl;
+		return(false);
+	}
+
+	Clear();
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		if (line.empty() || (line[0] == '#'))
+		{
+			continue;
+		}
+
+		std::istringstream values(line);
+		float time = 0.0f;
+		glm::vec3 position;
+		glm::vec3 target;
+		if (values >> time >> position.x >> position.y >> position.z >> target.x >> target.y >> target.z)
+		{
+			AddKey(time, position, target);
+		}
+		else if (line.find_first_not_of(" \t\r") != std::string::npos)
+		{
+			std::cout << filename << "(" << lineNumber << "): camera key needs 7 values" << std::endl;
+		}
+	}
+
+	return(!m_keys.empty());
+}
+
+/***********************************************************
+ *  CreateOrbit()
+ *
+ *  This method is used for replacing the keys with a full
+ *  circle around a point, looking at that point.
+ ***********************************************************/
+void CameraPath::CreateOrbit(
+	const glm::vec3& center,
+	float radius,
+	float height,
+	float duration)
+{
+	Clear();
+	for (int i = 0; i <= ORBIT_KEYS; i++)
+	{
+		float fraction = (float)i / ORBIT_KEYS;
+		float angle = fraction * 2.0f * PI;
+		glm::vec3 position(
+			center.x + radius * sinf(angle),
+			center.y + height,
+			center.z + radius * cosf(angle));
+		AddKey(fraction * duration, position, center);
+	}
+}
+
+/***********************************************************
+ *  GetDuration()
+ *
+ *  This method is used for getting the time of the last
+ *  key on the path.
+ ***********************************************************/
+float CameraPath::GetDuration() const
+{
+	if (m_keys.empty())
+	{
+		return(0.0f);
+	}
+	return(m_keys.back().time);
+}
+
+/***********************************************************
+ *  Evaluate()
+ *
+ *  This method is used for getting the camera position and
+ *  the normalized front vector at a time along the path.
+ *  Times before the first key or after the last one hold
+ *  the pose of that key.
+ ***********************************************************/
+void CameraPath::Evaluate(float time, glm::vec3& position, glm::vec3& front) const
+{
+	if (m_keys.empty())
+	{
+		position = glm::vec3(0.0f);
+		front = glm::vec3(0.0f, 0.0f, -1.0f);
+		return;
+	}
+
+	int next = 0;
+	while ((next < (int)m_keys.size()) && (m_keys[next].time < time))
+	{
+		next++;
+	}
+
+	glm::vec3 target;
+	if (next == 0)
+	{
+		position = m_keys[0].position;
+		target = m_keys[0].target;
+	}
+	else if (next == (int)m_keys.size())
+	{
+		position = m_keys[next - 1].position;
+		target = m_keys[next - 1].target;
+	}
+	else
+	{
+		const CAMERA_KEY& from = m_keys[next - 1];
+		const CAMERA_KEY& to = m_keys[next];
+		float span = to.time - from.time;
+		float blend = (span > 0.0f) ? (time - from.time) / span : 1.0f;
+
+		position = glm::mix(from.position, to.position, blend);
+		target = glm::mix(from.target, to.target, blend);
+	}
+
+	front = target - position;
+	if (glm::length(front) > 0.0f)
+	{
+		front = glm::normalize(front);
+	}
+	else
+	{
+		front = glm::vec3(0.0f, 0.0f, -1.0f);
+	}
+}
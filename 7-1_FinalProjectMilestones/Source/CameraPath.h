@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.h
+// ============
+// scripted camera movement through the 3D scene, so that rendered frames
+// can be reproduced exactly from one run to the next
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  CameraPath
+ *
+ *  This class holds a list of camera keys, each with a
+ *  position and a point being looked at. The camera pose
+ *  for any point along the path is blended between the
+ *  keys on either side of it.
+ ***********************************************************/
+class CameraPath
+{
+public:
+	// constructor
+	CameraPath();
+	// destructor
+	~CameraPath();
+
+	// one camera pose along the path
+	struct CAMERA_KEY
+	{
+		float time;
+		glm::vec3 position;
+		glm::vec3 target;
+	};
+
+	// remove all the keys
+	void Clear();
+	// add a key, keeping the keys in time order
+	void AddKey(float time, const glm::vec3& position, const glm::vec3& target);
+	// replace the keys with the ones in a camera path file
+	bool LoadFromFile(const std::string& filename);
+	// replace the keys with a circle around the scene
+	void CreateOrbit(
+		const glm::vec3& center,
+		float radius,
+		float height,
+		float duration);
+
+	// camera pose at a time along the path
+	void Evaluate(float time, glm::vec3& position, glm::vec3& front) const;
+
+	// accessors for the keys
+	int GetKeyCount() const { return((int)m_keys.size()); }
+	float GetDuration() const;
+
+private:
+	// keys in time order
+	std::vector<CAMERA_KEY> m_keys;
+};
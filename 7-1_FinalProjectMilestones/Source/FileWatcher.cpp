@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ============
+// report the watched files that were written since the last check
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// time between looks at the modification times, when the
+	// files cannot be watched through inotify
+	const int CHECK_INTERVAL_MS = 250;
+}
+
+/***********************************************************
+ *  FileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify < 0)
+	{
+		std::cout << "Could not start inotify, checking the watched files for changes instead" << std::endl;
+	}
+#endif
+	m_lastCheck = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  ~FileWatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if (m_inotify >= 0)
+	{
+		// closing the instance removes all of its watches
+		close(m_inotify);
+		m_inotify = -1;
+	}
+#endif
+}
+
+/***********************************************************
+ *  ReadFileStatus()
+ *
+ *  This method is used for reading the modification time
+ *  and the size of a file.
+ ***********************************************************/
+bool FileWatcher::ReadFileStatus(const std::string& filename, time_t& modifiedTime, long long& size)
+{
+	struct stat status;
+	if (stat(filename.c_str(), &status) != 0)
+	{
+		return(false);
+	}
+
+	modifiedTime = status.st_mtime;
+	size = (long long)status.st_size;
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddFile()
+ *
+ *  This method is used for starting to watch a file. The
+ *  directory holding it is watched, rather than the file,
+ *  so editors that save by writing a new file and renaming
+ *  it over the old one are still seen. A file that is
+ *  already watched is not added again.
+ ***********************************************************/
+bool FileWatcher::AddFile(const std::string& filename)
+{
+	for (int i = 0; i < (int)m_files.size(); i++)
+	{
+		if (m_files[i].filename == filename)
+		{
+			return(true);
+		}
+	}
+
+	WATCHED_FILE file;
+	file.filename = filename;
+	size_t separator = filename.find_last_of("/\\");
+	if (separator == std::string::npos)
+	{
+		file.directory = ".";
+		file.name = filename;
+	}
+	else
+	{
+		file.directory = filename.substr(0, separator);
+		file.name = filename.substr(separator + 1);
+	}
+	file.bChanged = false;
+	if (ReadFileStatus(filename, file.modifiedTime, file.size) == false)
+	{
+		std::cout << "Cannot watch missing file " << filename << std::endl;
+		return(false);
+	}
+
+#ifdef __linux__
+	bool bWatched = false;
+	for (int i = 0; i < (int)m_directories.size(); i++)
+	{
+		if (m_directories[i].directory == file.directory)
+		{
+			bWatched = true;
+		}
+	}
+	if ((m_inotify >= 0) && (bWatched == false))
+	{
+		WATCHED_DIRECTORY directory;
+		directory.directory = file.directory;
+		directory.watch = inotify_add_watch(m_inotify, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (directory.watch < 0)
+		{
+			// fall back to the modification times for every file
+			std::cout << "Could not watch " << file.directory << ", checking the watched files for changes instead" << std::endl;
+			close(m_inotify);
+			m_inotify = -1;
+			m_directories.clear();
+		}
+		else
+		{
+			m_directories.push_back(directory);
+		}
+	}
+#endif
+
+	m_files.push_back(file);
+
+	return(true);
+}
+
+#ifdef __linux__
+/***********************************************************
+ *  ReadEvents()
+ *
+ *  This method is used for reading every pending inotify
+ *  event without blocking, and marking the watched files
+ *  that were written or moved into place.
+ ***********************************************************/
+void FileWatcher::ReadEvents()
+{
+	// aligned for the event structures read into it
+	alignas(struct inotify_event) char buffer[4096];
+
+	while (true)
+	{
+		ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			// EAGAIN once every pending event has been read
+			return;
+		}
+
+		for (ssize_t offset = 0; offset < length; )
+		{
+			const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+			offset += sizeof(struct inotify_event) + event->len;
+			if (event->len == 0)
+			{
+				continue;
+			}
+
+			const std::string* directory = NULL;
+			for (int i = 0; i < (int)m_directories.size(); i++)
+			{
+				if (m_directories[i].watch == event->wd)
+				{
+					directory = &m_directories[i].directory;
+				}
+			}
+			for (int i = 0; (NULL != directory) && (i < (int)m_files.size()); i++)
+			{
+				if ((m_files[i].directory == *directory) && (m_files[i].name == event->name))
+				{
+					m_files[i].bChanged = true;
+				}
+			}
+		}
+	}
+}
+#endif
+
+/***********************************************************
+ *  CheckModifiedTimes()
+ *
+ *  This method is used for marking the watched files whose
+ *  modification time or size differs from the last seen
+ *  one. A file that is missing for the moment, as it is
+ *  while being replaced, is checked again next time.
+ ***********************************************************/
+void FileWatcher::CheckModifiedTimes()
+{
+	for (int i = 0; i < (int)m_files.size(); i++)
+	{
+		WATCHED_FILE& file = m_files[i];
+		time_t modifiedTime = 0;
+		long long size = 0;
+		if (ReadFileStatus(file.filename, modifiedTime, size) == false)
+		{
+			continue;
+		}
+
+		if ((modifiedTime != file.modifiedTime) || (size != file.size))
+		{
+			file.modifiedTime = modifiedTime;
+			file.size = size;
+			file.bChanged = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  Poll()
+ *
+ *  This method is used for collecting the watched files
+ *  that changed since the last call. Several writes to a
+ *  file in between are reported as one change.
+ ***********************************************************/
+void FileWatcher::Poll(std::vector<std::string>& changedFiles)
+{
+	changedFiles.clear();
+
+#ifdef __linux__
+	if (m_inotify >= 0)
+	{
+		ReadEvents();
+	}
+	else
+#endif
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - m_lastCheck < std::chrono::milliseconds(CHECK_INTERVAL_MS))
+		{
+			return;
+		}
+		m_lastCheck = now;
+		CheckModifiedTimes();
+	}
+
+	for (int i = 0; i < (int)m_files.size(); i++)
+	{
+		if (m_files[i].bChanged == true)
+		{
+			m_files[i].bChanged = false;
+			changedFiles.push_back(m_files[i].filename);
+		}
+	}
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ============
+// report the watched files that were written since the last check
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FileWatcher
+ *
+ *  This class watches a set of files for changes and is
+ *  checked once per frame, never blocking. On Linux it
+ *  listens to inotify events on the directories holding the
+ *  files, so a change is seen on the next frame, and saves
+ *  that replace the file with a new one are caught as well.
+ *  Elsewhere it compares the modification times of the
+ *  files a few times per second.
+ ***********************************************************/
+class FileWatcher
+{
+public:
+	// constructor
+	FileWatcher();
+	// destructor
+	~FileWatcher();
+
+	// start watching a file, returning false if it cannot be
+	bool AddFile(const std::string& filename);
+	// collect the watched files written since the last call,
+	// each named once as it was added
+	void Poll(std::vector<std::string>& changedFiles);
+
+private:
+	// a watched file and the directory it is in
+	struct WATCHED_FILE
+	{
+		std::string filename;
+		std::string directory;
+		std::string name;
+		// last seen modification time and size of the file
+		time_t modifiedTime;
+		long long size;
+		// set when the file changed since the last call
+		bool bChanged;
+	};
+
+	// the watched files
+	std::vector<WATCHED_FILE> m_files;
+
+#ifdef __linux__
+	// a watched directory and its inotify watch
+	struct WATCHED_DIRECTORY
+	{
+		std::string directory;
+		int watch;
+	};
+
+	// inotify instance, or -1 when it is not available
+	int m_inotify;
+	std::vector<WATCHED_DIRECTORY> m_directories;
+
+	// read the pending inotify events and mark the changed files
+	void ReadEvents();
+#endif
+
+	// time of the last look at the modification times
+	std::chrono::steady_clock::time_point m_lastCheck;
+
+	// compare the modification times with the last seen ones
+	void CheckModifiedTimes();
+	// read the modification time and size of a file
+	static bool ReadFileStatus(const std::string& filename, time_t& modifiedTime, long long& size);
+};
@@ -0,0 +1,381 @@
+///////////////////////////////////////////////////////////////////////////////
+// framebenchmark.cpp
+// ============
+// record the CPU and GPU time and the work done in every benchmark frame, and
+// report the frame time percentiles of each benchmark case as JSON
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameBenchmark.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// frames a timer query result has to catch up with the CPU
+	const int QUERY_LATENCY = 4;
+
+	// the statistics of one recorded value over a case
+	struct VALUE_SUMMARY
+	{
+		double mean;
+		double p50;
+		double p95;
+		double p99;
+		double max;
+	};
+
+	/***********************************************************
+	 *  Summarize()
+	 *
+	 *  Returns the mean, the nearest rank percentiles and the
+	 *  largest of the values. Negative values mark samples
+	 *  with no result and are left out.
+	 ***********************************************************/
+	VALUE_SUMMARY Summarize(std::vector<double> values)
+	{
+		VALUE_SUMMARY summary = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+		values.erase(std::remove_if(values.begin(), values.end(),
+			[](double value) { return(value < 0.0); }), values.end());
+		if (values.empty())
+		{
+			return(summary);
+		}
+
+		std::sort(values.begin(), values.end());
+		double total = 0.0;
+		for (int i = 0; i < (int)values.size(); i++)
+		{
+			total += values[i];
+		}
+
+		int last = (int)values.size() - 1;
+		summary.mean = total / values.size();
+		summary.p50 = values[std::min(last, (int)(0.50 * values.size()))];
+		summary.p95 = values[std::min(last, (int)(0.95 * values.size()))];
+		summary.p99 = values[std::min(last, (int)(0.99 * values.size()))];
+		summary.max = values[last];
+
+		return(summary);
+	}
+
+	/***********************************************************
+	 *  WriteSummary()
+	 *
+	 *  Writes the statistics of a value as a JSON object.
+	 ***********************************************************/
+	void WriteSummary(std::ofstream& file, const char* name, const VALUE_SUMMARY& summary, bool bLast)
+	{
+		file << "      \"" << name << "\": { "
+			<< "\"mean\": " << summary.mean << ", "
+			<< "\"p50\": " << summary.p50 << ", "
+			<< "\"p95\": " << summary.p95 << ", "
+			<< "\"p99\": " << summary.p99 << ", "
+			<< "\"max\": " << summary.max << " }"
+			<< (bLast ? "\n" : ",\n");
+	}
+
+	/***********************************************************
+	 *  WriteString()
+	 *
+	 *  Writes a JSON string value with its quotes and escapes.
+	 ***********************************************************/
+	void WriteString(std::ofstream& file, const char* value)
+	{
+		file << "\"";
+		for (const char* c = value; (NULL != c) && (*c != 0); c++)
+		{
+			if ((*c == '"') || (*c == '\\'))
+			{
+				file << '\\';
+			}
+			if ((unsigned char)*c >= 0x20)
+			{
+				file << *c;
+			}
+		}
+		file << "\"";
+	}
+}
+
+/***********************************************************
+ *  FrameBenchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameBenchmark::FrameBenchmark()
+{
+	m_nextQuery = 0;
+	m_bTimerQueries = false;
+	m_bHasLastFrame = false;
+}
+
+/***********************************************************
+ *  ~FrameBenchmark()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameBenchmark::~FrameBenchmark()
+{
+	DestroyQueries();
+}
+
+/***********************************************************
+ *  CreateQueries()
+ *
+ *  This method is used for creating the ring of timer
+ *  queries. The time elapsed query is core since OpenGL
+ *  3.3, but some drivers report no timer bits, and then
+ *  no GPU times are recorded.
+ ***********************************************************/
+void FrameBenchmark::CreateQueries()
+{
+	GLint timerBits = 0;
+	glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &timerBits);
+	m_bTimerQueries = (timerBits > 0);
+
+	if (m_bTimerQueries == true)
+	{
+		m_queries.resize(QUERY_LATENCY);
+		glGenQueries(QUERY_LATENCY, m_queries.data());
+		m_pendingSamples.assign(QUERY_LATENCY, -1);
+	}
+	m_nextQuery = 0;
+}
+
+/***********************************************************
+ *  DestroyQueries()
+ *
+ *  This method is used for freeing the timer queries.
+ ***********************************************************/
+void FrameBenchmark::DestroyQueries()
+{
+	if (!m_queries.empty())
+	{
+		glDeleteQueries((GLsizei)m_queries.size(), m_queries.data());
+		m_queries.clear();
+	}
+	m_pendingSamples.clear();
+	m_bTimerQueries = false;
+}
+
+/***********************************************************
+ *  BeginCase()
+ *
+ *  This method is used for starting a new case, which the
+ *  following frames are recorded into.
+ ***********************************************************/
+void FrameBenchmark::BeginCase(const std::string& name, int width, int height)
+{
+	CASE_RESULT result;
+	result.name = name;
+	result.width = width;
+	result.height = height;
+	m_cases.push_back(result);
+
+	m_bHasLastFrame = false;
+}
+
+/***********************************************************
+ *  EndCase()
+ *
+ *  This method is used for waiting on the timer queries
+ *  that are still in flight, so the case is complete.
+ ***********************************************************/
+void FrameBenchmark::EndCase()
+{
+	for (int i = 0; i < (int)m_queries.size(); i++)
+	{
+		ResolveQuery(i);
+	}
+}
+
+/***********************************************************
+ *  ResolveQuery()
+ *
+ *  This method is used for reading the result of a timer
+ *  query into the sample that it timed. The ring is long
+ *  enough that the result is normally ready by then.
+ ***********************************************************/
+void FrameBenchmark::ResolveQuery(int query)
+{
+	int sample = m_pendingSamples[query];
+	if ((sample < 0) || m_cases.empty())
+	{
+		return;
+	}
+
+	GLuint64 elapsedNanoseconds = 0;
+	glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &elapsedNanoseconds);
+	m_cases.back().samples[sample].gpuMilliseconds = elapsedNanoseconds / 1.0e6;
+	m_pendingSamples[query] = -1;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the timers of a frame.
+ ***********************************************************/
+void FrameBenchmark::BeginFrame()
+{
+	m_lastFrameStart = m_frameStart;
+	m_frameStart = std::chrono::steady_clock::now();
+
+	if (m_bTimerQueries == true)
+	{
+		// the query is reused once its earlier result is read
+		ResolveQuery(m_nextQuery);
+		glBeginQuery(GL_TIME_ELAPSED, m_queries[m_nextQuery]);
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for stopping the timers of a frame
+ *  and storing its sample. The CPU time covers the work of
+ *  submitting the frame, and the frame time is the time
+ *  since the start of the frame before it.
+ ***********************************************************/
+void FrameBenchmark::EndFrame(int drawCalls, int uniformUploads, int objectsDrawn, int trianglesDrawn)
+{
+	std::chrono::duration<double, std::milli> cpuTime = std::chrono::steady_clock::now() - m_frameStart;
+
+	FRAME_SAMPLE sample;
+	sample.cpuMilliseconds = cpuTime.count();
+	sample.gpuMilliseconds = -1.0;
+	sample.frameMilliseconds = -1.0;
+	sample.drawCalls = drawCalls;
+	sample.uniformUploads = uniformUploads;
+	sample.objectsDrawn = objectsDrawn;
+	sample.trianglesDrawn = trianglesDrawn;
+
+	if (m_bHasLastFrame == true)
+	{
+		std::chrono::duration<double, std::milli> frameTime = m_frameStart - m_lastFrameStart;
+		sample.frameMilliseconds = frameTime.count();
+	}
+	m_bHasLastFrame = true;
+
+	CASE_RESULT& result = m_cases.back();
+	result.samples.push_back(sample);
+
+	if (m_bTimerQueries == true)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_pendingSamples[m_nextQuery] = (int)result.samples.size() - 1;
+		m_nextQuery = (m_nextQuery + 1) % (int)m_queries.size();
+	}
+}
+
+/***********************************************************
+ *  GetMedianFrameTime()
+ *
+ *  This method is used for getting the median GPU time of
+ *  the frames of a case, which is what a change to the
+ *  shaders moves. Without timer queries the time between
+ *  frame starts is used instead.
+ ***********************************************************/
+double FrameBenchmark::GetMedianFrameTime(int caseIndex) const
+{
+	const CASE_RESULT& result = m_cases[caseIndex];
+	std::vector<double> times;
+	for (int s = 0; s < (int)result.samples.size(); s++)
+	{
+		times.push_back((m_bTimerQueries == true) ?
+			result.samples[s].gpuMilliseconds :
+			result.samples[s].frameMilliseconds);
+	}
+
+	return(Summarize(times).p50);
+}
+
+/***********************************************************
+ *  PrintSummary()
+ *
+ *  This method is used for printing the frame time
+ *  percentiles of every case.
+ ***********************************************************/
+void FrameBenchmark::PrintSummary() const
+{
+	for (int i = 0; i < (int)m_cases.size(); i++)
+	{
+		const CASE_RESULT& result = m_cases[i];
+		std::vector<double> cpuTimes;
+		std::vector<double> gpuTimes;
+		for (int s = 0; s < (int)result.samples.size(); s++)
+		{
+			cpuTimes.push_back(result.samples[s].cpuMilliseconds);
+			gpuTimes.push_back(result.samples[s].gpuMilliseconds);
+		}
+		VALUE_SUMMARY cpu = Summarize(cpuTimes);
+		VALUE_SUMMARY gpu = Summarize(gpuTimes);
+
+		std::cout << "INFO: " << result.name << " " << result.width << "x" << result.height
+			<< " - cpu ms p50/p95/p99: " << cpu.p50 << " / " << cpu.p95 << " / " << cpu.p99
+			<< ", gpu ms p50/p95/p99: " << gpu.p50 << " / " << gpu.p95 << " / " << gpu.p99
+			<< std::endl;
+	}
+}
+
+/***********************************************************
+ *  WriteReport()
+ *
+ *  This method is used for writing the statistics of every
+ *  case into a JSON file, so that runs can be compared and
+ *  regressions caught by a script.
+ ***********************************************************/
+bool FrameBenchmark::WriteReport(const std::string& filename) const
+{
+	std::ofstream file(filename.c_str());
+	if (!file)
+	{
+		std::cout << "Could not write benchmark report " << filename << std::endl;
+		return(false);
+	}
+
+	file << "{\n  \"renderer\": ";
+	WriteString(file, (const char*)glGetString(GL_RENDERER));
+	file << ",\n  \"version\": ";
+	WriteString(file, (const char*)glGetString(GL_VERSION));
+	file << ",\n  \"gpu_timer_queries\": " << (m_bTimerQueries ? "true" : "false");
+	file << ",\n  \"cases\": [\n";
+
+	for (int i = 0; i < (int)m_cases.size(); i++)
+	{
+		const CASE_RESULT& result = m_cases[i];
+		std::vector<double> values[7];
+		for (int s = 0; s < (int)result.samples.size(); s++)
+		{
+			const FRAME_SAMPLE& sample = result.samples[s];
+			values[0].push_back(sample.cpuMilliseconds);
+			values[1].push_back(sample.gpuMilliseconds);
+			values[2].push_back(sample.frameMilliseconds);
+			values[3].push_back(sample.drawCalls);
+			values[4].push_back(sample.uniformUploads);
+			values[5].push_back(sample.objectsDrawn);
+			values[6].push_back(sample.trianglesDrawn);
+		}
+
+		file << "    {\n      \"name\": ";
+		WriteString(file, result.name.c_str());
+		file << ",\n      \"width\": " << result.width
+			<< ",\n      \"height\": " << result.height
+			<< ",\n      \"frames\": " << result.samples.size() << ",\n";
+		WriteSummary(file, "cpu_ms", Summarize(values[0]), false);
+		WriteSummary(file, "gpu_ms", Summarize(values[1]), false);
+		WriteSummary(file, "frame_ms", Summarize(values[2]), false);
+		WriteSummary(file, "draw_calls", Summarize(values[3]), false);
+		WriteSummary(file, "uniform_uploads", Summarize(values[4]), false);
+		WriteSummary(file, "objects_drawn", Summarize(values[5]), false);
+		WriteSummary(file, "triangles_drawn", Summarize(values[6]), true);
+		file << "    }" << ((i + 1 < (int)m_cases.size()) ? ",\n" : "\n");
+	}
+
+	file << "  ]\n}\n";
+
+	return(file.good());
+}
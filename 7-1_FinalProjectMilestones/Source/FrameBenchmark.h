@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// framebenchmark.h
+// ============
+// record the CPU and GPU time and the work done in every benchmark frame, and
+// report the frame time percentiles of each benchmark case as JSON
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameBenchmark
+ *
+ *  This class collects one sample per rendered frame. The
+ *  GPU time comes from GL_TIME_ELAPSED queries that are
+ *  read back a few frames later, so the CPU never waits on
+ *  them. Frames are grouped into cases, one for each camera
+ *  path and resolution that is replayed.
+ ***********************************************************/
+class FrameBenchmark
+{
+public:
+	// constructor
+	FrameBenchmark();
+	// destructor
+	~FrameBenchmark();
+
+	// the values recorded for one frame
+	struct FRAME_SAMPLE
+	{
+		double cpuMilliseconds;
+		double gpuMilliseconds;
+		double frameMilliseconds;
+		int drawCalls;
+		int uniformUploads;
+		int objectsDrawn;
+		int trianglesDrawn;
+	};
+
+	// all the frames of one camera path at one resolution
+	struct CASE_RESULT
+	{
+		std::string name;
+		int width;
+		int height;
+		std::vector<FRAME_SAMPLE> samples;
+	};
+
+	// create and free the timer queries
+	void CreateQueries();
+	void DestroyQueries();
+
+	// start and finish recording a case
+	void BeginCase(const std::string& name, int width, int height);
+	void EndCase();
+	// start and finish timing a frame
+	void BeginFrame();
+	void EndFrame(int drawCalls, int uniformUploads, int objectsDrawn, int trianglesDrawn);
+
+	// number of recorded cases
+	int GetCaseCount() const { return((int)m_cases.size()); }
+	// median time a frame of a case took on the GPU, or between
+	// frame starts when there are no timer queries
+	double GetMedianFrameTime(int caseIndex) const;
+
+	// print the percentiles of every case
+	void PrintSummary() const;
+	// write the percentiles of every case into a JSON file
+	bool WriteReport(const std::string& filename) const;
+
+private:
+	// timer queries used in turn, and the sample waiting on each
+	std::vector<GLuint> m_queries;
+	std::vector<int> m_pendingSamples;
+	int m_nextQuery;
+	// whether the driver provides timer queries
+	bool m_bTimerQueries;
+
+	// the recorded cases, the last one being recorded
+	std::vector<CASE_RESULT> m_cases;
+	// start of the frame being timed and of the one before it
+	std::chrono::steady_clock::time_point m_frameStart;
+	std::chrono::steady_clock::time_point m_lastFrameStart;
+	bool m_bHasLastFrame;
+
+	// store the result of a finished timer query in its sample
+	void ResolveQuery(int query);
+};
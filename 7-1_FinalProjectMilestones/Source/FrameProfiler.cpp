@@ -0,0 +1,434 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// nested CPU and GPU timing scopes recorded for every frame, kept in a ring
+// of recent frames for the on-screen summary and for trace exports
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// frames kept in the ring for the summary and the trace
+	const int HISTORY_FRAMES = 240;
+	// most recent frames averaged in the summary
+	const int SUMMARY_FRAMES = 60;
+	// sets of timestamp queries used in turn
+	const int QUERY_SETS = 2;
+
+	// averaged times of one scope in the summary
+	struct SCOPE_SUMMARY
+	{
+		const char* name;
+		int depth;
+		double cpuTotal;
+		double gpuTotal;
+		int calls;
+	};
+}
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler()
+{
+	m_bEnabled = false;
+	m_bTimestamps = false;
+	m_frames.resize(HISTORY_FRAMES);
+	for (int i = 0; i < HISTORY_FRAMES; i++)
+	{
+		m_frames[i].frameNumber = -1;
+		m_frames[i].bComplete = false;
+		m_frames[i].bGpuValid = false;
+	}
+	m_currentFrame = 0;
+	m_frameNumber = 0;
+	for (int i = 0; i < QUERY_SETS; i++)
+	{
+		m_queriesUsed[i] = 0;
+		m_querySetFrames[i] = -1;
+	}
+	m_startTime = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	DestroyQueries();
+}
+
+/***********************************************************
+ *  CreateQueries()
+ *
+ *  This method is used for checking that the driver counts
+ *  timestamps. The queries themselves are created as the
+ *  scopes need them. Without timestamps only the CPU times
+ *  are recorded.
+ ***********************************************************/
+void FrameProfiler::CreateQueries()
+{
+	GLint timestampBits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+	m_bTimestamps = (timestampBits > 0);
+}
+
+/***********************************************************
+ *  DestroyQueries()
+ *
+ *  This method is used for freeing the timestamp queries.
+ ***********************************************************/
+void FrameProfiler::DestroyQueries()
+{
+	for (int i = 0; i < QUERY_SETS; i++)
+	{
+		if (!m_queries[i].empty())
+		{
+			glDeleteQueries((GLsizei)m_queries[i].size(), m_queries[i].data());
+			m_queries[i].clear();
+		}
+		m_queriesUsed[i] = 0;
+		m_querySetFrames[i] = -1;
+	}
+	m_bTimestamps = false;
+}
+
+/***********************************************************
+ *  NowMilliseconds()
+ *
+ *  This method is used for reading the steady clock.
+ ***********************************************************/
+double FrameProfiler::NowMilliseconds() const
+{
+	std::chrono::duration<double, std::milli> elapsed =
+		std::chrono::steady_clock::now() - m_startTime;
+	return(elapsed.count());
+}
+
+/***********************************************************
+ *  WriteTimestamp()
+ *
+ *  This method is used for writing the GPU time into the
+ *  next free query of a set, creating more queries when
+ *  the set has run out.
+ ***********************************************************/
+int FrameProfiler::WriteTimestamp(int querySet)
+{
+	std::vector<GLuint>& queries = m_queries[querySet];
+	int index = m_queriesUsed[querySet]++;
+	if (index >= (int)queries.size())
+	{
+		int oldCount = (int)queries.size();
+		queries.resize(oldCount + 64);
+		glGenQueries(64, &queries[oldCount]);
+	}
+	glQueryCounter(queries[index], GL_TIMESTAMP);
+
+	return(index);
+}
+
+/***********************************************************
+ *  ResolveQuerySet()
+ *
+ *  This method is used for reading back the timestamps of
+ *  the frame that last used a query set. When the GPU has
+ *  not reached the end of that frame yet, its GPU times are
+ *  dropped rather than waited for.
+ ***********************************************************/
+void FrameProfiler::ResolveQuerySet(int querySet)
+{
+	int frameIndex = m_querySetFrames[querySet];
+	m_querySetFrames[querySet] = -1;
+	if ((frameIndex < 0) || (m_queriesUsed[querySet] == 0))
+	{
+		return;
+	}
+
+	FRAME_RECORD& frame = m_frames[frameIndex];
+	const std::vector<GLuint>& queries = m_queries[querySet];
+
+	// the queries finish in order, so the last one tells for all
+	GLint available = 0;
+	glGetQueryObjectiv(queries[m_queriesUsed[querySet] - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < (int)frame.scopes.size(); i++)
+	{
+		SCOPE_RECORD& scope = frame.scopes[i];
+		glGetQueryObjectui64v(queries[scope.gpuBeginQuery], GL_QUERY_RESULT, &scope.gpuBegin);
+		glGetQueryObjectui64v(queries[scope.gpuEndQuery], GL_QUERY_RESULT, &scope.gpuEnd);
+	}
+	frame.bGpuValid = true;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the record of a new
+ *  frame in the ring. The query set it is going to use
+ *  is read back first, which holds the frame from two
+ *  frames ago. The whole frame is the outermost scope.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	if (m_bEnabled == false)
+	{
+		return;
+	}
+
+	m_frameNumber++;
+	m_currentFrame = (m_currentFrame + 1) % HISTORY_FRAMES;
+	int querySet = (int)(m_frameNumber % QUERY_SETS);
+	if (m_bTimestamps == true)
+	{
+		ResolveQuerySet(querySet);
+	}
+	m_queriesUsed[querySet] = 0;
+	m_querySetFrames[querySet] = m_currentFrame;
+
+	FRAME_RECORD& frame = m_frames[m_currentFrame];
+	frame.frameNumber = m_frameNumber;
+	frame.bComplete = false;
+	frame.bGpuValid = false;
+	frame.scopes.clear();
+	m_scopeStack.clear();
+
+	PushScope("Frame");
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for closing every scope that is
+ *  still open and finishing the record of the frame.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+	if ((m_bEnabled == false) || (m_frames[m_currentFrame].frameNumber != m_frameNumber))
+	{
+		return;
+	}
+
+	while (!m_scopeStack.empty())
+	{
+		PopScope();
+	}
+	m_frames[m_currentFrame].bComplete = true;
+}
+
+/***********************************************************
+ *  PushScope()
+ *
+ *  This method is used for opening a scope nested inside
+ *  the scope that is open now.
+ ***********************************************************/
+void FrameProfiler::PushScope(const char* name)
+{
+	if (m_bEnabled == false)
+	{
+		return;
+	}
+
+	FRAME_RECORD& frame = m_frames[m_currentFrame];
+	SCOPE_RECORD scope;
+	scope.name = name;
+	scope.depth = (int)m_scopeStack.size();
+	scope.cpuBegin = NowMilliseconds();
+	scope.cpuEnd = scope.cpuBegin;
+	scope.gpuBeginQuery = -1;
+	scope.gpuEndQuery = -1;
+	scope.gpuBegin = 0;
+	scope.gpuEnd = 0;
+	if (m_bTimestamps == true)
+	{
+		scope.gpuBeginQuery = WriteTimestamp((int)(m_frameNumber % QUERY_SETS));
+	}
+
+	m_scopeStack.push_back((int)frame.scopes.size());
+	frame.scopes.push_back(scope);
+}
+
+/***********************************************************
+ *  PopScope()
+ *
+ *  This method is used for closing the innermost open
+ *  scope.
+ ***********************************************************/
+void FrameProfiler::PopScope()
+{
+	if ((m_bEnabled == false) || m_scopeStack.empty())
+	{
+		return;
+	}
+
+	SCOPE_RECORD& scope = m_frames[m_currentFrame].scopes[m_scopeStack.back()];
+	m_scopeStack.pop_back();
+	if (m_bTimestamps == true)
+	{
+		scope.gpuEndQuery = WriteTimestamp((int)(m_frameNumber % QUERY_SETS));
+	}
+	scope.cpuEnd = NowMilliseconds();
+}
+
+/***********************************************************
+ *  GetSummaryLines()
+ *
+ *  This method is used for formatting the CPU and GPU time
+ *  of every scope per frame, averaged over the most recent
+ *  completed frames. Scopes with the same name and depth
+ *  are added together, and nested scopes are indented
+ *  under the scope they were opened in.
+ ***********************************************************/
+void FrameProfiler::GetSummaryLines(std::vector<std::string>& lines) const
+{
+	lines.clear();
+
+	std::vector<SCOPE_SUMMARY> summaries;
+	int cpuFrames = 0;
+	int gpuFrames = 0;
+	for (int i = 0; i < HISTORY_FRAMES && cpuFrames < SUMMARY_FRAMES; i++)
+	{
+		const FRAME_RECORD& frame = m_frames[(m_currentFrame + HISTORY_FRAMES - i) % HISTORY_FRAMES];
+		if (frame.bComplete == false)
+		{
+			continue;
+		}
+		cpuFrames++;
+		if (frame.bGpuValid == true)
+		{
+			gpuFrames++;
+		}
+
+		for (int s = 0; s < (int)frame.scopes.size(); s++)
+		{
+			const SCOPE_RECORD& scope = frame.scopes[s];
+			int found = 0;
+			while ((found < (int)summaries.size()) &&
+				((summaries[found].depth != scope.depth) ||
+				(summaries[found].name != scope.name)))
+			{
+				found++;
+			}
+			if (found == (int)summaries.size())
+			{
+				SCOPE_SUMMARY summary = { scope.name, scope.depth, 0.0, 0.0, 0 };
+				summaries.push_back(summary);
+			}
+
+			summaries[found].cpuTotal += scope.cpuEnd - scope.cpuBegin;
+			if (frame.bGpuValid == true)
+			{
+				summaries[found].gpuTotal += (scope.gpuEnd - scope.gpuBegin) / 1000000.0;
+			}
+			summaries[found].calls++;
+		}
+	}
+
+	if (cpuFrames == 0)
+	{
+		return;
+	}
+
+	char line[128];
+	snprintf(line, sizeof(line), "%-24s %9s %9s %6s", "SCOPE", "CPU MS", "GPU MS", "CALLS");
+	lines.push_back(line);
+	for (int i = 0; i < (int)summaries.size(); i++)
+	{
+		const SCOPE_SUMMARY& summary = summaries[i];
+		std::string name = std::string(summary.depth * 2, ' ') + summary.name;
+		char gpuText[16] = "-";
+		if (gpuFrames > 0)
+		{
+			snprintf(gpuText, sizeof(gpuText), "%.3f", summary.gpuTotal / gpuFrames);
+		}
+		snprintf(line, sizeof(line), "%-24.24s %9.3f %9s %6d",
+			name.c_str(),
+			summary.cpuTotal / cpuFrames,
+			gpuText,
+			(summary.calls + cpuFrames - 1) / cpuFrames);
+		lines.push_back(line);
+	}
+}
+
+/***********************************************************
+ *  WriteChromeTrace()
+ *
+ *  This method is used for writing the recorded frames as
+ *  Chrome trace events, which chrome://tracing and Perfetto
+ *  open. The CPU scopes are on one track and the GPU scopes
+ *  on another. The GPU clock is not the CPU clock, so the
+ *  GPU track is shifted to start with the first frame.
+ ***********************************************************/
+bool FrameProfiler::WriteChromeTrace(const std::string& filename) const
+{
+	std::ofstream file(filename.c_str());
+	if (!file)
+	{
+		std::cout << "Could not write profiler trace " << filename << std::endl;
+		return(false);
+	}
+
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	bool bHasGpuOffset = false;
+	double gpuOffset = 0.0;
+	char event[256];
+	for (int i = 1; i <= HISTORY_FRAMES; i++)
+	{
+		// oldest frame first
+		const FRAME_RECORD& frame = m_frames[(m_currentFrame + i) % HISTORY_FRAMES];
+		if ((frame.bComplete == false) || frame.scopes.empty())
+		{
+			continue;
+		}
+
+		if ((frame.bGpuValid == true) && (bHasGpuOffset == false))
+		{
+			gpuOffset = frame.scopes[0].cpuBegin * 1000.0 - frame.scopes[0].gpuBegin / 1000.0;
+			bHasGpuOffset = true;
+		}
+
+		for (int s = 0; s < (int)frame.scopes.size(); s++)
+		{
+			const SCOPE_RECORD& scope = frame.scopes[s];
+			snprintf(event, sizeof(event),
+				",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%lld}}",
+				scope.name,
+				scope.cpuBegin * 1000.0,
+				(scope.cpuEnd - scope.cpuBegin) * 1000.0,
+				frame.frameNumber);
+			file << event;
+
+			if (frame.bGpuValid == true)
+			{
+				snprintf(event, sizeof(event),
+					",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%lld}}",
+					scope.name,
+					scope.gpuBegin / 1000.0 + gpuOffset,
+					(scope.gpuEnd - scope.gpuBegin) / 1000.0,
+					frame.frameNumber);
+				file << event;
+			}
+		}
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	std::cout << "INFO: Profiler trace written to " << filename << std::endl;
+
+	return(true);
+}
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// nested CPU and GPU timing scopes recorded for every frame, kept in a ring
+// of recent frames for the on-screen summary and for trace exports
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class records named scopes that can be nested
+ *  inside each other. The CPU time of a scope comes from a
+ *  steady clock, and the GPU time from timestamp queries
+ *  written into two sets that are used in turn, so the
+ *  results of a frame are only read two frames later and
+ *  the CPU never waits on them.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler();
+	// destructor
+	~FrameProfiler();
+
+	// turn the recording on or off
+	void SetEnabled(bool bEnabled) { m_bEnabled = bEnabled; }
+	bool IsEnabled() const { return(m_bEnabled); }
+
+	// create and free the timestamp queries
+	void CreateQueries();
+	void DestroyQueries();
+
+	// start and finish recording a frame
+	void BeginFrame();
+	void EndFrame();
+	// start and finish a named scope inside the frame; the
+	// name must stay valid for as long as the frame is kept
+	void PushScope(const char* name);
+	void PopScope();
+
+	// one line per scope, averaged over the recent frames
+	void GetSummaryLines(std::vector<std::string>& lines) const;
+	// write the recorded frames as Chrome trace events
+	bool WriteChromeTrace(const std::string& filename) const;
+
+private:
+	// one recorded scope
+	struct SCOPE_RECORD
+	{
+		const char* name;
+		int depth;
+		double cpuBegin;
+		double cpuEnd;
+		int gpuBeginQuery;
+		int gpuEndQuery;
+		GLuint64 gpuBegin;
+		GLuint64 gpuEnd;
+	};
+
+	// one recorded frame
+	struct FRAME_RECORD
+	{
+		long long frameNumber;
+		bool bComplete;
+		bool bGpuValid;
+		std::vector<SCOPE_RECORD> scopes;
+	};
+
+	// whether scopes are recorded at all
+	bool m_bEnabled;
+	// whether the driver provides timestamp queries
+	bool m_bTimestamps;
+	// ring of recent frames, and the one being recorded
+	std::vector<FRAME_RECORD> m_frames;
+	int m_currentFrame;
+	long long m_frameNumber;
+	// scopes that are open in the current frame
+	std::vector<int> m_scopeStack;
+	// the two query sets, how many queries of each are in use,
+	// and the frame whose results each one holds
+	std::vector<GLuint> m_queries[2];
+	int m_queriesUsed[2];
+	int m_querySetFrames[2];
+	// time all the CPU times are measured from
+	std::chrono::steady_clock::time_point m_startTime;
+
+	// milliseconds since the profiler was created
+	double NowMilliseconds() const;
+	// write a timestamp query and return its index in the set
+	int WriteTimestamp(int querySet);
+	// read back the timestamps of the frame that used a set
+	void ResolveQuerySet(int querySet);
+};
+
+/***********************************************************
+ *  ScopedProfile
+ *
+ *  This class opens a profiler scope when it is created
+ *  and closes it when it goes out of scope. A NULL
+ *  profiler is allowed and records nothing.
+ ***********************************************************/
+class ScopedProfile
+{
+public:
+	ScopedProfile(FrameProfiler* pProfiler, const char* name)
+	{
+		m_pProfiler = pProfiler;
+		if (NULL != m_pProfiler)
+		{
+			m_pProfiler->PushScope(name);
+		}
+	}
+	~ScopedProfile()
+	{
+		if (NULL != m_pProfiler)
+		{
+			m_pProfiler->PopScope();
+		}
+	}
+
+private:
+	FrameProfiler* m_pProfiler;
+};
@@ -0,0 +1,230 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.cpp
+// ============
+// extract the view frustum planes from the camera matrices and test the
+// world bounds of the scene objects against them
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Frustum.h"
+
+#include <cmath>
+
+// the batched test needs at least SSE, which every x64 target has
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+/***********************************************************
+ *  Frustum()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Frustum::Frustum()
+{
+	// until planes are extracted nothing gets culled
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		m_planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+/***********************************************************
+ *  ~Frustum()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+Frustum::~Frustum()
+{
+}
+
+/***********************************************************
+ *  ExtractPlanes()
+ *
+ *  This method is used for deriving the six frustum planes
+ *  from the rows of the combined projection and view
+ *  matrix. Each plane is normalized so that its distance
+ *  can be compared against a bounding radius.
+ ***********************************************************/
+void Frustum::ExtractPlanes(const glm::mat4& viewProjection)
+{
+	// glm matrices are column major, so gather the rows
+	glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	m_planes[PLANE_LEFT] = row3 + row0;
+	m_planes[PLANE_RIGHT] = row3 - row0;
+	m_planes[PLANE_BOTTOM] = row3 + row1;
+	m_planes[PLANE_TOP] = row3 - row1;
+	m_planes[PLANE_NEAR] = row3 + row2;
+	m_planes[PLANE_FAR] = row3 - row2;
+
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		float length = glm::length(glm::vec3(m_planes[i]));
+		if (length > 0.0f)
+		{
+			m_planes[i] /= length;
+		}
+	}
+}
+
+/***********************************************************
+ *  TestBounds()
+ *
+ *  This method is used for testing a bounding box and the
+ *  bounding sphere around its center against the frustum.
+ *  Both are conservative, so the object is outside when
+ *  either one lies fully behind any of the planes.
+ ***********************************************************/
+bool Frustum::TestBounds(
+	const glm::vec3& center,
+	const glm::vec3& extents,
+	float radius) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		const glm::vec4& plane = m_planes[i];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float boxRadius =
+			fabsf(plane.x) * extents.x +
+			fabsf(plane.y) * extents.y +
+			fabsf(plane.z) * extents.z;
+
+		if (distance < -fminf(boxRadius, radius))
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ClassifyBox()
+ *
+ *  This method is used for finding whether a box is fully
+ *  outside, fully inside, or crossing the frustum. A box
+ *  that is fully inside needs none of its contents tested.
+ ***********************************************************/
+Frustum::CONTAINMENT Frustum::ClassifyBox(
+	const glm::vec3& minimumXYZ,
+	const glm::vec3& maximumXYZ) const
+{
+	glm::vec3 center = (minimumXYZ + maximumXYZ) * 0.5f;
+	glm::vec3 extents = (maximumXYZ - minimumXYZ) * 0.5f;
+	CONTAINMENT containment = INSIDE;
+
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		const glm::vec4& plane = m_planes[i];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float boxRadius =
+			fabsf(plane.x) * extents.x +
+			fabsf(plane.y) * extents.y +
+			fabsf(plane.z) * extents.z;
+
+		if (distance < -boxRadius)
+		{
+			return(OUTSIDE);
+		}
+		if (distance < boxRadius)
+		{
+			containment = INTERSECTING;
+		}
+	}
+
+	return(containment);
+}
+
+/***********************************************************
+ *  CullBounds()
+ *
+ *  This method is used for testing the world bounds of all
+ *  the scene nodes.
+ ***********************************************************/
+int Frustum::CullBounds(
+	const SceneGraph::WORLD_BOUNDS& bounds,
+	std::vector<unsigned char>& visible) const
+{
+	int count = (int)bounds.radius.size();
+
+	visible.resize(count);
+	return(CullBoundsRange(bounds, 0, count, visible));
+}
+
+/***********************************************************
+ *  CullBoundsRange()
+ *
+ *  This method is used for testing the world bounds of a
+ *  range of the scene nodes, so the nodes can be split over
+ *  threads. With SSE the nodes are tested in groups of four
+ *  straight from the structure-of-arrays bounds, and the
+ *  remaining nodes go through TestBounds().
+ ***********************************************************/
+int Frustum::CullBoundsRange(
+	const SceneGraph::WORLD_BOUNDS& bounds,
+	int first,
+	int last,
+	std::vector<unsigned char>& visible) const
+{
+	int visibleCount = 0;
+	int i = first;
+
+#ifdef FRUSTUM_USE_SSE
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	for (; i + 4 <= last; i += 4)
+	{
+		__m128 centerX = _mm_loadu_ps(&bounds.centerX[i]);
+		__m128 centerY = _mm_loadu_ps(&bounds.centerY[i]);
+		__m128 centerZ = _mm_loadu_ps(&bounds.centerZ[i]);
+		__m128 extentX = _mm_loadu_ps(&bounds.extentX[i]);
+		__m128 extentY = _mm_loadu_ps(&bounds.extentY[i]);
+		__m128 extentZ = _mm_loadu_ps(&bounds.extentZ[i]);
+		__m128 radius = _mm_loadu_ps(&bounds.radius[i]);
+		__m128 outside = _mm_setzero_ps();
+
+		for (int p = 0; p < PLANE_COUNT; p++)
+		{
+			__m128 planeX = _mm_set1_ps(m_planes[p].x);
+			__m128 planeY = _mm_set1_ps(m_planes[p].y);
+			__m128 planeZ = _mm_set1_ps(m_planes[p].z);
+			__m128 planeW = _mm_set1_ps(m_planes[p].w);
+
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeX, centerX), _mm_mul_ps(planeY, centerY)),
+				_mm_add_ps(_mm_mul_ps(planeZ, centerZ), planeW));
+			__m128 boxRadius = _mm_add_ps(
+				_mm_add_ps(
+					_mm_mul_ps(_mm_andnot_ps(signMask, planeX), extentX),
+					_mm_mul_ps(_mm_andnot_ps(signMask, planeY), extentY)),
+				_mm_mul_ps(_mm_andnot_ps(signMask, planeZ), extentZ));
+			__m128 limit = _mm_xor_ps(_mm_min_ps(boxRadius, radius), signMask);
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, limit));
+		}
+
+		int outsideMask = _mm_movemask_ps(outside);
+		for (int k = 0; k < 4; k++)
+		{
+			visible[i + k] = ((outsideMask >> k) & 1) ? 0 : 1;
+			visibleCount += visible[i + k];
+		}
+	}
+#endif
+
+	// the nodes that do not fill a whole group
+	for (; i < last; i++)
+	{
+		visible[i] = TestBounds(
+			glm::vec3(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]),
+			glm::vec3(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]),
+			bounds.radius[i]) ? 1 : 0;
+		visibleCount += visible[i];
+	}
+
+	return(visibleCount);
+}
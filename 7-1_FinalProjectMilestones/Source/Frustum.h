@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.h
+// ============
+// extract the view frustum planes from the camera matrices and test the
+// world bounds of the scene objects against them
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneGraph.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  Frustum
+ *
+ *  This class holds the six planes of the view frustum,
+ *  taken straight from the combined projection and view
+ *  matrix, so it works for both the perspective and the
+ *  orthographic projection. Objects are tested with their
+ *  world bounding sphere and box, four at a time when SSE
+ *  is available.
+ ***********************************************************/
+class Frustum
+{
+public:
+	// constructor
+	Frustum();
+	// destructor
+	~Frustum();
+
+	// the planes of the frustum, with normals pointing inwards
+	enum PLANE_ID
+	{
+		PLANE_LEFT = 0,
+		PLANE_RIGHT,
+		PLANE_BOTTOM,
+		PLANE_TOP,
+		PLANE_NEAR,
+		PLANE_FAR,
+		PLANE_COUNT
+	};
+
+	// where a box lies relative to the frustum
+	enum CONTAINMENT
+	{
+		OUTSIDE = 0,
+		INTERSECTING,
+		INSIDE
+	};
+
+	// extract the planes from a projection * view matrix
+	void ExtractPlanes(const glm::mat4& viewProjection);
+
+	// test one set of bounds, true when it may be visible
+	bool TestBounds(
+		const glm::vec3& center,
+		const glm::vec3& extents,
+		float radius) const;
+	// classify an axis aligned box against the frustum
+	CONTAINMENT ClassifyBox(
+		const glm::vec3& minimumXYZ,
+		const glm::vec3& maximumXYZ) const;
+	// test the world bounds of every scene node, writing one
+	// visible flag per node, and return the visible count
+	int CullBounds(
+		const SceneGraph::WORLD_BOUNDS& bounds,
+		std::vector<unsigned char>& visible) const;
+	// test the world bounds of a range of the scene nodes into a
+	// flag array already sized for every node
+	int CullBoundsRange(
+		const SceneGraph::WORLD_BOUNDS& bounds,
+		int first,
+		int last,
+		std::vector<unsigned char>& visible) const;
+
+	// accessor for one of the planes
+	const glm::vec4& GetPlane(int plane) const { return(m_planes[plane]); }
+
+private:
+	// plane normals in xyz and distances in w
+	glm::vec4 m_planes[PLANE_COUNT];
+};
@@ -0,0 +1,353 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// run the per-frame work of the scene over a pool of threads, each with its
+// own queue of jobs that the idle threads steal from
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// times an idle worker looks for a job again before it
+	// sleeps, since the jobs of a frame come in quick bursts
+	const int IDLE_SPIN_COUNT = 64;
+
+	// the pool the calling thread belongs to and its index there
+	thread_local const JobSystem* t_pJobSystem = nullptr;
+	thread_local int t_threadIndex = 0;
+	// jobs the calling thread is inside of, since a job that
+	// waits runs other jobs within its own time
+	thread_local int t_jobDepth = 0;
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem()
+{
+	m_threadCount = 1;
+	m_queuedCount = 0;
+	m_bStopping = false;
+	ResetStats();
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the worker threads.
+ *  The calling thread becomes thread zero of the pool, and
+ *  is the only one besides the workers that may dispatch.
+ ***********************************************************/
+void JobSystem::Start(int threadCount)
+{
+	Shutdown();
+
+	m_threadCount = std::max(1, std::min(threadCount, (int)MAX_THREADS));
+	t_pJobSystem = this;
+	t_threadIndex = 0;
+
+	for (int i = 1; i < m_threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+	ResetStats();
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for stopping the worker threads. It
+ *  must not be called while jobs are still queued.
+ ***********************************************************/
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bStopping = true;
+	}
+	m_jobReady.notify_all();
+	for (int i = 0; i < (int)m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	m_threadCount = 1;
+	m_bStopping = false;
+}
+
+/***********************************************************
+ *  Dispatch()
+ *
+ *  This method is used for splitting a range of items into
+ *  jobs and queueing them at the back of the queue of the
+ *  calling thread, waking the sleeping workers to steal
+ *  them.
+ ***********************************************************/
+void JobSystem::Dispatch(int count, int grainSize, const RANGE_FUNCTION& function, JOB_GROUP& group)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	grainSize = std::max(1, grainSize);
+	int jobCount = (count + grainSize - 1) / grainSize;
+	group.pendingCount.fetch_add(jobCount);
+
+	THREAD_QUEUE& queue = m_threads[GetCurrentThread()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		for (int first = 0; first < count; first += grainSize)
+		{
+			JOB job;
+			job.pFunction = &function;
+			job.first = first;
+			job.last = std::min(first + grainSize, count);
+			job.pGroup = &group;
+			queue.jobs.push_back(job);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_queuedCount.fetch_add(jobCount);
+	}
+	m_jobReady.notify_all();
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method is used for running queued jobs on the
+ *  calling thread until every job of the group is done.
+ *  The thread starts with its own jobs and steals when it
+ *  has none left, so it helps with the group and with any
+ *  jobs the group dispatched in turn.
+ ***********************************************************/
+void JobSystem::Wait(JOB_GROUP& group)
+{
+	int thread = GetCurrentThread();
+
+	while (group.pendingCount.load(std::memory_order_acquire) > 0)
+	{
+		JOB job;
+		if (FindJob(thread, job) == true)
+		{
+			RunJob(thread, job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a range of items over
+ *  the pool and returning once all of it is done.
+ ***********************************************************/
+void JobSystem::ParallelFor(int count, int grainSize, const RANGE_FUNCTION& function)
+{
+	JOB_GROUP group;
+	Dispatch(count, grainSize, function, group);
+	Wait(group);
+}
+
+/***********************************************************
+ *  ForEachRange()
+ *
+ *  This method is used for running a range of items over a
+ *  pool when there is one. A range that fits in a single
+ *  job is run straight away on the calling thread, so the
+ *  small scenes pay nothing for the pool.
+ ***********************************************************/
+void JobSystem::ForEachRange(
+	JobSystem* pJobSystem,
+	int count,
+	int grainSize,
+	const RANGE_FUNCTION& function)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if ((NULL == pJobSystem) || (count <= grainSize))
+	{
+		function(0, count);
+		return;
+	}
+
+	pJobSystem->ParallelFor(count, grainSize, function);
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for clearing the time and job counts
+ *  of every thread. It must not be called while jobs run.
+ ***********************************************************/
+void JobSystem::ResetStats()
+{
+	for (int i = 0; i < MAX_THREADS; i++)
+	{
+		m_threads[i].stats.busySeconds = 0.0;
+		m_threads[i].stats.jobCount = 0;
+		m_threads[i].stats.stealCount = 0;
+	}
+	m_statsStart = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  GetStatsSeconds()
+ *
+ *  This method is used for getting the time since the
+ *  thread stats were reset, which the busy time of each
+ *  thread is a share of.
+ ***********************************************************/
+double JobSystem::GetStatsSeconds() const
+{
+	return(std::chrono::duration<double>(std::chrono::steady_clock::now() - m_statsStart).count());
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by each worker thread, running jobs
+ *  while there are any and sleeping while every queue is
+ *  empty.
+ ***********************************************************/
+void JobSystem::WorkerLoop(int thread)
+{
+	t_pJobSystem = this;
+	t_threadIndex = thread;
+
+	while (true)
+	{
+		JOB job;
+		bool bFound = false;
+		for (int spin = 0; (spin < IDLE_SPIN_COUNT) && (bFound == false); spin++)
+		{
+			bFound = FindJob(thread, job);
+			if (bFound == false)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		if (bFound == true)
+		{
+			RunJob(thread, job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_jobReady.wait(lock, [this]() { return(m_bStopping || (m_queuedCount.load() > 0)); });
+		if (m_bStopping == true)
+		{
+			return;
+		}
+	}
+}
+
+/***********************************************************
+ *  FindJob()
+ *
+ *  This method is used for taking the next job of a thread.
+ *  The newest job of its own queue comes first, and when
+ *  that is empty the oldest job of the next queue holding
+ *  any is stolen, which is the largest part of the work
+ *  left there.
+ ***********************************************************/
+bool JobSystem::FindJob(int thread, JOB& job)
+{
+	{
+		THREAD_QUEUE& queue = m_threads[thread];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			m_queuedCount.fetch_sub(1);
+			return(true);
+		}
+	}
+
+	for (int i = 1; i < m_threadCount; i++)
+	{
+		THREAD_QUEUE& victim = m_threads[(thread + i) % m_threadCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			m_queuedCount.fetch_sub(1);
+			m_threads[thread].stats.stealCount++;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  RunJob()
+ *
+ *  This method is used for running a job and adding its
+ *  time to the thread that ran it. Only the outermost job
+ *  of a thread is timed, so the jobs run while another
+ *  waits are not counted twice. The group is marked last,
+ *  so a waiting thread sees the results of the job.
+ ***********************************************************/
+void JobSystem::RunJob(int thread, const JOB& job)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	t_jobDepth++;
+	(*job.pFunction)(job.first, job.last);
+	t_jobDepth--;
+
+	THREAD_STATS& stats = m_threads[thread].stats;
+	if (t_jobDepth == 0)
+	{
+		stats.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	stats.jobCount++;
+
+	job.pGroup->pendingCount.fetch_sub(1, std::memory_order_release);
+}
+
+/***********************************************************
+ *  GetCurrentThread()
+ *
+ *  This method is used for finding the index of the calling
+ *  thread in the pool. A thread outside the pool is taken
+ *  to be the starting thread.
+ ***********************************************************/
+int JobSystem::GetCurrentThread() const
+{
+	if (t_pJobSystem == this)
+	{
+		return(t_threadIndex);
+	}
+
+	return(0);
+}
@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// run the per-frame work of the scene over a pool of threads, each with its
+// own queue of jobs that the idle threads steal from
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs jobs over a range of items on a pool of
+ *  threads. The thread that starts the pool is thread zero
+ *  and the others are workers. Every thread has its own
+ *  queue; a thread adds the jobs it dispatches to the back
+ *  of its queue and takes its next job from there too, so
+ *  it keeps working on the data it just touched, while an
+ *  idle thread steals the oldest job from the front of
+ *  another queue. A thread waiting on its jobs runs queued
+ *  jobs until they are done instead of blocking, so jobs
+ *  may dispatch and wait on jobs of their own. The time
+ *  every thread spends running jobs is kept for reporting
+ *  how well the work spreads over the threads.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor
+	JobSystem();
+	// destructor
+	~JobSystem();
+
+	// most threads the pool can run, the starting thread included
+	static const int MAX_THREADS = 32;
+
+	// the work of a job, called with the first item and one past
+	// the last item of its part of the range
+	typedef std::function<void(int first, int last)> RANGE_FUNCTION;
+
+	// the jobs of one dispatch, which are waited on together
+	struct JOB_GROUP
+	{
+		std::atomic<int> pendingCount;
+
+		JOB_GROUP() : pendingCount(0) {}
+	};
+
+	// how one thread spent its time since the stats were reset
+	struct THREAD_STATS
+	{
+		double busySeconds;
+		long long jobCount;
+		long long stealCount;
+	};
+
+	// start the worker threads, so the calling thread and the
+	// workers make the given number of threads in all
+	void Start(int threadCount);
+	// stop the worker threads once they are idle
+	void Shutdown();
+	// number of threads running jobs, the starting thread included
+	int GetThreadCount() const { return(m_threadCount); }
+
+	// split a range into jobs of a number of items each and queue
+	// them on the calling thread; the function must stay valid
+	// until the group is waited on
+	void Dispatch(int count, int grainSize, const RANGE_FUNCTION& function, JOB_GROUP& group);
+	// run queued jobs on the calling thread until the group is done
+	void Wait(JOB_GROUP& group);
+	// dispatch a range and wait for it
+	void ParallelFor(int count, int grainSize, const RANGE_FUNCTION& function);
+	// run a range over the pool, or on the calling thread when
+	// there is no pool or the range fits in a single job
+	static void ForEachRange(
+		JobSystem* pJobSystem,
+		int count,
+		int grainSize,
+		const RANGE_FUNCTION& function);
+
+	// start measuring the thread stats again
+	void ResetStats();
+	// the stats of one thread, and the time they were measured over
+	THREAD_STATS GetThreadStats(int thread) const { return(m_threads[thread].stats); }
+	double GetStatsSeconds() const;
+
+private:
+	// one part of a dispatched range
+	struct JOB
+	{
+		const RANGE_FUNCTION* pFunction;
+		int first;
+		int last;
+		JOB_GROUP* pGroup;
+	};
+
+	// the queue and stats of one thread, padded so the stats the
+	// threads write do not share a cache line
+	struct THREAD_QUEUE
+	{
+		std::mutex mutex;
+		std::deque<JOB> jobs;
+		THREAD_STATS stats;
+		char padding[64];
+	};
+
+	THREAD_QUEUE m_threads[MAX_THREADS];
+	int m_threadCount;
+	std::vector<std::thread> m_workers;
+
+	// the workers sleep here while every queue is empty
+	std::mutex m_sleepMutex;
+	std::condition_variable m_jobReady;
+	std::atomic<int> m_queuedCount;
+	bool m_bStopping;
+
+	// time the thread stats were last reset
+	std::chrono::steady_clock::time_point m_statsStart;
+
+	// run jobs until the pool stops
+	void WorkerLoop(int thread);
+	// take a job from the back of the own queue, or else steal
+	// one from the front of another
+	bool FindJob(int thread, JOB& job);
+	// run a job and count it against the thread and its group
+	void RunJob(int thread, const JOB& job);
+	// index of the calling thread in the pool
+	int GetCurrentThread() const;
+};
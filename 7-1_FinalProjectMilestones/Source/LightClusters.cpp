@@ -0,0 +1,512 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.cpp
+// ============
+// split the view frustum into a grid of clusters and hand the fragment
+// shader the list of local lights reaching each cluster
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// the batched test needs at least SSE, which every x64 target has
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define CLUSTERS_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// the clusters of a row are tested four at a time
+	static_assert(CLUSTER_COLUMNS % 4 == 0, "the cluster columns must come in groups of four");
+
+	// lights assigned by one job, which fills a few hundred
+	// clusters each
+	const int LIGHT_JOB_LIGHTS = 64;
+
+	/***********************************************************
+	 *  Unproject()
+	 *
+	 *  Returns the view space position of a point given in
+	 *  normalized device coordinates.
+	 ***********************************************************/
+	glm::vec3 Unproject(const glm::mat4& inverseProjection, float x, float y, float z)
+	{
+		glm::vec4 position = inverseProjection * glm::vec4(x, y, z, 1.0f);
+		return(glm::vec3(position) / position.w);
+	}
+}
+
+/***********************************************************
+ *  LightClusters()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightClusters::LightClusters()
+{
+	m_lightBuffer = 0;
+	m_lightTexture = 0;
+	m_clusterBuffer = 0;
+	m_clusterTexture = 0;
+	m_listBuffer = 0;
+	m_listTexture = 0;
+	m_bUseRing = false;
+	m_textureAlignment = 1;
+	m_boundsProjection = glm::mat4(0.0f);
+	m_nearDepth = 0.0f;
+	m_farDepth = 0.0f;
+	m_tileScale = glm::vec2(0.0f);
+	m_depthPlane = glm::vec4(0.0f);
+	m_sliceScale = glm::vec2(0.0f);
+	m_maxClusterLights = 0;
+}
+
+/***********************************************************
+ *  ~LightClusters()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightClusters::~LightClusters()
+{
+	DestroyBuffers();
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for creating the buffers of the
+ *  lights, the cluster ranges and the light lists, and the
+ *  buffer textures the fragment shader reads them through.
+ *  The textures stay bound to their own texture units. The
+ *  ring buffer the cluster lists go through is made room
+ *  for the cluster ranges and a few lights per cluster,
+ *  and grows when the lists need more.
+ ***********************************************************/
+void LightClusters::CreateBuffers(bool bAllowPersistent)
+{
+	GLuint* buffers[3] = { &m_lightBuffer, &m_clusterBuffer, &m_listBuffer };
+	GLuint* textures[3] = { &m_lightTexture, &m_clusterTexture, &m_listTexture };
+	const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	const unsigned int units[3] = { LOCAL_LIGHT_TEXTURE_UNIT, LIGHT_CLUSTER_TEXTURE_UNIT, CLUSTER_LIST_TEXTURE_UNIT };
+
+	for (int i = 0; i < 3; i++)
+	{
+		glGenBuffers(1, buffers[i]);
+		glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(LOCAL_LIGHT), NULL, GL_DYNAMIC_DRAW);
+
+		glGenTextures(1, textures[i]);
+		glActiveTexture(GL_TEXTURE0 + units[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, *textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], *buffers[i]);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_bUseRing = (GLEW_ARB_texture_buffer_range == GL_TRUE);
+	if (m_bUseRing == true)
+	{
+		GLint alignment = 1;
+		glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		m_textureAlignment = (size_t)std::max(alignment, 1);
+		m_listRing.Create(GL_TEXTURE_BUFFER, TOTAL_CLUSTERS * 4 * sizeof(GLuint), bAllowPersistent);
+	}
+}
+
+/***********************************************************
+ *  FenceLists()
+ *
+ *  This method is used for placing a fence behind the draws
+ *  of a frame, which read the cluster lists of the current
+ *  region of the ring buffer.
+ ***********************************************************/
+void LightClusters::FenceLists()
+{
+	if (m_bUseRing == true)
+	{
+		m_listRing.FenceRegion(m_listRing.GetCurrentRegion());
+	}
+}
+
+/***********************************************************
+ *  DestroyBuffers()
+ *
+ *  This method is used for freeing the buffers and their
+ *  buffer textures.
+ ***********************************************************/
+void LightClusters::DestroyBuffers()
+{
+	GLuint* buffers[3] = { &m_lightBuffer, &m_clusterBuffer, &m_listBuffer };
+	GLuint* textures[3] = { &m_lightTexture, &m_clusterTexture, &m_listTexture };
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (*textures[i] != 0)
+		{
+			glDeleteTextures(1, textures[i]);
+			*textures[i] = 0;
+		}
+		if (*buffers[i] != 0)
+		{
+			glDeleteBuffers(1, buffers[i]);
+			*buffers[i] = 0;
+		}
+	}
+	m_listRing.Destroy();
+	m_bUseRing = false;
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for replacing the local lights and
+ *  sending them to the light buffer. The cluster lists are
+ *  made for them on the next update.
+ ***********************************************************/
+void LightClusters::SetLights(const LOCAL_LIGHT* lights, int count)
+{
+	m_lights.assign(lights, lights + count);
+	if (m_lights.empty())
+	{
+		return;
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, m_lightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, m_lights.size() * sizeof(LOCAL_LIGHT), &m_lights[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BuildClusterBounds()
+ *
+ *  This method is used for working out the view space box
+ *  around every cluster of a projection. The corners of
+ *  the screen tiles are taken back through the projection
+ *  onto the near and far planes, and the edges between
+ *  them are cut at the depths the slices start and end at,
+ *  so both the perspective and the orthographic projection
+ *  are covered. The slices grow by the same factor one
+ *  after another, keeping the clusters close to cubes.
+ ***********************************************************/
+void LightClusters::BuildClusterBounds(const glm::mat4& projection)
+{
+	glm::mat4 inverseProjection = glm::inverse(projection);
+	m_boundsProjection = projection;
+	m_nearDepth = -Unproject(inverseProjection, 0.0f, 0.0f, -1.0f).z;
+	m_farDepth = -Unproject(inverseProjection, 0.0f, 0.0f, 1.0f).z;
+
+	float depthRatio = std::log(m_farDepth / m_nearDepth);
+	m_sliceScale.x = CLUSTER_SLICES / depthRatio;
+	m_sliceScale.y = -CLUSTER_SLICES * std::log(m_nearDepth) / depthRatio;
+
+	float sliceDepths[CLUSTER_SLICES + 1];
+	for (int slice = 0; slice <= CLUSTER_SLICES; slice++)
+	{
+		sliceDepths[slice] = m_nearDepth * std::pow(m_farDepth / m_nearDepth, (float)slice / CLUSTER_SLICES);
+	}
+
+	// the tile corners on the near and far planes
+	glm::vec3 nearCorners[CLUSTER_ROWS + 1][CLUSTER_COLUMNS + 1];
+	glm::vec3 farCorners[CLUSTER_ROWS + 1][CLUSTER_COLUMNS + 1];
+	for (int row = 0; row <= CLUSTER_ROWS; row++)
+	{
+		for (int column = 0; column <= CLUSTER_COLUMNS; column++)
+		{
+			float x = -1.0f + 2.0f * column / CLUSTER_COLUMNS;
+			float y = -1.0f + 2.0f * row / CLUSTER_ROWS;
+			nearCorners[row][column] = Unproject(inverseProjection, x, y, -1.0f);
+			farCorners[row][column] = Unproject(inverseProjection, x, y, 1.0f);
+		}
+	}
+
+	m_minX.resize(TOTAL_CLUSTERS);
+	m_maxX.resize(TOTAL_CLUSTERS);
+	m_minY.resize(TOTAL_CLUSTERS);
+	m_maxY.resize(TOTAL_CLUSTERS);
+	m_minDepth.resize(TOTAL_CLUSTERS);
+	m_maxDepth.resize(TOTAL_CLUSTERS);
+
+	for (int slice = 0; slice < CLUSTER_SLICES; slice++)
+	{
+		for (int row = 0; row < CLUSTER_ROWS; row++)
+		{
+			for (int column = 0; column < CLUSTER_COLUMNS; column++)
+			{
+				int cluster = (slice * CLUSTER_ROWS + row) * CLUSTER_COLUMNS + column;
+				glm::vec2 minimum(1e30f);
+				glm::vec2 maximum(-1e30f);
+
+				for (int corner = 0; corner < 4; corner++)
+				{
+					const glm::vec3& nearCorner = nearCorners[row + corner / 2][column + corner % 2];
+					const glm::vec3& farCorner = farCorners[row + corner / 2][column + corner % 2];
+					for (int end = 0; end < 2; end++)
+					{
+						float t = (sliceDepths[slice + end] + nearCorner.z) / (nearCorner.z - farCorner.z);
+						glm::vec3 position = nearCorner + t * (farCorner - nearCorner);
+						minimum = glm::min(minimum, glm::vec2(position.x, position.y));
+						maximum = glm::max(maximum, glm::vec2(position.x, position.y));
+					}
+				}
+
+				m_minX[cluster] = minimum.x;
+				m_maxX[cluster] = maximum.x;
+				m_minY[cluster] = minimum.y;
+				m_maxY[cluster] = maximum.y;
+				m_minDepth[cluster] = sliceDepths[slice];
+				m_maxDepth[cluster] = sliceDepths[slice + 1];
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GetSlice()
+ *
+ *  This method is used for getting the slice a view depth
+ *  falls into, the same way the fragment shader does.
+ ***********************************************************/
+int LightClusters::GetSlice(float depth) const
+{
+	int slice = (int)std::floor(std::log(std::max(depth, 0.0001f)) * m_sliceScale.x + m_sliceScale.y);
+	return(std::min(std::max(slice, 0), CLUSTER_SLICES - 1));
+}
+
+/***********************************************************
+ *  AssignRow()
+ *
+ *  This method is used for adding a light to every cluster
+ *  of a row whose box its sphere touches, into the entries
+ *  of the job assigning it. The center is in view space
+ *  with the depth in place of z. With SSE the distances to
+ *  four boxes are measured at once.
+ ***********************************************************/
+void LightClusters::AssignRow(
+	int firstCluster,
+	unsigned int light,
+	const glm::vec3& center,
+	float radius,
+	LIGHT_ENTRIES& entries) const
+{
+#ifdef CLUSTERS_USE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 centerX = _mm_set1_ps(center.x);
+	const __m128 centerY = _mm_set1_ps(center.y);
+	const __m128 centerZ = _mm_set1_ps(center.z);
+	const __m128 radiusSquared = _mm_set1_ps(radius * radius);
+
+	for (int column = 0; column < CLUSTER_COLUMNS; column += 4)
+	{
+		int cluster = firstCluster + column;
+		__m128 distanceX = _mm_max_ps(
+			_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minX[cluster]), centerX), _mm_sub_ps(centerX, _mm_loadu_ps(&m_maxX[cluster]))),
+			zero);
+		__m128 distanceY = _mm_max_ps(
+			_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minY[cluster]), centerY), _mm_sub_ps(centerY, _mm_loadu_ps(&m_maxY[cluster]))),
+			zero);
+		__m128 distanceZ = _mm_max_ps(
+			_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_minDepth[cluster]), centerZ), _mm_sub_ps(centerZ, _mm_loadu_ps(&m_maxDepth[cluster]))),
+			zero);
+		__m128 distanceSquared = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(distanceX, distanceX), _mm_mul_ps(distanceY, distanceY)),
+			_mm_mul_ps(distanceZ, distanceZ));
+
+		int touchedMask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, radiusSquared));
+		for (int j = 0; touchedMask != 0; j++, touchedMask >>= 1)
+		{
+			if ((touchedMask & 1) != 0)
+			{
+				entries.clusters.push_back((unsigned int)(cluster + j));
+				entries.lights.push_back(light);
+			}
+		}
+	}
+#else
+	for (int column = 0; column < CLUSTER_COLUMNS; column++)
+	{
+		int cluster = firstCluster + column;
+		float distanceX = std::max(std::max(m_minX[cluster] - center.x, center.x - m_maxX[cluster]), 0.0f);
+		float distanceY = std::max(std::max(m_minY[cluster] - center.y, center.y - m_maxY[cluster]), 0.0f);
+		float distanceZ = std::max(std::max(m_minDepth[cluster] - center.z, center.z - m_maxDepth[cluster]), 0.0f);
+		if (distanceX * distanceX + distanceY * distanceY + distanceZ * distanceZ <= radius * radius)
+		{
+			entries.clusters.push_back((unsigned int)cluster);
+			entries.lights.push_back(light);
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for making the light list of every
+ *  cluster for a view. Each light is only tested against
+ *  the slices its depth range covers, and only against the
+ *  rows its height reaches, as the height range of a row is
+ *  the same in every column. Runs of the lights are tested
+ *  on the threads, each into entries of its own, which are
+ *  joined in the order of the lights, so the lists are the
+ *  same however many threads there are. The entries are
+ *  then sorted by cluster, keeping the lights of each list
+ *  in order, and the ranges and lists are sent to their
+ *  buffers.
+ ***********************************************************/
+void LightClusters::Update(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	int width,
+	int height,
+	JobSystem* pJobSystem)
+{
+	if ((m_lights.empty()) || (width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	if ((m_minX.empty()) || (projection != m_boundsProjection))
+	{
+		BuildClusterBounds(projection);
+	}
+	m_tileScale = glm::vec2((float)CLUSTER_COLUMNS / width, (float)CLUSTER_ROWS / height);
+	// the view depth is the distance along the view direction
+	m_depthPlane = glm::vec4(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+
+	int lightCount = (int)m_lights.size();
+	m_jobEntries.resize((lightCount + LIGHT_JOB_LIGHTS - 1) / LIGHT_JOB_LIGHTS);
+	for (int job = 0; job < (int)m_jobEntries.size(); job++)
+	{
+		m_jobEntries[job].clusters.clear();
+		m_jobEntries[job].lights.clear();
+	}
+
+	JobSystem::ForEachRange(pJobSystem, lightCount, LIGHT_JOB_LIGHTS,
+		[this, &view](int first, int last)
+		{
+			// every job starts at a whole run of lights, and a range
+			// run on the calling thread all goes into the first one
+			LIGHT_ENTRIES& entries = m_jobEntries[first / LIGHT_JOB_LIGHTS];
+			for (int i = first; i < last; i++)
+			{
+				const LOCAL_LIGHT& light = m_lights[i];
+				glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+				center.z = -center.z;
+				if ((center.z + light.radius < m_nearDepth) || (center.z - light.radius > m_farDepth))
+				{
+					continue;
+				}
+
+				int firstSlice = GetSlice(std::max(center.z - light.radius, m_nearDepth));
+				int lastSlice = GetSlice(std::min(center.z + light.radius, m_farDepth));
+				for (int slice = firstSlice; slice <= lastSlice; slice++)
+				{
+					for (int row = 0; row < CLUSTER_ROWS; row++)
+					{
+						int firstCluster = (slice * CLUSTER_ROWS + row) * CLUSTER_COLUMNS;
+						if ((center.y + light.radius >= m_minY[firstCluster]) &&
+							(center.y - light.radius <= m_maxY[firstCluster]))
+						{
+							AssignRow(firstCluster, (unsigned int)i, center, light.radius, entries);
+						}
+					}
+				}
+			}
+		});
+
+	// join the entries of the jobs in the order of their lights
+	m_entryClusters.clear();
+	m_entryLights.clear();
+	for (int job = 0; job < (int)m_jobEntries.size(); job++)
+	{
+		const LIGHT_ENTRIES& entries = m_jobEntries[job];
+		m_entryClusters.insert(m_entryClusters.end(), entries.clusters.begin(), entries.clusters.end());
+		m_entryLights.insert(m_entryLights.end(), entries.lights.begin(), entries.lights.end());
+	}
+
+	// count the entries of every cluster, then turn the counts
+	// into offsets and place the entries behind them
+	m_clusterRanges.assign(TOTAL_CLUSTERS * 2, 0);
+	for (int i = 0; i < (int)m_entryClusters.size(); i++)
+	{
+		m_clusterRanges[m_entryClusters[i] * 2 + 1]++;
+	}
+	GLuint offset = 0;
+	m_maxClusterLights = 0;
+	for (int cluster = 0; cluster < TOTAL_CLUSTERS; cluster++)
+	{
+		GLuint count = m_clusterRanges[cluster * 2 + 1];
+		m_clusterRanges[cluster * 2] = offset;
+		m_clusterRanges[cluster * 2 + 1] = 0;
+		m_maxClusterLights = std::max(m_maxClusterLights, (int)count);
+		offset += count;
+	}
+	m_listEntries.resize(m_entryClusters.size());
+	for (int i = 0; i < (int)m_entryClusters.size(); i++)
+	{
+		GLuint* range = &m_clusterRanges[m_entryClusters[i] * 2];
+		m_listEntries[range[0] + range[1]] = m_entryLights[i];
+		range[1]++;
+	}
+
+	if (m_bUseRing == true)
+	{
+		WriteListsToRing();
+		return;
+	}
+
+	// orphan the old storage so the driver does not have to
+	// wait for the previous frame's draws to finish with it
+	glBindBuffer(GL_TEXTURE_BUFFER, m_clusterBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, m_clusterRanges.size() * sizeof(GLuint), &m_clusterRanges[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_listBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max(m_listEntries.size(), (size_t)1) * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+	if (!m_listEntries.empty())
+	{
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, m_listEntries.size() * sizeof(GLuint), &m_listEntries[0]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  WriteListsToRing()
+ *
+ *  This method is used for writing the cluster ranges and
+ *  lists into the next region of the ring buffer and
+ *  pointing their buffer textures at them. The region was
+ *  last read a few frames ago, so nothing waits for the
+ *  GPU. They are copied in one go rather than placed there
+ *  entry by entry, since mapped memory is slow to write
+ *  out of order.
+ ***********************************************************/
+void LightClusters::WriteListsToRing()
+{
+	size_t rangeBytes = m_clusterRanges.size() * sizeof(GLuint);
+	size_t listBytes = std::max(m_listEntries.size(), (size_t)1) * sizeof(GLuint);
+	m_listRing.Reserve(rangeBytes + listBytes + 2 * m_textureAlignment);
+	m_listRing.BeginRegion();
+
+	GLintptr rangeOffset = 0;
+	GLintptr listOffset = 0;
+	void* pRanges = m_listRing.Allocate(rangeBytes, m_textureAlignment, rangeOffset);
+	void* pList = m_listRing.Allocate(listBytes, m_textureAlignment, listOffset);
+
+	memcpy(pRanges, &m_clusterRanges[0], rangeBytes);
+	if (!m_listEntries.empty())
+	{
+		memcpy(pList, &m_listEntries[0], m_listEntries.size() * sizeof(GLuint));
+	}
+	m_listRing.Flush(rangeOffset, rangeBytes);
+	m_listRing.Flush(listOffset, listBytes);
+
+	glActiveTexture(GL_TEXTURE0 + LIGHT_CLUSTER_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_clusterTexture);
+	glTexBufferRange(GL_TEXTURE_BUFFER, GL_RG32UI, m_listRing.GetBuffer(), rangeOffset, rangeBytes);
+	glActiveTexture(GL_TEXTURE0 + CLUSTER_LIST_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_listTexture);
+	glTexBufferRange(GL_TEXTURE_BUFFER, GL_R32UI, m_listRing.GetBuffer(), listOffset, listBytes);
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,147 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.h
+// ============
+// split the view frustum into a grid of clusters and hand the fragment
+// shader the list of local lights reaching each cluster
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderBlocks.h"
+#include "RingBuffer.h"
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LightClusters
+ *
+ *  This class holds the local lights of the scene, point
+ *  lights that only reach as far as their radius. The view
+ *  frustum is split into columns and rows of screen tiles
+ *  and into slices of view depth that grow with distance,
+ *  and every light is added to the list of each cluster
+ *  its sphere touches, testing four clusters at a time
+ *  when SSE is available, with runs of the lights spread
+ *  over the threads of a job system. The lights, the offset and count
+ *  of every cluster list and the lists themselves are sent
+ *  in buffer textures, so a fragment only shades the few
+ *  lights of its own cluster, however many the scene has.
+ *  The cluster lists change with every camera move, so
+ *  when buffer textures can read part of a buffer they are
+ *  written into a ring buffer instead of being uploaded.
+ ***********************************************************/
+class LightClusters
+{
+public:
+	// constructor
+	LightClusters();
+	// destructor
+	~LightClusters();
+
+	// create and free the buffer textures; the cluster lists are
+	// sent through a mapped ring buffer when that is allowed
+	void CreateBuffers(bool bAllowPersistent);
+	void DestroyBuffers();
+
+	// replace the local lights and send them to the light buffer
+	void SetLights(const LOCAL_LIGHT* lights, int count);
+	int GetLightCount() const { return((int)m_lights.size()); }
+
+	// assign the lights to the clusters of a view and send the
+	// cluster lists; the size is that of the rendered image, and
+	// the lights are spread over the threads of a job system if any
+	void Update(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		int width,
+		int height,
+		JobSystem* pJobSystem = NULL);
+	// fence the cluster lists behind the draws that read them
+	void FenceLists();
+
+	// the values the fragment shader finds its cluster with
+	const glm::vec2& GetTileScale() const { return(m_tileScale); }
+	const glm::vec4& GetDepthPlane() const { return(m_depthPlane); }
+	const glm::vec2& GetSliceScale() const { return(m_sliceScale); }
+
+	// light list entries of the last update, over all the
+	// clusters and in the fullest cluster
+	int GetListEntryCount() const { return((int)m_listEntries.size()); }
+	int GetMaxClusterLights() const { return(m_maxClusterLights); }
+	// the ring buffer the cluster lists are written into
+	const RingBuffer& GetListRing() const { return(m_listRing); }
+	void ResetRingStats() { m_listRing.ResetStats(); }
+
+private:
+	// the local lights, as they are sent to the light buffer
+	std::vector<LOCAL_LIGHT> m_lights;
+
+	// buffers and buffer textures of the lights, the cluster
+	// offsets and counts, and the light lists
+	GLuint m_lightBuffer;
+	GLuint m_lightTexture;
+	GLuint m_clusterBuffer;
+	GLuint m_clusterTexture;
+	GLuint m_listBuffer;
+	GLuint m_listTexture;
+	// the ring buffer the cluster ranges and lists are written
+	// into when the textures can read part of a buffer, and the
+	// alignment their offsets there must have
+	RingBuffer m_listRing;
+	bool m_bUseRing;
+	size_t m_textureAlignment;
+
+	// view space bounding boxes of the clusters for the
+	// projection they were made for, as parallel arrays
+	glm::mat4 m_boundsProjection;
+	std::vector<float> m_minX;
+	std::vector<float> m_maxX;
+	std::vector<float> m_minY;
+	std::vector<float> m_maxY;
+	std::vector<float> m_minDepth;
+	std::vector<float> m_maxDepth;
+	// view depth of the near and far planes
+	float m_nearDepth;
+	float m_farDepth;
+
+	// shader values of the last update
+	glm::vec2 m_tileScale;
+	glm::vec4 m_depthPlane;
+	glm::vec2 m_sliceScale;
+
+	// the cluster and light of the light list entries made by
+	// one job, for a run of the lights
+	struct LIGHT_ENTRIES
+	{
+		std::vector<unsigned int> clusters;
+		std::vector<unsigned int> lights;
+	};
+
+	// the entries of every job, in the order of their lights
+	std::vector<LIGHT_ENTRIES> m_jobEntries;
+	// the cluster and light of every light list entry, then
+	// the offset and count of every cluster and the lists
+	std::vector<unsigned int> m_entryClusters;
+	std::vector<unsigned int> m_entryLights;
+	std::vector<GLuint> m_clusterRanges;
+	std::vector<GLuint> m_listEntries;
+	int m_maxClusterLights;
+
+	// work out the bounding boxes of the clusters of a projection
+	void BuildClusterBounds(const glm::mat4& projection);
+	// the slice holding a view depth
+	int GetSlice(float depth) const;
+	// add a light to every cluster of a row its sphere touches
+	void AssignRow(
+		int firstCluster,
+		unsigned int light,
+		const glm::vec3& center,
+		float radius,
+		LIGHT_ENTRIES& entries) const;
+	// write the cluster ranges and lists into the ring buffer
+	void WriteListsToRing();
+};
@@ -1,186 +1,1173 @@
-///////////////////////////////////////////////////////////////////////////////
-// maincode.cpp
-// ============
-// gets called when application is launched - initializes GLEW, GLFW
-//
-//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
-//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
-///////////////////////////////////////////////////////////////////////////////
-
-#include <iostream>         // error handling and output
-#include <cstdlib>          // EXIT_FAILURE
-
-#include <GL/glew.h>        // GLEW library
-#include "GLFW/glfw3.h"     // GLFW library
-
-// GLM Math Header inclusions
-#include <glm/glm.hpp>
-#include <glm/gtx/transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-#include "SceneManager.h"
-#include "ViewManager.h"
-#include "ShapeMeshes.h"
-#include "ShaderManager.h"
-
-// Namespace for declaring global variables
-namespace
-{
-	// Macro for window title
-	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
-
-	// Main GLFW window
-	GLFWwindow* g_Window = nullptr;
-
-	// scene manager object for managing the 3D scene prepare and render
-	SceneManager* g_SceneManager = nullptr;
-	// shader manager object for dynamic interaction with the shader code
-	ShaderManager* g_ShaderManager = nullptr;
-	// view manager object for managing the 3D view setup and projection to 2D
-	ViewManager* g_ViewManager = nullptr;
-}
-
-// Function declarations - all functions that are called manually
-// need to be pre-declared at the beginning of the source code.
-bool InitializeGLFW();
-bool InitializeGLEW();
-
-
-/***********************************************************
- *  main(int, char*)
- *
- *  This function gets called after the application has been
- *  launched.
- ***********************************************************/
-int main(int argc, char* argv[])
-{
-	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
-	{
-		return(EXIT_FAILURE);
-	}
-
-	// try to create a new shader manager object
-	g_ShaderManager = new ShaderManager();
-	// try to create a new view manager object
-	g_ViewManager = new ViewManager(
-		g_ShaderManager);
-
-	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
-
-	// if GLEW fails initialization, then terminate the application
-	if (InitializeGLEW() == false)
-	{
-		return(EXIT_FAILURE);
-	}
-
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
-
-	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
-
-	// loop will keep running until the application is closed 
-	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
-	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
-
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
-
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
-
-
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
-
-		// query the latest GLFW events
-		glfwPollEvents();
-	}
-
-	// clear the allocated manager objects from memory
-	if (NULL != g_SceneManager)
-	{
-		delete g_SceneManager;
-		g_SceneManager = NULL;
-	}
-	if (NULL != g_ViewManager)
-	{
-		delete g_ViewManager;
-		g_ViewManager = NULL;
-	}
-	if (NULL != g_ShaderManager)
-	{
-		delete g_ShaderManager;
-		g_ShaderManager = NULL;
-	}
-
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
-}
-
-/***********************************************************
- *	InitializeGLFW()
- * 
- *  This function is used to initialize the GLFW library.   
- ***********************************************************/
-bool InitializeGLFW()
-{
-	// GLFW: initialize and configure library
-	// --------------------------------------
-	glfwInit();
-
-#ifdef __APPLE__
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#else
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#endif
-	// GLFW: end -------------------------------
-
-	return(true);
-}
-
-/***********************************************************
- *	InitializeGLEW()
- *
- *  This function is used to initialize the GLEW library.
- ***********************************************************/
-bool InitializeGLEW()
-{
-	// GLEW: initialize
-	// -----------------------------------------
-	GLenum GLEWInitResult = GLEW_OK;
-
-	// try to initialize the GLEW library
-	GLEWInitResult = glewInit();
-	if (GLEW_OK != GLEWInitResult)
-	{
-		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
-		return false;
-	}
-	// GLEW: end -------------------------------
-
-	// Displays a successful OpenGL initialization message
-	std::cout << "INFO: OpenGL Successfully Initialized\n";
-	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
-
-	return(true);
-}
\ No newline at end of file
+///////////////////////////////////////////////////////////////////////////////
+// maincode.cpp
+// ============
+// gets called when application is launched - initializes GLEW, GLFW
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>         // error handling and output
+#include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <cstdio>           // snprintf
+#include <chrono>           // frame timing
+#include <algorithm>        // std::min, std::max
+#include <string>
+#include <vector>
+#include <thread>           // hardware_concurrency
+
+#include <GL/glew.h>        // GLEW library
+#include "GLFW/glfw3.h"     // GLFW library
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "ShapeMeshes.h"
+#include "ShaderManager.h"
+#include "UniformCache.h"
+#include "ShaderProgramCache.h"
+#include "MicroBenchmarks.h"
+#include "OffscreenTarget.h"
+#include "CameraPath.h"
+#include "FrameBenchmark.h"
+#include "FrameProfiler.h"
+#include "TextOverlay.h"
+#include "TextureCooker.h"
+#include "ScenePackage.h"
+#include "FileWatcher.h"
+#include "ShaderReloader.h"
+#include "JobSystem.h"
+
+// Namespace for declaring global variables
+namespace
+{
+	// Macro for window title
+	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
+
+	// Main GLFW window
+	GLFWwindow* g_Window = nullptr;
+
+	// scene manager object for managing the 3D scene prepare and render
+	SceneManager* g_SceneManager = nullptr;
+	// shader manager object for dynamic interaction with the shader code
+	ShaderManager* g_ShaderManager = nullptr;
+	// view manager object for managing the 3D view setup and projection to 2D
+	ViewManager* g_ViewManager = nullptr;
+	// uniform cache object for skipping redundant shader uploads
+	UniformCache* g_UniformCache = nullptr;
+	// program cache object holding the scene shader variants
+	ShaderProgramCache* g_ProgramCache = nullptr;
+	// frame profiler object for timing the phases of every frame
+	FrameProfiler* g_FrameProfiler = nullptr;
+	// text overlay object for showing the profiler summary
+	TextOverlay* g_TextOverlay = nullptr;
+	// file watcher and shader reloader objects for reloading
+	// edited shaders and textures while the window is open
+	FileWatcher* g_FileWatcher = nullptr;
+	ShaderReloader* g_ShaderReloader = nullptr;
+	// job system object the frame preparation is spread over
+	JobSystem* g_JobSystem = nullptr;
+
+	// the shader files of the scene program, and the file the
+	// linked variants are kept in between runs
+	const char* const VERTEX_SHADER_FILE = "shaders/vertexShader.glsl";
+	const char* const FRAGMENT_SHADER_FILE = "shaders/fragmentShader.glsl";
+	const char* const PROGRAM_CACHE_FILE = "shader_cache.bin";
+
+	// the profiler summary is shown with F1, and F2 writes the
+	// recorded frames into the trace file
+	bool g_bShowProfiler = false;
+	bool g_bProfilerKeyDown = false;
+	bool g_bTraceKeyDown = false;
+	std::string g_TraceFile = "";
+	const char* const DEFAULT_TRACE_FILE = "frame_trace.json";
+
+	// scene package loaded instead of the built-in scene, if any
+	std::string g_ScenePackageFile = "";
+	// local lights scattered over the scene for the light clusters
+	int g_LocalLightCount = 0;
+	// whether the lights cast shadows
+	bool g_bShadows = true;
+	// silhouette error in pixels the levels of detail are chosen
+	// by, or less than zero to keep the scene manager default
+	float g_LodErrorPixels = -1.0f;
+	// whether the static objects are merged into static batches
+	bool g_bStaticBatching = true;
+	// threads of the job system, or zero for one per core, and
+	// whether the next frame is prepared while one is drawn
+	int g_JobThreadCount = 0;
+	bool g_bPipelineFrames = true;
+	// whether the per-frame ring buffers are mapped for good
+	bool g_bPersistentBuffers = true;
+
+	// settings for rendering frames without a visible window
+	struct HEADLESS_SETTINGS
+	{
+		bool bEnabled;
+		int frameCount;
+		int width;
+		int height;
+		std::string outputDirectory;
+		bool bBenchmark;
+		std::string reportFile;
+		// fragment shader the scene shader is compared against,
+		// or empty when not comparing shaders
+		std::string shadingBaseline;
+	};
+	HEADLESS_SETTINGS g_Headless = { false, 300, 1000, 800, "", false, "benchmark_report.json", "" };
+
+	// camera paths and resolutions replayed by the benchmark
+	const char* const BENCHMARK_PATHS[] =
+	{
+		"benchmarks/orbit.path",
+		"benchmarks/flythrough.path"
+	};
+	const int BENCHMARK_SIZES[][2] =
+	{
+		{ 1280, 720 },
+		{ 1920, 1080 }
+	};
+	// frames rendered before and during the timing of each case
+	const int BENCHMARK_WARMUP_FRAMES = 30;
+	const int BENCHMARK_FRAMES = 600;
+
+	// the shading comparison is bound by the pixels filled, so it
+	// runs at the larger resolutions with fewer frames per case
+	const char* const SHADING_BASELINE_FILE = "benchmarks/reference_fragment.glsl";
+	const int SHADING_BENCHMARK_SIZES[][2] =
+	{
+		{ 1920, 1080 },
+		{ 3840, 2160 }
+	};
+	const int SHADING_BENCHMARK_FRAMES = 120;
+
+	// running totals over all the rendered frames
+	long long g_FrameCount = 0;
+	long long g_TotalDrawn = 0;
+	long long g_TotalCulled = 0;
+	long long g_TotalLightListEntries = 0;
+	long long g_TotalStaticShadowTiles = 0;
+	long long g_TotalDynamicShadowTiles = 0;
+	long long g_TotalTriangles = 0;
+	long long g_TotalFullDetailTriangles = 0;
+	int g_MaxClusterLights = 0;
+}
+
+// Function declarations - all functions that are called manually
+// need to be pre-declared at the beginning of the source code.
+bool InitializeGLFW();
+bool InitializeGLEW();
+bool ParseHeadlessArguments(int argc, char* argv[]);
+void RenderFrame();
+void ProcessProfilerKeys();
+void WatchSceneFiles();
+void ProcessFileChanges();
+void DrawProfilerOverlay();
+bool RunHeadless();
+bool RunBenchmarkCase(
+	FrameBenchmark& frameBenchmark,
+	CameraPath& cameraPath,
+	const std::string& name,
+	int width,
+	int height,
+	int frameCount);
+bool RunBenchmark();
+bool RunShadingBenchmark();
+
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	// run the transform micro benchmark without opening a window
+	if ((argc > 1) && (strcmp(argv[1], "--bench-transforms") == 0))
+	{
+		int objectCount = 100000;
+		if (argc > 2)
+		{
+			objectCount = atoi(argv[2]);
+		}
+		RunTransformBenchmark(objectCount);
+		return(EXIT_SUCCESS);
+	}
+
+	// run the bounding volume hierarchy benchmark without opening a window
+	if ((argc > 1) && (strcmp(argv[1], "--bench-bvh") == 0))
+	{
+		int maxObjectCount = 256000;
+		if (argc > 2)
+		{
+			maxObjectCount = atoi(argv[2]);
+		}
+		RunBVHBenchmark(maxObjectCount);
+		return(EXIT_SUCCESS);
+	}
+
+	// run the job system scaling benchmark without opening a window
+	if ((argc > 1) && (strcmp(argv[1], "--bench-jobs") == 0))
+	{
+		int objectCount = 256000;
+		if (argc > 2)
+		{
+			objectCount = atoi(argv[2]);
+		}
+		RunJobBenchmark(objectCount);
+		return(EXIT_SUCCESS);
+	}
+
+	// cook the given texture images into compressed files
+	if ((argc > 1) && (strcmp(argv[1], "--cook-textures") == 0))
+	{
+		std::vector<std::string> imagePaths(argv + 2, argv + argc);
+		if (imagePaths.empty())
+		{
+			std::cout << "Usage: --cook-textures image.jpg [image.jpg ...]" << std::endl;
+			return(EXIT_FAILURE);
+		}
+		return((RunTextureCooker(imagePaths) == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// build a scene package from a scene description file
+	if ((argc > 1) && (strcmp(argv[1], "--build-package") == 0))
+	{
+		if (argc != 4)
+		{
+			std::cout << "Usage: --build-package scene.scene package.pkg" << std::endl;
+			return(EXIT_FAILURE);
+		}
+		return((ScenePackage::Build(argv[2], argv[3]) == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// check for rendering frames without a visible window
+	if (ParseHeadlessArguments(argc, argv) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// if GLFW fails initialization, then terminate the application
+	if (InitializeGLFW() == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// try to create a new shader manager object
+	g_ShaderManager = new ShaderManager();
+	// try to create a new uniform cache object
+	g_UniformCache = new UniformCache();
+	// try to create a new view manager object
+	g_ViewManager = new ViewManager(
+		g_ShaderManager,
+		g_UniformCache);
+
+	// try to create the main display window
+	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	if ((g_Window == NULL) && (g_Headless.bEnabled == true))
+	{
+		std::cout << "Failed to create a headless OpenGL context, on machines "
+			<< "without a GPU try LIBGL_ALWAYS_SOFTWARE=1" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	// if GLEW fails initialization, then terminate the application
+	if (InitializeGLEW() == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// try to create a new program cache object, which builds the
+	// variants of the scene program from the external GLSL files
+	// as they are first drawn with, or loads them from the last run
+	g_ProgramCache = new ShaderProgramCache();
+	if (g_ProgramCache->LoadSources(VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+	g_ProgramCache->LoadBinaryCache(PROGRAM_CACHE_FILE);
+
+	// try to create a new frame profiler object, which records
+	// in the window and when a trace file was asked for
+	g_FrameProfiler = new FrameProfiler();
+	g_FrameProfiler->CreateQueries();
+	g_FrameProfiler->SetEnabled((g_Headless.bEnabled == false) || (!g_TraceFile.empty()));
+	// try to create a new text overlay object
+	g_TextOverlay = new TextOverlay();
+	g_TextOverlay->Create();
+
+	// try to create a new job system object, which spreads the
+	// transforms, culling and queue of every frame over the cores
+	g_JobSystem = new JobSystem();
+	g_JobSystem->Start((g_JobThreadCount > 0) ? g_JobThreadCount : (int)std::thread::hardware_concurrency());
+
+	// try to create a new scene manager object and prepare the 3D scene
+	g_SceneManager = new SceneManager(g_ShaderManager, g_UniformCache, g_ProgramCache);
+	g_SceneManager->SetProfiler(g_FrameProfiler);
+	g_SceneManager->SetJobSystem(g_JobSystem, g_bPipelineFrames);
+	g_SceneManager->SetPersistentBuffers(g_bPersistentBuffers);
+	if ((!g_ScenePackageFile.empty()) &&
+		(g_SceneManager->OpenScenePackage(g_ScenePackageFile) == false))
+	{
+		std::cout << "Drawing the built-in scene instead" << std::endl;
+	}
+	g_SceneManager->PrepareScene();
+	g_SceneManager->SetShadows(g_bShadows);
+	if (g_LodErrorPixels >= 0.0f)
+	{
+		g_SceneManager->SetLodError(g_LodErrorPixels);
+	}
+	g_SceneManager->SetStaticBatching(g_bStaticBatching);
+	if (g_LocalLightCount > 0)
+	{
+		g_SceneManager->ScatterLocalLights(g_LocalLightCount);
+	}
+
+	// the thread and fence stats cover the rendered frames only
+	g_JobSystem->ResetStats();
+	g_SceneManager->ResetRingStats();
+
+	if (g_Headless.bEnabled == true)
+	{
+		// render the frames into an offscreen framebuffer
+		bool bSuccess = false;
+		if (g_Headless.bBenchmark == true)
+		{
+			bSuccess = RunBenchmark();
+		}
+		else if (!g_Headless.shadingBaseline.empty())
+		{
+			bSuccess = RunShadingBenchmark();
+		}
+		else
+		{
+			bSuccess = RunHeadless();
+		}
+		if (bSuccess == false)
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+	else
+	{
+		// reload the shaders and textures when they are edited
+		WatchSceneFiles();
+
+		// loop will keep running until the application is closed 
+		// or until an error has occurred
+		while (!glfwWindowShouldClose(g_Window))
+		{
+			g_FrameProfiler->BeginFrame();
+			RenderFrame();
+			if (g_bShowProfiler == true)
+			{
+				ScopedProfile profile(g_FrameProfiler, "Profiler Overlay");
+				DrawProfilerOverlay();
+			}
+			g_FrameProfiler->EndFrame();
+
+			// Flips the the back buffer with the front buffer every frame.
+			glfwSwapBuffers(g_Window);
+
+			// query the latest GLFW events
+			glfwPollEvents();
+			ProcessProfilerKeys();
+			ProcessFileChanges();
+		}
+	}
+
+	// write the frames still held by the profiler
+	if (!g_TraceFile.empty())
+	{
+		g_FrameProfiler->WriteChromeTrace(g_TraceFile);
+	}
+
+	// report the average uniform uploads that were sent and skipped
+	if (g_FrameCount > 0)
+	{
+		std::cout << "INFO: Uniform uploads per frame: "
+			<< (double)g_UniformCache->GetTotalUploadCount() / g_FrameCount << ", skipped: "
+			<< (double)g_UniformCache->GetTotalSkippedCount() / g_FrameCount << std::endl;
+		std::cout << "INFO: Objects drawn per frame: "
+			<< (double)g_TotalDrawn / g_FrameCount << ", culled: "
+			<< (double)g_TotalCulled / g_FrameCount << std::endl;
+		std::cout << "INFO: Triangles drawn per frame: "
+			<< (double)g_TotalTriangles / g_FrameCount << ", at full detail: "
+			<< (double)g_TotalFullDetailTriangles / g_FrameCount << std::endl;
+		if (g_SceneManager->GetLocalLightCount() > 0)
+		{
+			std::cout << "INFO: Local lights: " << g_SceneManager->GetLocalLightCount()
+				<< ", light list entries per cluster - average: "
+				<< (double)g_TotalLightListEntries / g_FrameCount / TOTAL_CLUSTERS
+				<< ", max: " << g_MaxClusterLights << std::endl;
+		}
+		std::cout << "INFO: Shadow tiles drawn per frame - cached: "
+			<< (double)g_TotalStaticShadowTiles / g_FrameCount << ", dynamic: "
+			<< (double)g_TotalDynamicShadowTiles / g_FrameCount << std::endl;
+
+		// report the share of the frames every job thread was busy
+		double statsSeconds = g_JobSystem->GetStatsSeconds();
+		long long jobCount = 0;
+		long long stealCount = 0;
+		std::cout << "INFO: Job threads: " << g_JobSystem->GetThreadCount()
+			<< ((g_bPipelineFrames == true) ? ", pipelined" : "") << ", busy per thread:";
+		for (int thread = 0; thread < g_JobSystem->GetThreadCount(); thread++)
+		{
+			JobSystem::THREAD_STATS stats = g_JobSystem->GetThreadStats(thread);
+			std::cout << " " << 100.0 * stats.busySeconds / statsSeconds << "%";
+			jobCount += stats.jobCount;
+			stealCount += stats.stealCount;
+		}
+		std::cout << std::endl;
+		std::cout << "INFO: Jobs per frame: " << (double)jobCount / g_FrameCount
+			<< ", stolen: " << (double)stealCount / g_FrameCount << std::endl;
+
+		// report how long the CPU waited for the GPU to be done with
+		// the regions of the per-frame ring buffers
+		std::cout << "INFO: Ring buffers "
+			<< ((g_SceneManager->IsInstanceRingPersistent() == true) ? "mapped persistently" : "uploaded")
+			<< ", regions per frame: " << (double)g_SceneManager->GetRingRegionCount() / g_FrameCount
+			<< ", stalled on fences: " << g_SceneManager->GetRingStallCount()
+			<< ", fence wait ms per frame: " << g_SceneManager->GetRingWaitSeconds() * 1000.0 / g_FrameCount << std::endl;
+	}
+
+	// keep the linked shader variants for the next run
+	g_ProgramCache->SaveBinaryCache(PROGRAM_CACHE_FILE);
+
+	// clear the allocated manager objects from memory
+	if (NULL != g_ShaderReloader)
+	{
+		delete g_ShaderReloader;
+		g_ShaderReloader = NULL;
+	}
+	if (NULL != g_FileWatcher)
+	{
+		delete g_FileWatcher;
+		g_FileWatcher = NULL;
+	}
+	if (NULL != g_SceneManager)
+	{
+		delete g_SceneManager;
+		g_SceneManager = NULL;
+	}
+	if (NULL != g_JobSystem)
+	{
+		delete g_JobSystem;
+		g_JobSystem = NULL;
+	}
+	if (NULL != g_ViewManager)
+	{
+		delete g_ViewManager;
+		g_ViewManager = NULL;
+	}
+	if (NULL != g_TextOverlay)
+	{
+		delete g_TextOverlay;
+		g_TextOverlay = NULL;
+	}
+	if (NULL != g_FrameProfiler)
+	{
+		delete g_FrameProfiler;
+		g_FrameProfiler = NULL;
+	}
+	if (NULL != g_ProgramCache)
+	{
+		delete g_ProgramCache;
+		g_ProgramCache = NULL;
+	}
+	if (NULL != g_UniformCache)
+	{
+		delete g_UniformCache;
+		g_UniformCache = NULL;
+	}
+	if (NULL != g_ShaderManager)
+	{
+		delete g_ShaderManager;
+		g_ShaderManager = NULL;
+	}
+
+	// Terminates the program successfully
+	exit(EXIT_SUCCESS); 
+}
+
+/***********************************************************
+ *	InitializeGLFW()
+ * 
+ *  This function is used to initialize the GLFW library.   
+ ***********************************************************/
+bool InitializeGLFW()
+{
+	// GLFW: initialize and configure library
+	// --------------------------------------
+#if defined(GLFW_PLATFORM_NULL) && !defined(_WIN32) && !defined(__APPLE__)
+	// without a display server, GLFW 3.4 can create its contexts
+	// through OSMesa, which renders on the CPU with llvmpipe
+	if ((g_Headless.bEnabled == true) &&
+		(getenv("DISPLAY") == NULL) &&
+		(getenv("WAYLAND_DISPLAY") == NULL))
+	{
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
+#endif
+	if (glfwInit() == GLFW_FALSE)
+	{
+		std::cout << "Failed to initialize GLFW" << std::endl;
+		return(false);
+	}
+
+#ifdef __APPLE__
+	// set the version of OpenGL and profile to use
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#else
+	// set the version of OpenGL and profile to use
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (g_Headless.bEnabled == true)
+	{
+		// the shaders only need 3.3, which the Mesa software
+		// renderers all provide
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	}
+#endif
+	if (g_Headless.bEnabled == true)
+	{
+		// the window only provides the context, so keep it hidden
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+	// GLFW: end -------------------------------
+
+	return(true);
+}
+
+/***********************************************************
+ *	InitializeGLEW()
+ *
+ *  This function is used to initialize the GLEW library.
+ ***********************************************************/
+bool InitializeGLEW()
+{
+	// GLEW: initialize
+	// -----------------------------------------
+	GLenum GLEWInitResult = GLEW_OK;
+
+	// try to initialize the GLEW library
+	GLEWInitResult = glewInit();
+	if (GLEW_OK != GLEWInitResult)
+	{
+		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
+		return false;
+	}
+	// GLEW: end -------------------------------
+
+	// Displays a successful OpenGL initialization message
+	std::cout << "INFO: OpenGL Successfully Initialized\n";
+	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *	ParseHeadlessArguments()
+ *
+ *  This function is used to read the command line options
+ *  for rendering without a visible window:
+ *
+ *    --headless [frames]   render the frames offscreen and exit
+ *    --size WxH            size of the rendered frames
+ *    --output directory    save every frame as a PPM image,
+ *                          otherwise the frames are discarded
+ *    --benchmark [report]  replay the benchmark camera paths and
+ *                          write the frame time report as JSON
+ *    --bench-shading [fs]  compare the fragment throughput of the
+ *                          scene shader with a baseline fragment
+ *                          shader, writing the report as above
+ *    --profile-trace file  write the last profiled frames as
+ *                          Chrome trace events when exiting
+ *    --package file        load the scene from a scene package
+ *                          built with --build-package
+ *    --local-lights count  scatter local lights over the scene,
+ *                          shaded through the light clusters
+ *    --no-shadows          draw the lights without shadows
+ *    --lod-error pixels    silhouette error the round shapes may
+ *                          be drawn with, 0 for full detail
+ *    --no-static-batching  draw every object through the render
+ *                          queue instead of merging the static ones
+ *    --threads count       threads the frame preparation is spread
+ *                          over, one per core by default
+ *    --no-pipeline         prepare each frame before drawing it,
+ *                          instead of while the last one is drawn
+ *    --no-persistent-mapping  upload the per-frame instances and
+ *                          light lists instead of writing them
+ *                          into buffers mapped for good
+ *
+ *  It returns false when an option is not valid.
+ ***********************************************************/
+bool ParseHeadlessArguments(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			g_Headless.bEnabled = true;
+			if ((i + 1 < argc) && (argv[i + 1][0] != '-'))
+			{
+				g_Headless.frameCount = atoi(argv[++i]);
+			}
+		}
+		else if ((strcmp(argv[i], "--size") == 0) && (i + 1 < argc))
+		{
+			if (sscanf(argv[++i], "%dx%d", &g_Headless.width, &g_Headless.height) != 2)
+			{
+				std::cout << "The size must be given as WIDTHxHEIGHT" << std::endl;
+				return(false);
+			}
+		}
+		else if ((strcmp(argv[i], "--output") == 0) && (i + 1 < argc))
+		{
+			g_Headless.outputDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			g_Headless.bEnabled = true;
+			g_Headless.bBenchmark = true;
+			if ((i + 1 < argc) && (argv[i + 1][0] != '-'))
+			{
+				g_Headless.reportFile = argv[++i];
+			}
+		}
+		else if (strcmp(argv[i], "--bench-shading") == 0)
+		{
+			g_Headless.bEnabled = true;
+			g_Headless.shadingBaseline = SHADING_BASELINE_FILE;
+			if ((i + 1 < argc) && (argv[i + 1][0] != '-'))
+			{
+				g_Headless.shadingBaseline = argv[++i];
+			}
+		}
+		else if ((strcmp(argv[i], "--profile-trace") == 0) && (i + 1 < argc))
+		{
+			g_TraceFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--package") == 0) && (i + 1 < argc))
+		{
+			g_ScenePackageFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--local-lights") == 0) && (i + 1 < argc))
+		{
+			g_LocalLightCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-shadows") == 0)
+		{
+			g_bShadows = false;
+		}
+		else if ((strcmp(argv[i], "--lod-error") == 0) && (i + 1 < argc))
+		{
+			g_LodErrorPixels = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-static-batching") == 0)
+		{
+			g_bStaticBatching = false;
+		}
+		else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc))
+		{
+			g_JobThreadCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-pipeline") == 0)
+		{
+			g_bPipelineFrames = false;
+		}
+		else if (strcmp(argv[i], "--no-persistent-mapping") == 0)
+		{
+			g_bPersistentBuffers = false;
+		}
+	}
+
+	if ((g_Headless.frameCount <= 0) || (g_Headless.width <= 0) || (g_Headless.height <= 0))
+	{
+		std::cout << "The frame count and size must be greater than zero" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	RenderFrame()
+ *
+ *  This function is used to draw one frame of the 3D scene
+ *  into the bound framebuffer.
+ ***********************************************************/
+void RenderFrame()
+{
+	// start counting the uniform uploads for this frame
+	g_UniformCache->BeginFrame();
+	g_FrameCount++;
+
+	// Enable z-depth
+	glEnable(GL_DEPTH_TEST);
+
+	// Clear the frame and z buffers
+	g_FrameProfiler->PushScope("Clear");
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	g_FrameProfiler->PopScope();
+
+	// convert from 3D object space to 2D view
+	g_FrameProfiler->PushScope("PrepareSceneView");
+	g_ViewManager->PrepareSceneView();
+	g_SceneManager->SetSceneView(
+		g_ViewManager->GetViewMatrix(),
+		g_ViewManager->GetProjectionMatrix());
+	g_FrameProfiler->PopScope();
+
+	// refresh the 3D scene
+	g_FrameProfiler->PushScope("RenderScene");
+	g_SceneManager->RenderScene();
+	g_FrameProfiler->PopScope();
+	g_TotalDrawn += g_SceneManager->GetDrawnCount();
+	g_TotalCulled += g_SceneManager->GetCulledCount();
+	g_TotalLightListEntries += g_SceneManager->GetLightListEntryCount();
+	g_MaxClusterLights = std::max(g_MaxClusterLights, g_SceneManager->GetMaxClusterLights());
+	g_TotalStaticShadowTiles += g_SceneManager->GetStaticShadowTileCount();
+	g_TotalDynamicShadowTiles += g_SceneManager->GetDynamicShadowTileCount();
+	g_TotalTriangles += g_SceneManager->GetTriangleCount();
+	g_TotalFullDetailTriangles += g_SceneManager->GetFullDetailTriangleCount();
+}
+
+/***********************************************************
+ *	ProcessProfilerKeys()
+ *
+ *  This function is used to toggle the profiler overlay
+ *  with F1 and to write the profiler trace with F2. Each
+ *  key acts once when it goes down.
+ ***********************************************************/
+void ProcessProfilerKeys()
+{
+	bool bProfilerKey = (glfwGetKey(g_Window, GLFW_KEY_F1) == GLFW_PRESS);
+	if ((bProfilerKey == true) && (g_bProfilerKeyDown == false))
+	{
+		g_bShowProfiler = !g_bShowProfiler;
+	}
+	g_bProfilerKeyDown = bProfilerKey;
+
+	bool bTraceKey = (glfwGetKey(g_Window, GLFW_KEY_F2) == GLFW_PRESS);
+	if ((bTraceKey == true) && (g_bTraceKeyDown == false))
+	{
+		g_FrameProfiler->WriteChromeTrace(g_TraceFile.empty() ? DEFAULT_TRACE_FILE : g_TraceFile);
+	}
+	g_bTraceKeyDown = bTraceKey;
+}
+
+/***********************************************************
+ *	WatchSceneFiles()
+ *
+ *  This function is used to start watching the shader files
+ *  and the scene texture files for edits.
+ ***********************************************************/
+void WatchSceneFiles()
+{
+	g_FileWatcher = new FileWatcher();
+	g_ShaderReloader = new ShaderReloader(g_ProgramCache);
+
+	g_FileWatcher->AddFile(VERTEX_SHADER_FILE);
+	g_FileWatcher->AddFile(FRAGMENT_SHADER_FILE);
+	std::vector<std::string> textureFiles;
+	g_SceneManager->GetTextureFiles(textureFiles);
+	for (int i = 0; i < (int)textureFiles.size(); i++)
+	{
+		g_FileWatcher->AddFile(textureFiles[i]);
+	}
+}
+
+/***********************************************************
+ *	ProcessFileChanges()
+ *
+ *  This function is used to start reloading the watched
+ *  files edited since the last frame, and to swap in the
+ *  rebuilt shader variants once they have all linked. The
+ *  uniform cache forgets the old programs, so the new ones
+ *  are resolved and sent every value as they are first
+ *  drawn with. Changed textures are uploaded by the scene
+ *  as they finish.
+ ***********************************************************/
+void ProcessFileChanges()
+{
+	std::vector<std::string> changedFiles;
+	g_FileWatcher->Poll(changedFiles);
+
+	bool bShaderChanged = false;
+	for (int i = 0; i < (int)changedFiles.size(); i++)
+	{
+		std::cout << "Reloading " << changedFiles[i] << std::endl;
+		if (g_ShaderReloader->IsShaderFile(changedFiles[i]) == true)
+		{
+			bShaderChanged = true;
+		}
+		else
+		{
+			g_SceneManager->ReloadTexture(changedFiles[i]);
+		}
+	}
+	// both shader files are read again for one build
+	if (bShaderChanged == true)
+	{
+		g_ShaderReloader->BeginReload();
+	}
+
+	if (g_ShaderReloader->Update() == true)
+	{
+		g_UniformCache->Invalidate();
+	}
+}
+
+/***********************************************************
+ *	DrawProfilerOverlay()
+ *
+ *  This function is used to draw the averaged profiler
+ *  scopes in the top left corner of the window.
+ ***********************************************************/
+void DrawProfilerOverlay()
+{
+	std::vector<std::string> lines;
+	g_FrameProfiler->GetSummaryLines(lines);
+	if (lines.empty())
+	{
+		return;
+	}
+
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(g_Window, &width, &height);
+
+	float margin = 8.0f;
+	float lineHeight = g_TextOverlay->GetLineHeight();
+	size_t longestLine = 0;
+	for (int i = 0; i < (int)lines.size(); i++)
+	{
+		longestLine = std::max(longestLine, lines[i].size());
+	}
+
+	g_TextOverlay->AddBox(
+		0.0f,
+		0.0f,
+		longestLine * g_TextOverlay->GetCharacterWidth() + 2.0f * margin,
+		lines.size() * lineHeight + 2.0f * margin,
+		glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+	for (int i = 0; i < (int)lines.size(); i++)
+	{
+		glm::vec4 color = (i == 0) ? glm::vec4(1.0f, 0.85f, 0.3f, 1.0f) : glm::vec4(1.0f);
+		g_TextOverlay->AddText(margin, margin + i * lineHeight, lines[i], color);
+	}
+	g_TextOverlay->Draw(width, height);
+}
+
+/***********************************************************
+ *	RunHeadless()
+ *
+ *  This function is used to render a fixed number of frames
+ *  into an offscreen framebuffer, with the camera following
+ *  an orbit around the scene so every run draws the same
+ *  frames. Each frame is waited on before it is timed, and
+ *  the frame time statistics are printed at the end.
+ ***********************************************************/
+bool RunHeadless()
+{
+	OffscreenTarget offscreenTarget;
+	if (offscreenTarget.Create(g_Headless.width, g_Headless.height) == false)
+	{
+		return(false);
+	}
+	g_ViewManager->SetRenderSize(g_Headless.width, g_Headless.height);
+	// every run must draw the finished textures from the first frame
+	g_SceneManager->FinishTextureLoading();
+
+	// one orbit around the middle of the desk over all the frames
+	CameraPath cameraPath;
+	cameraPath.CreateOrbit(glm::vec3(-1.0f, 2.0f, 0.0f), 14.0f, 6.0f, 1.0f);
+
+	std::vector<unsigned char> pixels;
+	std::vector<double> frameTimes;
+	frameTimes.reserve(g_Headless.frameCount);
+
+	std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < g_Headless.frameCount; frame++)
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		cameraPath.Evaluate((float)frame / g_Headless.frameCount, position, front);
+		g_ViewManager->SetCameraPose(position, front);
+
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+		offscreenTarget.Bind();
+		g_FrameProfiler->BeginFrame();
+		RenderFrame();
+		g_FrameProfiler->EndFrame();
+		glFinish();
+		std::chrono::duration<double> frameTime = std::chrono::steady_clock::now() - frameStart;
+		frameTimes.push_back(frameTime.count());
+
+		// saving the images is not part of the frame time
+		if (!g_Headless.outputDirectory.empty())
+		{
+			char filename[32];
+			snprintf(filename, sizeof(filename), "frame_%04d.ppm", frame);
+			offscreenTarget.ReadPixels(pixels);
+			OffscreenTarget::WritePPM(
+				g_Headless.outputDirectory + "/" + filename,
+				g_Headless.width,
+				g_Headless.height,
+				pixels);
+		}
+	}
+	std::chrono::duration<double> runTime = std::chrono::steady_clock::now() - runStart;
+	offscreenTarget.Unbind();
+
+	double totalFrameTime = 0.0;
+	double minFrameTime = frameTimes[0];
+	double maxFrameTime = frameTimes[0];
+	for (int i = 0; i < (int)frameTimes.size(); i++)
+	{
+		totalFrameTime += frameTimes[i];
+		minFrameTime = std::min(minFrameTime, frameTimes[i]);
+		maxFrameTime = std::max(maxFrameTime, frameTimes[i]);
+	}
+	double averageFrameTime = totalFrameTime / frameTimes.size();
+
+	std::cout << "INFO: Rendered " << frameTimes.size() << " frames at "
+		<< g_Headless.width << "x" << g_Headless.height << " in "
+		<< runTime.count() << " s" << std::endl;
+	std::cout << "INFO: Frame time ms - average: " << averageFrameTime * 1000.0
+		<< ", min: " << minFrameTime * 1000.0
+		<< ", max: " << maxFrameTime * 1000.0
+		<< ", frames per second: " << 1.0 / averageFrameTime << std::endl;
+
+	// the profiler scopes point at the phase of a slow frame
+	if (!g_TraceFile.empty())
+	{
+		std::vector<std::string> lines;
+		g_FrameProfiler->GetSummaryLines(lines);
+		for (int i = 0; i < (int)lines.size(); i++)
+		{
+			std::cout << "INFO: " << lines[i] << std::endl;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	RunBenchmarkCase()
+ *
+ *  This function is used to replay one camera path at one
+ *  resolution into an offscreen framebuffer. A few frames
+ *  are rendered first to warm up the caches and the driver,
+ *  and then the CPU and GPU time, draw calls, uniform
+ *  uploads and drawn objects of every frame are recorded as
+ *  one case of the benchmark.
+ ***********************************************************/
+bool RunBenchmarkCase(
+	FrameBenchmark& frameBenchmark,
+	CameraPath& cameraPath,
+	const std::string& name,
+	int width,
+	int height,
+	int frameCount)
+{
+	OffscreenTarget offscreenTarget;
+	if (offscreenTarget.Create(width, height) == false)
+	{
+		return(false);
+	}
+	g_ViewManager->SetRenderSize(width, height);
+	offscreenTarget.Bind();
+
+	// the path is stretched over the recorded frames, so
+	// every run draws exactly the same frames
+	float duration = cameraPath.GetDuration();
+	glm::vec3 position;
+	glm::vec3 front;
+	cameraPath.Evaluate(0.0f, position, front);
+	g_ViewManager->SetCameraPose(position, front);
+	for (int frame = 0; frame < BENCHMARK_WARMUP_FRAMES; frame++)
+	{
+		RenderFrame();
+	}
+	glFinish();
+
+	frameBenchmark.BeginCase(name, width, height);
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		cameraPath.Evaluate(duration * frame / (frameCount - 1), position, front);
+		g_ViewManager->SetCameraPose(position, front);
+
+		long long uploadsBefore = g_UniformCache->GetTotalUploadCount();
+		frameBenchmark.BeginFrame();
+		g_FrameProfiler->BeginFrame();
+		RenderFrame();
+		g_FrameProfiler->EndFrame();
+		frameBenchmark.EndFrame(
+			g_SceneManager->GetDrawCallCount(),
+			(int)(g_UniformCache->GetTotalUploadCount() - uploadsBefore),
+			g_SceneManager->GetDrawnCount(),
+			g_SceneManager->GetTriangleCount());
+
+		// hand the frame to the driver as a swap would
+		glFlush();
+	}
+	frameBenchmark.EndCase();
+
+	offscreenTarget.Unbind();
+
+	return(true);
+}
+
+/***********************************************************
+ *	RunBenchmark()
+ *
+ *  This function is used to replay every benchmark camera
+ *  path at every benchmark resolution. The frame time
+ *  percentiles of all the cases are written as JSON.
+ ***********************************************************/
+bool RunBenchmark()
+{
+	FrameBenchmark frameBenchmark;
+	frameBenchmark.CreateQueries();
+	// the texture uploads are not part of any measured frame
+	g_SceneManager->FinishTextureLoading();
+
+	int pathCount = sizeof(BENCHMARK_PATHS) / sizeof(BENCHMARK_PATHS[0]);
+	int sizeCount = sizeof(BENCHMARK_SIZES) / sizeof(BENCHMARK_SIZES[0]);
+
+	for (int path = 0; path < pathCount; path++)
+	{
+		CameraPath cameraPath;
+		if (cameraPath.LoadFromFile(BENCHMARK_PATHS[path]) == false)
+		{
+			return(false);
+		}
+
+		for (int size = 0; size < sizeCount; size++)
+		{
+			if (RunBenchmarkCase(
+				frameBenchmark,
+				cameraPath,
+				BENCHMARK_PATHS[path],
+				BENCHMARK_SIZES[size][0],
+				BENCHMARK_SIZES[size][1],
+				BENCHMARK_FRAMES) == false)
+			{
+				return(false);
+			}
+		}
+	}
+
+	frameBenchmark.PrintSummary();
+	bool bWritten = frameBenchmark.WriteReport(g_Headless.reportFile);
+	if (bWritten == true)
+	{
+		std::cout << "INFO: Benchmark report written to " << g_Headless.reportFile << std::endl;
+	}
+	frameBenchmark.DestroyQueries();
+
+	return(bWritten);
+}
+
+/***********************************************************
+ *	RunShadingBenchmark()
+ *
+ *  This function is used to compare the scene fragment
+ *  shader against a baseline fragment shader, such as the
+ *  one from before a change to the lighting. Both shaders
+ *  replay every benchmark camera path at the shading
+ *  resolutions, taking turns case by case so that both see
+ *  the same conditions. The median GPU time of each case
+ *  gives the pixels shaded per second, and the speedup of
+ *  the scene shader over the baseline is printed for each
+ *  path and resolution. All the cases are written as JSON.
+ ***********************************************************/
+bool RunShadingBenchmark()
+{
+	FrameBenchmark frameBenchmark;
+	frameBenchmark.CreateQueries();
+	// the texture uploads are not part of any measured frame
+	g_SceneManager->FinishTextureLoading();
+	// the baseline shader has no shadows, so both are drawn without
+	g_SceneManager->SetShadows(false);
+
+	// the baseline is drawn first in every pair of cases
+	const std::string fragmentFiles[2] = { g_Headless.shadingBaseline, FRAGMENT_SHADER_FILE };
+	int pathCount = sizeof(BENCHMARK_PATHS) / sizeof(BENCHMARK_PATHS[0]);
+	int sizeCount = sizeof(SHADING_BENCHMARK_SIZES) / sizeof(SHADING_BENCHMARK_SIZES[0]);
+
+	for (int path = 0; path < pathCount; path++)
+	{
+		CameraPath cameraPath;
+		if (cameraPath.LoadFromFile(BENCHMARK_PATHS[path]) == false)
+		{
+			return(false);
+		}
+
+		for (int size = 0; size < sizeCount; size++)
+		{
+			int width = SHADING_BENCHMARK_SIZES[size][0];
+			int height = SHADING_BENCHMARK_SIZES[size][1];
+
+			for (int shader = 0; shader < 2; shader++)
+			{
+				// build the variants of this shader before any frame
+				// is timed, and send every uniform to them again
+				g_ProgramCache->Clear();
+				if (g_ProgramCache->LoadSources(VERTEX_SHADER_FILE, fragmentFiles[shader]) == false)
+				{
+					return(false);
+				}
+				g_UniformCache->Invalidate();
+				g_SceneManager->PrepareShaderVariants();
+
+				if (RunBenchmarkCase(
+					frameBenchmark,
+					cameraPath,
+					fragmentFiles[shader] + " " + BENCHMARK_PATHS[path],
+					width,
+					height,
+					SHADING_BENCHMARK_FRAMES) == false)
+				{
+					return(false);
+				}
+			}
+
+			// the last two cases are the baseline and the scene shader
+			int caseIndex = frameBenchmark.GetCaseCount() - 2;
+			double baselineTime = frameBenchmark.GetMedianFrameTime(caseIndex);
+			double shaderTime = frameBenchmark.GetMedianFrameTime(caseIndex + 1);
+			if ((baselineTime > 0.0) && (shaderTime > 0.0))
+			{
+				double pixels = (double)width * height;
+				std::cout << "INFO: Shading " << BENCHMARK_PATHS[path] << " " << width << "x" << height
+					<< " - megapixels per second: " << pixels / (baselineTime * 1000.0)
+					<< " -> " << pixels / (shaderTime * 1000.0)
+					<< ", speedup: " << baselineTime / shaderTime << "x" << std::endl;
+			}
+		}
+	}
+
+	frameBenchmark.PrintSummary();
+	bool bWritten = frameBenchmark.WriteReport(g_Headless.reportFile);
+	if (bWritten == true)
+	{
+		std::cout << "INFO: Benchmark report written to " << g_Headless.reportFile << std::endl;
+	}
+	frameBenchmark.DestroyQueries();
+
+	return(bWritten);
+}
@@ -0,0 +1,518 @@
+///////////////////////////////////////////////////////////////////////////////
+// microbenchmarks.cpp
+// ============
+// CPU-only micro benchmarks for the scene management code, run from the
+// command line without opening a display window
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MicroBenchmarks.h"
+#include "SceneGraph.h"
+#include "SceneBVH.h"
+#include "Frustum.h"
+#include "RenderQueue.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	// number of times each benchmark pass is repeated
+	const int BENCHMARK_PASSES = 20;
+	// number of picking rays cast per hierarchy benchmark pass
+	const int BENCHMARK_RAYS = 1000;
+	// nodes and items per job of the job benchmark, as the scene
+	// manager splits them
+	const int BENCHMARK_JOB_NODES = 2048;
+
+	// keeps the optimizer from discarding the benchmarked results
+	volatile float g_BenchmarkSink = 0.0f;
+
+	/***********************************************************
+	 *  ComposeModelMatrix()
+	 *
+	 *  The reference model matrix composition that builds the
+	 *  five separate matrices and multiplies them together.
+	 ***********************************************************/
+	glm::mat4 ComposeModelMatrix(
+		const glm::vec3& scaleXYZ,
+		const glm::vec3& rotationDegreesXYZ,
+		const glm::vec3& positionXYZ)
+	{
+		glm::mat4 scale = glm::scale(scaleXYZ);
+		glm::mat4 rotationX = glm::rotate(glm::radians(rotationDegreesXYZ.x), glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::mat4 rotationY = glm::rotate(glm::radians(rotationDegreesXYZ.y), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 rotationZ = glm::rotate(glm::radians(rotationDegreesXYZ.z), glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat4 translation = glm::translate(positionXYZ);
+
+		return(translation * rotationZ * rotationY * rotationX * scale);
+	}
+
+	/***********************************************************
+	 *  RandomRange()
+	 *
+	 *  Returns a pseudo random value between min and max.
+	 ***********************************************************/
+	float RandomRange(float minValue, float maxValue)
+	{
+		return(minValue + (maxValue - minValue) * ((float)rand() / (float)RAND_MAX));
+	}
+
+	/***********************************************************
+	 *  ElapsedSeconds()
+	 *
+	 *  Returns the seconds passed since the start time.
+	 ***********************************************************/
+	double ElapsedSeconds(std::chrono::steady_clock::time_point start)
+	{
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return(elapsed.count());
+	}
+}
+
+/***********************************************************
+ *  RunTransformBenchmark()
+ *
+ *  This function is used for measuring how many model
+ *  matrices per second are produced by the reference five
+ *  matrix composition, by the fused closed form rotation,
+ *  and by the scene graph when no nodes are dirty (the
+ *  static scene case).
+ ***********************************************************/
+void RunTransformBenchmark(int objectCount)
+{
+	std::vector<glm::vec3> scales(objectCount);
+	std::vector<glm::vec3> rotations(objectCount);
+	std::vector<glm::vec3> positions(objectCount);
+	SceneGraph sceneGraph;
+
+	srand(1);
+	for (int i = 0; i < objectCount; i++)
+	{
+		scales[i] = glm::vec3(RandomRange(0.1f, 5.0f), RandomRange(0.1f, 5.0f), RandomRange(0.1f, 5.0f));
+		rotations[i] = glm::vec3(RandomRange(0.0f, 360.0f), RandomRange(0.0f, 360.0f), RandomRange(0.0f, 360.0f));
+		positions[i] = glm::vec3(RandomRange(-50.0f, 50.0f), RandomRange(0.0f, 20.0f), RandomRange(-50.0f, 50.0f));
+		sceneGraph.AddNode(SceneGraph::MESH_BOX, scales[i], rotations[i], positions[i], 0, -1);
+	}
+	sceneGraph.UpdateTransforms();
+
+	// make sure both methods build the same matrices
+	float maxError = 0.0f;
+	for (int i = 0; i < objectCount; i++)
+	{
+		glm::mat4 reference = ComposeModelMatrix(scales[i], rotations[i], positions[i]);
+		glm::mat4 fused = SceneGraph::ComputeModelMatrix(scales[i], rotations[i], positions[i]);
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				float error = fabsf(reference[column][row] - fused[column][row]);
+				if (error > maxError)
+				{
+					maxError = error;
+				}
+			}
+		}
+	}
+
+	// reference composition of five matrices per object
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+	{
+		for (int i = 0; i < objectCount; i++)
+		{
+			g_BenchmarkSink = g_BenchmarkSink + ComposeModelMatrix(scales[i], rotations[i], positions[i])[3][0];
+		}
+	}
+	double composeSeconds = ElapsedSeconds(start);
+
+	// fused closed form rotation per object
+	start = std::chrono::steady_clock::now();
+	for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+	{
+		for (int i = 0; i < objectCount; i++)
+		{
+			g_BenchmarkSink = g_BenchmarkSink + SceneGraph::ComputeModelMatrix(scales[i], rotations[i], positions[i])[3][0];
+		}
+	}
+	double fusedSeconds = ElapsedSeconds(start);
+
+	// static scene - the cached matrices are reused as they are
+	start = std::chrono::steady_clock::now();
+	int updated = 0;
+	for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+	{
+		updated += sceneGraph.UpdateTransforms();
+	}
+	double cachedSeconds = ElapsedSeconds(start);
+
+	double matrixCount = (double)objectCount * BENCHMARK_PASSES;
+
+	std::cout << "Transform benchmark: " << objectCount << " objects x " << BENCHMARK_PASSES << " passes" << std::endl;
+	std::cout << "  max difference between methods: " << maxError << std::endl;
+	std::cout << "  composed (5 matrices):  " << composeSeconds * 1000.0 << " ms, "
+		<< matrixCount / composeSeconds / 1.0e6 << " M matrices/sec" << std::endl;
+	std::cout << "  fused closed form:      " << fusedSeconds * 1000.0 << " ms, "
+		<< matrixCount / fusedSeconds / 1.0e6 << " M matrices/sec" << std::endl;
+	std::cout << "  cached (static scene):  " << cachedSeconds * 1000.0 << " ms, "
+		<< updated << " matrices re-derived" << std::endl;
+}
+
+/***********************************************************
+ *  RunBVHBenchmark()
+ *
+ *  This function is used for measuring the bounding volume
+ *  hierarchy against the linear tests. Scenes of growing
+ *  size are built with the same density of objects, and
+ *  for each one the build, frustum query, picking ray and
+ *  refit times are reported. The hierarchy results are
+ *  checked against the linear results as they are timed.
+ ***********************************************************/
+void RunBVHBenchmark(int maxObjectCount)
+{
+	std::cout << "BVH benchmark: times in ms, frustum and ray times per query" << std::endl;
+	std::cout << "  objects    build   frustum(bvh/linear)   ray(bvh/linear)   refit 1%   mismatches" << std::endl;
+
+	for (int objectCount = 1000; objectCount <= maxObjectCount; objectCount *= 4)
+	{
+		// keep the density of objects the same as the scene grows
+		float halfSize = 50.0f * sqrtf(objectCount / 1000.0f);
+		SceneGraph sceneGraph;
+
+		srand(1);
+		for (int i = 0; i < objectCount; i++)
+		{
+			sceneGraph.AddNode(
+				rand() % SceneGraph::MESH_COUNT,
+				glm::vec3(RandomRange(0.2f, 3.0f), RandomRange(0.2f, 3.0f), RandomRange(0.2f, 3.0f)),
+				glm::vec3(RandomRange(0.0f, 360.0f), RandomRange(0.0f, 360.0f), 0.0f),
+				glm::vec3(RandomRange(-halfSize, halfSize), RandomRange(0.0f, 10.0f), RandomRange(-halfSize, halfSize)),
+				0, -1);
+		}
+		sceneGraph.UpdateTransforms();
+		const SceneGraph::WORLD_BOUNDS& bounds = sceneGraph.GetWorldBounds();
+
+		// build
+		SceneBVH sceneBVH;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		sceneBVH.Build(bounds);
+		double buildSeconds = ElapsedSeconds(start);
+
+		// frustum queries from the camera above the scene edge
+		Frustum frustum;
+		glm::vec3 eye(0.0f, 10.0f, halfSize);
+		frustum.ExtractPlanes(
+			glm::perspective(glm::radians(80.0f), 1.25f, 0.1f, 100.0f) *
+			glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+		std::vector<unsigned char> bvhVisible;
+		std::vector<unsigned char> linearVisible;
+		int mismatches = 0;
+
+		start = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+		{
+			g_BenchmarkSink = g_BenchmarkSink + sceneBVH.FrustumQuery(frustum, bounds, bvhVisible);
+		}
+		double bvhFrustumSeconds = ElapsedSeconds(start) / BENCHMARK_PASSES;
+
+		start = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+		{
+			g_BenchmarkSink = g_BenchmarkSink + frustum.CullBounds(bounds, linearVisible);
+		}
+		double linearFrustumSeconds = ElapsedSeconds(start) / BENCHMARK_PASSES;
+
+		// the hierarchy may only skip the tests of nodes it
+		// knows to be inside, so it can accept more, never fewer
+		for (int i = 0; i < objectCount; i++)
+		{
+			if ((linearVisible[i] != 0) && (bvhVisible[i] == 0))
+			{
+				mismatches++;
+			}
+		}
+
+		// picking rays from above the scene pointing downwards
+		std::vector<glm::vec3> origins(BENCHMARK_RAYS);
+		std::vector<glm::vec3> directions(BENCHMARK_RAYS);
+		for (int i = 0; i < BENCHMARK_RAYS; i++)
+		{
+			origins[i] = glm::vec3(RandomRange(-halfSize, halfSize), 20.0f, RandomRange(-halfSize, halfSize));
+			directions[i] = glm::normalize(glm::vec3(RandomRange(-0.5f, 0.5f), -1.0f, RandomRange(-0.5f, 0.5f)));
+		}
+		std::vector<int> bvhHits(BENCHMARK_RAYS);
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < BENCHMARK_RAYS; i++)
+		{
+			float hitDistance = 0.0f;
+			bvhHits[i] = sceneBVH.RayQuery(bounds, origins[i], directions[i], 1000.0f, hitDistance);
+		}
+		double bvhRaySeconds = ElapsedSeconds(start) / BENCHMARK_RAYS;
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < BENCHMARK_RAYS; i++)
+		{
+			glm::vec3 inverseDirection(1.0f / directions[i].x, 1.0f / directions[i].y, 1.0f / directions[i].z);
+			float hitDistance = 1000.0f;
+			int hitNode = -1;
+			for (int node = 0; node < objectCount; node++)
+			{
+				glm::vec3 center(bounds.centerX[node], bounds.centerY[node], bounds.centerZ[node]);
+				glm::vec3 extents(bounds.extentX[node], bounds.extentY[node], bounds.extentZ[node]);
+				float entryDistance = 0.0f;
+				if ((SceneBVH::IntersectRayBox(origins[i], inverseDirection, center - extents, center + extents, hitDistance, entryDistance) == true) &&
+					((entryDistance < hitDistance) || (hitNode < 0)))
+				{
+					hitDistance = entryDistance;
+					hitNode = node;
+				}
+			}
+			if (hitNode != bvhHits[i])
+			{
+				mismatches++;
+			}
+		}
+		double linearRaySeconds = ElapsedSeconds(start) / BENCHMARK_RAYS;
+
+		// move one in a hundred objects and refit
+		for (int i = 0; i < objectCount; i += 100)
+		{
+			sceneGraph.SetPosition(i, glm::vec3(RandomRange(-halfSize, halfSize), RandomRange(0.0f, 10.0f), RandomRange(-halfSize, halfSize)));
+		}
+		sceneGraph.UpdateTransforms();
+		start = std::chrono::steady_clock::now();
+		sceneBVH.Refit(bounds, sceneGraph.GetUpdatedNodes());
+		double refitSeconds = ElapsedSeconds(start);
+
+		std::cout << "  " << objectCount
+			<< "   " << buildSeconds * 1000.0
+			<< "   " << bvhFrustumSeconds * 1000.0 << " / " << linearFrustumSeconds * 1000.0
+			<< "   " << bvhRaySeconds * 1000.0 << " / " << linearRaySeconds * 1000.0
+			<< "   " << refitSeconds * 1000.0
+			<< "   " << mismatches << std::endl;
+	}
+}
+
+/***********************************************************
+ *  RunJobBenchmark()
+ *
+ *  This function is used for measuring the frame preparation
+ *  of a large scene over the threads of the job system. In
+ *  every frame each object turns, and the transforms, the
+ *  hierarchy refit, the frustum query, the queue items, the
+ *  sort and the instance copies are done as the scene
+ *  manager does them. The refit runs on one thread, so it
+ *  shows how much of the frame cannot be spread. The queue
+ *  order of every thread count is checked against the one
+ *  of a single thread.
+ ***********************************************************/
+void RunJobBenchmark(int objectCount)
+{
+	float halfSize = 50.0f * sqrtf(objectCount / 1000.0f);
+	SceneGraph sceneGraph;
+
+	srand(1);
+	for (int i = 0; i < objectCount; i++)
+	{
+		sceneGraph.AddNode(
+			rand() % SceneGraph::MESH_COUNT,
+			glm::vec3(RandomRange(0.2f, 3.0f), RandomRange(0.2f, 3.0f), RandomRange(0.2f, 3.0f)),
+			glm::vec3(RandomRange(0.0f, 360.0f), RandomRange(0.0f, 360.0f), 0.0f),
+			glm::vec3(RandomRange(-halfSize, halfSize), RandomRange(0.0f, 10.0f), RandomRange(-halfSize, halfSize)),
+			rand() % 16, (rand() % 4) - 1);
+	}
+	sceneGraph.UpdateTransforms();
+	const SceneGraph::WORLD_BOUNDS& bounds = sceneGraph.GetWorldBounds();
+
+	SceneBVH sceneBVH;
+	sceneBVH.Build(bounds);
+
+	glm::vec3 eye(0.0f, 10.0f, halfSize);
+	glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	Frustum frustum;
+	frustum.ExtractPlanes(glm::perspective(glm::radians(80.0f), 1.25f, 0.1f, 100.0f) * view);
+
+	std::vector<unsigned char> visible;
+	std::vector<int> subtrees;
+	std::vector<RenderQueue::RENDER_ITEM> nodeItems(objectCount);
+	std::vector<glm::mat4> instances;
+	RenderQueue renderQueue;
+	std::vector<int> referenceOrder;
+
+	int coreCount = (int)std::thread::hardware_concurrency();
+	std::cout << "Job benchmark: " << objectCount << " objects, all moving, " << BENCHMARK_PASSES
+		<< " frames per thread count, " << coreCount << " cores" << std::endl;
+	std::cout << "  times in ms per frame: transforms + refit, cull, queue, sort, instances" << std::endl;
+	std::cout << "  threads   transforms   refit   cull   queue   sort   instances   total   speedup   busy   stolen   mismatches" << std::endl;
+
+	double singleThreadSeconds = 0.0;
+	for (int threadCount = 1; threadCount <= JobSystem::MAX_THREADS; threadCount *= 2)
+	{
+		JobSystem jobSystem;
+		jobSystem.Start(threadCount);
+
+		double phaseSeconds[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+		long long stealCount = 0;
+		int mismatches = 0;
+
+		for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+		{
+			// turning every object is the input of the frame, and is not timed
+			for (int node = 0; node < objectCount; node++)
+			{
+				sceneGraph.SetRotation(node, glm::vec3((float)(pass * 7 + node % 360), (float)(node % 180), 0.0f));
+			}
+			if (pass == 1)
+			{
+				// the first frame warms the threads and caches up
+				for (int phase = 0; phase < 6; phase++)
+				{
+					phaseSeconds[phase] = 0.0;
+				}
+				jobSystem.ResetStats();
+			}
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			sceneGraph.UpdateTransforms(&jobSystem);
+			phaseSeconds[0] += ElapsedSeconds(start);
+
+			start = std::chrono::steady_clock::now();
+			sceneBVH.Refit(bounds, sceneGraph.GetUpdatedNodes());
+			phaseSeconds[1] += ElapsedSeconds(start);
+
+			start = std::chrono::steady_clock::now();
+			sceneBVH.GetSubtrees(threadCount * 4, subtrees);
+			visible.assign(objectCount, 0);
+			std::atomic<int> visibleCount(0);
+			JobSystem::ForEachRange(&jobSystem, (int)subtrees.size(), 1,
+				[&](int first, int last)
+				{
+					for (int i = first; i < last; i++)
+					{
+						visibleCount += sceneBVH.FrustumQuerySubtree(frustum, bounds, subtrees[i], visible);
+					}
+				});
+			phaseSeconds[2] += ElapsedSeconds(start);
+
+			start = std::chrono::steady_clock::now();
+			JobSystem::ForEachRange(&jobSystem, objectCount, BENCHMARK_JOB_NODES,
+				[&](int first, int last)
+				{
+					for (int node = first; node < last; node++)
+					{
+						if (visible[node] == 0)
+						{
+							nodeItems[node].node = -1;
+							continue;
+						}
+						const glm::vec4& origin = sceneGraph.GetModelMatrix(node)[3];
+						float viewDepth = -(view[0][2] * origin.x + view[1][2] * origin.y + view[2][2] * origin.z + view[3][2]);
+						nodeItems[node] = RenderQueue::MakeItem(
+							node, 0, sceneGraph.GetMeshID(node), 0,
+							sceneGraph.GetTextureSlot(node), sceneGraph.GetMaterialID(node),
+							viewDepth, false);
+					}
+				});
+			renderQueue.Clear();
+			for (int node = 0; node < objectCount; node++)
+			{
+				if (nodeItems[node].node >= 0)
+				{
+					renderQueue.AddItem(nodeItems[node]);
+				}
+			}
+			phaseSeconds[3] += ElapsedSeconds(start);
+
+			start = std::chrono::steady_clock::now();
+			renderQueue.Sort(&jobSystem);
+			phaseSeconds[4] += ElapsedSeconds(start);
+
+			start = std::chrono::steady_clock::now();
+			instances.resize(renderQueue.GetItemCount());
+			JobSystem::ForEachRange(&jobSystem, (int)instances.size(), BENCHMARK_JOB_NODES * 2,
+				[&](int first, int last)
+				{
+					for (int i = first; i < last; i++)
+					{
+						instances[i] = sceneGraph.GetModelMatrix(renderQueue.GetItem(i).node);
+					}
+				});
+			phaseSeconds[5] += ElapsedSeconds(start);
+			g_BenchmarkSink = g_BenchmarkSink + (instances.empty() ? 0.0f : instances[0][3][0]);
+
+			// the same frame must give the same queue on any number of threads
+			if (threadCount == 1)
+			{
+				if (pass == BENCHMARK_PASSES - 1)
+				{
+					referenceOrder.resize(renderQueue.GetItemCount());
+					for (int i = 0; i < renderQueue.GetItemCount(); i++)
+					{
+						referenceOrder[i] = renderQueue.GetItem(i).node;
+					}
+				}
+			}
+			else if (pass == BENCHMARK_PASSES - 1)
+			{
+				mismatches = std::abs((int)referenceOrder.size() - renderQueue.GetItemCount());
+				for (int i = 0; (i < renderQueue.GetItemCount()) && (i < (int)referenceOrder.size()); i++)
+				{
+					if (renderQueue.GetItem(i).node != referenceOrder[i])
+					{
+						mismatches++;
+					}
+				}
+			}
+		}
+
+		int timedFrames = BENCHMARK_PASSES - 1;
+		double totalSeconds = 0.0;
+		for (int phase = 0; phase < 6; phase++)
+		{
+			totalSeconds += phaseSeconds[phase];
+		}
+		if (threadCount == 1)
+		{
+			singleThreadSeconds = totalSeconds;
+		}
+
+		// share of the timed phases each thread spent running jobs
+		double busyShare = 0.0;
+		for (int thread = 0; thread < threadCount; thread++)
+		{
+			JobSystem::THREAD_STATS stats = jobSystem.GetThreadStats(thread);
+			busyShare += stats.busySeconds / totalSeconds;
+			stealCount += stats.stealCount;
+		}
+		busyShare /= threadCount;
+
+		std::cout << "  " << threadCount << ((threadCount > coreCount) ? "*" : "")
+			<< "   " << phaseSeconds[0] * 1000.0 / timedFrames
+			<< "   " << phaseSeconds[1] * 1000.0 / timedFrames
+			<< "   " << phaseSeconds[2] * 1000.0 / timedFrames
+			<< "   " << phaseSeconds[3] * 1000.0 / timedFrames
+			<< "   " << phaseSeconds[4] * 1000.0 / timedFrames
+			<< "   " << phaseSeconds[5] * 1000.0 / timedFrames
+			<< "   " << totalSeconds * 1000.0 / timedFrames
+			<< "   " << singleThreadSeconds / totalSeconds << "x"
+			<< "   " << busyShare * 100.0 << "%"
+			<< "   " << stealCount / timedFrames
+			<< "   " << mismatches << std::endl;
+		jobSystem.Shutdown();
+	}
+	if (coreCount < JobSystem::MAX_THREADS)
+	{
+		std::cout << "  * more threads than cores" << std::endl;
+	}
+}
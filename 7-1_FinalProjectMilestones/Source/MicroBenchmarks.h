@@ -0,0 +1,19 @@
+///////////////////////////////////////////////////////////////////////////////
+// microbenchmarks.h
+// ============
+// CPU-only micro benchmarks for the scene management code, run from the
+// command line without opening a display window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// measure how many model matrices per second can be built
+void RunTransformBenchmark(int objectCount);
+
+// measure the hierarchy build, refit and query times against
+// the linear tests, for growing object counts
+void RunBVHBenchmark(int maxObjectCount);
+
+// measure how the frame preparation scales over the threads of
+// the job system, from one thread up to the most it can run
+void RunJobBenchmark(int objectCount);
@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////////////
+// offscreentarget.cpp
+// ============
+// framebuffer object that the scene can be rendered into without a visible
+// window, and read back into image files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OffscreenTarget.h"
+
+#include <fstream>
+#include <iostream>
+
+/***********************************************************
+ *  OffscreenTarget()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OffscreenTarget::OffscreenTarget()
+{
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~OffscreenTarget()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OffscreenTarget::~OffscreenTarget()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the framebuffer with
+ *  an 8 bit RGBA color buffer and a 24 bit depth buffer.
+ *  It returns false when the driver does not accept it.
+ ***********************************************************/
+bool OffscreenTarget::Create(int width, int height)
+{
+	Destroy();
+
+	m_width = width;
+	m_height = height;
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create the offscreen framebuffer, status 0x" << std::hex << status << std::dec << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the framebuffer and its
+ *  attachments.
+ ***********************************************************/
+void OffscreenTarget::Destroy()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for directing all drawing into the
+ *  framebuffer, over its whole size.
+ ***********************************************************/
+void OffscreenTarget::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  Unbind()
+ *
+ *  This method is used for directing drawing back into
+ *  the window.
+ ***********************************************************/
+void OffscreenTarget::Unbind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  ReadPixels()
+ *
+ *  This method is used for copying the color buffer back
+ *  into memory. It waits for the frame to finish drawing.
+ ***********************************************************/
+void OffscreenTarget::ReadPixels(std::vector<unsigned char>& pixels)
+{
+	pixels.resize((size_t)m_width * m_height * 3);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  WritePPM()
+ *
+ *  This method is used for saving pixels read back from
+ *  OpenGL as a binary PPM image. OpenGL returns the bottom
+ *  row first, so the rows are written in reverse.
+ ***********************************************************/
+bool OffscreenTarget::WritePPM(
+	const std::string& filename,
+	int width,
+	int height,
+	const std::vector<unsigned char>& pixels)
+{
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not write image " << filename << std::endl;
+		return(false);
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	size_t rowSize = (size_t)width * 3;
+	for (int row = height - 1; row >= 0; row--)
+	{
+		file.write((const char*)&pixels[row * rowSize], rowSize);
+	}
+
+	return(file.good());
+}
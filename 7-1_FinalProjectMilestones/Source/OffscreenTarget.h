@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// offscreentarget.h
+// ============
+// framebuffer object that the scene can be rendered into without a visible
+// window, and read back into image files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  OffscreenTarget
+ *
+ *  This class holds a framebuffer object with a color and
+ *  a depth renderbuffer. While it is bound, everything is
+ *  drawn into it instead of the window, and the finished
+ *  frame can be read back and saved as a PPM image.
+ ***********************************************************/
+class OffscreenTarget
+{
+public:
+	// constructor
+	OffscreenTarget();
+	// destructor
+	~OffscreenTarget();
+
+	// create the framebuffer at the given size
+	bool Create(int width, int height);
+	// free the framebuffer
+	void Destroy();
+
+	// draw into the framebuffer, or back into the window
+	void Bind();
+	void Unbind();
+
+	// read the color pixels of the framebuffer as RGB rows,
+	// bottom row first
+	void ReadPixels(std::vector<unsigned char>& pixels);
+	// save RGB pixels, bottom row first, as a binary PPM image
+	static bool WritePPM(
+		const std::string& filename,
+		int width,
+		int height,
+		const std::vector<unsigned char>& pixels);
+
+	// accessors for the framebuffer size
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+
+private:
+	// framebuffer and its attachments
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+	// size of the attachments in pixels
+	int m_width;
+	int m_height;
+};
@@ -0,0 +1,631 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitivemeshes.cpp
+// ============
+// generate the basic shape meshes and draw them with instanced rendering
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PrimitiveMeshes.h"
+
+#include <cmath>
+#include <cstddef>
+
+// declaration of the global variables and defines
+namespace
+{
+	const float PI = 3.14159265358979f;
+
+	// segments around the round shapes at each level of detail
+	const int LOD_SEGMENTS[PrimitiveMeshes::LOD_LEVEL_COUNT] = { PrimitiveMeshes::DEFAULT_SEGMENTS, 20, 12, 6 };
+}
+
+/***********************************************************
+ *  PrimitiveMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PrimitiveMeshes::PrimitiveMeshes()
+{
+	for (int i = 0; i < SceneGraph::MESH_COUNT; i++)
+	{
+		for (int level = 0; level < LOD_LEVEL_COUNT; level++)
+		{
+			m_meshes[i][level].vao = 0;
+			m_meshes[i][level].vbo = 0;
+			m_meshes[i][level].ibo = 0;
+			m_meshes[i][level].indexCount = 0;
+		}
+		m_levelCounts[i] = 0;
+		m_boundsMinimum[i] = glm::vec3(-1.0f);
+		m_boundsMaximum[i] = glm::vec3(1.0f);
+	}
+	m_instanceBuffer = 0;
+}
+
+/***********************************************************
+ *  ~PrimitiveMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PrimitiveMeshes::~PrimitiveMeshes()
+{
+	DestroyMeshes();
+}
+
+/***********************************************************
+ *  LoadMeshes()
+ *
+ *  This method is used for generating all of the basic
+ *  shape meshes at each of their levels of detail and
+ *  uploading them into OpenGL buffers.
+ ***********************************************************/
+void PrimitiveMeshes::LoadMeshes()
+{
+	for (int meshID = 0; meshID < SceneGraph::MESH_COUNT; meshID++)
+	{
+		for (int level = 0; level < GetShapeLevelCount(meshID); level++)
+		{
+			MESH_DATA mesh;
+			GenerateMesh(meshID, GetLevelSegments(level), mesh);
+			LoadMesh(meshID, level, &mesh.vertices[0], (int)mesh.vertices.size(), &mesh.indices[0], (int)mesh.indices.size());
+		}
+	}
+}
+
+/***********************************************************
+ *  LoadMesh()
+ *
+ *  This method is used for uploading the geometry of one
+ *  level of the basic shape meshes, either generated or read
+ *  from a scene package, in place of any already loaded
+ *  one. The bounds are taken from the full detail level.
+ ***********************************************************/
+void PrimitiveMeshes::LoadMesh(
+	int meshID,
+	int level,
+	const MESH_VERTEX* vertices,
+	int vertexCount,
+	const GLuint* indices,
+	int indexCount)
+{
+	if ((meshID < 0) || (meshID >= SceneGraph::MESH_COUNT) ||
+		(level < 0) || (level >= LOD_LEVEL_COUNT) ||
+		(vertexCount <= 0) || (indexCount <= 0))
+	{
+		return;
+	}
+
+	// the instance buffer must exist before the mesh vertex
+	// layouts can reference it
+	if (m_instanceBuffer == 0)
+	{
+		glGenBuffers(1, &m_instanceBuffer);
+	}
+
+	GL_MESH& glMesh = m_meshes[meshID][level];
+	FreeMesh(glMesh);
+
+	if (level == 0)
+	{
+		ComputeBounds(vertices, vertexCount, m_boundsMinimum[meshID], m_boundsMaximum[meshID]);
+		m_meshData[meshID].vertices.assign(vertices, vertices + vertexCount);
+		m_meshData[meshID].indices.assign(indices, indices + indexCount);
+	}
+	UploadMesh(vertices, vertexCount, indices, indexCount, glMesh);
+
+	// the levels are drawn in order, so only the run of them
+	// loaded from the full detail one up can be chosen
+	int levelCount = 0;
+	while ((levelCount < LOD_LEVEL_COUNT) && (m_meshes[meshID][levelCount].vao != 0))
+	{
+		levelCount++;
+	}
+	m_levelCounts[meshID] = levelCount;
+}
+
+/***********************************************************
+ *  DestroyMeshes()
+ *
+ *  This method is used for freeing all of the OpenGL
+ *  buffers used by the meshes.
+ ***********************************************************/
+void PrimitiveMeshes::DestroyMeshes()
+{
+	for (int i = 0; i < SceneGraph::MESH_COUNT; i++)
+	{
+		for (int level = 0; level < LOD_LEVEL_COUNT; level++)
+		{
+			FreeMesh(m_meshes[i][level]);
+		}
+		m_levelCounts[i] = 0;
+		m_meshData[i].vertices.clear();
+		m_meshData[i].indices.clear();
+	}
+	if (m_instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  UploadMesh()
+ *
+ *  This method is used for uploading the geometry of a mesh
+ *  and setting up the vertex layout, including the per-
+ *  instance attributes that advance once per instance.
+ ***********************************************************/
+void PrimitiveMeshes::UploadMesh(
+	const MESH_VERTEX* vertices,
+	int vertexCount,
+	const GLuint* indices,
+	int indexCount,
+	GL_MESH& glMesh)
+{
+	glGenVertexArrays(1, &glMesh.vao);
+	glBindVertexArray(glMesh.vao);
+
+	glGenBuffers(1, &glMesh.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, glMesh.vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(MESH_VERTEX), vertices, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &glMesh.ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glMesh.ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLuint), indices, GL_STATIC_DRAW);
+	glMesh.indexCount = (GLsizei)indexCount;
+
+	// per-vertex attributes
+	glEnableVertexAttribArray(POSITION_ATTRIBUTE);
+	glVertexAttribPointer(POSITION_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (void*)offsetof(MESH_VERTEX, position));
+	glEnableVertexAttribArray(NORMAL_ATTRIBUTE);
+	glVertexAttribPointer(NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (void*)offsetof(MESH_VERTEX, normal));
+	glEnableVertexAttribArray(TEXTURE_ATTRIBUTE);
+	glVertexAttribPointer(TEXTURE_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (void*)offsetof(MESH_VERTEX, textureCoordinate));
+
+	// per-instance attributes - the pointers are set for each
+	// run of instances when drawing
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(INSTANCE_MODEL_ATTRIBUTE + column);
+		glVertexAttribDivisor(INSTANCE_MODEL_ATTRIBUTE + column, 1);
+	}
+	glEnableVertexAttribArray(INSTANCE_MATERIAL_ATTRIBUTE);
+	glVertexAttribDivisor(INSTANCE_MATERIAL_ATTRIBUTE, 1);
+	glEnableVertexAttribArray(INSTANCE_TEXTURE_ATTRIBUTE);
+	glVertexAttribDivisor(INSTANCE_TEXTURE_ATTRIBUTE, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  FreeMesh()
+ *
+ *  This method is used for freeing the OpenGL objects of an
+ *  uploaded mesh, if it has any.
+ ***********************************************************/
+void PrimitiveMeshes::FreeMesh(GL_MESH& glMesh)
+{
+	if (glMesh.vao != 0)
+	{
+		glDeleteVertexArrays(1, &glMesh.vao);
+		glDeleteBuffers(1, &glMesh.vbo);
+		glDeleteBuffers(1, &glMesh.ibo);
+		glMesh.vao = 0;
+		glMesh.vbo = 0;
+		glMesh.ibo = 0;
+		glMesh.indexCount = 0;
+	}
+}
+
+/***********************************************************
+ *  UploadInstances()
+ *
+ *  This method is used for replacing the contents of the
+ *  per-instance buffer.
+ ***********************************************************/
+void PrimitiveMeshes::UploadInstances(const std::vector<INSTANCE_DATA>& instances)
+{
+	if (instances.empty())
+	{
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	// orphan the old storage so the driver does not have to
+	// wait for the previous frame's draws to finish with it
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(INSTANCE_DATA), NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(INSTANCE_DATA), &instances[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  DrawInstanced()
+ *
+ *  This method is used for drawing a run of consecutive
+ *  instances of one mesh level from the per-instance buffer
+ *  with a single draw call.
+ ***********************************************************/
+void PrimitiveMeshes::DrawInstanced(int meshID, int level, int firstInstance, int instanceCount)
+{
+	DrawInstanced(meshID, level, firstInstance, instanceCount, m_instanceBuffer);
+}
+
+/***********************************************************
+ *  DrawInstanced()
+ *
+ *  This method is used for drawing a run of consecutive
+ *  instances of one mesh from a buffer of instance values
+ *  kept apart from the shared one, such as the shadow
+ *  casters, so that drawing them does not disturb the
+ *  instances of the render queue, or from a part of a ring
+ *  buffer starting at an offset. A level that is not
+ *  loaded is drawn with the finest one below it.
+ ***********************************************************/
+void PrimitiveMeshes::DrawInstanced(
+	int meshID,
+	int level,
+	int firstInstance,
+	int instanceCount,
+	GLuint instanceBuffer,
+	GLintptr bufferOffset)
+{
+	if ((meshID < 0) || (meshID >= SceneGraph::MESH_COUNT) || (instanceCount <= 0) || (m_levelCounts[meshID] == 0))
+	{
+		return;
+	}
+
+	if (level >= m_levelCounts[meshID])
+	{
+		level = m_levelCounts[meshID] - 1;
+	}
+	else if (level < 0)
+	{
+		level = 0;
+	}
+
+	const GL_MESH& glMesh = m_meshes[meshID][level];
+	size_t instanceOffset = (size_t)bufferOffset + (size_t)firstInstance * sizeof(INSTANCE_DATA);
+
+	glBindVertexArray(glMesh.vao);
+
+	// point the per-instance attributes at the first instance of the run
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(
+			INSTANCE_MODEL_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, sizeof(INSTANCE_DATA),
+			(void*)(instanceOffset + offsetof(INSTANCE_DATA, model) + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribIPointer(
+		INSTANCE_MATERIAL_ATTRIBUTE, 1, GL_INT, sizeof(INSTANCE_DATA),
+		(void*)(instanceOffset + offsetof(INSTANCE_DATA, materialIndex)));
+	glVertexAttribIPointer(
+		INSTANCE_TEXTURE_ATTRIBUTE, 1, GL_INT, sizeof(INSTANCE_DATA),
+		(void*)(instanceOffset + offsetof(INSTANCE_DATA, textureLayer)));
+
+	glDrawElementsInstanced(GL_TRIANGLES, glMesh.indexCount, GL_UNSIGNED_INT, NULL, instanceCount);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  GenerateMesh()
+ *
+ *  This method is used for building the geometry of one of
+ *  the basic shapes, using the same unit sizes as the
+ *  ShapeMeshes shapes. The segments value sets how many
+ *  segments are used around the round shapes.
+ ***********************************************************/
+void PrimitiveMeshes::GenerateMesh(int meshID, int segments, MESH_DATA& mesh)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+
+	switch (meshID)
+	{
+	case SceneGraph::MESH_PLANE:
+		// 2 x 2 plane on the XZ axes, facing up
+		AddQuadFace(mesh, glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		break;
+	case SceneGraph::MESH_BOX:
+		// 1 x 1 x 1 box centered on the origin
+		AddQuadFace(mesh, glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		AddQuadFace(mesh, glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+		AddQuadFace(mesh, glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+		AddQuadFace(mesh, glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
+		AddQuadFace(mesh, glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+		AddQuadFace(mesh, glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.0f, -1.0f, 0.0f));
+		break;
+	case SceneGraph::MESH_CYLINDER:
+		// radius 1, from a height of 0 up to 1
+		AddRevolvedSide(mesh, segments, 1.0f, 1.0f);
+		AddDiskCap(mesh, segments, 1.0f, 1.0f, true);
+		AddDiskCap(mesh, segments, 0.0f, 1.0f, false);
+		break;
+	case SceneGraph::MESH_TAPERED_CYLINDER:
+		// radius 1 at the bottom narrowing to 0.5 at the top
+		AddRevolvedSide(mesh, segments, 1.0f, 0.5f);
+		AddDiskCap(mesh, segments, 1.0f, 0.5f, true);
+		AddDiskCap(mesh, segments, 0.0f, 1.0f, false);
+		break;
+	case SceneGraph::MESH_CONE:
+		// radius 1 at the bottom up to a point at a height of 1
+		AddRevolvedSide(mesh, segments, 1.0f, 0.0f);
+		AddDiskCap(mesh, segments, 0.0f, 1.0f, false);
+		break;
+	case SceneGraph::MESH_SPHERE:
+		// radius 1 centered on the origin
+		AddSphere(mesh, segments);
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  GetShapeLevelCount()
+ *
+ *  This method is used for getting how many levels of
+ *  detail a basic shape is made at. The plane and the box
+ *  have no segments to take away, so they only have one.
+ ***********************************************************/
+int PrimitiveMeshes::GetShapeLevelCount(int meshID)
+{
+	if ((meshID == SceneGraph::MESH_PLANE) || (meshID == SceneGraph::MESH_BOX))
+	{
+		return(1);
+	}
+
+	return(LOD_LEVEL_COUNT);
+}
+
+/***********************************************************
+ *  GetLevelSegments()
+ *
+ *  This method is used for getting the number of segments
+ *  around the round shapes at a level of detail.
+ ***********************************************************/
+int PrimitiveMeshes::GetLevelSegments(int level)
+{
+	if ((level < 0) || (level >= LOD_LEVEL_COUNT))
+	{
+		return(DEFAULT_SEGMENTS);
+	}
+
+	return(LOD_SEGMENTS[level]);
+}
+
+/***********************************************************
+ *  ComputeBounds()
+ *
+ *  This method is used for finding the object space box
+ *  that holds all of the vertices of a mesh.
+ ***********************************************************/
+void PrimitiveMeshes::ComputeBounds(const MESH_VERTEX* vertices, int vertexCount, glm::vec3& minimumXYZ, glm::vec3& maximumXYZ)
+{
+	if (vertexCount <= 0)
+	{
+		minimumXYZ = glm::vec3(0.0f);
+		maximumXYZ = glm::vec3(0.0f);
+		return;
+	}
+
+	minimumXYZ = vertices[0].position;
+	maximumXYZ = vertices[0].position;
+	for (int i = 1; i < vertexCount; i++)
+	{
+		minimumXYZ = glm::min(minimumXYZ, vertices[i].position);
+		maximumXYZ = glm::max(maximumXYZ, vertices[i].position);
+	}
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the object space box
+ *  of one of the loaded meshes.
+ ***********************************************************/
+void PrimitiveMeshes::GetMeshBounds(int meshID, glm::vec3& minimumXYZ, glm::vec3& maximumXYZ) const
+{
+	minimumXYZ = m_boundsMinimum[meshID];
+	maximumXYZ = m_boundsMaximum[meshID];
+}
+
+/***********************************************************
+ *  AddQuadFace()
+ *
+ *  This method is used for adding a flat four sided face,
+ *  spanning the center plus and minus the two axes.
+ ***********************************************************/
+void PrimitiveMeshes::AddQuadFace(
+	MESH_DATA& mesh,
+	const glm::vec3& center,
+	const glm::vec3& axisU,
+	const glm::vec3& axisV,
+	const glm::vec3& normal)
+{
+	GLuint first = (GLuint)mesh.vertices.size();
+	const float cornerU[4] = { -1.0f, 1.0f, 1.0f, -1.0f };
+	const float cornerV[4] = { -1.0f, -1.0f, 1.0f, 1.0f };
+
+	for (int i = 0; i < 4; i++)
+	{
+		MESH_VERTEX vertex;
+		vertex.position = center + axisU * cornerU[i] + axisV * cornerV[i];
+		vertex.normal = normal;
+		vertex.textureCoordinate = glm::vec2((cornerU[i] + 1.0f) * 0.5f, (cornerV[i] + 1.0f) * 0.5f);
+		mesh.vertices.push_back(vertex);
+	}
+
+	const GLuint quad[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int i = 0; i < 6; i++)
+	{
+		mesh.indices.push_back(first + quad[i]);
+	}
+}
+
+/***********************************************************
+ *  AddRevolvedSide()
+ *
+ *  This method is used for adding the side of a cylinder,
+ *  tapered cylinder or cone from a height of 0 up to 1.
+ ***********************************************************/
+void PrimitiveMeshes::AddRevolvedSide(
+	MESH_DATA& mesh,
+	int segments,
+	float bottomRadius,
+	float topRadius)
+{
+	GLuint first = (GLuint)mesh.vertices.size();
+
+	for (int i = 0; i <= segments; i++)
+	{
+		float u = (float)i / (float)segments;
+		float angle = u * 2.0f * PI;
+		float cosAngle = cosf(angle);
+		float sinAngle = sinf(angle);
+		// the side normal leans up by the slope of the side
+		glm::vec3 normal = glm::normalize(glm::vec3(cosAngle, bottomRadius - topRadius, sinAngle));
+
+		MESH_VERTEX bottom;
+		bottom.position = glm::vec3(cosAngle * bottomRadius, 0.0f, sinAngle * bottomRadius);
+		bottom.normal = normal;
+		bottom.textureCoordinate = glm::vec2(u, 0.0f);
+		mesh.vertices.push_back(bottom);
+
+		MESH_VERTEX top;
+		top.position = glm::vec3(cosAngle * topRadius, 1.0f, sinAngle * topRadius);
+		top.normal = normal;
+		top.textureCoordinate = glm::vec2(u, 1.0f);
+		mesh.vertices.push_back(top);
+	}
+
+	for (int i = 0; i < segments; i++)
+	{
+		GLuint bottom0 = first + i * 2;
+		GLuint top0 = bottom0 + 1;
+		GLuint bottom1 = bottom0 + 2;
+		GLuint top1 = bottom0 + 3;
+
+		mesh.indices.push_back(bottom0);
+		mesh.indices.push_back(top0);
+		mesh.indices.push_back(bottom1);
+		// a cone has no area at the top of the side
+		if (topRadius > 0.0f)
+		{
+			mesh.indices.push_back(top0);
+			mesh.indices.push_back(top1);
+			mesh.indices.push_back(bottom1);
+		}
+	}
+}
+
+/***********************************************************
+ *  AddDiskCap()
+ *
+ *  This method is used for adding a flat round cap at the
+ *  passed in height, facing either up or down.
+ ***********************************************************/
+void PrimitiveMeshes::AddDiskCap(
+	MESH_DATA& mesh,
+	int segments,
+	float height,
+	float radius,
+	bool bFacingUp)
+{
+	GLuint center = (GLuint)mesh.vertices.size();
+	glm::vec3 normal(0.0f, bFacingUp ? 1.0f : -1.0f, 0.0f);
+
+	MESH_VERTEX centerVertex;
+	centerVertex.position = glm::vec3(0.0f, height, 0.0f);
+	centerVertex.normal = normal;
+	centerVertex.textureCoordinate = glm::vec2(0.5f, 0.5f);
+	mesh.vertices.push_back(centerVertex);
+
+	for (int i = 0; i <= segments; i++)
+	{
+		float angle = (float)i / (float)segments * 2.0f * PI;
+		float cosAngle = cosf(angle);
+		float sinAngle = sinf(angle);
+
+		MESH_VERTEX vertex;
+		vertex.position = glm::vec3(cosAngle * radius, height, sinAngle * radius);
+		vertex.normal = normal;
+		vertex.textureCoordinate = glm::vec2(0.5f + cosAngle * 0.5f, 0.5f + sinAngle * 0.5f);
+		mesh.vertices.push_back(vertex);
+	}
+
+	for (int i = 0; i < segments; i++)
+	{
+		GLuint ring0 = center + 1 + i;
+		GLuint ring1 = ring0 + 1;
+
+		mesh.indices.push_back(center);
+		if (bFacingUp)
+		{
+			mesh.indices.push_back(ring1);
+			mesh.indices.push_back(ring0);
+		}
+		else
+		{
+			mesh.indices.push_back(ring0);
+			mesh.indices.push_back(ring1);
+		}
+	}
+}
+
+/***********************************************************
+ *  AddSphere()
+ *
+ *  This method is used for adding a sphere of radius 1,
+ *  with half as many stacks as segments around it.
+ ***********************************************************/
+void PrimitiveMeshes::AddSphere(
+	MESH_DATA& mesh,
+	int segments)
+{
+	GLuint first = (GLuint)mesh.vertices.size();
+	int stacks = segments / 2;
+	if (stacks < 2)
+	{
+		stacks = 2;
+	}
+
+	for (int stack = 0; stack <= stacks; stack++)
+	{
+		float v = (float)stack / (float)stacks;
+		float polar = v * PI;
+
+		for (int i = 0; i <= segments; i++)
+		{
+			float u = (float)i / (float)segments;
+			float angle = u * 2.0f * PI;
+
+			MESH_VERTEX vertex;
+			vertex.normal = glm::vec3(sinf(polar) * cosf(angle), cosf(polar), sinf(polar) * sinf(angle));
+			vertex.position = vertex.normal;
+			vertex.textureCoordinate = glm::vec2(u, 1.0f - v);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	GLuint rowLength = segments + 1;
+	for (int stack = 0; stack < stacks; stack++)
+	{
+		for (int i = 0; i < segments; i++)
+		{
+			GLuint top0 = first + stack * rowLength + i;
+			GLuint top1 = top0 + 1;
+			GLuint bottom0 = top0 + rowLength;
+			GLuint bottom1 = bottom0 + 1;
+
+			mesh.indices.push_back(bottom0);
+			mesh.indices.push_back(top0);
+			mesh.indices.push_back(bottom1);
+			mesh.indices.push_back(top0);
+			mesh.indices.push_back(top1);
+			mesh.indices.push_back(bottom1);
+		}
+	}
+}
@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitivemeshes.h
+// ============
+// generate the basic shape meshes and draw them with instanced rendering
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneGraph.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  PrimitiveMeshes
+ *
+ *  This class generates the same unit sized basic shapes as
+ *  ShapeMeshes, as indexed meshes that read their model
+ *  matrix, material index and texture layer from a shared
+ *  per-instance buffer, so each run of repeated shapes can
+ *  be drawn with a single instanced draw call. The round
+ *  shapes are made at several levels of detail, each with
+ *  fewer segments than the one before, so objects that are
+ *  small on the screen can be drawn with fewer triangles.
+ ***********************************************************/
+class PrimitiveMeshes
+{
+public:
+	// constructor
+	PrimitiveMeshes();
+	// destructor
+	~PrimitiveMeshes();
+
+	// one vertex of a generated mesh
+	struct MESH_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 textureCoordinate;
+	};
+
+	// the CPU side geometry of a generated mesh
+	struct MESH_DATA
+	{
+		std::vector<MESH_VERTEX> vertices;
+		std::vector<GLuint> indices;
+	};
+
+	// the per-instance values read by the vertex shader
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		int materialIndex;
+		int textureLayer;
+		int padding[2];
+	};
+
+	// the OpenGL objects of an uploaded mesh
+	struct GL_MESH
+	{
+		GLuint vao;
+		GLuint vbo;
+		GLuint ibo;
+		GLsizei indexCount;
+	};
+
+	// number of segments around the round shapes at full detail
+	static const int DEFAULT_SEGMENTS = 36;
+	// number of levels of detail the round shapes are made at
+	static const int LOD_LEVEL_COUNT = 4;
+
+	// vertex attribute locations used by vertexShader.glsl
+	static const GLuint POSITION_ATTRIBUTE = 0;
+	static const GLuint NORMAL_ATTRIBUTE = 1;
+	static const GLuint TEXTURE_ATTRIBUTE = 2;
+	static const GLuint INSTANCE_MODEL_ATTRIBUTE = 3;		// uses 3 through 6
+	static const GLuint INSTANCE_MATERIAL_ATTRIBUTE = 7;
+	static const GLuint INSTANCE_TEXTURE_ATTRIBUTE = 8;
+
+	// generate all the basic shape meshes and upload them
+	void LoadMeshes();
+	// upload the geometry of one level of a basic shape mesh
+	void LoadMesh(
+		int meshID,
+		int level,
+		const MESH_VERTEX* vertices,
+		int vertexCount,
+		const GLuint* indices,
+		int indexCount);
+	// free all the OpenGL mesh and instance buffers
+	void DestroyMeshes();
+
+	// replace the contents of the per-instance buffer
+	void UploadInstances(const std::vector<INSTANCE_DATA>& instances);
+	// draw a run of instances of one mesh level from the instance buffer
+	void DrawInstanced(int meshID, int level, int firstInstance, int instanceCount);
+	// draw a run of instances from another buffer of instance values,
+	// whose first instance starts at a byte offset into the buffer
+	void DrawInstanced(
+		int meshID,
+		int level,
+		int firstInstance,
+		int instanceCount,
+		GLuint instanceBuffer,
+		GLintptr bufferOffset = 0);
+
+	// object space bounding box of a mesh, the same at every level
+	void GetMeshBounds(int meshID, glm::vec3& minimumXYZ, glm::vec3& maximumXYZ) const;
+	// the geometry of the full detail level of a mesh as loaded
+	const MESH_DATA& GetMeshData(int meshID) const { return(m_meshData[meshID]); }
+
+	// number of levels of a mesh that are loaded
+	int GetLevelCount(int meshID) const { return(m_levelCounts[meshID]); }
+	// number of triangles in one instance of a mesh level
+	int GetTriangleCount(int meshID, int level) const { return(m_meshes[meshID][level].indexCount / 3); }
+
+	// build the geometry of a basic shape mesh
+	static void GenerateMesh(int meshID, int segments, MESH_DATA& mesh);
+	// number of levels a basic shape is made at, which is one
+	// for the shapes without round sides
+	static int GetShapeLevelCount(int meshID);
+	// number of segments around the round shapes at a level
+	static int GetLevelSegments(int level);
+	// find the bounding box of the mesh vertices
+	static void ComputeBounds(const MESH_VERTEX* vertices, int vertexCount, glm::vec3& minimumXYZ, glm::vec3& maximumXYZ);
+
+	// upload the geometry of a mesh and set up its vertex layout,
+	// so meshes made elsewhere can be drawn the same way
+	static void UploadMesh(
+		const MESH_VERTEX* vertices,
+		int vertexCount,
+		const GLuint* indices,
+		int indexCount,
+		GL_MESH& glMesh);
+	// free the OpenGL objects of an uploaded mesh
+	static void FreeMesh(GL_MESH& glMesh);
+
+private:
+	// uploaded basic shape meshes indexed by SceneGraph::MESH_TYPE
+	// and level of detail, and the number of levels loaded
+	GL_MESH m_meshes[SceneGraph::MESH_COUNT][LOD_LEVEL_COUNT];
+	int m_levelCounts[SceneGraph::MESH_COUNT];
+	// CPU side copy of the full detail level of the meshes
+	MESH_DATA m_meshData[SceneGraph::MESH_COUNT];
+	// object space bounds of the meshes
+	glm::vec3 m_boundsMinimum[SceneGraph::MESH_COUNT];
+	glm::vec3 m_boundsMaximum[SceneGraph::MESH_COUNT];
+	// buffer holding the per-instance values
+	GLuint m_instanceBuffer;
+
+	// geometry builders for the basic shapes
+	static void AddQuadFace(
+		MESH_DATA& mesh,
+		const glm::vec3& center,
+		const glm::vec3& axisU,
+		const glm::vec3& axisV,
+		const glm::vec3& normal);
+	static void AddRevolvedSide(
+		MESH_DATA& mesh,
+		int segments,
+		float bottomRadius,
+		float topRadius);
+	static void AddDiskCap(
+		MESH_DATA& mesh,
+		int segments,
+		float height,
+		float radius,
+		bool bFacingUp);
+	static void AddSphere(
+		MESH_DATA& mesh,
+		int segments);
+};
@@ -0,0 +1,312 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// collect the draws of a frame, sort them by a packed state and depth key,
+// and merge neighbouring draws that share the same state into batches
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// widths of the sort key fields
+	const int VARIANT_BITS = 4;
+	const int MESH_BITS = 8;
+	const int LOD_BITS = 2;
+	const int TEXTURE_BITS = 12;
+	const int MATERIAL_BITS = 12;
+	const int DEPTH_BITS = 24;
+
+	// the top bit places every blended item after the opaque ones
+	const uint64_t BLENDED_BIT = 1ULL << 63;
+
+	// fewest items sorted by one thread when the sort is split
+	const int MIN_SORT_RUN_ITEMS = 4096;
+
+	/***********************************************************
+	 *  QuantizeDepth()
+	 *
+	 *  The bit pattern of a non-negative float grows with its
+	 *  value, so the top bits of it can be used as a depth
+	 *  value that sorts correctly without knowing the range
+	 *  of the scene. Depths behind the camera are clamped.
+	 ***********************************************************/
+	uint64_t QuantizeDepth(float viewDepth)
+	{
+		if (!(viewDepth > 0.0f))
+		{
+			viewDepth = 0.0f;
+		}
+
+		uint32_t bits = 0;
+		memcpy(&bits, &viewDepth, sizeof(bits));
+
+		return((uint64_t)(bits >> (31 - DEPTH_BITS)));
+	}
+
+	/***********************************************************
+	 *  PackField()
+	 *
+	 *  Shift an index into the field of the given width. The
+	 *  indices are offset by one so that -1, meaning none,
+	 *  sorts first.
+	 ***********************************************************/
+	uint64_t PackField(int value, int bits)
+	{
+		uint64_t mask = (1ULL << bits) - 1;
+		return((uint64_t)(value + 1) & mask);
+	}
+
+	/***********************************************************
+	 *  CompareItems()
+	 *
+	 *  Orders two items by their keys, and by node when the
+	 *  keys are equal, so every sort gives the same order.
+	 ***********************************************************/
+	bool CompareItems(const RenderQueue::RENDER_ITEM& a, const RenderQueue::RENDER_ITEM& b)
+	{
+		if (a.sortKey != b.sortKey)
+			return(a.sortKey < b.sortKey);
+		return(a.node < b.node);
+	}
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+}
+
+/***********************************************************
+ *  ~RenderQueue()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderQueue::~RenderQueue()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the items from the
+ *  queue, keeping the allocated storage for the next frame.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_items.clear();
+	m_batches.clear();
+}
+
+/***********************************************************
+ *  MakeSortKey()
+ *
+ *  This method is used for packing the state and depth of
+ *  an item into a single 64-bit value.
+ *
+ *  opaque:  | 0 | variant 4 | mesh 8 | lod 2 | texture 12 | material 12 | - | depth 24 |
+ *  blended: | 1 | far-to-near depth 24 | variant 4 | mesh 8 | lod 2 | texture 12 | material 12 | - |
+ *
+ *  The level of detail is stored as is, not offset like the
+ *  indices, since it is never -1.
+ ***********************************************************/
+uint64_t RenderQueue::MakeSortKey(
+	int shaderVariant,
+	int meshID,
+	int lodLevel,
+	int textureSlot,
+	int materialID,
+	float viewDepth,
+	bool bBlended)
+{
+	uint64_t state =
+		(PackField(shaderVariant, VARIANT_BITS) << (MESH_BITS + LOD_BITS + TEXTURE_BITS + MATERIAL_BITS)) |
+		(PackField(meshID, MESH_BITS) << (LOD_BITS + TEXTURE_BITS + MATERIAL_BITS)) |
+		(((uint64_t)lodLevel & ((1ULL << LOD_BITS) - 1)) << (TEXTURE_BITS + MATERIAL_BITS)) |
+		(PackField(textureSlot, TEXTURE_BITS) << MATERIAL_BITS) |
+		PackField(materialID, MATERIAL_BITS);
+	uint64_t depth = QuantizeDepth(viewDepth);
+	uint64_t sortKey = 0;
+
+	if (bBlended == false)
+	{
+		// state first, then nearest objects first within each state
+		sortKey = (state << (63 - VARIANT_BITS - MESH_BITS - LOD_BITS - TEXTURE_BITS - MATERIAL_BITS)) | depth;
+	}
+	else
+	{
+		// farthest objects first, so blending composites correctly
+		uint64_t farToNear = ((1ULL << DEPTH_BITS) - 1) - depth;
+		sortKey = BLENDED_BIT |
+			(farToNear << (63 - DEPTH_BITS)) |
+			(state << (63 - DEPTH_BITS - VARIANT_BITS - MESH_BITS - LOD_BITS - TEXTURE_BITS - MATERIAL_BITS));
+	}
+
+	return(sortKey);
+}
+
+/***********************************************************
+ *  MakeItem()
+ *
+ *  This method is used for building an item with its sort
+ *  key. It touches no queue, so it can run on any thread.
+ ***********************************************************/
+RenderQueue::RENDER_ITEM RenderQueue::MakeItem(
+	int node,
+	int shaderVariant,
+	int meshID,
+	int lodLevel,
+	int textureSlot,
+	int materialID,
+	float viewDepth,
+	bool bBlended)
+{
+	RENDER_ITEM item;
+	item.sortKey = MakeSortKey(shaderVariant, meshID, lodLevel, textureSlot, materialID, viewDepth, bBlended);
+	item.node = node;
+	item.shaderVariant = shaderVariant;
+	item.meshID = meshID;
+	item.lodLevel = lodLevel;
+	item.textureSlot = textureSlot;
+	item.materialID = materialID;
+
+	return(item);
+}
+
+/***********************************************************
+ *  AddItem()
+ *
+ *  This method is used for adding an object to be drawn in
+ *  the current frame. The view depth is the distance of the
+ *  object in front of the camera, and the level of detail
+ *  is the one of its mesh it is drawn with.
+ ***********************************************************/
+void RenderQueue::AddItem(
+	int node,
+	int shaderVariant,
+	int meshID,
+	int lodLevel,
+	int textureSlot,
+	int materialID,
+	float viewDepth,
+	bool bBlended)
+{
+	m_items.push_back(MakeItem(node, shaderVariant, meshID, lodLevel, textureSlot, materialID, viewDepth, bBlended));
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the items by their keys
+ *  and merging them into batches. Items with equal keys
+ *  keep a stable order by node, so the submitted order does
+ *  not flicker between frames. With a job system the items
+ *  are cut into one run per thread, the runs are sorted at
+ *  the same time, and neighbouring runs are merged in pairs
+ *  until one is left, giving the same order as one sort.
+ ***********************************************************/
+void RenderQueue::Sort(JobSystem* pJobSystem)
+{
+	int itemCount = (int)m_items.size();
+	int runCount = (NULL != pJobSystem) ? pJobSystem->GetThreadCount() : 1;
+	runCount = std::min(runCount, itemCount / MIN_SORT_RUN_ITEMS);
+
+	if (runCount <= 1)
+	{
+		std::sort(m_items.begin(), m_items.end(), CompareItems);
+		BuildBatches();
+		return;
+	}
+
+	std::vector<int> runStarts(runCount + 1);
+	for (int run = 0; run <= runCount; run++)
+	{
+		runStarts[run] = (int)((long long)itemCount * run / runCount);
+	}
+
+	pJobSystem->ParallelFor(runCount, 1,
+		[this, &runStarts](int first, int last)
+		{
+			for (int run = first; run < last; run++)
+			{
+				std::sort(m_items.begin() + runStarts[run], m_items.begin() + runStarts[run + 1], CompareItems);
+			}
+		});
+
+	m_sortScratch.resize(itemCount);
+	while (runCount > 1)
+	{
+		int pairCount = (runCount + 1) / 2;
+		pJobSystem->ParallelFor(pairCount, 1,
+			[this, &runStarts, runCount](int first, int last)
+			{
+				for (int pair = first; pair < last; pair++)
+				{
+					int start = runStarts[pair * 2];
+					int middle = runStarts[std::min(pair * 2 + 1, runCount)];
+					int end = runStarts[std::min(pair * 2 + 2, runCount)];
+					std::merge(
+						m_items.begin() + start, m_items.begin() + middle,
+						m_items.begin() + middle, m_items.begin() + end,
+						m_sortScratch.begin() + start,
+						CompareItems);
+				}
+			});
+		m_items.swap(m_sortScratch);
+
+		// every merged pair starts where its first run did
+		for (int pair = 0; pair < pairCount; pair++)
+		{
+			runStarts[pair] = runStarts[pair * 2];
+		}
+		runStarts[pairCount] = itemCount;
+		runCount = pairCount;
+	}
+
+	BuildBatches();
+}
+
+/***********************************************************
+ *  BuildBatches()
+ *
+ *  This method is used for merging neighbouring sorted items
+ *  into batches. The material and the texture layer are
+ *  read per instance, so a batch only ends where the shader
+ *  variant, the mesh, its level of detail or the blend mode
+ *  changes.
+ ***********************************************************/
+void RenderQueue::BuildBatches()
+{
+	m_batches.clear();
+
+	for (int i = 0; i < (int)m_items.size(); i++)
+	{
+		const RENDER_ITEM& item = m_items[i];
+		bool bBlended = (item.sortKey & BLENDED_BIT) != 0;
+
+		if (m_batches.empty() ||
+			(m_batches.back().shaderVariant != item.shaderVariant) ||
+			(m_batches.back().meshID != item.meshID) ||
+			(m_batches.back().lodLevel != item.lodLevel) ||
+			(m_batches.back().bBlended != bBlended))
+		{
+			RENDER_BATCH batch;
+			batch.shaderVariant = item.shaderVariant;
+			batch.meshID = item.meshID;
+			batch.lodLevel = item.lodLevel;
+			batch.bBlended = bBlended;
+			batch.firstItem = i;
+			batch.itemCount = 0;
+			m_batches.push_back(batch);
+		}
+		m_batches.back().itemCount++;
+	}
+}
@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// collect the draws of a frame, sort them by a packed state and depth key,
+// and merge neighbouring draws that share the same state into batches
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class holds one item per object to be drawn, each
+ *  with a 64-bit sort key. Opaque items are keyed by shader
+ *  variant, mesh, level of detail, texture and material first and then
+ *  front-to-back depth, so state changes are kept to a
+ *  minimum and early depth rejection works. Blended items sort after all the opaque
+ *  ones and are keyed back-to-front by depth first.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+	// destructor
+	~RenderQueue();
+
+	// one object to be drawn
+	struct RENDER_ITEM
+	{
+		uint64_t sortKey;
+		int node;
+		int shaderVariant;
+		int meshID;
+		int lodLevel;
+		int textureSlot;
+		int materialID;
+	};
+
+	// a run of sorted items that can be drawn with one call
+	struct RENDER_BATCH
+	{
+		int shaderVariant;
+		int meshID;
+		int lodLevel;
+		bool bBlended;
+		int firstItem;
+		int itemCount;
+	};
+
+	// remove all the items and batches
+	void Clear();
+	// add an object to be drawn this frame
+	void AddItem(
+		int node,
+		int shaderVariant,
+		int meshID,
+		int lodLevel,
+		int textureSlot,
+		int materialID,
+		float viewDepth,
+		bool bBlended);
+	// add an item made with MakeItem()
+	void AddItem(const RENDER_ITEM& item) { m_items.push_back(item); }
+	// sort the items and merge them into batches, over the
+	// threads of a job system when one is given
+	void Sort(JobSystem* pJobSystem = NULL);
+
+	// build one item, so the items can be made on other threads
+	static RENDER_ITEM MakeItem(
+		int node,
+		int shaderVariant,
+		int meshID,
+		int lodLevel,
+		int textureSlot,
+		int materialID,
+		float viewDepth,
+		bool bBlended);
+
+	// build the sort key of one item
+	static uint64_t MakeSortKey(
+		int shaderVariant,
+		int meshID,
+		int lodLevel,
+		int textureSlot,
+		int materialID,
+		float viewDepth,
+		bool bBlended);
+
+	// accessors for the sorted items and batches
+	int GetItemCount() const { return((int)m_items.size()); }
+	const RENDER_ITEM& GetItem(int item) const { return(m_items[item]); }
+	int GetBatchCount() const { return((int)m_batches.size()); }
+	const RENDER_BATCH& GetBatch(int batch) const { return(m_batches[batch]); }
+
+private:
+	// the items in the order they were added, until sorted
+	std::vector<RENDER_ITEM> m_items;
+	// the runs of items sharing a shader variant, mesh level and blend mode
+	std::vector<RENDER_BATCH> m_batches;
+	// the items of the sorted runs while they are merged
+	std::vector<RENDER_ITEM> m_sortScratch;
+
+	// merge neighbouring sorted items into batches
+	void BuildBatches();
+};
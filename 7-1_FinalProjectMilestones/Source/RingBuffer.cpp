@@ -0,0 +1,303 @@
+///////////////////////////////////////////////////////////////////////////////
+// ringbuffer.cpp
+// ============
+// hand out per-frame buffer memory from a few regions of one persistently
+// mapped buffer, each guarded by a fence until the GPU is done with it
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// nanoseconds a blocked fence wait sleeps in the driver
+	// before it checks again
+	const GLuint64 FENCE_WAIT_TIMEOUT = 1000000;
+}
+
+/***********************************************************
+ *  RingBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RingBuffer::RingBuffer()
+{
+	m_buffer = 0;
+	m_target = GL_ARRAY_BUFFER;
+	m_regionBytes = 0;
+	m_bAllowPersistent = true;
+	m_pMapped = NULL;
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		m_regions[i].fence = 0;
+		m_regions[i].usedBytes = 0;
+	}
+	m_currentRegion = REGION_COUNT - 1;
+	ResetStats();
+}
+
+/***********************************************************
+ *  ~RingBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RingBuffer::~RingBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the buffer with room
+ *  for a number of bytes in each of its regions. The
+ *  buffer is only mapped for good when the driver has
+ *  immutable buffer storage.
+ ***********************************************************/
+void RingBuffer::Create(GLenum target, size_t regionBytes, bool bAllowPersistent)
+{
+	Destroy();
+
+	m_target = target;
+	m_regionBytes = std::max(regionBytes, (size_t)1);
+	m_bAllowPersistent = bAllowPersistent;
+	CreateStorage();
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for waiting until the GPU is done
+ *  with every region and freeing the buffer.
+ ***********************************************************/
+void RingBuffer::Destroy()
+{
+	if (m_buffer == 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		WaitForRegion(i);
+		m_regions[i].usedBytes = 0;
+	}
+
+	if (NULL != m_pMapped)
+	{
+		glBindBuffer(m_target, m_buffer);
+		glUnmapBuffer(m_target);
+		glBindBuffer(m_target, 0);
+		m_pMapped = NULL;
+	}
+	glDeleteBuffers(1, &m_buffer);
+	m_buffer = 0;
+	m_copy.clear();
+	m_currentRegion = REGION_COUNT - 1;
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for making sure every region holds
+ *  a number of bytes. A buffer that is too small is made
+ *  again with half as much room again as asked for, so a
+ *  scene that keeps growing does not do it every frame.
+ ***********************************************************/
+bool RingBuffer::Reserve(size_t regionBytes)
+{
+	if ((m_buffer != 0) && (regionBytes <= m_regionBytes))
+	{
+		return(false);
+	}
+
+	Create(m_target, regionBytes + regionBytes / 2, m_bAllowPersistent);
+	return(true);
+}
+
+/***********************************************************
+ *  BeginRegion()
+ *
+ *  This method is used for moving on to the next region.
+ *  Its values were last read by the draws of a few frames
+ *  ago, so the fence behind them has normally been passed
+ *  and nothing is waited for.
+ ***********************************************************/
+int RingBuffer::BeginRegion()
+{
+	m_currentRegion = (m_currentRegion + 1) % REGION_COUNT;
+	WaitForRegion(m_currentRegion);
+	m_regions[m_currentRegion].usedBytes = 0;
+	m_regionCount++;
+
+	return(m_currentRegion);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for taking bytes from the current
+ *  region. The pointer is into the mapped buffer, or into
+ *  the copy in memory that Flush() sends from, and stays
+ *  valid for writing from any thread until the region is
+ *  begun again. The offset is aligned in the buffer and
+ *  not only in the region, since a region that was grown
+ *  by Reserve() need not start on the alignment.
+ ***********************************************************/
+void* RingBuffer::Allocate(size_t bytes, size_t alignment, GLintptr& offset)
+{
+	RING_REGION& region = m_regions[m_currentRegion];
+	alignment = std::max(alignment, (size_t)1);
+	size_t regionStart = m_currentRegion * m_regionBytes;
+	size_t start = (regionStart + region.usedBytes + alignment - 1) / alignment * alignment - regionStart;
+
+	if ((m_buffer == 0) || (start + bytes > m_regionBytes))
+	{
+		offset = 0;
+		return(NULL);
+	}
+
+	region.usedBytes = start + bytes;
+	offset = (GLintptr)(regionStart + start);
+
+	if (NULL != m_pMapped)
+	{
+		return(m_pMapped + offset);
+	}
+	return(&m_copy[offset]);
+}
+
+/***********************************************************
+ *  Flush()
+ *
+ *  This method is used for sending the bytes written into
+ *  the copy in memory to the buffer. The region was waited
+ *  for when it was begun, so the upload does not have to
+ *  wait for the GPU either. A mapped buffer sees the bytes
+ *  as soon as they are written, and nothing is done.
+ ***********************************************************/
+void RingBuffer::Flush(GLintptr offset, size_t bytes)
+{
+	if ((NULL != m_pMapped) || (m_buffer == 0) || (bytes == 0))
+	{
+		return;
+	}
+
+	glBindBuffer(m_target, m_buffer);
+	glBufferSubData(m_target, offset, bytes, &m_copy[offset]);
+	glBindBuffer(m_target, 0);
+}
+
+/***********************************************************
+ *  FenceRegion()
+ *
+ *  This method is used for placing a fence behind the draws
+ *  sent so far, in place of any earlier fence of a region,
+ *  since a region drawn in several frames is only free
+ *  once the last of them is done.
+ ***********************************************************/
+void RingBuffer::FenceRegion(int region)
+{
+	if ((m_buffer == 0) || (region < 0) || (region >= REGION_COUNT))
+	{
+		return;
+	}
+
+	if (m_regions[region].fence != 0)
+	{
+		glDeleteSync(m_regions[region].fence);
+	}
+	m_regions[region].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for clearing the region count and
+ *  the time waited on fences.
+ ***********************************************************/
+void RingBuffer::ResetStats()
+{
+	m_regionCount = 0;
+	m_stallCount = 0;
+	m_waitSeconds = 0.0;
+}
+
+/***********************************************************
+ *  CreateStorage()
+ *
+ *  This method is used for creating the storage of all the
+ *  regions. With immutable storage the buffer is mapped
+ *  once with persistent, coherent writes; otherwise it is
+ *  given plain storage and a copy in memory to write into.
+ ***********************************************************/
+void RingBuffer::CreateStorage()
+{
+	size_t totalBytes = m_regionBytes * REGION_COUNT;
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(m_target, m_buffer);
+
+	bool bImmutable = (m_bAllowPersistent == true) && (GLEW_ARB_buffer_storage == GL_TRUE);
+	if (bImmutable == true)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(m_target, totalBytes, NULL, flags);
+		m_pMapped = (unsigned char*)glMapBufferRange(m_target, 0, totalBytes, flags);
+	}
+
+	if (NULL == m_pMapped)
+	{
+		// a buffer whose storage was made but could not be mapped
+		// is immutable, so it is made again with plain storage
+		if (bImmutable == true)
+		{
+			glBindBuffer(m_target, 0);
+			glDeleteBuffers(1, &m_buffer);
+			glGenBuffers(1, &m_buffer);
+			glBindBuffer(m_target, m_buffer);
+		}
+		glBufferData(m_target, totalBytes, NULL, GL_STREAM_DRAW);
+		m_copy.resize(totalBytes);
+	}
+
+	glBindBuffer(m_target, 0);
+}
+
+/***********************************************************
+ *  WaitForRegion()
+ *
+ *  This method is used for waiting until the GPU passes the
+ *  fence of a region. A fence already passed costs a single
+ *  check; otherwise the queued commands are sent on and the
+ *  time until the fence is passed is added to the stalls.
+ ***********************************************************/
+void RingBuffer::WaitForRegion(int region)
+{
+	GLsync fence = m_regions[region].fence;
+	if (fence == 0)
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		do
+		{
+			result = glClientWaitSync(fence, flags, FENCE_WAIT_TIMEOUT);
+			flags = 0;
+		} while (result == GL_TIMEOUT_EXPIRED);
+
+		m_waitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		m_stallCount++;
+	}
+
+	glDeleteSync(fence);
+	m_regions[region].fence = 0;
+}
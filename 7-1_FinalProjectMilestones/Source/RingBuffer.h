@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// ringbuffer.h
+// ============
+// hand out per-frame buffer memory from a few regions of one persistently
+// mapped buffer, each guarded by a fence until the GPU is done with it
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  RingBuffer
+ *
+ *  This class holds one buffer split into three regions
+ *  that are written in turn, so the CPU can fill one while
+ *  the GPU still reads the two before it. The buffer is
+ *  created with immutable storage and mapped once, for
+ *  good, with coherent writes, so the values are written
+ *  straight into the memory the draws read and no upload
+ *  call can make the driver wait. Instead, a fence is
+ *  placed behind the last draw reading a region, and the
+ *  CPU only waits when it comes back to a region whose
+ *  fence has not been passed yet; that time is kept, so
+ *  stalls of the pipeline show up. When the driver cannot
+ *  map a buffer for good, the values are written into a
+ *  copy in memory and sent with an upload per region.
+ ***********************************************************/
+class RingBuffer
+{
+public:
+	// constructor
+	RingBuffer();
+	// destructor
+	~RingBuffer();
+
+	// number of regions the buffer is split into
+	static const int REGION_COUNT = 3;
+
+	// create the buffer with room for a number of bytes in every
+	// region, mapped for good when the driver can and it is allowed
+	void Create(GLenum target, size_t regionBytes, bool bAllowPersistent);
+	// wait for the GPU to finish with the buffer and free it
+	void Destroy();
+
+	// make every region hold at least a number of bytes; returns
+	// true when the buffer was created again, losing its values
+	bool Reserve(size_t regionBytes);
+
+	// move on to the next region, waiting until the GPU has passed
+	// the fence of its last draw; returns the index of the region
+	int BeginRegion();
+	// take bytes from the current region at an offset with the
+	// given alignment; returns where to write them, or NULL when
+	// the region is full, and the offset of the bytes in the buffer
+	void* Allocate(size_t bytes, size_t alignment, GLintptr& offset);
+	// send written bytes to the buffer when it is not mapped for good
+	void Flush(GLintptr offset, size_t bytes);
+	// place a fence behind the draws that read a region so far
+	void FenceRegion(int region);
+
+	// accessors for the buffer
+	GLuint GetBuffer() const { return(m_buffer); }
+	bool IsPersistent() const { return(NULL != m_pMapped); }
+	int GetCurrentRegion() const { return(m_currentRegion); }
+
+	// regions moved on to, the number of those the CPU had to wait
+	// for, and the time spent waiting, since the stats were reset
+	long long GetRegionCount() const { return(m_regionCount); }
+	long long GetStallCount() const { return(m_stallCount); }
+	double GetWaitSeconds() const { return(m_waitSeconds); }
+	void ResetStats();
+
+private:
+	// one region and the fence of the last draw reading it
+	struct RING_REGION
+	{
+		GLsync fence;
+		size_t usedBytes;
+	};
+
+	GLuint m_buffer;
+	GLenum m_target;
+	size_t m_regionBytes;
+	bool m_bAllowPersistent;
+	// the mapped buffer, or NULL when the copy in memory is used
+	unsigned char* m_pMapped;
+	std::vector<unsigned char> m_copy;
+
+	RING_REGION m_regions[REGION_COUNT];
+	int m_currentRegion;
+
+	long long m_regionCount;
+	long long m_stallCount;
+	double m_waitSeconds;
+
+	// create the storage of the buffer and map it if it can be
+	void CreateStorage();
+	// wait for the GPU to pass the fence of a region and drop it
+	void WaitForRegion(int region);
+};
@@ -0,0 +1,698 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// bounding volume hierarchy over the world bounds of the scene objects, for
+// frustum culling and picking in large scenes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// boxes with this many scene nodes or fewer are not split
+	const int MIN_LEAF_NODES = 2;
+	// boxes with more scene nodes than this are always split
+	const int MAX_LEAF_NODES = 8;
+	// number of bins per axis when searching for a split
+	const int SPLIT_BINS = 8;
+	// deepest traversal stack of a frustum query, below which
+	// the boxes are accepted whole
+	const int MAX_STACK_DEPTH = 64;
+
+	/***********************************************************
+	 *  SurfaceArea()
+	 *
+	 *  Returns the surface area of a box, which is what the
+	 *  chance of a ray or a view hitting it grows with.
+	 ***********************************************************/
+	float SurfaceArea(const glm::vec3& minimumXYZ, const glm::vec3& maximumXYZ)
+	{
+		glm::vec3 size = maximumXYZ - minimumXYZ;
+		if ((size.x < 0.0f) || (size.y < 0.0f) || (size.z < 0.0f))
+		{
+			return(0.0f);
+		}
+		return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+	}
+
+	/***********************************************************
+	 *  NodeCenter() / NodeMinimum() / NodeMaximum()
+	 *
+	 *  Return the world box of one scene node.
+	 ***********************************************************/
+	glm::vec3 NodeCenter(const SceneGraph::WORLD_BOUNDS& bounds, int node)
+	{
+		return(glm::vec3(bounds.centerX[node], bounds.centerY[node], bounds.centerZ[node]));
+	}
+	glm::vec3 NodeMinimum(const SceneGraph::WORLD_BOUNDS& bounds, int node)
+	{
+		return(glm::vec3(
+			bounds.centerX[node] - bounds.extentX[node],
+			bounds.centerY[node] - bounds.extentY[node],
+			bounds.centerZ[node] - bounds.extentZ[node]));
+	}
+	glm::vec3 NodeMaximum(const SceneGraph::WORLD_BOUNDS& bounds, int node)
+	{
+		return(glm::vec3(
+			bounds.centerX[node] + bounds.extentX[node],
+			bounds.centerY[node] + bounds.extentY[node],
+			bounds.centerZ[node] + bounds.extentZ[node]));
+	}
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+	m_maxDepth = 0;
+}
+
+/***********************************************************
+ *  ~SceneBVH()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneBVH::~SceneBVH()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing the whole tree.
+ ***********************************************************/
+void SceneBVH::Clear()
+{
+	m_nodes.clear();
+	m_parents.clear();
+	m_orderedNodes.clear();
+	m_nodeLeaves.clear();
+	m_maxDepth = 0;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the
+ *  world bounds of all the scene nodes. Boxes are split
+ *  from the root down until each leaf holds only a few
+ *  scene nodes, or until splitting stops paying off. The
+ *  depth of the deepest leaf is kept for sizing the stack
+ *  of the ray query.
+ ***********************************************************/
+void SceneBVH::Build(const SceneGraph::WORLD_BOUNDS& bounds)
+{
+	int nodeCount = (int)bounds.radius.size();
+
+	Clear();
+	if (nodeCount == 0)
+	{
+		return;
+	}
+
+	m_orderedNodes.resize(nodeCount);
+	for (int i = 0; i < nodeCount; i++)
+	{
+		m_orderedNodes[i] = i;
+	}
+	m_nodeLeaves.resize(nodeCount);
+
+	// a binary tree with one scene node per leaf is the largest
+	m_nodes.reserve(2 * nodeCount);
+	m_parents.reserve(2 * nodeCount);
+
+	BVH_NODE root;
+	root.firstChildOrNode = 0;
+	root.nodeCount = nodeCount;
+	m_nodes.push_back(root);
+	m_parents.push_back(-1);
+	FitLeaf(0, bounds);
+
+	// split the boxes breadth first without recursion
+	std::vector<int> pending;
+	std::vector<int> pendingDepths;
+	pending.push_back(0);
+	pendingDepths.push_back(1);
+	m_maxDepth = 1;
+	while (!pending.empty())
+	{
+		int treeNode = pending.back();
+		int depth = pendingDepths.back();
+		pending.pop_back();
+		pendingDepths.pop_back();
+
+		if (SplitNode(treeNode, bounds) == true)
+		{
+			int firstChild = m_nodes[treeNode].firstChildOrNode;
+			pending.push_back(firstChild);
+			pending.push_back(firstChild + 1);
+			pendingDepths.push_back(depth + 1);
+			pendingDepths.push_back(depth + 1);
+			m_maxDepth = std::max(m_maxDepth, depth + 1);
+		}
+		else
+		{
+			const BVH_NODE& leaf = m_nodes[treeNode];
+			for (int i = 0; i < leaf.nodeCount; i++)
+			{
+				m_nodeLeaves[m_orderedNodes[leaf.firstChildOrNode + i]] = treeNode;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  SplitNode()
+ *
+ *  This method is used for splitting a leaf box in two.
+ *  The node centers are sorted into bins along each axis,
+ *  and the bin boundary with the lowest surface area cost
+ *  is used. It returns false when the box stays a leaf.
+ ***********************************************************/
+bool SceneBVH::SplitNode(int treeNode, const SceneGraph::WORLD_BOUNDS& bounds)
+{
+	int first = m_nodes[treeNode].firstChildOrNode;
+	int count = m_nodes[treeNode].nodeCount;
+
+	if (count <= MIN_LEAF_NODES)
+	{
+		return(false);
+	}
+
+	// the bins are laid over the spread of the node centers
+	glm::vec3 centerMinimum(FLT_MAX);
+	glm::vec3 centerMaximum(-FLT_MAX);
+	for (int i = first; i < first + count; i++)
+	{
+		glm::vec3 center = NodeCenter(bounds, m_orderedNodes[i]);
+		centerMinimum = glm::min(centerMinimum, center);
+		centerMaximum = glm::max(centerMaximum, center);
+	}
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestSplit = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float spread = centerMaximum[axis] - centerMinimum[axis];
+		if (spread <= 0.0f)
+		{
+			continue;
+		}
+		float binScale = SPLIT_BINS / spread;
+
+		int binCounts[SPLIT_BINS] = { 0 };
+		glm::vec3 binMinimum[SPLIT_BINS];
+		glm::vec3 binMaximum[SPLIT_BINS];
+		for (int bin = 0; bin < SPLIT_BINS; bin++)
+		{
+			binMinimum[bin] = glm::vec3(FLT_MAX);
+			binMaximum[bin] = glm::vec3(-FLT_MAX);
+		}
+
+		for (int i = first; i < first + count; i++)
+		{
+			int node = m_orderedNodes[i];
+			int bin = (int)((NodeCenter(bounds, node)[axis] - centerMinimum[axis]) * binScale);
+			bin = glm::clamp(bin, 0, SPLIT_BINS - 1);
+			binCounts[bin]++;
+			binMinimum[bin] = glm::min(binMinimum[bin], NodeMinimum(bounds, node));
+			binMaximum[bin] = glm::max(binMaximum[bin], NodeMaximum(bounds, node));
+		}
+
+		// sweep from the right to get the cost of every right side
+		float rightAreas[SPLIT_BINS];
+		int rightCounts[SPLIT_BINS];
+		glm::vec3 sweepMinimum(FLT_MAX);
+		glm::vec3 sweepMaximum(-FLT_MAX);
+		int sweepCount = 0;
+		for (int bin = SPLIT_BINS - 1; bin > 0; bin--)
+		{
+			sweepMinimum = glm::min(sweepMinimum, binMinimum[bin]);
+			sweepMaximum = glm::max(sweepMaximum, binMaximum[bin]);
+			sweepCount += binCounts[bin];
+			rightAreas[bin] = SurfaceArea(sweepMinimum, sweepMaximum);
+			rightCounts[bin] = sweepCount;
+		}
+
+		// then from the left, combining both sides of each split
+		sweepMinimum = glm::vec3(FLT_MAX);
+		sweepMaximum = glm::vec3(-FLT_MAX);
+		sweepCount = 0;
+		for (int bin = 0; bin < SPLIT_BINS - 1; bin++)
+		{
+			sweepMinimum = glm::min(sweepMinimum, binMinimum[bin]);
+			sweepMaximum = glm::max(sweepMaximum, binMaximum[bin]);
+			sweepCount += binCounts[bin];
+			if ((sweepCount == 0) || (rightCounts[bin + 1] == 0))
+			{
+				continue;
+			}
+
+			float cost = sweepCount * SurfaceArea(sweepMinimum, sweepMaximum) +
+				rightCounts[bin + 1] * rightAreas[bin + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = bin + 1;
+			}
+		}
+	}
+
+	// all the node centers are in the same place
+	if (bestAxis < 0)
+	{
+		return(false);
+	}
+
+	// small boxes are kept whole when no split is cheaper
+	float leafCost = count * SurfaceArea(m_nodes[treeNode].minimum, m_nodes[treeNode].maximum);
+	if ((count <= MAX_LEAF_NODES) && (bestCost >= leafCost))
+	{
+		return(false);
+	}
+
+	// move the nodes left of the split to the front of the run
+	float binScale = SPLIT_BINS / (centerMaximum[bestAxis] - centerMinimum[bestAxis]);
+	int left = first;
+	int right = first + count - 1;
+	while (left <= right)
+	{
+		int bin = (int)((NodeCenter(bounds, m_orderedNodes[left])[bestAxis] - centerMinimum[bestAxis]) * binScale);
+		bin = glm::clamp(bin, 0, SPLIT_BINS - 1);
+		if (bin < bestSplit)
+		{
+			left++;
+		}
+		else
+		{
+			int swapped = m_orderedNodes[left];
+			m_orderedNodes[left] = m_orderedNodes[right];
+			m_orderedNodes[right] = swapped;
+			right--;
+		}
+	}
+
+	int leftCount = left - first;
+	if ((leftCount == 0) || (leftCount == count))
+	{
+		return(false);
+	}
+
+	// the children are added next to each other
+	int firstChild = (int)m_nodes.size();
+	BVH_NODE child;
+	child.firstChildOrNode = first;
+	child.nodeCount = leftCount;
+	m_nodes.push_back(child);
+	m_parents.push_back(treeNode);
+	child.firstChildOrNode = first + leftCount;
+	child.nodeCount = count - leftCount;
+	m_nodes.push_back(child);
+	m_parents.push_back(treeNode);
+	FitLeaf(firstChild, bounds);
+	FitLeaf(firstChild + 1, bounds);
+
+	m_nodes[treeNode].firstChildOrNode = firstChild;
+	m_nodes[treeNode].nodeCount = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FitLeaf()
+ *
+ *  This method is used for setting a leaf box to hold the
+ *  world boxes of all its scene nodes.
+ ***********************************************************/
+void SceneBVH::FitLeaf(int treeNode, const SceneGraph::WORLD_BOUNDS& bounds)
+{
+	BVH_NODE& leaf = m_nodes[treeNode];
+
+	leaf.minimum = glm::vec3(FLT_MAX);
+	leaf.maximum = glm::vec3(-FLT_MAX);
+	for (int i = 0; i < leaf.nodeCount; i++)
+	{
+		int node = m_orderedNodes[leaf.firstChildOrNode + i];
+		leaf.minimum = glm::min(leaf.minimum, NodeMinimum(bounds, node));
+		leaf.maximum = glm::max(leaf.maximum, NodeMaximum(bounds, node));
+	}
+}
+
+/***********************************************************
+ *  FitInner()
+ *
+ *  This method is used for setting an inner box to hold
+ *  both of its children.
+ ***********************************************************/
+void SceneBVH::FitInner(int treeNode)
+{
+	BVH_NODE& inner = m_nodes[treeNode];
+	const BVH_NODE& leftChild = m_nodes[inner.firstChildOrNode];
+	const BVH_NODE& rightChild = m_nodes[inner.firstChildOrNode + 1];
+
+	inner.minimum = glm::min(leftChild.minimum, rightChild.minimum);
+	inner.maximum = glm::max(leftChild.maximum, rightChild.maximum);
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for updating the tree after scene
+ *  nodes have moved. The leaf of each moved node is fitted
+ *  again, and the boxes above it are refitted up to the
+ *  first one that does not change. The tree gets looser as
+ *  nodes move far from where it was built, so a scene that
+ *  is rearranged should be built again instead.
+ ***********************************************************/
+void SceneBVH::Refit(
+	const SceneGraph::WORLD_BOUNDS& bounds,
+	const std::vector<int>& movedNodes)
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	for (int i = 0; i < (int)movedNodes.size(); i++)
+	{
+		int treeNode = m_nodeLeaves[movedNodes[i]];
+		glm::vec3 oldMinimum = m_nodes[treeNode].minimum;
+		glm::vec3 oldMaximum = m_nodes[treeNode].maximum;
+
+		FitLeaf(treeNode, bounds);
+
+		while ((m_nodes[treeNode].minimum != oldMinimum) ||
+			(m_nodes[treeNode].maximum != oldMaximum))
+		{
+			treeNode = m_parents[treeNode];
+			if (treeNode < 0)
+			{
+				break;
+			}
+			oldMinimum = m_nodes[treeNode].minimum;
+			oldMaximum = m_nodes[treeNode].maximum;
+			FitInner(treeNode);
+		}
+	}
+}
+
+/***********************************************************
+ *  MarkSubtree()
+ *
+ *  This method is used for marking all of the scene nodes
+ *  under a box that is fully inside the frustum.
+ ***********************************************************/
+int SceneBVH::MarkSubtree(int treeNode, std::vector<unsigned char>& visible) const
+{
+	// the leaves under a box hold one contiguous run of the
+	// ordered nodes, so find its two ends
+	int firstLeaf = treeNode;
+	while (m_nodes[firstLeaf].nodeCount == 0)
+	{
+		firstLeaf = m_nodes[firstLeaf].firstChildOrNode;
+	}
+	int lastLeaf = treeNode;
+	while (m_nodes[lastLeaf].nodeCount == 0)
+	{
+		lastLeaf = m_nodes[lastLeaf].firstChildOrNode + 1;
+	}
+
+	int first = m_nodes[firstLeaf].firstChildOrNode;
+	int last = m_nodes[lastLeaf].firstChildOrNode + m_nodes[lastLeaf].nodeCount;
+	for (int i = first; i < last; i++)
+	{
+		visible[m_orderedNodes[i]] = 1;
+	}
+
+	return(last - first);
+}
+
+/***********************************************************
+ *  FrustumQuery()
+ *
+ *  This method is used for finding the scene nodes that
+ *  may be inside the frustum. Boxes outside are skipped
+ *  with everything under them, boxes fully inside mark
+ *  everything under them without further tests, and only
+ *  the scene nodes in leaves crossing a plane are tested.
+ ***********************************************************/
+int SceneBVH::FrustumQuery(
+	const Frustum& frustum,
+	const SceneGraph::WORLD_BOUNDS& bounds,
+	std::vector<unsigned char>& visible) const
+{
+	visible.assign(bounds.radius.size(), 0);
+	if (m_nodes.empty())
+	{
+		return(0);
+	}
+
+	return(FrustumQuerySubtree(frustum, bounds, 0, visible));
+}
+
+/***********************************************************
+ *  GetSubtrees()
+ *
+ *  This method is used for cutting the tree into subtrees
+ *  that hold every scene node between them once. The boxes
+ *  are split level by level, so the subtrees are close in
+ *  size, until there are enough or only leaves are left.
+ ***********************************************************/
+void SceneBVH::GetSubtrees(int count, std::vector<int>& subtrees) const
+{
+	subtrees.clear();
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	std::vector<int> pending(1, 0);
+	size_t head = 0;
+	while ((head < pending.size()) && ((int)(subtrees.size() + pending.size() - head) < count))
+	{
+		int treeNode = pending[head++];
+		const BVH_NODE& box = m_nodes[treeNode];
+		if (box.nodeCount > 0)
+		{
+			subtrees.push_back(treeNode);
+		}
+		else
+		{
+			pending.push_back(box.firstChildOrNode);
+			pending.push_back(box.firstChildOrNode + 1);
+		}
+	}
+	subtrees.insert(subtrees.end(), pending.begin() + head, pending.end());
+}
+
+/***********************************************************
+ *  FrustumQuerySubtree()
+ *
+ *  This method is used for the frustum query under one box
+ *  of the tree. The subtrees from GetSubtrees() share no
+ *  scene nodes, so they can be queried at the same time.
+ ***********************************************************/
+int SceneBVH::FrustumQuerySubtree(
+	const Frustum& frustum,
+	const SceneGraph::WORLD_BOUNDS& bounds,
+	int rootNode,
+	std::vector<unsigned char>& visible) const
+{
+	int visibleCount = 0;
+
+	int stack[MAX_STACK_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = rootNode;
+
+	while (stackSize > 0)
+	{
+		int treeNode = stack[--stackSize];
+		const BVH_NODE& box = m_nodes[treeNode];
+
+		Frustum::CONTAINMENT containment = frustum.ClassifyBox(box.minimum, box.maximum);
+		if (containment == Frustum::OUTSIDE)
+		{
+			continue;
+		}
+		if (containment == Frustum::INSIDE)
+		{
+			visibleCount += MarkSubtree(treeNode, visible);
+			continue;
+		}
+
+		if (box.nodeCount > 0)
+		{
+			for (int i = 0; i < box.nodeCount; i++)
+			{
+				int node = m_orderedNodes[box.firstChildOrNode + i];
+				if (frustum.TestBounds(
+					NodeCenter(bounds, node),
+					glm::vec3(bounds.extentX[node], bounds.extentY[node], bounds.extentZ[node]),
+					bounds.radius[node]) == true)
+				{
+					visible[node] = 1;
+					visibleCount++;
+				}
+			}
+		}
+		else if (stackSize + 2 <= MAX_STACK_DEPTH)
+		{
+			stack[stackSize++] = box.firstChildOrNode;
+			stack[stackSize++] = box.firstChildOrNode + 1;
+		}
+		else
+		{
+			// too deep to keep splitting, so accept it whole
+			visibleCount += MarkSubtree(treeNode, visible);
+		}
+	}
+
+	return(visibleCount);
+}
+
+/***********************************************************
+ *  IntersectRayBox()
+ *
+ *  This method is used for the slab test of a ray against
+ *  an axis aligned box. The entry distance is clamped to
+ *  zero when the ray starts inside the box.
+ ***********************************************************/
+bool SceneBVH::IntersectRayBox(
+	const glm::vec3& origin,
+	const glm::vec3& inverseDirection,
+	const glm::vec3& minimumXYZ,
+	const glm::vec3& maximumXYZ,
+	float maxDistance,
+	float& entryDistance)
+{
+	float nearDistance = 0.0f;
+	float farDistance = maxDistance;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float t0 = (minimumXYZ[axis] - origin[axis]) * inverseDirection[axis];
+		float t1 = (maximumXYZ[axis] - origin[axis]) * inverseDirection[axis];
+		if (t0 > t1)
+		{
+			float swapped = t0;
+			t0 = t1;
+			t1 = swapped;
+		}
+		// fmin and fmax drop the NaN from a ray in the slab plane
+		nearDistance = fmaxf(nearDistance, t0);
+		farDistance = fminf(farDistance, t1);
+	}
+
+	entryDistance = nearDistance;
+	return(nearDistance <= farDistance);
+}
+
+/***********************************************************
+ *  RayQuery()
+ *
+ *  This method is used for finding the nearest scene node
+ *  whose world box is hit by a ray, such as one cast from
+ *  the camera position along its front vector. Nearer
+ *  children are visited first, and boxes entered beyond
+ *  the closest hit so far are skipped. Every level keeps
+ *  at most one far child waiting, so the stack is sized
+ *  from the depth of the tree and no box is ever dropped.
+ ***********************************************************/
+int SceneBVH::RayQuery(
+	const SceneGraph::WORLD_BOUNDS& bounds,
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	float& hitDistance) const
+{
+	int hitNode = -1;
+
+	hitDistance = maxDistance;
+	if (m_nodes.empty())
+	{
+		return(-1);
+	}
+
+	glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float entryDistance = 0.0f;
+
+	if (IntersectRayBox(origin, inverseDirection, m_nodes[0].minimum, m_nodes[0].maximum, hitDistance, entryDistance) == false)
+	{
+		return(-1);
+	}
+
+	std::vector<int> stack(m_maxDepth + 1);
+	std::vector<float> stackDistances(m_maxDepth + 1);
+	int stackSize = 0;
+	stack[stackSize] = 0;
+	stackDistances[stackSize++] = entryDistance;
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		int treeNode = stack[stackSize];
+		if (stackDistances[stackSize] > hitDistance)
+		{
+			continue;
+		}
+
+		const BVH_NODE& box = m_nodes[treeNode];
+		if (box.nodeCount > 0)
+		{
+			for (int i = 0; i < box.nodeCount; i++)
+			{
+				int node = m_orderedNodes[box.firstChildOrNode + i];
+				if ((IntersectRayBox(origin, inverseDirection, NodeMinimum(bounds, node), NodeMaximum(bounds, node), hitDistance, entryDistance) == true) &&
+					((entryDistance < hitDistance) || (hitNode < 0)))
+				{
+					hitDistance = entryDistance;
+					hitNode = node;
+				}
+			}
+			continue;
+		}
+
+		int nearChild = box.firstChildOrNode;
+		int farChild = box.firstChildOrNode + 1;
+		float nearEntry = 0.0f;
+		float farEntry = 0.0f;
+		bool bNearHit = IntersectRayBox(origin, inverseDirection, m_nodes[nearChild].minimum, m_nodes[nearChild].maximum, hitDistance, nearEntry);
+		bool bFarHit = IntersectRayBox(origin, inverseDirection, m_nodes[farChild].minimum, m_nodes[farChild].maximum, hitDistance, farEntry);
+
+		if ((bNearHit == true) && (bFarHit == true) && (farEntry < nearEntry))
+		{
+			int swappedChild = nearChild;
+			nearChild = farChild;
+			farChild = swappedChild;
+			float swappedEntry = nearEntry;
+			nearEntry = farEntry;
+			farEntry = swappedEntry;
+		}
+
+		// push the farther child first so the nearer one is visited first
+		if (bFarHit == true)
+		{
+			stack[stackSize] = farChild;
+			stackDistances[stackSize++] = farEntry;
+		}
+		if (bNearHit == true)
+		{
+			stack[stackSize] = nearChild;
+			stackDistances[stackSize++] = nearEntry;
+		}
+	}
+
+	return(hitNode);
+}
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy over the world bounds of the scene objects, for
+// frustum culling and picking in large scenes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneGraph.h"
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  This class holds a binary tree of axis aligned boxes
+ *  over the world bounding boxes of the scene nodes. It is
+ *  built once with binned surface area splits, and when
+ *  nodes move only the boxes above them are refitted, so
+ *  the tree shape is kept and no rebuild is needed.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+	// constructor
+	SceneBVH();
+	// destructor
+	~SceneBVH();
+
+	// build the tree over the world bounds of all the nodes
+	void Build(const SceneGraph::WORLD_BOUNDS& bounds);
+	// remove the tree
+	void Clear();
+	// refit the boxes above the nodes that moved
+	void Refit(
+		const SceneGraph::WORLD_BOUNDS& bounds,
+		const std::vector<int>& movedNodes);
+
+	// write one visible flag per scene node and return the
+	// number of nodes that may be visible
+	int FrustumQuery(
+		const Frustum& frustum,
+		const SceneGraph::WORLD_BOUNDS& bounds,
+		std::vector<unsigned char>& visible) const;
+	// split the tree into about the given number of subtrees,
+	// so a query can be spread over threads
+	void GetSubtrees(int count, std::vector<int>& subtrees) const;
+	// query the scene nodes under one box into flags already
+	// cleared for every node, returning the visible count
+	int FrustumQuerySubtree(
+		const Frustum& frustum,
+		const SceneGraph::WORLD_BOUNDS& bounds,
+		int rootNode,
+		std::vector<unsigned char>& visible) const;
+	// find the nearest scene node whose box is hit by a ray,
+	// or -1 when nothing is hit
+	int RayQuery(
+		const SceneGraph::WORLD_BOUNDS& bounds,
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		float& hitDistance) const;
+
+	// test a ray against a box, giving the distance it enters at
+	static bool IntersectRayBox(
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		const glm::vec3& minimumXYZ,
+		const glm::vec3& maximumXYZ,
+		float maxDistance,
+		float& entryDistance);
+
+	// accessors for the tree size
+	bool IsBuilt() const { return(!m_nodes.empty()); }
+	int GetTreeNodeCount() const { return((int)m_nodes.size()); }
+	int GetMaxDepth() const { return(m_maxDepth); }
+
+private:
+	// one box of the tree; a leaf holds a run of the ordered
+	// scene nodes, an inner box holds two children stored
+	// next to each other
+	struct BVH_NODE
+	{
+		glm::vec3 minimum;
+		int firstChildOrNode;
+		glm::vec3 maximum;
+		int nodeCount;
+	};
+
+	// boxes of the tree, the root first
+	std::vector<BVH_NODE> m_nodes;
+	// parent box of every box, -1 for the root
+	std::vector<int> m_parents;
+	// scene nodes in leaf order
+	std::vector<int> m_orderedNodes;
+	// leaf box holding every scene node
+	std::vector<int> m_nodeLeaves;
+	// boxes on the longest path from the root to a leaf, which
+	// the surface area splits do not bound
+	int m_maxDepth;
+
+	// split a box into two children or make it a leaf
+	bool SplitNode(int treeNode, const SceneGraph::WORLD_BOUNDS& bounds);
+	// grow a leaf box around its scene nodes
+	void FitLeaf(int treeNode, const SceneGraph::WORLD_BOUNDS& bounds);
+	// grow an inner box around its two children
+	void FitInner(int treeNode);
+	// mark every scene node under a box as visible
+	int MarkSubtree(int treeNode, std::vector<unsigned char>& visible) const;
+};
@@ -0,0 +1,333 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+// ============
+// retained storage for the objects in a 3D scene - transforms, meshes,
+// materials and textures kept in contiguous arrays
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// dirty nodes re-derived by one job of a transform update
+	const int TRANSFORM_JOB_NODES = 1024;
+}
+
+/***********************************************************
+ *  SceneGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGraph::SceneGraph()
+{
+	// until the meshes report their bounds, assume each one
+	// fits in the unit cube around its origin
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		m_meshCenters[i] = glm::vec3(0.0f);
+		m_meshExtents[i] = glm::vec3(1.0f);
+	}
+	m_dynamicCount = 0;
+}
+
+/***********************************************************
+ *  ~SceneGraph()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneGraph::~SceneGraph()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a new object into the
+ *  scene. The returned index can be used for changing the
+ *  transform of the object later on.
+ ***********************************************************/
+int SceneGraph::AddNode(
+	int meshID,
+	const glm::vec3& scaleXYZ,
+	const glm::vec3& rotationDegreesXYZ,
+	const glm::vec3& positionXYZ,
+	int materialID,
+	int textureSlot)
+{
+	int node = (int)m_meshIDs.size();
+
+	m_scales.push_back(scaleXYZ);
+	m_rotations.push_back(rotationDegreesXYZ);
+	m_positions.push_back(positionXYZ);
+	m_modelMatrices.push_back(glm::mat4(1.0f));
+	m_meshIDs.push_back(meshID);
+	m_materialIDs.push_back(materialID);
+	m_textureSlots.push_back(textureSlot);
+	m_blendFlags.push_back(0);
+	m_dynamicFlags.push_back(0);
+	m_worldBounds.centerX.push_back(0.0f);
+	m_worldBounds.centerY.push_back(0.0f);
+	m_worldBounds.centerZ.push_back(0.0f);
+	m_worldBounds.extentX.push_back(0.0f);
+	m_worldBounds.extentY.push_back(0.0f);
+	m_worldBounds.extentZ.push_back(0.0f);
+	m_worldBounds.radius.push_back(0.0f);
+	m_dirtyFlags.push_back(0);
+
+	// the model matrix of a new node always needs to be derived
+	MarkDirty(node);
+
+	return(node);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the nodes from
+ *  the scene.
+ ***********************************************************/
+void SceneGraph::Clear()
+{
+	m_scales.clear();
+	m_rotations.clear();
+	m_positions.clear();
+	m_modelMatrices.clear();
+	m_meshIDs.clear();
+	m_materialIDs.clear();
+	m_textureSlots.clear();
+	m_blendFlags.clear();
+	m_dynamicFlags.clear();
+	m_dynamicCount = 0;
+	m_worldBounds = WORLD_BOUNDS();
+	m_dirtyFlags.clear();
+	m_dirtyNodes.clear();
+	m_updatedNodes.clear();
+}
+
+/***********************************************************
+ *  SetScale()
+ *
+ *  This method is used for changing the scale of a node.
+ ***********************************************************/
+void SceneGraph::SetScale(int node, const glm::vec3& scaleXYZ)
+{
+	m_scales[node] = scaleXYZ;
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  SetRotation()
+ *
+ *  This method is used for changing the rotation of a node.
+ ***********************************************************/
+void SceneGraph::SetRotation(int node, const glm::vec3& rotationDegreesXYZ)
+{
+	m_rotations[node] = rotationDegreesXYZ;
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  SetPosition()
+ *
+ *  This method is used for changing the position of a node.
+ ***********************************************************/
+void SceneGraph::SetPosition(int node, const glm::vec3& positionXYZ)
+{
+	m_positions[node] = positionXYZ;
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  SetBlended()
+ *
+ *  This method is used for marking a node as drawn with
+ *  alpha blending, after all the opaque nodes.
+ ***********************************************************/
+void SceneGraph::SetBlended(int node, bool bBlended)
+{
+	m_blendFlags[node] = bBlended ? 1 : 0;
+}
+
+/***********************************************************
+ *  SetDynamic()
+ *
+ *  This method is used for marking a node as one that is
+ *  expected to move every so often. The shadows of the
+ *  other nodes are cached, and moving one of them renders
+ *  the cache again.
+ ***********************************************************/
+void SceneGraph::SetDynamic(int node, bool bDynamic)
+{
+	unsigned char flag = bDynamic ? 1 : 0;
+	if (m_dynamicFlags[node] != flag)
+	{
+		m_dynamicFlags[node] = flag;
+		m_dynamicCount += bDynamic ? 1 : -1;
+		MarkDirty(node);
+	}
+}
+
+/***********************************************************
+ *  SetMeshBounds()
+ *
+ *  This method is used for setting the object space
+ *  bounding box of a mesh. Every node using the mesh gets
+ *  its world bounds re-derived on the next update.
+ ***********************************************************/
+void SceneGraph::SetMeshBounds(
+	int meshID,
+	const glm::vec3& minimumXYZ,
+	const glm::vec3& maximumXYZ)
+{
+	m_meshCenters[meshID] = (minimumXYZ + maximumXYZ) * 0.5f;
+	m_meshExtents[meshID] = (maximumXYZ - minimumXYZ) * 0.5f;
+
+	for (int node = 0; node < (int)m_meshIDs.size(); node++)
+	{
+		if (m_meshIDs[node] == meshID)
+		{
+			MarkDirty(node);
+		}
+	}
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for flagging a node so its model
+ *  matrix gets re-derived on the next transform update.
+ ***********************************************************/
+void SceneGraph::MarkDirty(int node)
+{
+	if (m_dirtyFlags[node] == 0)
+	{
+		m_dirtyFlags[node] = 1;
+		m_dirtyNodes.push_back(node);
+	}
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method is used for re-deriving the model matrices
+ *  and world bounds of only the nodes that have changed since the last
+ *  update. The nodes do not depend on each other, so a
+ *  job system can split them over its threads. The number
+ *  of updated nodes is returned.
+ ***********************************************************/
+int SceneGraph::UpdateTransforms(JobSystem* pJobSystem)
+{
+	int updated = (int)m_dirtyNodes.size();
+
+	JobSystem::ForEachRange(pJobSystem, updated, TRANSFORM_JOB_NODES,
+		[this](int first, int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				int node = m_dirtyNodes[i];
+				m_modelMatrices[node] = ComputeModelMatrix(
+					m_scales[node],
+					m_rotations[node],
+					m_positions[node]);
+				UpdateWorldBounds(node);
+				m_dirtyFlags[node] = 0;
+			}
+		});
+	m_updatedNodes.swap(m_dirtyNodes);
+	m_dirtyNodes.clear();
+
+	return(updated);
+}
+
+/***********************************************************
+ *  UpdateWorldBounds()
+ *
+ *  This method is used for transforming the mesh bounding
+ *  box of a node by its model matrix. The world box keeps
+ *  the transformed center and is widened to hold the
+ *  rotated extents. The sphere radius is the smaller of the
+ *  scaled mesh box diagonal and the world box diagonal.
+ ***********************************************************/
+void SceneGraph::UpdateWorldBounds(int node)
+{
+	const glm::mat4& model = m_modelMatrices[node];
+	const glm::vec3& center = m_meshCenters[m_meshIDs[node]];
+	const glm::vec3& extents = m_meshExtents[m_meshIDs[node]];
+
+	glm::vec3 axisX(model[0]);
+	glm::vec3 axisY(model[1]);
+	glm::vec3 axisZ(model[2]);
+
+	glm::vec3 worldCenter = glm::vec3(model[3]) +
+		axisX * center.x + axisY * center.y + axisZ * center.z;
+	glm::vec3 worldExtents =
+		glm::abs(axisX) * extents.x +
+		glm::abs(axisY) * extents.y +
+		glm::abs(axisZ) * extents.z;
+
+	float maxScale = glm::max(glm::length(axisX), glm::max(glm::length(axisY), glm::length(axisZ)));
+	float radius = glm::min(glm::length(extents) * maxScale, glm::length(worldExtents));
+
+	m_worldBounds.centerX[node] = worldCenter.x;
+	m_worldBounds.centerY[node] = worldCenter.y;
+	m_worldBounds.centerZ[node] = worldCenter.z;
+	m_worldBounds.extentX[node] = worldExtents.x;
+	m_worldBounds.extentY[node] = worldExtents.y;
+	m_worldBounds.extentZ[node] = worldExtents.z;
+	m_worldBounds.radius[node] = radius;
+}
+
+/***********************************************************
+ *  ComputeModelMatrix()
+ *
+ *  This method is used for building a model matrix from
+ *  the scale, rotation and position values. The result is
+ *  the same as translation * rotZ * rotY * rotX * scale,
+ *  but the three axis rotations are fused into one closed
+ *  form rotation and the scale and translation are folded
+ *  into its columns, so no intermediate matrices or matrix
+ *  multiplies are needed.
+ ***********************************************************/
+glm::mat4 SceneGraph::ComputeModelMatrix(
+	const glm::vec3& scaleXYZ,
+	const glm::vec3& rotationDegreesXYZ,
+	const glm::vec3& positionXYZ)
+{
+	float radiansX = glm::radians(rotationDegreesXYZ.x);
+	float radiansY = glm::radians(rotationDegreesXYZ.y);
+	float radiansZ = glm::radians(rotationDegreesXYZ.z);
+
+	float cosX = cosf(radiansX);
+	float sinX = sinf(radiansX);
+	float cosY = cosf(radiansY);
+	float sinY = sinf(radiansY);
+	float cosZ = cosf(radiansZ);
+	float sinZ = sinf(radiansZ);
+
+	glm::mat4 model;
+
+	// each column of the rotation is scaled by the matching axis scale
+	model[0] = glm::vec4(
+		cosZ * cosY,
+		sinZ * cosY,
+		-sinY,
+		0.0f) * scaleXYZ.x;
+	model[1] = glm::vec4(
+		cosZ * sinY * sinX - sinZ * cosX,
+		sinZ * sinY * sinX + cosZ * cosX,
+		cosY * sinX,
+		0.0f) * scaleXYZ.y;
+	model[2] = glm::vec4(
+		cosZ * sinY * cosX + sinZ * sinX,
+		sinZ * sinY * cosX - cosZ * sinX,
+		cosY * cosX,
+		0.0f) * scaleXYZ.z;
+	// the translation is the last column
+	model[3] = glm::vec4(positionXYZ, 1.0f);
+
+	return(model);
+}
@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+// ============
+// retained storage for the objects in a 3D scene - transforms, meshes,
+// materials and textures kept in contiguous arrays
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class holds every object in the 3D scene as a set
+ *  of parallel arrays, indexed by node. The nodes are built
+ *  once when the scene is prepared, and the model matrices
+ *  are only re-derived for nodes that have been marked dirty.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+	// constructor
+	SceneGraph();
+	// destructor
+	~SceneGraph();
+
+	// basic shape meshes that a node can reference
+	enum MESH_TYPE
+	{
+		MESH_PLANE = 0,
+		MESH_BOX,
+		MESH_CYLINDER,
+		MESH_TAPERED_CYLINDER,
+		MESH_CONE,
+		MESH_SPHERE,
+		MESH_COUNT
+	};
+
+	// world space bounds of all the nodes, as parallel arrays
+	// so they can be tested several nodes at a time
+	struct WORLD_BOUNDS
+	{
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> extentX;
+		std::vector<float> extentY;
+		std::vector<float> extentZ;
+		std::vector<float> radius;
+	};
+
+	// add a new node to the scene and return its index
+	int AddNode(
+		int meshID,
+		const glm::vec3& scaleXYZ,
+		const glm::vec3& rotationDegreesXYZ,
+		const glm::vec3& positionXYZ,
+		int materialID,
+		int textureSlot);
+	// remove all the nodes from the scene
+	void Clear();
+
+	// change the transform values of an existing node
+	void SetScale(int node, const glm::vec3& scaleXYZ);
+	void SetRotation(int node, const glm::vec3& rotationDegreesXYZ);
+	void SetPosition(int node, const glm::vec3& positionXYZ);
+	// mark a node as drawn with alpha blending
+	void SetBlended(int node, bool bBlended);
+	// mark a node as one that moves, so its shadow is not cached
+	void SetDynamic(int node, bool bDynamic);
+
+	// set the object space bounding box of a mesh
+	void SetMeshBounds(
+		int meshID,
+		const glm::vec3& minimumXYZ,
+		const glm::vec3& maximumXYZ);
+
+	// re-derive the model matrices and bounds of all the dirty
+	// nodes, over the threads of a job system when one is given
+	int UpdateTransforms(JobSystem* pJobSystem = NULL);
+
+	// build the model matrix from the transform values
+	static glm::mat4 ComputeModelMatrix(
+		const glm::vec3& scaleXYZ,
+		const glm::vec3& rotationDegreesXYZ,
+		const glm::vec3& positionXYZ);
+
+	// accessors for the node data
+	int GetNodeCount() const { return((int)m_meshIDs.size()); }
+	int GetMeshID(int node) const { return(m_meshIDs[node]); }
+	int GetMaterialID(int node) const { return(m_materialIDs[node]); }
+	int GetTextureSlot(int node) const { return(m_textureSlots[node]); }
+	const glm::mat4& GetModelMatrix(int node) const { return(m_modelMatrices[node]); }
+	bool IsBlended(int node) const { return(m_blendFlags[node] != 0); }
+	bool IsDynamic(int node) const { return(m_dynamicFlags[node] != 0); }
+	int GetDynamicCount() const { return(m_dynamicCount); }
+	const WORLD_BOUNDS& GetWorldBounds() const { return(m_worldBounds); }
+	const std::vector<int>& GetUpdatedNodes() const { return(m_updatedNodes); }
+
+private:
+	// per-node transform values
+	std::vector<glm::vec3> m_scales;
+	std::vector<glm::vec3> m_rotations;
+	std::vector<glm::vec3> m_positions;
+	// per-node cached model matrices
+	std::vector<glm::mat4> m_modelMatrices;
+	// per-node render data
+	std::vector<int> m_meshIDs;
+	std::vector<int> m_materialIDs;
+	std::vector<int> m_textureSlots;
+	std::vector<unsigned char> m_blendFlags;
+	std::vector<unsigned char> m_dynamicFlags;
+	// number of nodes marked as dynamic
+	int m_dynamicCount;
+	// per-node world space bounds
+	WORLD_BOUNDS m_worldBounds;
+	// object space bounding box center and half size of each mesh
+	glm::vec3 m_meshCenters[MESH_COUNT];
+	glm::vec3 m_meshExtents[MESH_COUNT];
+	// per-node dirty flags, and the list of the nodes that are dirty
+	std::vector<unsigned char> m_dirtyFlags;
+	std::vector<int> m_dirtyNodes;
+	// the nodes re-derived by the last transform update
+	std::vector<int> m_updatedNodes;
+
+	// flag a node for having its model matrix re-derived
+	void MarkDirty(int node);
+	// transform the mesh bounds of a node into world space
+	void UpdateWorldBounds(int node);
+};
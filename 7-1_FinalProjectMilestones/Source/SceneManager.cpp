@@ -1,699 +1,1869 @@
-///////////////////////////////////////////////////////////////////////////////
-// scenemanager.cpp
-// ============
-// manage the preparing and rendering of 3D scenes - textures, materials, lighting
-//
-//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
-//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
-///////////////////////////////////////////////////////////////////////////////
-
-#include "SceneManager.h"
-
-#ifndef STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-#endif
-
-#include <glm/gtx/transform.hpp>
-
-// declaration of global variables
-namespace
-{
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
-}
-
-/***********************************************************
- *  SceneManager()
- *
- *  The constructor for the class
- ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
-{
-	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
-
-	// initialize the texture collection
-	for (int i = 0; i < 16; i++)
-	{
-		m_textureIDs[i].tag = "/0";
-		m_textureIDs[i].ID = -1;
-	}
-	m_loadedTextures = 0;
-}
-
-/***********************************************************
- *  ~SceneManager()
- *
- *  The destructor for the class
- ***********************************************************/
-SceneManager::~SceneManager()
-{
-	m_pShaderManager = NULL;
-	delete m_basicMeshes;
-	m_basicMeshes = NULL;
-	// destroy the created OpenGL textures
-	DestroyGLTextures();
-}
-
-/***********************************************************
- *  CreateGLTexture()
- *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
- ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
-{
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
-
-		return true;
-	}
-
-	std::cout << "Could not load image:" << filename << std::endl;
-
-	// Error loading the image
-	return false;
-}
-
-/***********************************************************
- *  BindGLTextures()
- *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
- ***********************************************************/
-void SceneManager::BindGLTextures()
-{
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
-	}
-}
-
-/***********************************************************
- *  DestroyGLTextures()
- *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
- ***********************************************************/
-void SceneManager::DestroyGLTextures()
-{
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		glGenTextures(1, &m_textureIDs[i].ID);
-	}
-}
-
-/***********************************************************
- *  FindTextureID()
- *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
- ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
-{
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
-	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
-	}
-
-	return(textureID);
-}
-
-/***********************************************************
- *  FindTextureSlot()
- *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
- ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
-{
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
-	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
-	}
-
-	return(textureSlot);
-}
-
-/***********************************************************
- *  FindMaterial()
- *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
- ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
-{
-	if (m_objectMaterials.size() == 0)
-	{
-		return(false);
-	}
-
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
-	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
-		{
-			bFound = true;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
-		}
-	}
-
-	return(true);
-}
-
-/***********************************************************
- *  SetTransformations()
- *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
- ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
-{
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
-
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
-}
-
-/***********************************************************
- *  SetShaderColor()
- *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
- ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
-{
-	// variables for this method
-	glm::vec4 currentColor;
-
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
-
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
-}
-
-/***********************************************************
- *  SetShaderTexture()
- *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
- ***********************************************************/
-void SceneManager::SetShaderTexture(
-	std::string textureTag)
-{
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
-
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
-}
-
-/***********************************************************
- *  SetTextureUVScale()
- *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
- ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
-{
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
-}
-
-/***********************************************************
-  *  LoadSceneTextures()
-  *
-  *  This method is used for preparing the 3D scene by loading
-  *  the shapes, textures in memory to support the 3D scene
-  *  rendering
-  ***********************************************************/
-void SceneManager::LoadSceneTextures()
-{
-	bool bReturn = false;
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/knife_handle.jpg",
-		"cone");
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/seamless-wood3.jpg",
-		"cylinder");
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/road.jpg",
-		"plane");
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/blueTape.jpg",
-		"tape");\
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/cardboard.jpg",
-		"cardboard");
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/drywall.jpg",
-		"chapstick");
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/pen.jpg",
-		"pen");
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/stainless.jpg",
-		"solo");
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/napkinfinance.jpg",
-		"book");
-	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
-	BindGLTextures();
-}
-
-/***********************************************************
- *  SetShaderMaterial()
- *
- *  This method is used for passing the material values
- *  into the shader.
- ***********************************************************/
-void SceneManager::SetShaderMaterial(
-	std::string materialTag)
-{
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
-	}
-}
-
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
-void SceneManager::DefineObjectMaterials()
-{
-	// Wood (for the rack tiers and top)
-	OBJECT_MATERIAL woodMaterial;
-	woodMaterial.ambientColor = glm::vec3(0.3f, 0.2f, 0.1f);
-	woodMaterial.ambientStrength = 0.25f;
-	woodMaterial.diffuseColor = glm::vec3(0.4f, 0.25f, 0.15f);
-	woodMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	woodMaterial.shininess = 8.0f;
-	woodMaterial.tag = "wood";
-	m_objectMaterials.push_back(woodMaterial);
-
-	// Cement for the floor
-	OBJECT_MATERIAL cementMaterial;
-	cementMaterial.ambientColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	cementMaterial.ambientStrength = 0.4f;
-	cementMaterial.diffuseColor = glm::vec3(0.6f, 0.6f, 0.6f);
-	cementMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	cementMaterial.shininess = 4.0f;
-	cementMaterial.tag = "cement";
-	m_objectMaterials.push_back(cementMaterial);
-
-	OBJECT_MATERIAL blueTape;
-	blueTape.ambientColor = glm::vec3(0.1f, 0.2f, 0.5f);     // Subtle blue ambient tone
-	blueTape.ambientStrength = 0.3f;                         // Slight ambient glow
-	blueTape.diffuseColor = glm::vec3(0.1f, 0.3f, 0.9f);      // Vivid blue when lit
-	blueTape.specularColor = glm::vec3(0.2f, 0.4f, 1.0f);     // Bright blue highlights
-	blueTape.shininess = 16.0f;                              // Moderate specular shine
-	blueTape.tag = "blue_tape";
-	m_objectMaterials.push_back(blueTape);
-
-	OBJECT_MATERIAL cardboard;
-	cardboard.ambientColor = glm::vec3(0.25f, 0.2f, 0.15f);     // Warm brown ambient
-	cardboard.ambientStrength = 0.2f;                           // Subtle glow
-	cardboard.diffuseColor = glm::vec3(0.45f, 0.35f, 0.25f);    // Light brown under direct light
-	cardboard.specularColor = glm::vec3(0.05f, 0.05f, 0.05f);   // Very low reflectivity
-	cardboard.shininess = 4.0f;                                // Very dull surface
-	cardboard.tag = "cardboard";
-	m_objectMaterials.push_back(cardboard);
-
-	OBJECT_MATERIAL chapstick;
-	chapstick.ambientColor = glm::vec3(0.8f, 0.8f, 0.8f);     // Very light gray
-	chapstick.ambientStrength = 0.3f;
-	chapstick.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);     // White plastic body
-	chapstick.specularColor = glm::vec3(0.6f, 0.6f, 0.6f);    // Light shine
-	chapstick.shininess = 32.0f;                              // Smooth, glossy surface
-	chapstick.tag = "chapstick";
-	m_objectMaterials.push_back(chapstick);
-
-	OBJECT_MATERIAL penBody;
-	penBody.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);      // Brighter ambient
-	penBody.ambientStrength = 0.3f;                          // More ambient contribution
-	penBody.diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);       // Light gray under lighting
-	penBody.specularColor = glm::vec3(0.4f, 0.4f, 0.4f);      // Soft plastic reflection
-	penBody.shininess = 12.0f;                               // Mild highlight
-	penBody.tag = "pen";
-	m_objectMaterials.push_back(penBody);
-
-	OBJECT_MATERIAL cupMaterial;
-	cupMaterial.ambientColor = glm::vec3(0.8f, 0.0f, 0.1f);
-	cupMaterial.ambientStrength = 0.25f;
-	cupMaterial.diffuseColor = glm::vec3(0.75f, 0.0f, 0.04f);
-	cupMaterial.specularColor = glm::vec3(0.3f, 0.2f, 0.2f);
-	cupMaterial.shininess = 8.0f;
-	cupMaterial.tag = "solo";
-	m_objectMaterials.push_back(cupMaterial);
-
-	OBJECT_MATERIAL bookMaterial;
-	bookMaterial.ambientColor = glm::vec3(1.0f, 1.0f, 1.0f);        // Neutral white to let texture shine through
-	bookMaterial.ambientStrength = 0.4f;                            // Moderate ambient to avoid shadowy areas
-	bookMaterial.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);         // No tint on texture
-	bookMaterial.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);        // Light shine (could increase if glossy)
-	bookMaterial.shininess = 8.0f;                                  // Low gloss  use 32.0+ if it's laminated
-	bookMaterial.tag = "book";
-	m_objectMaterials.push_back(bookMaterial);
-}
-
-
-
-void SceneManager::SetupSceneLights()
-{
-	// Tell shader to use lighting system
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
-
-	// Directional Light (soft fill light from above-left) 
-	m_pShaderManager->setVec3Value("directionalLight.direction", -0.3f, -1.0f, -0.2f);
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.3f, 0.2f, 0.2f);     
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 1.0f, 0.9f, 0.9f);     
-	m_pShaderManager->setVec3Value("directionalLight.specular", 0.5f, 0.5f, 0.5f);    
-	
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
-
-	// Point Light 0 (front of structure  reduced to avoid washing out the ground)
-	m_pShaderManager->setVec3Value("pointLights[0].position", 2.0f, 6.0f, 6.0f);
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.03f, 0.025f, 0.025f);    // Slight warm tint
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.7f, 0.5f, 0.5f);         // Reduced intensity
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.6f, 0.4f, 0.4f);        // Less blinding reflection
-	
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
-
-	// Point Light 1 (back-right fill light) 
-	m_pShaderManager->setVec3Value("pointLights[1].position", -3.0f, 6.0f, -2.0f);
-	m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.02f, 0.02f, 0.03f);
-	m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.5f, 0.5f, 0.6f);
-	m_pShaderManager->setVec3Value("pointLights[1].specular", 0.4f, 0.4f, 0.5f);
-	
-	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
-
-	// Point Light 2 (above top tier highlight) 
-	m_pShaderManager->setVec3Value("pointLights[2].position", -5.0f, 12.0f, -3.0f);
-	m_pShaderManager->setVec3Value("pointLights[2].ambient", 0.03f, 0.025f, 0.025f);
-	m_pShaderManager->setVec3Value("pointLights[2].diffuse", 0.8f, 0.7f, 0.7f);
-	m_pShaderManager->setVec3Value("pointLights[2].specular", 1.2f, 1.0f, 1.0f);
-	
-	m_pShaderManager->setBoolValue("pointLights[2].bActive", true);
-}
-
-void SceneManager::RenderCylinder(
-	const glm::vec3& scale,
-	float rotX, float rotY, float rotZ,
-	const glm::vec3& position,
-	const std::string& materialTag,
-	const std::string& textureTag,
-	bool useTexture)
-{
-	SetTransformations(scale, rotX, rotY, rotZ, position);
-	SetShaderMaterial(materialTag);
-	if (useTexture) SetShaderTexture(textureTag);
-	m_basicMeshes->DrawCylinderMesh();
-}
-
-void SceneManager::RenderCone(
-	const glm::vec3& scale,
-	float rotX, float rotY, float rotZ,
-	const glm::vec3& position,
-	const std::string& materialTag,
-	const std::string& textureTag,
-	bool useTexture)
-{
-	SetTransformations(scale, rotX, rotY, rotZ, position);
-	SetShaderMaterial(materialTag);
-	if (useTexture) SetShaderTexture(textureTag);
-	m_basicMeshes->DrawConeMesh();
-}
-
-void SceneManager::RenderBox(
-	const glm::vec3& scale,
-	float rotX, float rotY, float rotZ,
-	const glm::vec3& position,
-	const std::string& materialTag,
-	const std::string& textureTag,
-	bool useTexture)
-{
-	SetTransformations(scale, rotX, rotY, rotZ, position);
-	SetShaderMaterial(materialTag);
-	if (useTexture) SetShaderTexture(textureTag);
-	m_basicMeshes->DrawBoxMesh();
-}
-
-void SceneManager::RenderPlane(
-	const glm::vec3& scale,
-	float rotX, float rotY, float rotZ,
-	const glm::vec3& position,
-	const std::string& materialTag,
-	const std::string& textureTag,
-	bool useTexture)
-{
-	SetTransformations(scale, rotX, rotY, rotZ, position);
-	SetShaderMaterial(materialTag);
-	if (useTexture) SetShaderTexture(textureTag);
-	m_basicMeshes->DrawPlaneMesh();
-}
-
-void SceneManager::RenderTaperedCylinder(
-	const glm::vec3& scale,
-	float rotX, float rotY, float rotZ,
-	const glm::vec3& position,
-	const std::string& materialTag,
-	const std::string& textureTag,
-	bool useTexture)
-{
-	SetTransformations(scale, rotX, rotY, rotZ, position);
-	SetShaderMaterial(materialTag);
-	if (useTexture) SetShaderTexture(textureTag);
-	m_basicMeshes->DrawTaperedCylinderMesh();
-}
-
-void SceneManager::RenderSphere(
-	const glm::vec3& scale,
-	float rotX, float rotY, float rotZ,
-	const glm::vec3& position,
-	const std::string& materialTag,
-	const std::string& textureTag,
-	bool useTexture)
-{
-	SetTransformations(scale, rotX, rotY, rotZ, position);
-	SetShaderMaterial(materialTag);
-	if (useTexture) SetShaderTexture(textureTag);
-	m_basicMeshes->DrawSphereMesh();
-}
-
-
-/***********************************************************
- *  PrepareScene()
- *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
- ***********************************************************/
-void SceneManager::PrepareScene()
-{
-	LoadSceneTextures();
-	DefineObjectMaterials();
-	SetupSceneLights();
-
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
-}
-
-
-/***********************************************************
- *  RenderScene()
- *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
- ***********************************************************/
-void SceneManager::RenderScene()
-{
-	// Ground
-	RenderPlane({ 20.0f, 1.0f, 10.0f }, 0.0f, 0.0f, 0.0f, { 0.0f, 0.0f, 0.0f }, "cement", "plane", true);
-
-
-	// Spice rack bottom tier
-	RenderCylinder({ 5.0f, 2.0f, 5.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 0.0f, -3.0f }, "wood", "cylinder", true);
-	RenderCone({ 1.0f, 4.0f, 1.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 0.0f, -3.0f }, "wood", "cone", true);
-	RenderCone({ 1.0f, 4.0f, 1.0f }, 190.0f, 0.0f, 0.0f, { -5.0f, 5.0f, -3.0f }, "wood", "cone", true);
-	
-
-	//Spice rack middle tier
-	RenderCylinder({ 3.5f, 2.0f, 3.5f }, 0.0f, 0.0f, 0.0f, { -5.0f, 4.0f, -3.0f }, "wood", "cylinder", true);
-	RenderCone({ 1.0f, 4.0f, 1.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 4.0f, -3.0f }, "wood", "cone", true);
-	RenderCone({ 1.0f, 4.0f, 1.0f }, 190.0f, 0.0f, 0.0f, { -5.0f, 9.0f, -3.0f }, "wood", "cone", true);
-	
-
-	//Spice rack top tier
-	RenderCylinder({ 2.0f, 1.5f, 2.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 9.0f, -3.0f }, "wood", "cylinder", true);
-	RenderCone({ 1.0f, 4.0f, 1.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 9.0f, -3.0f }, "wood", "cone", true);
-	RenderCylinder({ 0.5f, 1.5f, 0.5f }, 0.0f, 0.0f, 0.0f, { -5.0f, 12.0f, -3.0f }, "wood", "cylinder", true);
-
-
-	// Masking tape + inner liner
-	RenderCylinder({ 1.0f, 1.0f, 1.0f }, 0.0f, 0.0f, 0.0f, { 1.1f, 0.0f, 1.5f }, "blue_tape", "tape", true);
-	RenderCylinder({ 0.8f, 1.02f, 0.8f }, 0.0f, 0.0f, 0.0f, { 1.1f, 0.0f, 1.5f }, "cardboard", "cardboard", true);
-
-	// Chapstick
-	RenderCylinder({ 0.20f, 1.5f, 0.20f }, 90.0f, 110.0f, 0.0f, { 0.0f, 0.20f, 3.0f }, "chapstick", "chapstick", true);
-
-	// Pen body
-	RenderCylinder({ 0.15f, 2.5f, 0.15f }, 0.0f, 0.0f, 90.0f, { -5.0f, 0.15f, 3.0f }, "pen", "pen", true);
-
-	// Pen tip
-	RenderCone({ 0.15f, 0.4f, 0.15f }, 0.0f, 0.0f, 270.0f, { -5.0f, 0.15f, 3.0f }, "pen", "pen", true);
-
-	// Pen clicker
-	RenderSphere({ 0.1f, 0.3f, 0.1f }, 0.0f, 0.0f, 90.0f, { -7.5f, 0.15f, 3.0f }, "pen", "pen", true);
-
-	// Solo cup
-	RenderTaperedCylinder({ 1.4f, 3.0f, 1.4f }, 0.0f, 0.0f, 0.0f, { 2.4f, 0.0f, -2.0f }, "solo", "solo", true);
-
-	// Book
-	RenderBox({ 6.0f, 6.0f, 0.5f }, 0.0f, -25.0f, 0.0f, { 4.0f, 3.0f, -3.4f }, "book", "book", true);
-}
-
+///////////////////////////////////////////////////////////////////////////////
+// scenemanager.cpp
+// ============
+// manage the preparing and rendering of 3D scenes - textures, materials, lighting
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneManager.h"
+
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// scenes with fewer nodes than this are culled with the
+	// linear test, which is faster for them than the hierarchy
+	const int BVH_MIN_NODES = 1024;
+
+	// silhouette error in pixels the levels of detail are chosen by
+	const float DEFAULT_LOD_ERROR_PIXELS = 1.0f;
+	// a node only moves to a coarser level once its error there
+	// is this much under the limit, so that a node close to the
+	// limit does not switch back and forth between two levels
+	const float LOD_HYSTERESIS = 0.25f;
+	const float PI = 3.14159265358979f;
+
+	// scene nodes and queue items handled by one job of the frame
+	// preparation, and the subtrees of the hierarchy per thread
+	const int CULL_JOB_NODES = 4096;
+	const int QUEUE_JOB_NODES = 2048;
+	const int INSTANCE_JOB_ITEMS = 4096;
+	const int QUERY_SUBTREES_PER_THREAD = 4;
+
+	// profiler scope names of the draw calls, in MESH_TYPE order
+	const char* g_DrawScopeNames[SceneGraph::MESH_COUNT] =
+	{
+		"Draw Plane",
+		"Draw Box",
+		"Draw Cylinder",
+		"Draw Tapered Cylinder",
+		"Draw Cone",
+		"Draw Sphere"
+	};
+}
+
+/***********************************************************
+ *  SceneManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneManager::SceneManager(
+	ShaderManager *pShaderManager,
+	UniformCache* pUniformCache,
+	ShaderProgramCache* pProgramCache)
+{
+	m_pShaderManager = pShaderManager;
+	m_pUniformCache = pUniformCache;
+	m_pProgramCache = pProgramCache;
+	m_primitiveMeshes = new PrimitiveMeshes();
+	m_textureLoader = new TextureLoader();
+	m_textureArray = 0;
+	m_materialBuffer = 0;
+	m_lightBuffer = 0;
+	m_lightBlock = LIGHT_BLOCK();
+	m_bUseLighting = false;
+	m_lightFeatures = 0;
+	m_bLightsDirty = true;
+	m_bUseShadows = true;
+	m_bUseStaticBatches = false;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_bQueueDirty = true;
+	m_drawFrame = 0;
+	m_bFrameReady = false;
+	m_pJobSystem = NULL;
+	m_bPipelined = false;
+	m_bNextFrameReady = false;
+	m_prepareFunction = [this](int, int) { PrepareNextFrame(); };
+	m_bPersistentBuffers = true;
+	for (int i = 0; i < 2; i++)
+	{
+		m_frames[i].viewMatrix = glm::mat4(1.0f);
+		m_frames[i].projectionMatrix = glm::mat4(1.0f);
+		m_frames[i].viewPosition = glm::vec3(0.0f);
+		m_frames[i].viewportHeight = 0;
+		m_frames[i].instanceRegion = -1;
+		m_frames[i].instanceOffset = 0;
+		m_frames[i].pInstances = NULL;
+		m_frames[i].bInstancesFlushed = false;
+		m_frames[i].drawnCount = 0;
+		m_frames[i].culledCount = 0;
+	}
+	m_drawCallCount = 0;
+	m_triangleCount = 0;
+	m_fullDetailTriangleCount = 0;
+	m_pProfiler = NULL;
+
+	// a ring of segments misses the circle it stands in for by
+	// 1 - cos(half a segment angle) of the radius
+	m_lodErrorPixels = DEFAULT_LOD_ERROR_PIXELS;
+	for (int level = 0; level < PrimitiveMeshes::LOD_LEVEL_COUNT; level++)
+	{
+		m_levelErrors[level] = 1.0f - cosf(PI / (float)PrimitiveMeshes::GetLevelSegments(level));
+	}
+}
+
+/***********************************************************
+ *  ~SceneManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneManager::~SceneManager()
+{
+	m_pShaderManager = NULL;
+	m_pUniformCache = NULL;
+	m_pProgramCache = NULL;
+	delete m_primitiveMeshes;
+	m_primitiveMeshes = NULL;
+	// destroy the created OpenGL textures
+	DestroyGLTextures();
+	delete m_textureLoader;
+	m_textureLoader = NULL;
+	// destroy the created uniform buffers
+	DestroyShaderBlocks();
+}
+
+/***********************************************************
+ *  CreateGLTexture()
+ *
+ *  This method is used for registering a texture image file
+ *  in the next available texture slot. The image is loaded
+ *  into the matching layer of the texture array once all
+ *  the textures are registered and the array is created.
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, const std::string& tag)
+{
+	// register the texture and associate it with the special tag string
+	TEXTURE_INFO textureInfo;
+	textureInfo.tag = tag;
+	textureInfo.filename = filename;
+	textureInfo.data = NULL;
+	textureInfo.size = 0;
+	textureInfo.bCooked = false;
+	m_textureIndex[tag] = (int)m_textures.size();
+	m_textures.push_back(textureInfo);
+
+	return true;
+}
+
+/***********************************************************
+ *  BindGLTextures()
+ *
+ *  This method is used for creating the texture array that
+ *  holds every registered texture as the layer matching its
+ *  slot, and binding it once. Each layer holds a placeholder
+ *  until its image is decoded on a worker thread and
+ *  uploaded during a later frame. The shader picks the layer
+ *  from the per-instance texture slot, so drawing never
+ *  changes any texture state.
+ ***********************************************************/
+void SceneManager::BindGLTextures()
+{
+	m_textureArray = m_textureLoader->CreateTextureArray((int)m_textures.size());
+
+	for (int i = 0; i < (int)m_textures.size(); i++)
+	{
+		const TEXTURE_INFO& texture = m_textures[i];
+		if (NULL != texture.data)
+		{
+			m_textureLoader->RequestMemory(i, texture.filename, texture.data, texture.size, texture.bCooked);
+		}
+		else
+		{
+			m_textureLoader->Request(i, texture.filename);
+		}
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+	m_pUniformCache->SetInt(UniformCache::UNIFORM_OBJECT_TEXTURES, 0);
+}
+
+/***********************************************************
+ *  DestroyGLTextures()
+ *
+ *  This method is used for freeing the texture array.
+ ***********************************************************/
+void SceneManager::DestroyGLTextures()
+{
+	// no decoded image may land in a deleted texture
+	m_textureLoader->Shutdown();
+	if (m_textureArray != 0)
+	{
+		glDeleteTextures(1, &m_textureArray);
+		m_textureArray = 0;
+	}
+	m_textures.clear();
+	m_textureIndex.clear();
+}
+
+/***********************************************************
+ *  GetTextureFiles()
+ *
+ *  This method is used for getting the file names of the
+ *  registered textures, each named once.
+ ***********************************************************/
+void SceneManager::GetTextureFiles(std::vector<std::string>& filenames) const
+{
+	filenames.clear();
+	for (int i = 0; i < (int)m_textures.size(); i++)
+	{
+		if (std::find(filenames.begin(), filenames.end(), m_textures[i].filename) == filenames.end())
+		{
+			filenames.push_back(m_textures[i].filename);
+		}
+	}
+}
+
+/***********************************************************
+ *  ReloadTexture()
+ *
+ *  This method is used for loading a changed texture file
+ *  again into every layer registered with it. Only those
+ *  layers are uploaded, and each keeps showing its old
+ *  image until the new one is ready. The file is read from
+ *  disk even when the scene came from a package, since the
+ *  packaged copy is the one that is out of date.
+ ***********************************************************/
+bool SceneManager::ReloadTexture(const std::string& filename)
+{
+	bool bFound = false;
+	for (int i = 0; i < (int)m_textures.size(); i++)
+	{
+		if (m_textures[i].filename == filename)
+		{
+			m_textures[i].data = NULL;
+			m_textures[i].size = 0;
+			m_textures[i].bCooked = false;
+			m_textureLoader->Request(i, filename);
+			bFound = true;
+		}
+	}
+
+	return(bFound);
+}
+
+/***********************************************************
+ *  FindTextureSlot()
+ *
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureSlot(const std::string& tag)
+{
+	std::unordered_map<std::string, int>::const_iterator found = m_textureIndex.find(tag);
+
+	if (found == m_textureIndex.end())
+	{
+		return(-1);
+	}
+
+	return(found->second);
+}
+
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ ***********************************************************/
+bool SceneManager::FindMaterial(const std::string& tag, OBJECT_MATERIAL& material)
+{
+	int materialIndex = FindMaterialIndex(tag);
+
+	if (materialIndex < 0)
+	{
+		return(false);
+	}
+
+	material = m_objectMaterials[materialIndex];
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a material
+ *  in the previously defined materials list that is
+ *  associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const std::string& tag)
+{
+	std::unordered_map<std::string, int>::const_iterator found = m_materialIndex.find(tag);
+
+	if (found == m_materialIndex.end())
+	{
+		return(-1);
+	}
+
+	return(found->second);
+}
+
+/***********************************************************
+ *  AddObjectMaterial()
+ *
+ *  This method is used for adding a material into the
+ *  defined materials list and indexing it by its tag.
+ ***********************************************************/
+int SceneManager::AddObjectMaterial(const OBJECT_MATERIAL& material)
+{
+	int materialIndex = (int)m_objectMaterials.size();
+
+	m_materialIndex[material.tag] = materialIndex;
+	m_objectMaterials.push_back(material);
+
+	return(materialIndex);
+}
+
+/***********************************************************
+ *  SetShaderColor()
+ *
+ *  This method is used for setting the passed in color
+ *  into the shader for the next draw command
+ ***********************************************************/
+void SceneManager::SetShaderColor(
+	float redColorValue,
+	float greenColorValue,
+	float blueColorValue,
+	float alphaValue)
+{
+	// variables for this method
+	glm::vec4 currentColor;
+
+	currentColor.r = redColorValue;
+	currentColor.g = greenColorValue;
+	currentColor.b = blueColorValue;
+	currentColor.a = alphaValue;
+
+	if (NULL != m_pUniformCache)
+	{
+		m_pUniformCache->SetVec4(UniformCache::UNIFORM_OBJECT_COLOR, currentColor);
+	}
+}
+
+/***********************************************************
+ *  SetTextureUVScale()
+ *
+ *  This method is used for setting the texture UV scale
+ *  values into the shader.
+ ***********************************************************/
+void SceneManager::SetTextureUVScale(float u, float v)
+{
+	if (NULL != m_pUniformCache)
+	{
+		m_pUniformCache->SetVec2(UniformCache::UNIFORM_UV_SCALE, glm::vec2(u, v));
+	}
+}
+
+/***********************************************************
+  *  LoadSceneTextures()
+  *
+  *  This method is used for preparing the 3D scene by loading
+  *  the shapes, textures in memory to support the 3D scene
+  *  rendering
+  ***********************************************************/
+void SceneManager::LoadSceneTextures()
+{
+	bool bReturn = false;
+	bReturn = CreateGLTexture(
+		"../../Utilities/textures/knife_handle.jpg",
+		"cone");
+	bReturn = CreateGLTexture(
+		"../../Utilities/textures/seamless-wood3.jpg",
+		"cylinder");
+	bReturn = CreateGLTexture(
+		"../../Utilities/textures/road.jpg",
+		"plane");
+	bReturn = CreateGLTexture(
+		"../../Utilities/textures/blueTape.jpg",
+		"tape");\
+	bReturn = CreateGLTexture(
+		"../../Utilities/textures/cardboard.jpg",
+		"cardboard");
+	bReturn = CreateGLTexture(
+		"../../Utilities/textures/drywall.jpg",
+		"chapstick");
+	bReturn = CreateGLTexture(
+		"../../Utilities/textures/pen.jpg",
+		"pen");
+	bReturn = CreateGLTexture(
+		"../../Utilities/textures/stainless.jpg",
+		"solo");
+	bReturn = CreateGLTexture(
+		"../../Utilities/textures/napkinfinance.jpg",
+		"book");
+	// after all the textures are registered, the texture array
+	// holding them is created and bound to its texture unit
+	BindGLTextures();
+}
+
+/***********************************************************
+ *  CreateShaderBlocks()
+ *
+ *  This method is used for creating the uniform buffers
+ *  that hold the material and light blocks, and attaching
+ *  them to the binding points used by the shader, the
+ *  buffer textures of the local lights and the shadow atlas,
+ *  and the ring buffer the instances of the frames are
+ *  written into, which grows with the scene.
+ ***********************************************************/
+void SceneManager::CreateShaderBlocks()
+{
+	glGenBuffers(1, &m_materialBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(MATERIAL_BLOCK_ENTRY) * MAX_OBJECT_MATERIALS, NULL, GL_STATIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, m_materialBuffer);
+
+	glGenBuffers(1, &m_lightBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_lightBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(LIGHT_BLOCK), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING, m_lightBuffer);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_lightClusters.CreateBuffers(m_bPersistentBuffers);
+	m_pUniformCache->SetInt(UniformCache::UNIFORM_LOCAL_LIGHTS, LOCAL_LIGHT_TEXTURE_UNIT);
+	m_pUniformCache->SetInt(UniformCache::UNIFORM_LIGHT_CLUSTERS, LIGHT_CLUSTER_TEXTURE_UNIT);
+	m_pUniformCache->SetInt(UniformCache::UNIFORM_CLUSTER_LIGHTS, CLUSTER_LIST_TEXTURE_UNIT);
+
+	m_shadowAtlas.Create();
+	m_pUniformCache->SetInt(UniformCache::UNIFORM_SHADOW_ATLAS, SHADOW_ATLAS_TEXTURE_UNIT);
+
+	m_instanceRing.Create(GL_ARRAY_BUFFER, sizeof(PrimitiveMeshes::INSTANCE_DATA) * 1024, m_bPersistentBuffers);
+}
+
+/***********************************************************
+ *  DestroyShaderBlocks()
+ *
+ *  This method is used for freeing the uniform buffers.
+ ***********************************************************/
+void SceneManager::DestroyShaderBlocks()
+{
+	if (m_materialBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_materialBuffer);
+		m_materialBuffer = 0;
+	}
+	if (m_lightBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_lightBuffer);
+		m_lightBuffer = 0;
+	}
+	m_lightClusters.DestroyBuffers();
+	m_shadowAtlas.Destroy();
+	m_instanceRing.Destroy();
+}
+
+/***********************************************************
+ *  UploadMaterialBlock()
+ *
+ *  This method is used for sending all of the defined
+ *  materials into the material uniform buffer, indexed by
+ *  material ID.
+ ***********************************************************/
+void SceneManager::UploadMaterialBlock()
+{
+	int materialCount = (int)m_objectMaterials.size();
+	if (materialCount > MAX_OBJECT_MATERIALS)
+	{
+		std::cout << "Only the first " << MAX_OBJECT_MATERIALS << " of " << materialCount
+			<< " materials fit in the material block; objects using the others get the first" << std::endl;
+		materialCount = MAX_OBJECT_MATERIALS;
+	}
+
+	std::vector<MATERIAL_BLOCK_ENTRY> materialBlock(materialCount);
+	for (int i = 0; i < materialCount; i++)
+	{
+		materialBlock[i].diffuseColor = m_objectMaterials[i].diffuseColor;
+		materialBlock[i].shininess = m_objectMaterials[i].shininess;
+		materialBlock[i].specularColor = m_objectMaterials[i].specularColor;
+		materialBlock[i].padding0 = 0.0f;
+	}
+
+	if (materialCount > 0)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(MATERIAL_BLOCK_ENTRY) * materialCount, &materialBlock[0]);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+}
+
+/***********************************************************
+ *  UploadLightBlock()
+ *
+ *  This method is used for sending all of the light values
+ *  into the light uniform buffer with a single update. The
+ *  active point lights are moved to the front of the block,
+ *  and the active lights are kept as shader features, so
+ *  the shader variants loop over exactly the lights that
+ *  are on without testing any of them. The terms that are
+ *  the same for every fragment, the normalized directions
+ *  towards the lights and the scale of the spot light
+ *  falloff, are worked out here once.
+ ***********************************************************/
+void SceneManager::UploadLightBlock()
+{
+	LIGHT_BLOCK lightBlock = m_lightBlock;
+	int pointLightCount = 0;
+	for (int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+	{
+		if (m_lightBlock.pointLights[i].bActive)
+		{
+			lightBlock.pointLights[pointLightCount++] = m_lightBlock.pointLights[i];
+		}
+	}
+	for (int i = pointLightCount; i < TOTAL_POINT_LIGHTS; i++)
+	{
+		lightBlock.pointLights[i] = POINT_LIGHT_BLOCK();
+	}
+
+	if (m_lightBlock.directionalLight.bActive)
+	{
+		lightBlock.directionalLight.direction = -glm::normalize(m_lightBlock.directionalLight.direction);
+	}
+	if (m_lightBlock.spotLight.bActive)
+	{
+		const SPOT_LIGHT_BLOCK& spotLight = m_lightBlock.spotLight;
+		lightBlock.spotLight.direction = -glm::normalize(spotLight.direction);
+		lightBlock.spotLight.cutOff = 1.0f / glm::max(spotLight.cutOff - spotLight.outerCutOff, 0.0001f);
+	}
+
+	m_lightFeatures = (unsigned int)pointLightCount << ShaderProgramCache::POINT_LIGHT_SHIFT;
+	if (m_lightBlock.directionalLight.bActive)
+	{
+		m_lightFeatures |= ShaderProgramCache::FEATURE_DIRECTIONAL_LIGHT;
+	}
+	if (m_lightBlock.spotLight.bActive)
+	{
+		m_lightFeatures |= ShaderProgramCache::FEATURE_SPOT_LIGHT;
+	}
+	if (m_lightClusters.GetLightCount() > 0)
+	{
+		m_lightFeatures |= ShaderProgramCache::FEATURE_LOCAL_LIGHTS;
+	}
+
+	// the shadows are cast by the directional and point lights
+	m_shadowAtlas.SetLights(lightBlock, pointLightCount);
+	if ((m_bUseShadows == true) &&
+		((m_lightBlock.directionalLight.bActive) || (pointLightCount > 0)))
+	{
+		m_lightFeatures |= ShaderProgramCache::FEATURE_SHADOWS;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_lightBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LIGHT_BLOCK), &lightBlock);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  AssignLocalLights()
+ *
+ *  This method is used for making the light list of every
+ *  cluster of the view of the drawn frame, and passing the
+ *  shader the values that place a fragment in its cluster.
+ *  The tiles follow the viewport being rendered into.
+ ***********************************************************/
+void SceneManager::AssignLocalLights()
+{
+	const PREPARED_FRAME& frame = m_frames[m_drawFrame];
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	m_lightClusters.Update(frame.viewMatrix, frame.projectionMatrix, viewport[2], viewport[3], m_pJobSystem);
+
+	m_pUniformCache->SetVec2(UniformCache::UNIFORM_CLUSTER_TILE_SCALE, m_lightClusters.GetTileScale());
+	m_pUniformCache->SetVec4(UniformCache::UNIFORM_CLUSTER_DEPTH_PLANE, m_lightClusters.GetDepthPlane());
+	m_pUniformCache->SetVec2(UniformCache::UNIFORM_CLUSTER_SLICE_SCALE, m_lightClusters.GetSliceScale());
+}
+
+/***********************************************************
+ *  RenderShadows()
+ *
+ *  This method is used for bringing the shadow atlas up to
+ *  date before the scene is drawn. Most frames nothing has
+ *  changed and nothing is drawn. The tiles are drawn with
+ *  the light views, so the view of the drawn frame is set
+ *  again when any were.
+ ***********************************************************/
+void SceneManager::RenderShadows()
+{
+	if ((GetSceneFeatures() & ShaderProgramCache::FEATURE_SHADOWS) == 0)
+	{
+		return;
+	}
+
+	ScopedProfile profile(m_pProfiler, "Shadow Maps");
+	if (m_shadowAtlas.Update(m_sceneGraph, m_primitiveMeshes, m_pUniformCache, m_pProgramCache->GetProgram(0)) == true)
+	{
+		m_pUniformCache->SetMat4(UniformCache::UNIFORM_VIEW, m_frames[m_drawFrame].viewMatrix);
+		m_pUniformCache->SetMat4(UniformCache::UNIFORM_PROJECTION, m_frames[m_drawFrame].projectionMatrix);
+	}
+}
+
+/***********************************************************
+ *  SetShadows()
+ *
+ *  This method is used for turning the shadows of the
+ *  lights on or off, switching to the shader variants
+ *  with or without them.
+ ***********************************************************/
+void SceneManager::SetShadows(bool bUseShadows)
+{
+	if (bUseShadows != m_bUseShadows)
+	{
+		m_bUseShadows = bUseShadows;
+		UploadLightBlock();
+		PrepareShaderVariants();
+	}
+}
+
+/***********************************************************
+ *  SetStaticBatching()
+ *
+ *  This method is used for turning the static batches on or
+ *  off. The static nodes are baked in their current place,
+ *  so the transforms are brought up to date first. The
+ *  prepared frames left the baked nodes out or held them,
+ *  so the next frame is prepared again before it is drawn.
+ ***********************************************************/
+void SceneManager::SetStaticBatching(bool bUseStaticBatches)
+{
+	if (bUseStaticBatches == m_bUseStaticBatches)
+	{
+		return;
+	}
+
+	m_bUseStaticBatches = bUseStaticBatches;
+	if (m_bUseStaticBatches == true)
+	{
+		UpdateSceneTransforms();
+		m_staticBatches.Build(m_sceneGraph, *m_primitiveMeshes);
+		std::cout << "INFO: Baked " << m_staticBatches.GetBakedNodeCount() << " of "
+			<< m_sceneGraph.GetNodeCount() << " objects into "
+			<< m_staticBatches.GetChunkCount() << " static batches" << std::endl;
+	}
+	else
+	{
+		m_staticBatches.Destroy();
+	}
+	m_bQueueDirty = true;
+	m_bFrameReady = false;
+}
+
+/***********************************************************
+ *  SetJobSystem()
+ *
+ *  This method is used for spreading the transforms, the
+ *  culling and the queue of every frame over the threads
+ *  of a job system. When pipelined, the next frame is
+ *  prepared on the workers while this thread draws the
+ *  current one, so every frame is shown one frame later.
+ ***********************************************************/
+void SceneManager::SetJobSystem(JobSystem* pJobSystem, bool bPipelined)
+{
+	m_pJobSystem = pJobSystem;
+	m_bPipelined = bPipelined;
+	m_bFrameReady = false;
+	m_bQueueDirty = true;
+}
+
+/***********************************************************
+ *  GetRingRegionCount()
+ *
+ *  This method is used for getting the number of regions
+ *  the instance and light list rings moved on to since
+ *  their stats were reset.
+ ***********************************************************/
+long long SceneManager::GetRingRegionCount() const
+{
+	return(m_instanceRing.GetRegionCount() + m_lightClusters.GetListRing().GetRegionCount());
+}
+
+/***********************************************************
+ *  GetRingStallCount()
+ *
+ *  This method is used for getting the number of regions
+ *  of the rings the CPU had to wait for the GPU to finish
+ *  reading before it could write them.
+ ***********************************************************/
+long long SceneManager::GetRingStallCount() const
+{
+	return(m_instanceRing.GetStallCount() + m_lightClusters.GetListRing().GetStallCount());
+}
+
+/***********************************************************
+ *  GetRingWaitSeconds()
+ *
+ *  This method is used for getting the time the CPU spent
+ *  waiting on the fences of the rings, which is time the
+ *  pipeline was stalled on the GPU.
+ ***********************************************************/
+double SceneManager::GetRingWaitSeconds() const
+{
+	return(m_instanceRing.GetWaitSeconds() + m_lightClusters.GetListRing().GetWaitSeconds());
+}
+
+/***********************************************************
+ *  ResetRingStats()
+ *
+ *  This method is used for clearing the stats of the rings.
+ ***********************************************************/
+void SceneManager::ResetRingStats()
+{
+	m_instanceRing.ResetStats();
+	m_lightClusters.ResetRingStats();
+}
+
+/***********************************************************
+ *  SetLodError()
+ *
+ *  This method is used for setting how far in pixels the
+ *  outline of a round shape may stray from the full detail
+ *  one. The levels are chosen again with the next queue.
+ ***********************************************************/
+void SceneManager::SetLodError(float pixels)
+{
+	m_lodErrorPixels = (pixels > 0.0f) ? pixels : 0.0f;
+	m_bQueueDirty = true;
+}
+
+/***********************************************************
+ *  GetSceneFeatures()
+ *
+ *  This method is used for getting the shader features that
+ *  every draw of the scene shares. Only whether an object
+ *  is textured differs between the draws.
+ ***********************************************************/
+unsigned int SceneManager::GetSceneFeatures() const
+{
+	if (m_bUseLighting == false)
+	{
+		return(0);
+	}
+
+	return(ShaderProgramCache::FEATURE_LIGHTING | m_lightFeatures);
+}
+
+/***********************************************************
+ *  PrepareShaderVariants()
+ *
+ *  This method is used for building the shader variants of
+ *  the scene up front, for the textured and the untextured
+ *  objects and the shadow maps, so the first frame does not
+ *  wait on them.
+ ***********************************************************/
+void SceneManager::PrepareShaderVariants()
+{
+	m_pProgramCache->GetProgram(GetSceneFeatures());
+	m_pProgramCache->GetProgram(GetSceneFeatures() | ShaderProgramCache::FEATURE_TEXTURED);
+	// the shadow maps are drawn with the plainest variant
+	if ((GetSceneFeatures() & ShaderProgramCache::FEATURE_SHADOWS) != 0)
+	{
+		m_pProgramCache->GetProgram(0);
+	}
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+void SceneManager::DefineObjectMaterials()
+{
+	// Wood (for the rack tiers and top)
+	OBJECT_MATERIAL woodMaterial;
+	woodMaterial.ambientColor = glm::vec3(0.3f, 0.2f, 0.1f);
+	woodMaterial.ambientStrength = 0.25f;
+	woodMaterial.diffuseColor = glm::vec3(0.4f, 0.25f, 0.15f);
+	woodMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	woodMaterial.shininess = 8.0f;
+	woodMaterial.tag = "wood";
+	AddObjectMaterial(woodMaterial);
+
+	// Cement for the floor
+	OBJECT_MATERIAL cementMaterial;
+	cementMaterial.ambientColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	cementMaterial.ambientStrength = 0.4f;
+	cementMaterial.diffuseColor = glm::vec3(0.6f, 0.6f, 0.6f);
+	cementMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	cementMaterial.shininess = 4.0f;
+	cementMaterial.tag = "cement";
+	AddObjectMaterial(cementMaterial);
+
+	OBJECT_MATERIAL blueTape;
+	blueTape.ambientColor = glm::vec3(0.1f, 0.2f, 0.5f);     // Subtle blue ambient tone
+	blueTape.ambientStrength = 0.3f;                         // Slight ambient glow
+	blueTape.diffuseColor = glm::vec3(0.1f, 0.3f, 0.9f);      // Vivid blue when lit
+	blueTape.specularColor = glm::vec3(0.2f, 0.4f, 1.0f);     // Bright blue highlights
+	blueTape.shininess = 16.0f;                              // Moderate specular shine
+	blueTape.tag = "blue_tape";
+	AddObjectMaterial(blueTape);
+
+	OBJECT_MATERIAL cardboard;
+	cardboard.ambientColor = glm::vec3(0.25f, 0.2f, 0.15f);     // Warm brown ambient
+	cardboard.ambientStrength = 0.2f;                           // Subtle glow
+	cardboard.diffuseColor = glm::vec3(0.45f, 0.35f, 0.25f);    // Light brown under direct light
+	cardboard.specularColor = glm::vec3(0.05f, 0.05f, 0.05f);   // Very low reflectivity
+	cardboard.shininess = 4.0f;                                // Very dull surface
+	cardboard.tag = "cardboard";
+	AddObjectMaterial(cardboard);
+
+	OBJECT_MATERIAL chapstick;
+	chapstick.ambientColor = glm::vec3(0.8f, 0.8f, 0.8f);     // Very light gray
+	chapstick.ambientStrength = 0.3f;
+	chapstick.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);     // White plastic body
+	chapstick.specularColor = glm::vec3(0.6f, 0.6f, 0.6f);    // Light shine
+	chapstick.shininess = 32.0f;                              // Smooth, glossy surface
+	chapstick.tag = "chapstick";
+	AddObjectMaterial(chapstick);
+
+	OBJECT_MATERIAL penBody;
+	penBody.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);      // Brighter ambient
+	penBody.ambientStrength = 0.3f;                          // More ambient contribution
+	penBody.diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);       // Light gray under lighting
+	penBody.specularColor = glm::vec3(0.4f, 0.4f, 0.4f);      // Soft plastic reflection
+	penBody.shininess = 12.0f;                               // Mild highlight
+	penBody.tag = "pen";
+	AddObjectMaterial(penBody);
+
+	OBJECT_MATERIAL cupMaterial;
+	cupMaterial.ambientColor = glm::vec3(0.8f, 0.0f, 0.1f);
+	cupMaterial.ambientStrength = 0.25f;
+	cupMaterial.diffuseColor = glm::vec3(0.75f, 0.0f, 0.04f);
+	cupMaterial.specularColor = glm::vec3(0.3f, 0.2f, 0.2f);
+	cupMaterial.shininess = 8.0f;
+	cupMaterial.tag = "solo";
+	AddObjectMaterial(cupMaterial);
+
+	OBJECT_MATERIAL bookMaterial;
+	bookMaterial.ambientColor = glm::vec3(1.0f, 1.0f, 1.0f);        // Neutral white to let texture shine through
+	bookMaterial.ambientStrength = 0.4f;                            // Moderate ambient to avoid shadowy areas
+	bookMaterial.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);         // No tint on texture
+	bookMaterial.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);        // Light shine (could increase if glossy)
+	bookMaterial.shininess = 8.0f;                                  // Low gloss  use 32.0+ if it's laminated
+	bookMaterial.tag = "book";
+	AddObjectMaterial(bookMaterial);
+}
+
+
+
+void SceneManager::SetupSceneLights()
+{
+	// draw the scene with the lighting system
+	m_bUseLighting = true;
+
+	// all the lights start out inactive
+	m_lightBlock = LIGHT_BLOCK();
+
+	// Directional Light (soft fill light from above-left) 
+	m_lightBlock.directionalLight.direction = glm::vec3(-0.3f, -1.0f, -0.2f);
+	m_lightBlock.directionalLight.ambient = glm::vec3(0.3f, 0.2f, 0.2f);
+	m_lightBlock.directionalLight.diffuse = glm::vec3(1.0f, 0.9f, 0.9f);
+	m_lightBlock.directionalLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
+	
+	m_lightBlock.directionalLight.bActive = true;
+
+	// Point Light 0 (front of structure  reduced to avoid washing out the ground)
+	m_lightBlock.pointLights[0].position = glm::vec3(2.0f, 6.0f, 6.0f);
+	m_lightBlock.pointLights[0].ambient = glm::vec3(0.03f, 0.025f, 0.025f);    // Slight warm tint
+	m_lightBlock.pointLights[0].diffuse = glm::vec3(0.7f, 0.5f, 0.5f);         // Reduced intensity
+	m_lightBlock.pointLights[0].specular = glm::vec3(0.6f, 0.4f, 0.4f);        // Less blinding reflection
+	
+	m_lightBlock.pointLights[0].bActive = true;
+
+	// Point Light 1 (back-right fill light) 
+	m_lightBlock.pointLights[1].position = glm::vec3(-3.0f, 6.0f, -2.0f);
+	m_lightBlock.pointLights[1].ambient = glm::vec3(0.02f, 0.02f, 0.03f);
+	m_lightBlock.pointLights[1].diffuse = glm::vec3(0.5f, 0.5f, 0.6f);
+	m_lightBlock.pointLights[1].specular = glm::vec3(0.4f, 0.4f, 0.5f);
+	
+	m_lightBlock.pointLights[1].bActive = true;
+
+	// Point Light 2 (above top tier highlight) 
+	m_lightBlock.pointLights[2].position = glm::vec3(-5.0f, 12.0f, -3.0f);
+	m_lightBlock.pointLights[2].ambient = glm::vec3(0.03f, 0.025f, 0.025f);
+	m_lightBlock.pointLights[2].diffuse = glm::vec3(0.8f, 0.7f, 0.7f);
+	m_lightBlock.pointLights[2].specular = glm::vec3(1.2f, 1.0f, 1.0f);
+	
+	m_lightBlock.pointLights[2].bActive = true;
+
+	// send all the light values to the shader at once
+	UploadLightBlock();
+}
+
+/***********************************************************
+ *  ScatterLocalLights()
+ *
+ *  This method is used for placing local lights of random
+ *  colors at random spots over the scene objects, replacing
+ *  any local lights the scene had, for trying out scenes
+ *  with many lights. The radius shrinks as the count grows,
+ *  so each light overlaps a few of its neighbours and the
+ *  lights covering a pixel stay about the same. The same
+ *  count always gives the same lights.
+ ***********************************************************/
+void SceneManager::ScatterLocalLights(int count)
+{
+	if ((count <= 0) || (m_sceneGraph.GetNodeCount() == 0))
+	{
+		return;
+	}
+
+	m_sceneGraph.UpdateTransforms(m_pJobSystem);
+	const SceneGraph::WORLD_BOUNDS& bounds = m_sceneGraph.GetWorldBounds();
+	glm::vec3 minimum(1e30f);
+	glm::vec3 maximum(-1e30f);
+	for (int i = 0; i < m_sceneGraph.GetNodeCount(); i++)
+	{
+		glm::vec3 center(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+		glm::vec3 extent(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+		minimum = glm::min(minimum, center - extent);
+		maximum = glm::max(maximum, center + extent);
+	}
+
+	float spacing = std::sqrt((maximum.x - minimum.x) * (maximum.z - minimum.z) / count);
+	float radius = glm::clamp(2.5f * spacing, 0.5f, 6.0f);
+
+	srand(1);
+	std::vector<LOCAL_LIGHT> lights(count);
+	for (int i = 0; i < count; i++)
+	{
+		glm::vec3 spot((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX);
+		glm::vec3 color((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX);
+		color = glm::vec3(0.2f) + 0.8f * color;
+
+		lights[i] = LOCAL_LIGHT();
+		lights[i].position = minimum + spot * (maximum - minimum + glm::vec3(0.0f, 0.5f * radius, 0.0f));
+		lights[i].radius = radius;
+		lights[i].diffuse = 0.8f * color;
+		lights[i].specular = 0.5f * color;
+	}
+	m_lightClusters.SetLights(&lights[0], count);
+
+	// the local lights are a shader feature of their own
+	UploadLightBlock();
+	PrepareShaderVariants();
+	m_bLightsDirty = true;
+
+	std::cout << "INFO: " << count << " local lights scattered over the scene with a radius of "
+		<< radius << std::endl;
+}
+
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object into the
+ *  retained scene. The material and texture tags are
+ *  resolved once here, so that rendering the object each
+ *  frame does not need any lookups. A material past the
+ *  end of the material block is drawn with the first one.
+ ***********************************************************/
+void SceneManager::AddSceneObject(
+	SceneGraph::MESH_TYPE meshType,
+	const glm::vec3& scale,
+	float rotX, float rotY, float rotZ,
+	const glm::vec3& position,
+	const std::string& materialTag,
+	const std::string& textureTag,
+	bool useTexture)
+{
+	int materialID = FindMaterialIndex(materialTag);
+	int textureSlot = -1;
+
+	if (materialID >= MAX_OBJECT_MATERIALS)
+	{
+		materialID = 0;
+	}
+
+	if (useTexture)
+	{
+		textureSlot = FindTextureSlot(textureTag);
+	}
+
+	m_sceneGraph.AddNode(
+		meshType,
+		scale,
+		glm::vec3(rotX, rotY, rotZ),
+		position,
+		materialID,
+		textureSlot);
+}
+
+/***********************************************************
+ *  SetFrameView()
+ *
+ *  This method is used for giving a frame the view last
+ *  passed in and the size of the viewport being rendered
+ *  into, which is read here on the OpenGL thread so the
+ *  frame can be prepared on any thread.
+ ***********************************************************/
+void SceneManager::SetFrameView(PREPARED_FRAME& frame)
+{
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	frame.viewMatrix = m_viewMatrix;
+	frame.projectionMatrix = m_projectionMatrix;
+	frame.viewPosition = glm::vec3(glm::inverse(m_viewMatrix)[3]);
+	frame.viewportHeight = viewport[3];
+}
+
+/***********************************************************
+ *  PrepareFrame()
+ *
+ *  This method is used for preparing everything a frame
+ *  draws from its view and the current node transforms.
+ *  It makes no OpenGL calls, so it can run on a worker
+ *  thread; the region of the instance ring it writes the
+ *  instances into is taken beforehand on the OpenGL thread.
+ ***********************************************************/
+void SceneManager::PrepareFrame(PREPARED_FRAME& frame)
+{
+	CullSceneNodes(frame);
+	BuildRenderQueue(frame);
+	FillInstances(frame);
+	frame.bInstancesFlushed = false;
+}
+
+/***********************************************************
+ *  PrepareNextFrame()
+ *
+ *  This method is used for preparing the frame after the
+ *  one being drawn. It runs as a job while this thread
+ *  draws, so it only touches the node transforms and the
+ *  frame that is not being drawn. When nothing moved and
+ *  the view is the same, the drawn frame is kept.
+ ***********************************************************/
+void SceneManager::PrepareNextFrame()
+{
+	UpdateSceneTransforms();
+	if (m_bQueueDirty == true)
+	{
+		PrepareFrame(m_frames[1 - m_drawFrame]);
+		m_bQueueDirty = false;
+		m_bNextFrameReady = true;
+	}
+}
+
+/***********************************************************
+ *  CullSceneNodes()
+ *
+ *  This method is used for testing the world bounds of the
+ *  scene nodes against the view frustum of a frame. Large
+ *  scenes are queried through the hierarchy, cut into a
+ *  few subtrees per thread, and the others are tested in
+ *  runs of nodes, so the test is spread over the threads
+ *  either way.
+ ***********************************************************/
+void SceneManager::CullSceneNodes(PREPARED_FRAME& frame)
+{
+	const SceneGraph::WORLD_BOUNDS& bounds = m_sceneGraph.GetWorldBounds();
+	int nodeCount = m_sceneGraph.GetNodeCount();
+	std::atomic<int> drawnCount(0);
+
+	frame.frustum.ExtractPlanes(frame.projectionMatrix * frame.viewMatrix);
+	if (m_sceneBVH.IsBuilt() == true)
+	{
+		int threadCount = (NULL != m_pJobSystem) ? m_pJobSystem->GetThreadCount() : 1;
+		m_sceneBVH.GetSubtrees(threadCount * QUERY_SUBTREES_PER_THREAD, m_querySubtrees);
+		m_visibleNodes.assign(nodeCount, 0);
+
+		JobSystem::ForEachRange(m_pJobSystem, (int)m_querySubtrees.size(), 1,
+			[this, &frame, &bounds, &drawnCount](int first, int last)
+			{
+				for (int i = first; i < last; i++)
+				{
+					drawnCount += m_sceneBVH.FrustumQuerySubtree(frame.frustum, bounds, m_querySubtrees[i], m_visibleNodes);
+				}
+			});
+	}
+	else
+	{
+		m_visibleNodes.resize(nodeCount);
+
+		JobSystem::ForEachRange(m_pJobSystem, nodeCount, CULL_JOB_NODES,
+			[this, &frame, &bounds, &drawnCount](int first, int last)
+			{
+				drawnCount += frame.frustum.CullBoundsRange(bounds, first, last, m_visibleNodes);
+			});
+	}
+
+	frame.drawnCount = drawnCount;
+	frame.culledCount = nodeCount - frame.drawnCount;
+}
+
+/***********************************************************
+ *  BuildRenderQueue()
+ *
+ *  This method is used for adding the scene nodes that may
+ *  be visible into the render queue of a frame with their
+ *  depth in front of the camera and level of detail, and
+ *  sorting the queue into batches. The items are made on
+ *  the threads into one slot per node, and gathered in
+ *  node order, so the queue is the same for any number of
+ *  threads.
+ ***********************************************************/
+void SceneManager::BuildRenderQueue(PREPARED_FRAME& frame)
+{
+	int nodeCount = m_sceneGraph.GetNodeCount();
+
+	m_nodeLevels.resize(nodeCount, 0);
+	m_nodeItems.resize(nodeCount);
+
+	JobSystem::ForEachRange(m_pJobSystem, nodeCount, QUEUE_JOB_NODES,
+		[this, &frame](int first, int last)
+		{
+			const glm::mat4& view = frame.viewMatrix;
+			for (int node = first; node < last; node++)
+			{
+				// the baked nodes are drawn with their static batch
+				if ((m_visibleNodes[node] == 0) || (m_staticBatches.IsBaked(node) == true))
+				{
+					m_nodeItems[node].node = -1;
+					continue;
+				}
+
+				// the view space depth of the object origin is the
+				// negated z of its translation after the view transform
+				const glm::vec4& origin = m_sceneGraph.GetModelMatrix(node)[3];
+				float viewDepth = -(
+					view[0][2] * origin.x +
+					view[1][2] * origin.y +
+					view[2][2] * origin.z +
+					view[3][2]);
+
+				// textured objects are drawn with their own shader variant
+				int textureSlot = m_sceneGraph.GetTextureSlot(node);
+				m_nodeItems[node] = RenderQueue::MakeItem(
+					node,
+					(textureSlot >= 0) ? ShaderProgramCache::FEATURE_TEXTURED : 0,
+					m_sceneGraph.GetMeshID(node),
+					SelectLodLevel(node, frame),
+					textureSlot,
+					m_sceneGraph.GetMaterialID(node),
+					viewDepth,
+					m_sceneGraph.IsBlended(node));
+			}
+		});
+
+	frame.renderQueue.Clear();
+	for (int node = 0; node < nodeCount; node++)
+	{
+		if (m_nodeItems[node].node >= 0)
+		{
+			frame.renderQueue.AddItem(m_nodeItems[node]);
+		}
+	}
+	frame.renderQueue.Sort(m_pJobSystem);
+}
+
+/***********************************************************
+ *  SelectLodLevel()
+ *
+ *  This method is used for choosing the level of detail a
+ *  node is drawn with. The sphere around its world box is
+ *  projected to find its radius in pixels, and the coarsest
+ *  level whose outline stays within the allowed error of
+ *  the full detail one is used. A node moves to a finer
+ *  level as soon as it needs to, but only to a coarser one
+ *  once it is well within the error there.
+ ***********************************************************/
+int SceneManager::SelectLodLevel(int node, const PREPARED_FRAME& frame)
+{
+	const glm::mat4& view = frame.viewMatrix;
+	const glm::mat4& projection = frame.projectionMatrix;
+
+	int levelCount = m_primitiveMeshes->GetLevelCount(m_sceneGraph.GetMeshID(node));
+	if ((levelCount <= 1) || (m_lodErrorPixels <= 0.0f))
+	{
+		m_nodeLevels[node] = 0;
+		return(0);
+	}
+
+	const SceneGraph::WORLD_BOUNDS& bounds = m_sceneGraph.GetWorldBounds();
+	float radius = sqrtf(
+		bounds.extentX[node] * bounds.extentX[node] +
+		bounds.extentY[node] * bounds.extentY[node] +
+		bounds.extentZ[node] * bounds.extentZ[node]);
+	float centerDepth = -(
+		view[0][2] * bounds.centerX[node] +
+		view[1][2] * bounds.centerY[node] +
+		view[2][2] * bounds.centerZ[node] +
+		view[3][2]);
+
+	// the clip w divides the size on the screen by the depth for
+	// a perspective projection and leaves it for an orthographic one
+	bool bPerspective = (projection[2][3] != 0.0f);
+	float clipW = -projection[2][3] * centerDepth + projection[3][3];
+	if ((clipW <= 0.0f) || ((bPerspective == true) && (centerDepth <= radius)))
+	{
+		// the camera is at or inside the node
+		m_nodeLevels[node] = 0;
+		return(0);
+	}
+	float pixelRadius = radius * projection[1][1] * 0.5f * (float)frame.viewportHeight / clipW;
+
+	// the coarsest level within the allowed error
+	int fitLevel = 0;
+	while ((fitLevel + 1 < levelCount) && (pixelRadius * m_levelErrors[fitLevel + 1] <= m_lodErrorPixels))
+	{
+		fitLevel++;
+	}
+
+	int level = std::min((int)m_nodeLevels[node], levelCount - 1);
+	if (fitLevel < level)
+	{
+		level = fitLevel;
+	}
+	else
+	{
+		while ((level < fitLevel) &&
+			(pixelRadius * m_levelErrors[level + 1] <= m_lodErrorPixels * (1.0f - LOD_HYSTERESIS)))
+		{
+			level++;
+		}
+	}
+
+	m_nodeLevels[node] = (unsigned char)level;
+	return(level);
+}
+
+/***********************************************************
+ *  BeginInstanceRegion()
+ *
+ *  This method is used for taking the next region of the
+ *  instance ring for a frame that is about to be prepared,
+ *  with room for every node. It waits for the GPU when the
+ *  frame that last used the region is still being drawn.
+ ***********************************************************/
+void SceneManager::BeginInstanceRegion(PREPARED_FRAME& frame)
+{
+	size_t bytes = std::max(m_sceneGraph.GetNodeCount(), 1) * sizeof(PrimitiveMeshes::INSTANCE_DATA);
+
+	frame.instanceRegion = m_instanceRing.BeginRegion();
+	frame.pInstances = (PrimitiveMeshes::INSTANCE_DATA*)m_instanceRing.Allocate(
+		bytes, sizeof(glm::vec4), frame.instanceOffset);
+	frame.bInstancesFlushed = false;
+}
+
+/***********************************************************
+ *  FillInstances()
+ *
+ *  This method is used for writing the model matrix,
+ *  material and texture of every node into the instances
+ *  of a frame, in the order of its sorted render queue.
+ *  They are written straight into the region of the ring
+ *  buffer the frame is drawn from, each thread filling a
+ *  run of them in order, and copied rather than read from
+ *  the nodes when drawn, so the nodes can move on while
+ *  it is drawn.
+ ***********************************************************/
+void SceneManager::FillInstances(PREPARED_FRAME& frame)
+{
+	JobSystem::ForEachRange(m_pJobSystem, frame.renderQueue.GetItemCount(), INSTANCE_JOB_ITEMS,
+		[this, &frame](int first, int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				int node = frame.renderQueue.GetItem(i).node;
+				PrimitiveMeshes::INSTANCE_DATA instance;
+
+				instance.model = m_sceneGraph.GetModelMatrix(node);
+				instance.materialIndex = m_sceneGraph.GetMaterialID(node);
+				instance.textureLayer = m_sceneGraph.GetTextureSlot(node);
+				instance.padding[0] = 0;
+				instance.padding[1] = 0;
+
+				// objects without a defined material use the first one
+				if (instance.materialIndex < 0)
+				{
+					instance.materialIndex = 0;
+				}
+
+				// the instance is stored whole, since the mapped
+				// memory is slow to read back or write in pieces
+				frame.pInstances[i] = instance;
+			}
+		});
+}
+
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	CreateShaderBlocks();
+
+	if (m_scenePackage.IsOpen() == true)
+	{
+		LoadPackagedScene();
+	}
+	else
+	{
+		LoadSceneTextures();
+		DefineObjectMaterials();
+		UploadMaterialBlock();
+		SetupSceneLights();
+
+		m_primitiveMeshes->LoadMeshes();
+	}
+	for (int meshID = 0; meshID < SceneGraph::MESH_COUNT; meshID++)
+	{
+		glm::vec3 minimum;
+		glm::vec3 maximum;
+		m_primitiveMeshes->GetMeshBounds(meshID, minimum, maximum);
+		m_sceneGraph.SetMeshBounds(meshID, minimum, maximum);
+	}
+
+	// the scene objects are built once, after the textures
+	// and materials they reference have been defined
+	if (m_scenePackage.IsOpen() == true)
+	{
+		BuildPackagedScene();
+	}
+	else
+	{
+		BuildScene();
+	}
+
+	// large scenes get a bounding volume hierarchy over the
+	// world bounds of the objects, built once here
+	m_sceneBVH.Clear();
+	if (m_sceneGraph.GetNodeCount() >= BVH_MIN_NODES)
+	{
+		m_sceneGraph.UpdateTransforms(m_pJobSystem);
+		m_sceneBVH.Build(m_sceneGraph.GetWorldBounds());
+	}
+
+	// the lights are set, so the variants drawn with are known
+	PrepareShaderVariants();
+}
+
+/***********************************************************
+ *  LoadPackagedScene()
+ *
+ *  This method is used for loading the textures, materials,
+ *  lights and meshes of the scene from the mapped package.
+ *  The tables are used as they are laid out in the file,
+ *  and the texture and mesh bytes are handed on straight
+ *  from the mapping without being copied or parsed first.
+ ***********************************************************/
+void SceneManager::LoadPackagedScene()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	int textureCount = 0;
+	const PACKAGE_TEXTURE* textures = m_scenePackage.GetTextures(textureCount);
+	for (int i = 0; i < textureCount; i++)
+	{
+		const char* tag = m_scenePackage.GetString(textures[i].tagOffset);
+		const char* path = m_scenePackage.GetString(textures[i].pathOffset);
+		const unsigned char* data = m_scenePackage.GetData(textures[i].dataOffset, textures[i].dataLength);
+		if ((NULL == tag) || (NULL == path))
+		{
+			tag = "";
+			path = "";
+		}
+
+		// the texture slots follow the order of the package
+		TEXTURE_INFO textureInfo;
+		textureInfo.tag = tag;
+		textureInfo.filename = path;
+		textureInfo.data = NULL;
+		textureInfo.size = 0;
+		textureInfo.bCooked = (textures[i].kind == PACKAGE_TEXTURE_COOKED);
+		if ((textures[i].kind != PACKAGE_TEXTURE_FILE) && (NULL != data))
+		{
+			textureInfo.data = data;
+			textureInfo.size = (size_t)textures[i].dataLength;
+		}
+		m_textureIndex[tag] = (int)m_textures.size();
+		m_textures.push_back(textureInfo);
+	}
+	BindGLTextures();
+
+	int materialCount = 0;
+	const PACKAGE_MATERIAL* materials = m_scenePackage.GetMaterials(materialCount);
+	for (int i = 0; i < materialCount; i++)
+	{
+		const char* tag = m_scenePackage.GetString(materials[i].tagOffset);
+
+		OBJECT_MATERIAL material;
+		material.ambientColor = glm::make_vec3(materials[i].ambientColor);
+		material.ambientStrength = materials[i].ambientStrength;
+		material.diffuseColor = glm::make_vec3(materials[i].diffuseColor);
+		material.specularColor = glm::make_vec3(materials[i].specularColor);
+		material.shininess = materials[i].shininess;
+		material.tag = (NULL != tag) ? tag : "";
+		AddObjectMaterial(material);
+	}
+	UploadMaterialBlock();
+
+	// the light block is stored in the layout of the shader
+	m_bUseLighting = true;
+	m_lightBlock = LIGHT_BLOCK();
+	const LIGHT_BLOCK* lights = m_scenePackage.GetLights();
+	if (NULL != lights)
+	{
+		memcpy(&m_lightBlock, lights, sizeof(LIGHT_BLOCK));
+	}
+	int localLightCount = 0;
+	const LOCAL_LIGHT* localLights = m_scenePackage.GetLocalLights(localLightCount);
+	m_lightClusters.SetLights(localLights, localLightCount);
+	UploadLightBlock();
+
+	int meshCount = 0;
+	const PACKAGE_MESH* meshes = m_scenePackage.GetMeshes(meshCount);
+	for (int i = 0; i < meshCount; i++)
+	{
+		const unsigned char* vertices = m_scenePackage.GetData(
+			meshes[i].vertexOffset,
+			(uint64_t)meshes[i].vertexCount * sizeof(PrimitiveMeshes::MESH_VERTEX));
+		const unsigned char* indices = m_scenePackage.GetData(
+			meshes[i].indexOffset,
+			(uint64_t)meshes[i].indexCount * sizeof(GLuint));
+		if ((NULL == vertices) || (NULL == indices) ||
+			(meshes[i].meshID >= SceneGraph::MESH_COUNT) ||
+			(meshes[i].level >= PrimitiveMeshes::LOD_LEVEL_COUNT))
+		{
+			std::cout << "Skipping damaged packaged mesh " << i << std::endl;
+			continue;
+		}
+
+		m_primitiveMeshes->LoadMesh(
+			(int)meshes[i].meshID,
+			(int)meshes[i].level,
+			(const PrimitiveMeshes::MESH_VERTEX*)vertices,
+			(int)meshes[i].vertexCount,
+			(const GLuint*)indices,
+			(int)meshes[i].indexCount);
+	}
+
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - startTime;
+	std::cout << "INFO: Scene package loaded in " << loadTime.count() << " ms - "
+		<< textureCount << " textures, " << materialCount << " materials, "
+		<< meshCount << " meshes" << std::endl;
+}
+
+/***********************************************************
+ *  BuildPackagedScene()
+ *
+ *  This method is used for adding all of the objects of the
+ *  mapped package into the retained scene graph. Their
+ *  material and texture indices were resolved when the
+ *  package was built; a material past the end of the
+ *  material block is drawn with the first one.
+ ***********************************************************/
+void SceneManager::BuildPackagedScene()
+{
+	m_sceneGraph.Clear();
+
+	int objectCount = 0;
+	const PACKAGE_OBJECT* objects = m_scenePackage.GetObjects(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		const PACKAGE_OBJECT& object = objects[i];
+		if ((object.meshID >= SceneGraph::MESH_COUNT) ||
+			(object.materialIndex >= (int)m_objectMaterials.size()) ||
+			(object.textureIndex >= (int)m_textures.size()))
+		{
+			std::cout << "Skipping damaged packaged object " << i << std::endl;
+			continue;
+		}
+
+		int materialIndex = object.materialIndex;
+		if (materialIndex >= MAX_OBJECT_MATERIALS)
+		{
+			materialIndex = 0;
+		}
+
+		int node = m_sceneGraph.AddNode(
+			(int)object.meshID,
+			glm::make_vec3(object.scale),
+			glm::make_vec3(object.rotation),
+			glm::make_vec3(object.position),
+			materialIndex,
+			object.textureIndex);
+		m_sceneGraph.SetBlended(node, (object.flags & PACKAGE_OBJECT_BLENDED) != 0);
+		m_sceneGraph.SetDynamic(node, (object.flags & PACKAGE_OBJECT_DYNAMIC) != 0);
+	}
+}
+
+/***********************************************************
+ *  BuildScene()
+ *
+ *  This method is used for adding all of the objects in
+ *  the 3D scene into the retained scene graph
+ ***********************************************************/
+void SceneManager::BuildScene()
+{
+	m_sceneGraph.Clear();
+
+	// Ground
+	AddSceneObject(SceneGraph::MESH_PLANE, { 20.0f, 1.0f, 10.0f }, 0.0f, 0.0f, 0.0f, { 0.0f, 0.0f, 0.0f }, "cement", "plane", true);
+
+
+	// Spice rack bottom tier
+	AddSceneObject(SceneGraph::MESH_CYLINDER, { 5.0f, 2.0f, 5.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 0.0f, -3.0f }, "wood", "cylinder", true);
+	AddSceneObject(SceneGraph::MESH_CONE, { 1.0f, 4.0f, 1.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 0.0f, -3.0f }, "wood", "cone", true);
+	AddSceneObject(SceneGraph::MESH_CONE, { 1.0f, 4.0f, 1.0f }, 190.0f, 0.0f, 0.0f, { -5.0f, 5.0f, -3.0f }, "wood", "cone", true);
+	
+
+	//Spice rack middle tier
+	AddSceneObject(SceneGraph::MESH_CYLINDER, { 3.5f, 2.0f, 3.5f }, 0.0f, 0.0f, 0.0f, { -5.0f, 4.0f, -3.0f }, "wood", "cylinder", true);
+	AddSceneObject(SceneGraph::MESH_CONE, { 1.0f, 4.0f, 1.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 4.0f, -3.0f }, "wood", "cone", true);
+	AddSceneObject(SceneGraph::MESH_CONE, { 1.0f, 4.0f, 1.0f }, 190.0f, 0.0f, 0.0f, { -5.0f, 9.0f, -3.0f }, "wood", "cone", true);
+	
+
+	//Spice rack top tier
+	AddSceneObject(SceneGraph::MESH_CYLINDER, { 2.0f, 1.5f, 2.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 9.0f, -3.0f }, "wood", "cylinder", true);
+	AddSceneObject(SceneGraph::MESH_CONE, { 1.0f, 4.0f, 1.0f }, 0.0f, 0.0f, 0.0f, { -5.0f, 9.0f, -3.0f }, "wood", "cone", true);
+	AddSceneObject(SceneGraph::MESH_CYLINDER, { 0.5f, 1.5f, 0.5f }, 0.0f, 0.0f, 0.0f, { -5.0f, 12.0f, -3.0f }, "wood", "cylinder", true);
+
+
+	// Masking tape + inner liner
+	AddSceneObject(SceneGraph::MESH_CYLINDER, { 1.0f, 1.0f, 1.0f }, 0.0f, 0.0f, 0.0f, { 1.1f, 0.0f, 1.5f }, "blue_tape", "tape", true);
+	AddSceneObject(SceneGraph::MESH_CYLINDER, { 0.8f, 1.02f, 0.8f }, 0.0f, 0.0f, 0.0f, { 1.1f, 0.0f, 1.5f }, "cardboard", "cardboard", true);
+
+	// Chapstick
+	AddSceneObject(SceneGraph::MESH_CYLINDER, { 0.20f, 1.5f, 0.20f }, 90.0f, 110.0f, 0.0f, { 0.0f, 0.20f, 3.0f }, "chapstick", "chapstick", true);
+
+	// Pen body
+	AddSceneObject(SceneGraph::MESH_CYLINDER, { 0.15f, 2.5f, 0.15f }, 0.0f, 0.0f, 90.0f, { -5.0f, 0.15f, 3.0f }, "pen", "pen", true);
+
+	// Pen tip
+	AddSceneObject(SceneGraph::MESH_CONE, { 0.15f, 0.4f, 0.15f }, 0.0f, 0.0f, 270.0f, { -5.0f, 0.15f, 3.0f }, "pen", "pen", true);
+
+	// Pen clicker
+	AddSceneObject(SceneGraph::MESH_SPHERE, { 0.1f, 0.3f, 0.1f }, 0.0f, 0.0f, 90.0f, { -7.5f, 0.15f, 3.0f }, "pen", "pen", true);
+
+	// Solo cup
+	AddSceneObject(SceneGraph::MESH_TAPERED_CYLINDER, { 1.4f, 3.0f, 1.4f }, 0.0f, 0.0f, 0.0f, { 2.4f, 0.0f, -2.0f }, "solo", "solo", true);
+
+	// Book
+	AddSceneObject(SceneGraph::MESH_BOX, { 6.0f, 6.0f, 0.5f }, 0.0f, -25.0f, 0.0f, { 4.0f, 3.0f, -3.4f }, "book", "book", true);
+
+}
+
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  drawing the retained scene objects with instanced
+ *  basic 3D shapes
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	// swap in the textures that finished decoding
+	if (m_textureLoader->IsIdle() == false)
+	{
+		ScopedProfile profile(m_pProfiler, "Texture Uploads");
+		m_textureLoader->Update();
+	}
+
+	// every region of the instance ring has room for all of the
+	// nodes; making it larger drops the instances of both frames,
+	// so the drawn one is prepared again
+	if (m_instanceRing.Reserve(m_sceneGraph.GetNodeCount() * sizeof(PrimitiveMeshes::INSTANCE_DATA)) == true)
+	{
+		m_frames[0].instanceRegion = -1;
+		m_frames[1].instanceRegion = -1;
+		m_bFrameReady = false;
+		m_bQueueDirty = true;
+	}
+
+	// when pipelined, the frame drawn now was prepared while the
+	// last one was drawn, and only the first one is prepared here
+	bool bPipelined = (NULL != m_pJobSystem) && (m_bPipelined == true) && (m_bFrameReady == true);
+	if (bPipelined == false)
+	{
+		// only the nodes that changed since the last frame need
+		// their model matrices re-derived
+		{
+			ScopedProfile profile(m_pProfiler, "Update Transforms");
+			UpdateSceneTransforms();
+		}
+
+		// the queue order depends on the node positions and the
+		// camera, so it is only rebuilt when one of them changed
+		if (m_bQueueDirty == true)
+		{
+			ScopedProfile profile(m_pProfiler, "Build Render Queue");
+			// the region the other frame took is given up, so the
+			// ring never comes back around to a region in use
+			m_frames[1 - m_drawFrame].instanceRegion = -1;
+			SetFrameView(m_frames[m_drawFrame]);
+			BeginInstanceRegion(m_frames[m_drawFrame]);
+			PrepareFrame(m_frames[m_drawFrame]);
+			m_bQueueDirty = false;
+			m_bFrameReady = true;
+		}
+	}
+
+	// the nodes that moved out of the static batches are taken
+	// out of their merged meshes before the next draw
+	if (m_staticBatches.IsDirty() == true)
+	{
+		ScopedProfile profile(m_pProfiler, "Bake Static Batches");
+		m_staticBatches.Build(m_sceneGraph, *m_primitiveMeshes);
+	}
+
+	// the cached shadows are only drawn again when a light or
+	// a static object changed, and the dynamic ones when a
+	// dynamic object moved
+	RenderShadows();
+
+	// the local lights do not move, so their cluster lists
+	// only change with the camera
+	if ((m_bLightsDirty == true) && (m_lightClusters.GetLightCount() > 0))
+	{
+		ScopedProfile profile(m_pProfiler, "Assign Lights");
+		AssignLocalLights();
+		m_bLightsDirty = false;
+	}
+
+	if (bPipelined == false)
+	{
+		DrawRenderQueue();
+		return;
+	}
+
+	// the workers move the nodes on and prepare the next frame
+	// while this thread sends the draws of the current one; its
+	// region of the instance ring is kept until it is written
+	SetFrameView(m_frames[1 - m_drawFrame]);
+	if (m_frames[1 - m_drawFrame].instanceRegion < 0)
+	{
+		BeginInstanceRegion(m_frames[1 - m_drawFrame]);
+	}
+	m_bNextFrameReady = false;
+	m_pJobSystem->Dispatch(1, 1, m_prepareFunction, m_prepareGroup);
+
+	DrawRenderQueue();
+
+	{
+		ScopedProfile profile(m_pProfiler, "Wait For Next Frame");
+		m_pJobSystem->Wait(m_prepareGroup);
+	}
+	if (m_bNextFrameReady == true)
+	{
+		m_frames[m_drawFrame].instanceRegion = -1;
+		m_drawFrame = 1 - m_drawFrame;
+		m_bLightsDirty = true;
+	}
+}
+
+/***********************************************************
+ *  UpdateSceneTransforms()
+ *
+ *  This method is used for re-deriving the model matrices
+ *  of the nodes that changed, refitting the hierarchy over
+ *  them and marking the render queue, the static batches
+ *  and the shadows that depend on them as stale.
+ ***********************************************************/
+void SceneManager::UpdateSceneTransforms()
+{
+	if (m_sceneGraph.UpdateTransforms(m_pJobSystem) == 0)
+	{
+		return;
+	}
+
+	const std::vector<int>& updatedNodes = m_sceneGraph.GetUpdatedNodes();
+	m_sceneBVH.Refit(m_sceneGraph.GetWorldBounds(), updatedNodes);
+	m_staticBatches.RemoveNodes(updatedNodes);
+	m_bQueueDirty = true;
+
+	for (size_t i = 0; i < updatedNodes.size(); i++)
+	{
+		if (m_sceneGraph.IsDynamic(updatedNodes[i]) == true)
+		{
+			m_shadowAtlas.InvalidateDynamic();
+		}
+		else
+		{
+			m_shadowAtlas.InvalidateStatic();
+			break;
+		}
+	}
+}
+
+/***********************************************************
+ *  SetSceneView()
+ *
+ *  This method is used for passing in the view and
+ *  projection matrices of the current frame, which the
+ *  render queue is sorted against.
+ ***********************************************************/
+void SceneManager::SetSceneView(
+	const glm::mat4& view,
+	const glm::mat4& projection)
+{
+	if ((view != m_viewMatrix) || (projection != m_projectionMatrix))
+	{
+		m_viewMatrix = view;
+		m_projectionMatrix = projection;
+		m_bQueueDirty = true;
+		m_bLightsDirty = true;
+	}
+}
+
+/***********************************************************
+ *  PickNode()
+ *
+ *  This method is used for finding the nearest scene node
+ *  whose world box is hit by a ray. The hierarchy is used
+ *  when the scene has one, and every node is tested when
+ *  it does not. It returns -1 when nothing is hit.
+ ***********************************************************/
+int SceneManager::PickNode(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	float& hitDistance)
+{
+	// picking must see the nodes where they are drawn
+	UpdateSceneTransforms();
+
+	const SceneGraph::WORLD_BOUNDS& bounds = m_sceneGraph.GetWorldBounds();
+	if (m_sceneBVH.IsBuilt() == true)
+	{
+		return(m_sceneBVH.RayQuery(bounds, origin, direction, maxDistance, hitDistance));
+	}
+
+	glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	int hitNode = -1;
+	hitDistance = maxDistance;
+	for (int node = 0; node < m_sceneGraph.GetNodeCount(); node++)
+	{
+		glm::vec3 center(bounds.centerX[node], bounds.centerY[node], bounds.centerZ[node]);
+		glm::vec3 extents(bounds.extentX[node], bounds.extentY[node], bounds.extentZ[node]);
+		float entryDistance = 0.0f;
+
+		if ((SceneBVH::IntersectRayBox(origin, inverseDirection, center - extents, center + extents, hitDistance, entryDistance) == true) &&
+			((entryDistance < hitDistance) || (hitNode < 0)))
+		{
+			hitDistance = entryDistance;
+			hitNode = node;
+		}
+	}
+
+	return(hitNode);
+}
+
+/***********************************************************
+ *  DrawRenderQueue()
+ *
+ *  This method is used for drawing the batches of the
+ *  sorted render queue of the drawn frame, one instanced
+ *  draw call each. The blended batches come last and are
+ *  drawn without writing into the depth buffer. A frame
+ *  prepared ahead is drawn with its own view, which the
+ *  camera may have moved on from.
+ ***********************************************************/
+void SceneManager::DrawRenderQueue()
+{
+	ScopedProfile profile(m_pProfiler, "Draw Render Queue");
+	PREPARED_FRAME& frame = m_frames[m_drawFrame];
+	bool bDepthWriteOff = false;
+
+	if ((frame.viewMatrix != m_viewMatrix) || (frame.projectionMatrix != m_projectionMatrix))
+	{
+		m_pUniformCache->SetMat4(UniformCache::UNIFORM_VIEW, frame.viewMatrix);
+		m_pUniformCache->SetMat4(UniformCache::UNIFORM_PROJECTION, frame.projectionMatrix);
+		m_pUniformCache->SetVec3(UniformCache::UNIFORM_VIEW_POSITION, frame.viewPosition);
+	}
+
+	// the instances were written into the instance ring when the
+	// frame was prepared, and are only sent, once, when the ring
+	// is not mapped
+	if (frame.bInstancesFlushed == false)
+	{
+		m_instanceRing.Flush(frame.instanceOffset, frame.renderQueue.GetItemCount() * sizeof(PrimitiveMeshes::INSTANCE_DATA));
+		frame.bInstancesFlushed = true;
+	}
+	const RenderQueue& renderQueue = frame.renderQueue;
+
+	// the texture layer of every instance comes from the instance
+	// buffer, so objects without one are drawn with a plain color
+	// and no state changes between the batches besides blending
+	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+	unsigned int sceneFeatures = GetSceneFeatures();
+	m_drawCallCount = renderQueue.GetBatchCount();
+	m_triangleCount = 0;
+	m_fullDetailTriangleCount = 0;
+
+	// the static batches are opaque and sorted by variant, so
+	// they go first and switch programs once or twice
+	if (m_staticBatches.GetChunkCount() > 0)
+	{
+		ScopedProfile profile(m_pProfiler, "Draw Static Batches");
+		m_staticBatches.Cull(frame.frustum);
+		for (int i = 0; i < m_staticBatches.GetChunkCount(); i++)
+		{
+			if (m_staticBatches.IsChunkVisible(i) == false)
+			{
+				continue;
+			}
+
+			const StaticBatches::STATIC_CHUNK& chunk = m_staticBatches.GetChunk(i);
+			m_pUniformCache->UseProgram(m_pProgramCache->GetProgram(sceneFeatures | chunk.shaderVariant));
+			m_staticBatches.DrawChunk(i);
+			m_drawCallCount++;
+			m_triangleCount += chunk.triangleCount;
+			m_fullDetailTriangleCount += chunk.triangleCount;
+		}
+	}
+
+	for (int i = 0; i < renderQueue.GetBatchCount(); i++)
+	{
+		const RenderQueue::RENDER_BATCH& batch = renderQueue.GetBatch(i);
+		m_triangleCount += batch.itemCount * m_primitiveMeshes->GetTriangleCount(batch.meshID, batch.lodLevel);
+		m_fullDetailTriangleCount += batch.itemCount * m_primitiveMeshes->GetTriangleCount(batch.meshID, 0);
+
+		// the batches are sorted by variant, so this switches
+		// programs only once or twice per frame
+		m_pUniformCache->UseProgram(m_pProgramCache->GetProgram(sceneFeatures | batch.shaderVariant));
+
+		if ((batch.bBlended == true) && (bDepthWriteOff == false))
+		{
+			glDepthMask(GL_FALSE);
+			bDepthWriteOff = true;
+		}
+
+		ScopedProfile profile(m_pProfiler, g_DrawScopeNames[batch.meshID]);
+		m_primitiveMeshes->DrawInstanced(
+			batch.meshID, batch.lodLevel, batch.firstItem, batch.itemCount,
+			m_instanceRing.GetBuffer(), frame.instanceOffset);
+	}
+
+	if (bDepthWriteOff == true)
+	{
+		glDepthMask(GL_TRUE);
+	}
+
+	// the regions of the instances and light lists the draws read
+	// are not written again until the GPU is past these fences
+	m_instanceRing.FenceRegion(frame.instanceRegion);
+	m_lightClusters.FenceLists();
+}
@@ -1,156 +1,364 @@
-///////////////////////////////////////////////////////////////////////////////
-// scenemanager.h
-// ============
-// manage the preparing and rendering of 3D scenes - textures, materials, lighting
-//
-//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
-//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
-///////////////////////////////////////////////////////////////////////////////
-
-#pragma once
-
-#include "ShaderManager.h"
-#include "ShapeMeshes.h"
-
-#include <string>
-#include <vector>
-
-/***********************************************************
- *  SceneManager
- *
- *  This class contains the code for preparing and rendering
- *  3D scenes, including the shader settings.
- ***********************************************************/
-class SceneManager
-{
-public:
-	// constructor
-	SceneManager(ShaderManager *pShaderManager);
-	// destructor
-	~SceneManager();
-
-	struct TEXTURE_INFO
-	{
-		std::string tag;
-		uint32_t ID;
-	};
-
-	struct OBJECT_MATERIAL
-	{
-		glm::vec3 ambientColor;
-		float ambientStrength;
-		glm::vec3 diffuseColor;
-		glm::vec3 specularColor;
-		float shininess;
-		std::string tag;
-	};
-
-private:
-	// pointer to shader manager object
-	ShaderManager* m_pShaderManager;
-	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
-	// defined object materials
-	std::vector<OBJECT_MATERIAL> m_objectMaterials;
-
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
-	// bind loaded OpenGL textures to slots in memory
-	void BindGLTextures();
-	// free the loaded OpenGL textures
-	void DestroyGLTextures();
-	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
-	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
-
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
-		glm::vec3 scaleXYZ,
-		float XrotationDegrees,
-		float YrotationDegrees,
-		float ZrotationDegrees,
-		glm::vec3 positionXYZ);
-
-	// set the color values into the shader
-	void SetShaderColor(
-		float redColorValue,
-		float greenColorValue,
-		float blueColorValue,
-		float alphaValue);
-
-	// set the texture data into the shader
-	void SetShaderTexture(
-		std::string textureTag);
-
-	// set the UV scale for the texture mapping
-	void SetTextureUVScale(
-		float u, float v);
-
-	// set the object material into the shader
-	void SetShaderMaterial(
-		std::string materialTag);
-
-public:
-
-	// The following methods are for the students to 
-	// customize for their own 3D scene
-	void PrepareScene();
-	void RenderScene();
-
-	// loads textures from image files
-	void LoadSceneTextures();
-
-	// pre-set light sources for 3D scene
-	void SetupSceneLights();
-	// pre-define the object materials for lighting
-	void DefineObjectMaterials();
-	void RenderCylinder(
-		const glm::vec3& scale,
-		float rotX, float rotY, float rotZ,
-		const glm::vec3& position,
-		const std::string& materialTag,
-		const std::string& textureTag = "",
-		bool useTexture = false);
-	void RenderCone(
-		const glm::vec3& scale,
-		float rotX, float rotY, float rotZ,
-		const glm::vec3& position,
-		const std::string& materialTag,
-		const std::string& textureTag = "",
-		bool useTexture = false);
-	void RenderBox(
-		const glm::vec3& scale,
-		float rotX, float rotY, float rotZ,
-		const glm::vec3& position,
-		const std::string& materialTag,
-		const std::string& textureTag = "",
-		bool useTexture = false);
-	void RenderPlane(
-		const glm::vec3& scale,
-		float rotX, float rotY, float rotZ,
-		const glm::vec3& position,
-		const std::string& materialTag,
-		const std::string& textureTag = "",
-		bool useTexture = false);
-	void RenderTaperedCylinder(
-		const glm::vec3& scale,
-		float rotX, float rotY, float rotZ,
-		const glm::vec3& position,
-		const std::string& materialTag,
-		const std::string& textureTag = "",
-		bool useTexture = false);
-	void RenderSphere(
-		const glm::vec3& scale,
-		float rotX, float rotY, float rotZ,
-		const glm::vec3& position,
-		const std::string& materialTag,
-		const std::string& textureTag = "",
-		bool useTexture = false);
+///////////////////////////////////////////////////////////////////////////////
+// scenemanager.h
+// ============
+// manage the preparing and rendering of 3D scenes - textures, materials, lighting
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "PrimitiveMeshes.h"
+#include "SceneGraph.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+#include "SceneBVH.h"
+#include "UniformCache.h"
+#include "ShaderProgramCache.h"
+#include "FrameProfiler.h"
+#include "TextureLoader.h"
+#include "ScenePackage.h"
+#include "ShaderBlocks.h"
+#include "LightClusters.h"
+#include "ShadowAtlas.h"
+#include "StaticBatches.h"
+#include "JobSystem.h"
+#include "RingBuffer.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  SceneManager
+ *
+ *  This class contains the code for preparing and rendering
+ *  3D scenes, including the shader settings.
+ ***********************************************************/
+class SceneManager
+{
+public:
+	// constructor
+	SceneManager(
+		ShaderManager *pShaderManager,
+		UniformCache* pUniformCache,
+		ShaderProgramCache* pProgramCache);
+	// destructor
+	~SceneManager();
+
+	struct TEXTURE_INFO
+	{
+		std::string tag;
+		std::string filename;
+		// the file contents when they are in a mapped scene package
+		const unsigned char* data;
+		size_t size;
+		bool bCooked;
+	};
+
+	struct OBJECT_MATERIAL
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+		std::string tag;
+	};
+
+private:
+	// the draws of one frame, prepared from the view of that
+	// frame; two are kept so the next one can be prepared on
+	// other threads while this one is drawn
+	struct PREPARED_FRAME
+	{
+		glm::mat4 viewMatrix;
+		glm::mat4 projectionMatrix;
+		glm::vec3 viewPosition;
+		int viewportHeight;
+		Frustum frustum;
+		// sorted and batched draws of the visible scene nodes
+		RenderQueue renderQueue;
+		// region of the instance ring the per-instance values of
+		// the nodes are written into in queue order, or -1 before
+		// one is taken, where they start in the ring, and whether
+		// they were sent when the ring is not mapped
+		int instanceRegion;
+		GLintptr instanceOffset;
+		PrimitiveMeshes::INSTANCE_DATA* pInstances;
+		bool bInstancesFlushed;
+		// nodes drawn and culled by the frustum test
+		int drawnCount;
+		int culledCount;
+	};
+
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the cached per-draw shader uniforms
+	UniformCache* m_pUniformCache;
+	// pointer to the variants of the scene shader program
+	ShaderProgramCache* m_pProgramCache;
+	// pointer to instanced basic shapes object
+	PrimitiveMeshes* m_primitiveMeshes;
+	// loaded textures info, indexed by texture slot, which is
+	// also the layer of the texture array holding the texture
+	std::vector<TEXTURE_INFO> m_textures;
+	// decodes the texture files in the background
+	TextureLoader* m_textureLoader;
+	// texture array holding every loaded texture as a layer
+	GLuint m_textureArray;
+	// texture slots indexed by tag
+	std::unordered_map<std::string, int> m_textureIndex;
+	// defined object materials
+	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// material indices indexed by tag
+	std::unordered_map<std::string, int> m_materialIndex;
+	// uniform buffers holding the material and light blocks
+	GLuint m_materialBuffer;
+	GLuint m_lightBuffer;
+	// current values of all the light sources
+	LIGHT_BLOCK m_lightBlock;
+	// whether the scene is drawn with lighting
+	bool m_bUseLighting;
+	// shader features of the active lights, as uploaded
+	unsigned int m_lightFeatures;
+	// local lights and their lists for the clusters of the view
+	LightClusters m_lightClusters;
+	// set when the light lists need to be made again
+	bool m_bLightsDirty;
+	// shadow maps of the lights, cached for the static objects
+	ShadowAtlas m_shadowAtlas;
+	// whether the lights cast shadows
+	bool m_bUseShadows;
+	// the frame being drawn and the one prepared next to it
+	PREPARED_FRAME m_frames[2];
+	int m_drawFrame;
+	// whether the drawn frame has been prepared yet
+	bool m_bFrameReady;
+	// threads the frame preparation is spread over, if any
+	JobSystem* m_pJobSystem;
+	// whether the next frame is prepared while one is drawn
+	bool m_bPipelined;
+	// the preparation of the next frame, run as a job, and
+	// whether it prepared one
+	JobSystem::JOB_GROUP m_prepareGroup;
+	JobSystem::RANGE_FUNCTION m_prepareFunction;
+	bool m_bNextFrameReady;
+	// queue item of every scene node, made on the threads in
+	// node order and gathered into the queue, with -1 for the
+	// node of an item that is not drawn
+	std::vector<RenderQueue::RENDER_ITEM> m_nodeItems;
+	// subtrees of the hierarchy the frustum query is split into
+	std::vector<int> m_querySubtrees;
+	// ring buffer the instances of the prepared frames are written
+	// into, and whether it and the light ring may be mapped for good
+	RingBuffer m_instanceRing;
+	bool m_bPersistentBuffers;
+	// the static nodes merged into world space chunks
+	StaticBatches m_staticBatches;
+	// whether the static nodes are drawn from the chunks
+	bool m_bUseStaticBatches;
+	// view and projection matrices last passed in
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// set when the queue needs to be sorted again
+	bool m_bQueueDirty;
+	// hierarchy over the node bounds for large scenes
+	SceneBVH m_sceneBVH;
+	// per-node result of the last frustum test
+	std::vector<unsigned char> m_visibleNodes;
+	// per-node level of detail chosen for the last queue
+	std::vector<unsigned char> m_nodeLevels;
+	// silhouette error allowed on the screen, in pixels, and the
+	// error of each level for a shape one pixel in radius
+	float m_lodErrorPixels;
+	float m_levelErrors[PrimitiveMeshes::LOD_LEVEL_COUNT];
+	// draw calls issued for the last frame
+	int m_drawCallCount;
+	// triangles drawn in the last frame, and how many the same
+	// objects would have cost at full detail
+	int m_triangleCount;
+	int m_fullDetailTriangleCount;
+	// profiler the scene phases and draws are timed with, if any
+	FrameProfiler* m_pProfiler;
+	// retained scene objects
+	SceneGraph m_sceneGraph;
+	// mapped scene package the scene is loaded from, if open
+	ScenePackage m_scenePackage;
+
+	// load texture images and convert to OpenGL texture data
+	bool CreateGLTexture(const char* filename, const std::string& tag);
+	// create the texture array of the loaded textures and bind it
+	void BindGLTextures();
+	// free the loaded OpenGL textures
+	void DestroyGLTextures();
+	// find a loaded texture by tag
+	int FindTextureSlot(const std::string& tag);
+	// find a defined material by tag
+	bool FindMaterial(const std::string& tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const std::string& tag);
+	// add a material into the defined materials
+	int AddObjectMaterial(const OBJECT_MATERIAL& material);
+
+	// set the color values into the shader
+	void SetShaderColor(
+		float redColorValue,
+		float greenColorValue,
+		float blueColorValue,
+		float alphaValue);
+
+	// set the UV scale for the texture mapping
+	void SetTextureUVScale(
+		float u, float v);
+
+	// create and free the material and light uniform buffers
+	void CreateShaderBlocks();
+	void DestroyShaderBlocks();
+	// send the materials and lights into their uniform buffers
+	void UploadMaterialBlock();
+	void UploadLightBlock();
+	// list the local lights of every cluster of the current view
+	void AssignLocalLights();
+	// bring the shadow maps of the changed lights and objects up to date
+	void RenderShadows();
+
+	// re-derive the transforms of the changed nodes and mark what
+	// depends on them as stale
+	void UpdateSceneTransforms();
+
+	// take the view passed in for the frame to be prepared
+	void SetFrameView(PREPARED_FRAME& frame);
+	// cull the nodes and build the queue and instances of a frame
+	void PrepareFrame(PREPARED_FRAME& frame);
+	// bring the transforms up to date and prepare the next frame
+	// when anything changed; run as a job while a frame is drawn
+	void PrepareNextFrame();
+	// test the scene nodes against the view frustum of a frame
+	void CullSceneNodes(PREPARED_FRAME& frame);
+	// sort the visible scene nodes into the render queue
+	void BuildRenderQueue(PREPARED_FRAME& frame);
+	// choose the level of detail of a node from its size on the screen
+	int SelectLodLevel(int node, const PREPARED_FRAME& frame);
+	// take a region of the instance ring for a frame to be prepared
+	void BeginInstanceRegion(PREPARED_FRAME& frame);
+	// copy the node values into the instances, in queue order
+	void FillInstances(PREPARED_FRAME& frame);
+	// draw the batches of the render queue of the drawn frame
+	void DrawRenderQueue();
+	// shader features shared by every draw of the scene
+	unsigned int GetSceneFeatures() const;
+
+	// load the textures, materials, lights and meshes of the package
+	void LoadPackagedScene();
+	// build the retained scene objects of the package
+	void BuildPackagedScene();
+
+public:
+
+	// The following methods are for the students to 
+	// customize for their own 3D scene
+	void PrepareScene();
+	void RenderScene();
+
+	// set the view used for sorting the scene this frame
+	void SetSceneView(
+		const glm::mat4& view,
+		const glm::mat4& projection);
+
+	// number of scene nodes drawn and culled in the last frame
+	int GetDrawnCount() const { return(m_frames[m_drawFrame].drawnCount); }
+	int GetCulledCount() const { return(m_frames[m_drawFrame].culledCount); }
+	// number of draw calls issued in the last frame
+	int GetDrawCallCount() const { return(m_drawCallCount); }
+	// number of triangles drawn in the last frame, and at full detail
+	int GetTriangleCount() const { return(m_triangleCount); }
+	int GetFullDetailTriangleCount() const { return(m_fullDetailTriangleCount); }
+
+	// set the silhouette error in pixels the round shapes may be
+	// drawn with, where zero draws everything at full detail
+	void SetLodError(float pixels);
+
+	// merge the static nodes into chunks, or go back to drawing
+	// every node through the render queue, after PrepareScene()
+	void SetStaticBatching(bool bUseStaticBatches);
+
+	// time the scene phases and draw calls with a profiler
+	void SetProfiler(FrameProfiler* pProfiler) { m_pProfiler = pProfiler; }
+
+	// spread the preparation of every frame over the threads of a
+	// job system, and prepare the next frame while one is drawn
+	// when pipelined, which shows every frame one frame later
+	void SetJobSystem(JobSystem* pJobSystem, bool bPipelined);
+
+	// write the per-frame instances and light lists into buffers
+	// mapped for good, or through uploads when not persistent;
+	// must be called before PrepareScene()
+	void SetPersistentBuffers(bool bPersistent) { m_bPersistentBuffers = bPersistent; }
+	// whether the instance ring is mapped for good, the regions of
+	// the per-frame rings moved on to, the number the CPU waited
+	// for the GPU at, and the time spent waiting on their fences
+	bool IsInstanceRingPersistent() const { return(m_instanceRing.IsPersistent()); }
+	long long GetRingRegionCount() const;
+	long long GetRingStallCount() const;
+	double GetRingWaitSeconds() const;
+	void ResetRingStats();
+
+	// load the scene from a package instead of the built-in scene;
+	// must be called before PrepareScene()
+	bool OpenScenePackage(const std::string& filename) { return(m_scenePackage.Open(filename)); }
+
+	// wait until every scene texture has replaced its placeholder
+	void FinishTextureLoading() { m_textureLoader->Finish(); }
+	// build the shader variants the scene draws with, again after
+	// the program cache was cleared
+	void PrepareShaderVariants();
+
+	// scatter local lights over the scene, after PrepareScene()
+	void ScatterLocalLights(int count);
+	// number of local lights, and the light list entries of the
+	// last view over all the clusters and in the fullest one
+	int GetLocalLightCount() const { return(m_lightClusters.GetLightCount()); }
+	int GetLightListEntryCount() const { return(m_lightClusters.GetListEntryCount()); }
+	int GetMaxClusterLights() const { return(m_lightClusters.GetMaxClusterLights()); }
+
+	// turn the shadows of the lights on or off
+	void SetShadows(bool bUseShadows);
+	// shadow tiles drawn in the last frame, into the cache and
+	// over it with the dynamic objects
+	int GetStaticShadowTileCount() const { return(m_shadowAtlas.GetStaticTileCount()); }
+	int GetDynamicShadowTileCount() const { return(m_shadowAtlas.GetDynamicTileCount()); }
+
+	// file names of the scene textures, for watching them
+	void GetTextureFiles(std::vector<std::string>& filenames) const;
+	// load a changed texture file again into the layers using it
+	bool ReloadTexture(const std::string& filename);
+
+	// find the nearest scene node hit by a ray, such as one from
+	// the camera position along its front vector
+	int PickNode(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		float& hitDistance);
+
+	// loads textures from image files
+	void LoadSceneTextures();
+
+	// pre-set light sources for 3D scene
+	void SetupSceneLights();
+	// pre-define the object materials for lighting
+	void DefineObjectMaterials();
+	// add an object into the retained scene
+	void AddSceneObject(
+		SceneGraph::MESH_TYPE meshType,
+		const glm::vec3& scale,
+		float rotX, float rotY, float rotZ,
+		const glm::vec3& position,
+		const std::string& materialTag,
+		const std::string& textureTag = "",
+		bool useTexture = false);
+	// build the retained scene objects
+	void BuildScene();
 };
\ No newline at end of file
@@ -0,0 +1,714 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenepackage.cpp
+// ============
+// a single versioned binary file holding everything a scene needs, built
+// offline from a scene description and memory-mapped at startup
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ScenePackage.h"
+#include "PrimitiveMeshes.h"
+#include "SceneGraph.h"
+#include "TextureCooker.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	// names of the meshes in scene files, in MESH_TYPE order
+	const char* g_MeshNames[SceneGraph::MESH_COUNT] =
+	{
+		"plane",
+		"box",
+		"cylinder",
+		"tapered_cylinder",
+		"cone",
+		"sphere"
+	};
+
+	// the values read from a scene description file
+	struct SCENE_DESCRIPTION
+	{
+		std::vector<std::string> textureTags;
+		std::vector<std::string> texturePaths;
+		std::vector<std::string> materialTags;
+		std::vector<PACKAGE_MATERIAL> materials;
+		LIGHT_BLOCK lights;
+		std::vector<LOCAL_LIGHT> localLights;
+		std::vector<PACKAGE_OBJECT> objects;
+	};
+
+	/***********************************************************
+	 *  FindName()
+	 *
+	 *  Returns the index of a name in a list, or -1.
+	 ***********************************************************/
+	int FindName(const std::vector<std::string>& names, const std::string& name)
+	{
+		for (int i = 0; i < (int)names.size(); i++)
+		{
+			if (names[i] == name)
+			{
+				return(i);
+			}
+		}
+		return(-1);
+	}
+
+	/***********************************************************
+	 *  ReadVec3()
+	 *
+	 *  Reads three floats from a line of a scene file.
+	 ***********************************************************/
+	bool ReadVec3(std::istringstream& values, float* vector)
+	{
+		return((bool)(values >> vector[0] >> vector[1] >> vector[2]));
+	}
+
+	/***********************************************************
+	 *  ReadVec3()
+	 *
+	 *  Reads three floats from a line of a scene file into a
+	 *  glm vector.
+	 ***********************************************************/
+	bool ReadVec3(std::istringstream& values, glm::vec3& vector)
+	{
+		return((bool)(values >> vector.x >> vector.y >> vector.z));
+	}
+
+	/***********************************************************
+	 *  ReadSceneFile()
+	 *
+	 *  Reads the textures, materials, lights and objects of
+	 *  a scene description, reporting every line it cannot
+	 *  read with its line number.
+	 ***********************************************************/
+	bool ReadSceneFile(const std::string& filename, SCENE_DESCRIPTION& scene)
+	{
+		std::ifstream file(filename.c_str());
+		if (!file)
+		{
+			std::cout << "Could not open scene file " << filename << std::endl;
+			return(false);
+		}
+
+		scene.lights = LIGHT_BLOCK();
+		int pointLightCount = 0;
+		bool bSuccess = true;
+
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(file, line))
+		{
+			lineNumber++;
+			std::istringstream values(line);
+			std::string keyword;
+			if (!(values >> keyword) || (keyword[0] == '#'))
+			{
+				continue;
+			}
+
+			bool bValid = false;
+			if (keyword == "texture")
+			{
+				std::string tag;
+				std::string path;
+				bValid = (bool)(values >> tag >> path);
+				if (bValid == true)
+				{
+					scene.textureTags.push_back(tag);
+					scene.texturePaths.push_back(path);
+				}
+			}
+			else if (keyword == "material")
+			{
+				std::string tag;
+				PACKAGE_MATERIAL material;
+				memset(&material, 0, sizeof(material));
+				bValid = (values >> tag) &&
+					ReadVec3(values, material.ambientColor) &&
+					(values >> material.ambientStrength) &&
+					ReadVec3(values, material.diffuseColor) &&
+					ReadVec3(values, material.specularColor) &&
+					(values >> material.shininess);
+				if (bValid == true)
+				{
+					scene.materialTags.push_back(tag);
+					scene.materials.push_back(material);
+				}
+			}
+			else if (keyword == "directional")
+			{
+				DIRECTIONAL_LIGHT_BLOCK& light = scene.lights.directionalLight;
+				bValid = ReadVec3(values, light.direction) &&
+					ReadVec3(values, light.ambient) &&
+					ReadVec3(values, light.diffuse) &&
+					ReadVec3(values, light.specular);
+				light.bActive = bValid;
+			}
+			else if ((keyword == "point") && (pointLightCount < TOTAL_POINT_LIGHTS))
+			{
+				POINT_LIGHT_BLOCK& light = scene.lights.pointLights[pointLightCount];
+				bValid = ReadVec3(values, light.position) &&
+					ReadVec3(values, light.ambient) &&
+					ReadVec3(values, light.diffuse) &&
+					ReadVec3(values, light.specular);
+				light.bActive = bValid;
+				if (bValid == true)
+				{
+					pointLightCount++;
+				}
+			}
+			else if (keyword == "local")
+			{
+				LOCAL_LIGHT light = LOCAL_LIGHT();
+				bValid = ReadVec3(values, light.position) &&
+					(values >> light.radius) &&
+					ReadVec3(values, light.diffuse) &&
+					ReadVec3(values, light.specular) &&
+					(light.radius > 0.0f);
+				if (bValid == true)
+				{
+					scene.localLights.push_back(light);
+				}
+			}
+			else if (keyword == "object")
+			{
+				std::string meshName;
+				std::string materialTag;
+				std::string textureTag;
+				std::string flag;
+				PACKAGE_OBJECT object;
+				memset(&object, 0, sizeof(object));
+				bValid = (values >> meshName) &&
+					ReadVec3(values, object.scale) &&
+					ReadVec3(values, object.rotation) &&
+					ReadVec3(values, object.position) &&
+					(values >> materialTag >> textureTag);
+				while (values >> flag)
+				{
+					if (flag == "blended")
+					{
+						object.flags |= PACKAGE_OBJECT_BLENDED;
+					}
+					else if (flag == "dynamic")
+					{
+						object.flags |= PACKAGE_OBJECT_DYNAMIC;
+					}
+				}
+
+				int meshID = -1;
+				for (int i = 0; i < SceneGraph::MESH_COUNT; i++)
+				{
+					if (meshName == g_MeshNames[i])
+					{
+						meshID = i;
+					}
+				}
+				object.meshID = (uint32_t)meshID;
+				object.materialIndex = FindName(scene.materialTags, materialTag);
+				object.textureIndex = (textureTag == "-") ? -1 : FindName(scene.textureTags, textureTag);
+
+				if ((bValid == true) &&
+					((meshID < 0) || (object.materialIndex < 0) ||
+					((textureTag != "-") && (object.textureIndex < 0))))
+				{
+					std::cout << filename << "(" << lineNumber << "): unknown mesh, material or texture" << std::endl;
+					bSuccess = false;
+					continue;
+				}
+				if (bValid == true)
+				{
+					scene.objects.push_back(object);
+				}
+			}
+
+			if (bValid == false)
+			{
+				std::cout << filename << "(" << lineNumber << "): could not read the " << keyword << " line" << std::endl;
+				bSuccess = false;
+			}
+		}
+
+		return(bSuccess);
+	}
+
+	/***********************************************************
+	 *  ReadWholeFile()
+	 *
+	 *  Reads the bytes of a file, returning false when it
+	 *  cannot be opened.
+	 ***********************************************************/
+	bool ReadWholeFile(const std::string& filename, std::vector<unsigned char>& bytes)
+	{
+		std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			return(false);
+		}
+		bytes.resize((size_t)file.tellg());
+		file.seekg(0);
+		return((bool)file.read((char*)bytes.data(), bytes.size()));
+	}
+
+	/***********************************************************
+	 *  AlignSize()
+	 *
+	 *  Rounds a size up to the package alignment.
+	 ***********************************************************/
+	uint64_t AlignSize(uint64_t size)
+	{
+		return((size + SCENE_PACKAGE_ALIGNMENT - 1) / SCENE_PACKAGE_ALIGNMENT * SCENE_PACKAGE_ALIGNMENT);
+	}
+
+	/***********************************************************
+	 *  AddString()
+	 *
+	 *  Appends a string to the strings section and returns
+	 *  its offset.
+	 ***********************************************************/
+	uint32_t AddString(std::vector<unsigned char>& strings, const std::string& text)
+	{
+		uint32_t offset = (uint32_t)strings.size();
+		strings.insert(strings.end(), text.begin(), text.end());
+		strings.push_back(0);
+		return(offset);
+	}
+
+	/***********************************************************
+	 *  AddData()
+	 *
+	 *  Appends bytes to the data section on the package
+	 *  alignment and returns their offset.
+	 ***********************************************************/
+	uint64_t AddData(std::vector<unsigned char>& data, const void* bytes, size_t length)
+	{
+		uint64_t offset = AlignSize(data.size());
+		data.resize((size_t)offset);
+		data.insert(data.end(), (const unsigned char*)bytes, (const unsigned char*)bytes + length);
+		return(offset);
+	}
+}
+
+/***********************************************************
+ *  ScenePackage()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ScenePackage::ScenePackage()
+{
+	m_data = NULL;
+	m_size = 0;
+#ifdef _WIN32
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = NULL;
+#else
+	m_fileDescriptor = -1;
+#endif
+	for (int i = 0; i <= PACKAGE_SECTION_LAST; i++)
+	{
+		m_sections[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~ScenePackage()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ScenePackage::~ScenePackage()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a package read-only into
+ *  memory and checking its header and that every section
+ *  lies inside the file with the size its entries need.
+ *  Nothing is copied or parsed; the pages are read in by
+ *  the system as they are first touched.
+ ***********************************************************/
+bool ScenePackage::Open(const std::string& filename)
+{
+	Close();
+
+#ifdef _WIN32
+	m_fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	LARGE_INTEGER fileSize;
+	if ((m_fileHandle == INVALID_HANDLE_VALUE) || (GetFileSizeEx(m_fileHandle, &fileSize) == FALSE))
+	{
+		std::cout << "Could not open scene package " << filename << std::endl;
+		Close();
+		return(false);
+	}
+	m_size = (size_t)fileSize.QuadPart;
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (NULL != m_mappingHandle)
+	{
+		m_data = (const unsigned char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	m_fileDescriptor = open(filename.c_str(), O_RDONLY);
+	struct stat fileStatus;
+	if ((m_fileDescriptor < 0) || (fstat(m_fileDescriptor, &fileStatus) != 0))
+	{
+		std::cout << "Could not open scene package " << filename << std::endl;
+		Close();
+		return(false);
+	}
+	m_size = (size_t)fileStatus.st_size;
+	if (m_size > 0)
+	{
+		void* mapped = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+		if (mapped != MAP_FAILED)
+		{
+			// the whole package is read during startup
+			madvise(mapped, m_size, MADV_WILLNEED);
+			m_data = (const unsigned char*)mapped;
+		}
+	}
+#endif
+	if (NULL == m_data)
+	{
+		std::cout << "Could not map scene package " << filename << std::endl;
+		Close();
+		return(false);
+	}
+
+	const PACKAGE_HEADER* header = (const PACKAGE_HEADER*)m_data;
+	if ((m_size < sizeof(PACKAGE_HEADER)) ||
+		(memcmp(header->identifier, SCENE_PACKAGE_IDENTIFIER, sizeof(header->identifier)) != 0) ||
+		(header->version != SCENE_PACKAGE_VERSION) ||
+		(header->fileSize != m_size) ||
+		(header->sectionCount > (m_size - sizeof(PACKAGE_HEADER)) / sizeof(PACKAGE_SECTION)))
+	{
+		std::cout << "Scene package " << filename << " is damaged or from another version" << std::endl;
+		Close();
+		return(false);
+	}
+
+	const PACKAGE_SECTION* sections = (const PACKAGE_SECTION*)(header + 1);
+	for (uint32_t i = 0; i < header->sectionCount; i++)
+	{
+		const PACKAGE_SECTION& section = sections[i];
+		size_t entrySize = 0;
+		switch (section.type)
+		{
+		case PACKAGE_SECTION_TEXTURES: entrySize = sizeof(PACKAGE_TEXTURE); break;
+		case PACKAGE_SECTION_MATERIALS: entrySize = sizeof(PACKAGE_MATERIAL); break;
+		case PACKAGE_SECTION_LIGHTS: entrySize = sizeof(LIGHT_BLOCK); break;
+		case PACKAGE_SECTION_MESHES: entrySize = sizeof(PACKAGE_MESH); break;
+		case PACKAGE_SECTION_OBJECTS: entrySize = sizeof(PACKAGE_OBJECT); break;
+		case PACKAGE_SECTION_LOCAL_LIGHTS: entrySize = sizeof(LOCAL_LIGHT); break;
+		default: break;
+		}
+
+		bool bValid =
+			(section.type >= PACKAGE_SECTION_STRINGS) && (section.type <= PACKAGE_SECTION_LAST) &&
+			(section.byteOffset % SCENE_PACKAGE_ALIGNMENT == 0) &&
+			(section.byteOffset <= m_size) && (section.byteLength <= m_size - section.byteOffset) &&
+			((entrySize == 0) || (section.byteLength == (uint64_t)section.count * entrySize));
+		// every string must end inside the strings section
+		if ((bValid == true) && (section.type == PACKAGE_SECTION_STRINGS))
+		{
+			bValid = (section.byteLength > 0) && (m_data[section.byteOffset + section.byteLength - 1] == 0);
+		}
+		if (bValid == false)
+		{
+			std::cout << "Scene package " << filename << " has a damaged section " << section.type << std::endl;
+			Close();
+			return(false);
+		}
+		m_sections[section.type] = &section;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the package.
+ ***********************************************************/
+void ScenePackage::Close()
+{
+#ifdef _WIN32
+	if (NULL != m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (NULL != m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = NULL;
+	}
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (NULL != m_data)
+	{
+		munmap((void*)m_data, m_size);
+	}
+	if (m_fileDescriptor >= 0)
+	{
+		close(m_fileDescriptor);
+		m_fileDescriptor = -1;
+	}
+#endif
+	m_data = NULL;
+	m_size = 0;
+	for (int i = 0; i <= PACKAGE_SECTION_LAST; i++)
+	{
+		m_sections[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  GetTable()
+ *
+ *  This method is used for getting the entries of a table
+ *  section, whose size was checked when the package was
+ *  opened.
+ ***********************************************************/
+const void* ScenePackage::GetTable(PACKAGE_SECTION_TYPE type, int& count) const
+{
+	const PACKAGE_SECTION* section = m_sections[type];
+	if ((NULL == section) || (section->count == 0))
+	{
+		count = 0;
+		return(NULL);
+	}
+
+	count = (int)section->count;
+	return(m_data + section->byteOffset);
+}
+
+const PACKAGE_TEXTURE* ScenePackage::GetTextures(int& count) const
+{
+	return((const PACKAGE_TEXTURE*)GetTable(PACKAGE_SECTION_TEXTURES, count));
+}
+
+const PACKAGE_MATERIAL* ScenePackage::GetMaterials(int& count) const
+{
+	return((const PACKAGE_MATERIAL*)GetTable(PACKAGE_SECTION_MATERIALS, count));
+}
+
+const PACKAGE_MESH* ScenePackage::GetMeshes(int& count) const
+{
+	return((const PACKAGE_MESH*)GetTable(PACKAGE_SECTION_MESHES, count));
+}
+
+const PACKAGE_OBJECT* ScenePackage::GetObjects(int& count) const
+{
+	return((const PACKAGE_OBJECT*)GetTable(PACKAGE_SECTION_OBJECTS, count));
+}
+
+const LIGHT_BLOCK* ScenePackage::GetLights() const
+{
+	int count = 0;
+	return((const LIGHT_BLOCK*)GetTable(PACKAGE_SECTION_LIGHTS, count));
+}
+
+const LOCAL_LIGHT* ScenePackage::GetLocalLights(int& count) const
+{
+	return((const LOCAL_LIGHT*)GetTable(PACKAGE_SECTION_LOCAL_LIGHTS, count));
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used for getting a string by its offset
+ *  in the strings section.
+ ***********************************************************/
+const char* ScenePackage::GetString(uint32_t offset) const
+{
+	const PACKAGE_SECTION* section = m_sections[PACKAGE_SECTION_STRINGS];
+	if ((NULL == section) || (offset >= section->byteLength))
+	{
+		return(NULL);
+	}
+
+	return((const char*)(m_data + section->byteOffset + offset));
+}
+
+/***********************************************************
+ *  GetData()
+ *
+ *  This method is used for getting a range of the data
+ *  section, checking that it lies inside the section.
+ ***********************************************************/
+const unsigned char* ScenePackage::GetData(uint64_t offset, uint64_t length) const
+{
+	const PACKAGE_SECTION* section = m_sections[PACKAGE_SECTION_DATA];
+	if ((NULL == section) || (offset > section->byteLength) || (length > section->byteLength - offset))
+	{
+		return(NULL);
+	}
+
+	return(m_data + section->byteOffset + offset);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building a package from a scene
+ *  description. The textures are copied in, the cooked
+ *  version when one is next to the image, the basic shape
+ *  meshes are generated into it, and every table is laid
+ *  out the way it is used, so loading it needs no parsing.
+ ***********************************************************/
+bool ScenePackage::Build(const std::string& sceneFilename, const std::string& packageFilename)
+{
+	SCENE_DESCRIPTION scene;
+	if (ReadSceneFile(sceneFilename, scene) == false)
+	{
+		return(false);
+	}
+
+	std::vector<unsigned char> strings;
+	std::vector<unsigned char> data;
+	std::vector<unsigned char> fileBytes;
+
+	std::vector<PACKAGE_TEXTURE> textures(scene.textureTags.size());
+	for (int i = 0; i < (int)textures.size(); i++)
+	{
+		PACKAGE_TEXTURE& texture = textures[i];
+		memset(&texture, 0, sizeof(texture));
+		texture.tagOffset = AddString(strings, scene.textureTags[i]);
+		texture.pathOffset = AddString(strings, scene.texturePaths[i]);
+		texture.kind = PACKAGE_TEXTURE_FILE;
+
+		if (ReadWholeFile(GetCookedTexturePath(scene.texturePaths[i]), fileBytes) == true)
+		{
+			texture.kind = PACKAGE_TEXTURE_COOKED;
+		}
+		else if (ReadWholeFile(scene.texturePaths[i], fileBytes) == true)
+		{
+			texture.kind = PACKAGE_TEXTURE_IMAGE;
+		}
+		else
+		{
+			std::cout << "Could not read " << scene.texturePaths[i] << ", only its path is packaged" << std::endl;
+		}
+
+		if (texture.kind != PACKAGE_TEXTURE_FILE)
+		{
+			texture.dataOffset = AddData(data, fileBytes.data(), fileBytes.size());
+			texture.dataLength = fileBytes.size();
+		}
+	}
+
+	for (int i = 0; i < (int)scene.materials.size(); i++)
+	{
+		scene.materials[i].tagOffset = AddString(strings, scene.materialTags[i]);
+	}
+
+	std::vector<PACKAGE_MESH> meshes;
+	for (int meshID = 0; meshID < SceneGraph::MESH_COUNT; meshID++)
+	{
+		for (int level = 0; level < PrimitiveMeshes::GetShapeLevelCount(meshID); level++)
+		{
+			PrimitiveMeshes::MESH_DATA mesh;
+			PrimitiveMeshes::GenerateMesh(meshID, PrimitiveMeshes::GetLevelSegments(level), mesh);
+
+			PACKAGE_MESH packageMesh;
+			memset(&packageMesh, 0, sizeof(packageMesh));
+			packageMesh.meshID = (uint32_t)meshID;
+			packageMesh.vertexCount = (uint32_t)mesh.vertices.size();
+			packageMesh.indexCount = (uint32_t)mesh.indices.size();
+			packageMesh.level = (uint32_t)level;
+			packageMesh.vertexOffset = AddData(data, mesh.vertices.data(), mesh.vertices.size() * sizeof(PrimitiveMeshes::MESH_VERTEX));
+			packageMesh.indexOffset = AddData(data, mesh.indices.data(), mesh.indices.size() * sizeof(GLuint));
+			meshes.push_back(packageMesh);
+		}
+	}
+
+	// lay the sections out one after another behind the table
+	struct SECTION_SOURCE
+	{
+		PACKAGE_SECTION_TYPE type;
+		uint32_t count;
+		const void* bytes;
+		size_t length;
+	};
+	SECTION_SOURCE sources[] =
+	{
+		{ PACKAGE_SECTION_STRINGS, (uint32_t)strings.size(), strings.data(), strings.size() },
+		{ PACKAGE_SECTION_TEXTURES, (uint32_t)textures.size(), textures.data(), textures.size() * sizeof(PACKAGE_TEXTURE) },
+		{ PACKAGE_SECTION_MATERIALS, (uint32_t)scene.materials.size(), scene.materials.data(), scene.materials.size() * sizeof(PACKAGE_MATERIAL) },
+		{ PACKAGE_SECTION_LIGHTS, 1, &scene.lights, sizeof(LIGHT_BLOCK) },
+		{ PACKAGE_SECTION_MESHES, (uint32_t)meshes.size(), meshes.data(), meshes.size() * sizeof(PACKAGE_MESH) },
+		{ PACKAGE_SECTION_OBJECTS, (uint32_t)scene.objects.size(), scene.objects.data(), scene.objects.size() * sizeof(PACKAGE_OBJECT) },
+		{ PACKAGE_SECTION_LOCAL_LIGHTS, (uint32_t)scene.localLights.size(), scene.localLights.data(), scene.localLights.size() * sizeof(LOCAL_LIGHT) },
+		{ PACKAGE_SECTION_DATA, (uint32_t)data.size(), data.data(), data.size() }
+	};
+	const int sectionCount = sizeof(sources) / sizeof(sources[0]);
+
+	PACKAGE_SECTION sections[sectionCount];
+	uint64_t offset = AlignSize(sizeof(PACKAGE_HEADER) + sizeof(sections));
+	for (int i = 0; i < sectionCount; i++)
+	{
+		sections[i].type = sources[i].type;
+		sections[i].count = sources[i].count;
+		sections[i].byteOffset = offset;
+		sections[i].byteLength = sources[i].length;
+		sections[i].reserved = 0;
+		offset = AlignSize(offset + sources[i].length);
+	}
+
+	PACKAGE_HEADER header;
+	memcpy(header.identifier, SCENE_PACKAGE_IDENTIFIER, sizeof(header.identifier));
+	header.version = SCENE_PACKAGE_VERSION;
+	header.sectionCount = sectionCount;
+	header.fileSize = offset;
+	header.reserved = 0;
+
+	std::ofstream file(packageFilename.c_str(), std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not write scene package " << packageFilename << std::endl;
+		return(false);
+	}
+	static const char padding[SCENE_PACKAGE_ALIGNMENT] = { 0 };
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)sections, sizeof(sections));
+	for (int i = 0; i < sectionCount; i++)
+	{
+		file.write(padding, (std::streamsize)(sections[i].byteOffset - (uint64_t)file.tellp()));
+		file.write((const char*)sources[i].bytes, sources[i].length);
+	}
+	file.write(padding, (std::streamsize)(header.fileSize - (uint64_t)file.tellp()));
+	if (!file)
+	{
+		std::cout << "Could not write scene package " << packageFilename << std::endl;
+		return(false);
+	}
+
+	std::cout << "INFO: Scene package " << packageFilename << " written - "
+		<< textures.size() << " textures, " << scene.materials.size() << " materials, "
+		<< scene.objects.size() << " objects, " << scene.localLights.size() << " local lights, " << header.fileSize / 1024 << " KB" << std::endl;
+
+	return(true);
+}
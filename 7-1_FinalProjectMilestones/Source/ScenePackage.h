@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenepackage.h
+// ============
+// a single versioned binary file holding everything a scene needs, built
+// offline from a scene description and memory-mapped at startup
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderBlocks.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// first bytes of every scene package
+const char SCENE_PACKAGE_IDENTIFIER[8] = { 'S', 'C', 'N', 'P', 'K', 'G', '\r', '\n' };
+const uint32_t SCENE_PACKAGE_VERSION = 1;
+// every section, and every piece of data in the data section,
+// starts on this alignment within the file
+const uint32_t SCENE_PACKAGE_ALIGNMENT = 16;
+
+// the kinds of section in a package
+enum PACKAGE_SECTION_TYPE
+{
+	PACKAGE_SECTION_STRINGS = 1,
+	PACKAGE_SECTION_TEXTURES,
+	PACKAGE_SECTION_MATERIALS,
+	PACKAGE_SECTION_LIGHTS,
+	PACKAGE_SECTION_MESHES,
+	PACKAGE_SECTION_OBJECTS,
+	PACKAGE_SECTION_DATA,
+	PACKAGE_SECTION_LOCAL_LIGHTS,
+	PACKAGE_SECTION_LAST = PACKAGE_SECTION_LOCAL_LIGHTS
+};
+
+// how the bytes of a packaged texture are stored
+enum PACKAGE_TEXTURE_KIND
+{
+	PACKAGE_TEXTURE_FILE = 0,		// no bytes, only the path of the image
+	PACKAGE_TEXTURE_IMAGE,			// the bytes of the image file
+	PACKAGE_TEXTURE_COOKED			// the bytes of the cooked texture file
+};
+
+// the start of a package, followed by the section table
+struct PACKAGE_HEADER
+{
+	char identifier[8];
+	uint32_t version;
+	uint32_t sectionCount;
+	uint64_t fileSize;
+	uint64_t reserved;
+};
+
+// where a section is stored and how many entries it holds
+struct PACKAGE_SECTION
+{
+	uint32_t type;
+	uint32_t count;
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t reserved;
+};
+
+// an entry of the textures section; the strings are offsets into
+// the strings section and the bytes an offset into the data section
+struct PACKAGE_TEXTURE
+{
+	uint32_t tagOffset;
+	uint32_t pathOffset;
+	uint32_t kind;
+	uint32_t reserved;
+	uint64_t dataOffset;
+	uint64_t dataLength;
+};
+
+// an entry of the materials section
+struct PACKAGE_MATERIAL
+{
+	uint32_t tagOffset;
+	float ambientColor[3];
+	float ambientStrength;
+	float diffuseColor[3];
+	float specularColor[3];
+	float shininess;
+};
+
+// an entry of the meshes section, one per level of detail of a
+// mesh; the vertices are laid out as PrimitiveMeshes::MESH_VERTEX
+// and the indices are 32 bit
+struct PACKAGE_MESH
+{
+	uint32_t meshID;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t level;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+};
+
+// flags of a packaged object
+enum PACKAGE_OBJECT_FLAGS
+{
+	PACKAGE_OBJECT_BLENDED = 0x01,
+	PACKAGE_OBJECT_DYNAMIC = 0x02
+};
+
+// an entry of the objects section; the material and texture are
+// indices into their sections, or -1 for none
+struct PACKAGE_OBJECT
+{
+	uint32_t meshID;
+	int32_t materialIndex;
+	int32_t textureIndex;
+	uint32_t flags;
+	float scale[3];
+	float rotation[3];
+	float position[3];
+};
+
+static_assert(sizeof(PACKAGE_HEADER) == 32, "package header must not be padded");
+static_assert(sizeof(PACKAGE_SECTION) == 32, "package section must not be padded");
+static_assert(sizeof(PACKAGE_TEXTURE) == 32, "package texture must not be padded");
+static_assert(sizeof(PACKAGE_MATERIAL) == 48, "package material must not be padded");
+static_assert(sizeof(PACKAGE_MESH) == 32, "package mesh must not be padded");
+static_assert(sizeof(PACKAGE_OBJECT) == 52, "package object must not be padded");
+
+/***********************************************************
+ *  ScenePackage
+ *
+ *  This class maps a scene package into memory and checks
+ *  that its sections fit the file, then hands out pointers
+ *  straight into the mapped file, so the tables are never
+ *  parsed and the bulk data can be given to OpenGL without
+ *  being copied first. The file stays mapped until Close().
+ ***********************************************************/
+class ScenePackage
+{
+public:
+	// constructor
+	ScenePackage();
+	// destructor
+	~ScenePackage();
+
+	// map a package, returning false when it is missing or damaged
+	bool Open(const std::string& filename);
+	// unmap the package; no pointer handed out stays valid
+	void Close();
+	bool IsOpen() const { return(NULL != m_data); }
+
+	// the entries of each table section, and their count
+	const PACKAGE_TEXTURE* GetTextures(int& count) const;
+	const PACKAGE_MATERIAL* GetMaterials(int& count) const;
+	const PACKAGE_MESH* GetMeshes(int& count) const;
+	const PACKAGE_OBJECT* GetObjects(int& count) const;
+	// the light block, or NULL when the package has none
+	const LIGHT_BLOCK* GetLights() const;
+	// the local lights, stored as the shader reads them
+	const LOCAL_LIGHT* GetLocalLights(int& count) const;
+	// a string of the strings section, or NULL when out of range
+	const char* GetString(uint32_t offset) const;
+	// bytes of the data section, or NULL when out of range
+	const unsigned char* GetData(uint64_t offset, uint64_t length) const;
+
+	// build a package from a scene description file
+	static bool Build(const std::string& sceneFilename, const std::string& packageFilename);
+
+private:
+	// the mapped file
+	const unsigned char* m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#else
+	int m_fileDescriptor;
+#endif
+	// the section table entry of each section type, if present
+	const PACKAGE_SECTION* m_sections[PACKAGE_SECTION_LAST + 1];
+
+	// the start of a table section and its entry count
+	const void* GetTable(PACKAGE_SECTION_TYPE type, int& count) const;
+};
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderblocks.h
+// ============
+// CPU side layouts of the std140 uniform blocks and the buffer textures
+// declared in the shaders
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// uniform buffer binding points shared with the shader program
+const unsigned int MATERIAL_BLOCK_BINDING = 0;
+const unsigned int LIGHT_BLOCK_BINDING = 1;
+const unsigned int SHADOW_BLOCK_BINDING = 2;
+
+// must match MAX_MATERIALS in fragmentShader.glsl
+const int MAX_OBJECT_MATERIALS = 256;
+// must match TOTAL_POINT_LIGHTS in fragmentShader.glsl
+const int TOTAL_POINT_LIGHTS = 5;
+// must match the CLUSTER_ sizes in fragmentShader.glsl
+const int CLUSTER_COLUMNS = 16;
+const int CLUSTER_ROWS = 9;
+const int CLUSTER_SLICES = 24;
+const int TOTAL_CLUSTERS = CLUSTER_COLUMNS * CLUSTER_ROWS * CLUSTER_SLICES;
+
+// texture units of the buffer textures holding the local lights,
+// the offset and count of every cluster list and the lists
+const unsigned int LOCAL_LIGHT_TEXTURE_UNIT = 1;
+const unsigned int LIGHT_CLUSTER_TEXTURE_UNIT = 2;
+const unsigned int CLUSTER_LIST_TEXTURE_UNIT = 3;
+// texture unit of the shadow atlas
+const unsigned int SHADOW_ATLAS_TEXTURE_UNIT = 4;
+// a point light has one shadow tile for every face of its cube
+const int POINT_SHADOW_FACES = 6;
+
+// the padding members keep each vec3 on a 16 byte boundary
+// as the std140 layout rules require
+
+// the light directions are the directions the light travels
+// in, and the cut offs are cosines; UploadLightBlock() sends
+// the direction towards the light, normalized, and the scale
+// of the spot light falloff instead, so no fragment has to
+// work them out again
+
+// one entry of the MaterialBlock materials array
+struct MATERIAL_BLOCK_ENTRY
+{
+	glm::vec3 diffuseColor;
+	float shininess;
+	glm::vec3 specularColor;
+	float padding0;
+};
+
+// DirectionalLight in the LightBlock
+struct DIRECTIONAL_LIGHT_BLOCK
+{
+	glm::vec3 direction;
+	int bActive;
+	glm::vec3 ambient;
+	float padding0;
+	glm::vec3 diffuse;
+	float padding1;
+	glm::vec3 specular;
+	float padding2;
+};
+
+// PointLight in the LightBlock
+struct POINT_LIGHT_BLOCK
+{
+	glm::vec3 position;
+	int bActive;
+	glm::vec3 ambient;
+	float padding0;
+	glm::vec3 diffuse;
+	float padding1;
+	glm::vec3 specular;
+	float padding2;
+};
+
+// SpotLight in the LightBlock
+struct SPOT_LIGHT_BLOCK
+{
+	glm::vec3 position;
+	float cutOff;
+	glm::vec3 direction;
+	float outerCutOff;
+	glm::vec3 ambient;
+	float constant;
+	glm::vec3 diffuse;
+	float linear;
+	glm::vec3 specular;
+	float quadratic;
+	int bActive;
+	float padding0[3];
+};
+
+// the whole LightBlock uniform block
+struct LIGHT_BLOCK
+{
+	DIRECTIONAL_LIGHT_BLOCK directionalLight;
+	POINT_LIGHT_BLOCK pointLights[TOTAL_POINT_LIGHTS];
+	SPOT_LIGHT_BLOCK spotLight;
+};
+
+// one local light, read by the fragment shader as three texels
+// of the localLights buffer texture; the light reaches no
+// further than its radius
+struct LOCAL_LIGHT
+{
+	glm::vec3 position;
+	float radius;
+	glm::vec3 diffuse;
+	float padding0;
+	glm::vec3 specular;
+	float padding1;
+};
+
+// the whole ShadowBlock uniform block; the matrices take a world
+// position to its atlas coordinates and depth, and the tiles are
+// the atlas bounds the coordinates are kept in, as min and max,
+// with the point light tiles in the order of the point lights
+// in the light block and of the cube faces +X -X +Y -Y +Z -Z
+struct SHADOW_BLOCK
+{
+	glm::mat4 directionalMatrix;
+	glm::vec4 directionalTile;
+	glm::mat4 pointMatrices[TOTAL_POINT_LIGHTS * POINT_SHADOW_FACES];
+	glm::vec4 pointTiles[TOTAL_POINT_LIGHTS * POINT_SHADOW_FACES];
+};
+
+static_assert(sizeof(MATERIAL_BLOCK_ENTRY) == 32, "MaterialBlock entry does not match std140");
+static_assert(sizeof(DIRECTIONAL_LIGHT_BLOCK) == 64, "DirectionalLight does not match std140");
+static_assert(sizeof(POINT_LIGHT_BLOCK) == 64, "PointLight does not match std140");
+static_assert(sizeof(SPOT_LIGHT_BLOCK) == 96, "SpotLight does not match std140");
+static_assert(sizeof(LOCAL_LIGHT) == 48, "LOCAL_LIGHT must be three texels");
+static_assert(sizeof(SHADOW_BLOCK) == 80 + TOTAL_POINT_LIGHTS * POINT_SHADOW_FACES * 80, "ShadowBlock does not match std140");
@@ -0,0 +1,539 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderprogramcache.cpp
+// ============
+// build the variants of the scene shader program with their features
+// fixed at compile time, and keep the linked programs between runs
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderProgramCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// header at the start of the program cache file
+	struct PROGRAM_CACHE_HEADER
+	{
+		char identifier[8];
+		uint32_t version;
+		uint32_t programCount;
+		// the sources and driver the binaries were built with
+		uint64_t sourceHash;
+	};
+
+	// header of each program binary in the cache file
+	struct PROGRAM_CACHE_ENTRY
+	{
+		uint32_t features;
+		uint32_t format;
+		uint32_t byteLength;
+		uint32_t padding;
+	};
+
+	const char PROGRAM_CACHE_IDENTIFIER[8] = { 'P', 'R', 'O', 'G', 'C', 'A', 'C', 'H' };
+	const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+	/***********************************************************
+	 *  HashString()
+	 *
+	 *  Adds a string into a 64-bit FNV-1a hash.
+	 ***********************************************************/
+	uint64_t HashString(uint64_t hash, const char* text)
+	{
+		for (const char* c = text; (NULL != c) && (*c != '\0'); c++)
+		{
+			hash ^= (unsigned char)*c;
+			hash *= 1099511628211ULL;
+		}
+
+		return(hash);
+	}
+}
+
+/***********************************************************
+ *  ShaderProgramCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderProgramCache::ShaderProgramCache()
+{
+	m_bBinariesSupported = false;
+	m_compiledCount = 0;
+
+	// some drivers expose the extension without any format
+	if (GLEW_ARB_get_program_binary == GL_TRUE)
+	{
+		GLint formatCount = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+		m_bBinariesSupported = (formatCount > 0);
+	}
+}
+
+/***********************************************************
+ *  ~ShaderProgramCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderProgramCache::~ShaderProgramCache()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  ReadSourceFile()
+ *
+ *  This method is used for reading a whole shader file.
+ ***********************************************************/
+bool ShaderProgramCache::ReadSourceFile(const std::string& filename, std::string& source)
+{
+	std::ifstream file(filename.c_str());
+	if (!file)
+	{
+		std::cout << "Could not read shader file " << filename << std::endl;
+		return(false);
+	}
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+	source = contents.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadSources()
+ *
+ *  This method is used for reading the shader files that
+ *  every variant is built from. The variants are built as
+ *  they are first asked for.
+ ***********************************************************/
+bool ShaderProgramCache::LoadSources(const std::string& vertexFile, const std::string& fragmentFile)
+{
+	m_vertexFile = vertexFile;
+	m_fragmentFile = fragmentFile;
+
+	return((ReadSourceFile(vertexFile, m_vertexSource) == true) &&
+		(ReadSourceFile(fragmentFile, m_fragmentSource) == true));
+}
+
+/***********************************************************
+ *  AddFeatureDefines()
+ *
+ *  This method is used for defining the features of a
+ *  variant in a shader source. The defines have to follow
+ *  the version line, which must come first in the source.
+ ***********************************************************/
+std::string ShaderProgramCache::AddFeatureDefines(const std::string& source, unsigned int features)
+{
+	std::stringstream defines;
+	defines << "#define TEXTURED " << (((features & FEATURE_TEXTURED) != 0) ? 1 : 0) << "\n"
+		<< "#define LIGHTING " << (((features & FEATURE_LIGHTING) != 0) ? 1 : 0) << "\n"
+		<< "#define DIRECTIONAL_LIGHT " << (((features & FEATURE_DIRECTIONAL_LIGHT) != 0) ? 1 : 0) << "\n"
+		<< "#define SPOT_LIGHT " << (((features & FEATURE_SPOT_LIGHT) != 0) ? 1 : 0) << "\n"
+		<< "#define LOCAL_LIGHTS " << (((features & FEATURE_LOCAL_LIGHTS) != 0) ? 1 : 0) << "\n"
+		<< "#define SHADOWS " << (((features & FEATURE_SHADOWS) != 0) ? 1 : 0) << "\n"
+		<< "#define POINT_LIGHT_COUNT " << (features >> POINT_LIGHT_SHIFT) << "\n";
+
+	size_t insertAt = 0;
+	size_t versionLine = source.find("#version");
+	if (versionLine != std::string::npos)
+	{
+		size_t lineEnd = source.find('\n', versionLine);
+		insertAt = (lineEnd == std::string::npos) ? source.size() : lineEnd + 1;
+	}
+
+	std::string result = source.substr(0, insertAt);
+	if ((insertAt > 0) && (result[insertAt - 1] != '\n'))
+	{
+		result += "\n";
+	}
+	result += defines.str();
+	result += source.substr(insertAt);
+
+	return(result);
+}
+
+/***********************************************************
+ *  StartBuild()
+ *
+ *  This method is used for compiling and linking a variant
+ *  in one go, without asking for any status in between, so
+ *  a driver that compiles in the background can return
+ *  right away. The program is marked so its binary can be
+ *  read back once it has linked.
+ ***********************************************************/
+GLuint ShaderProgramCache::StartBuild(
+	const std::string& vertexSource,
+	const std::string& fragmentSource,
+	unsigned int features,
+	GLuint shaders[2])
+{
+	const GLenum shaderTypes[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	std::string sources[2] =
+	{
+		AddFeatureDefines(vertexSource, features),
+		AddFeatureDefines(fragmentSource, features)
+	};
+
+	GLuint program = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		const char* source = sources[i].c_str();
+		shaders[i] = glCreateShader(shaderTypes[i]);
+		glShaderSource(shaders[i], 1, &source, NULL);
+		glCompileShader(shaders[i]);
+		glAttachShader(program, shaders[i]);
+	}
+	if (GLEW_ARB_get_program_binary == GL_TRUE)
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(program);
+
+	return(program);
+}
+
+/***********************************************************
+ *  ReportBuildFailure()
+ *
+ *  This method is used for printing the error log of the
+ *  first shader that failed to compile, or else of the
+ *  program that failed to link.
+ ***********************************************************/
+void ShaderProgramCache::ReportBuildFailure(GLuint program, const GLuint shaders[2])
+{
+	const char* shaderNames[2] = { "Vertex", "Fragment" };
+	for (int i = 0; i < 2; i++)
+	{
+		GLint bCompiled = GL_FALSE;
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &bCompiled);
+		if (bCompiled == GL_FALSE)
+		{
+			GLint logLength = 0;
+			glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &logLength);
+			std::vector<char> infoLog(std::max(logLength, 1), '\0');
+			glGetShaderInfoLog(shaders[i], (GLsizei)infoLog.size(), NULL, infoLog.data());
+			std::cout << shaderNames[i] << " shader failed to compile\n" << infoLog.data() << std::endl;
+			return;
+		}
+	}
+
+	GLint logLength = 0;
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+	std::vector<char> infoLog(std::max(logLength, 1), '\0');
+	glGetProgramInfoLog(program, (GLsizei)infoLog.size(), NULL, infoLog.data());
+	std::cout << "Shader program failed to link\n" << infoLog.data() << std::endl;
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for getting the program of a variant.
+ *  A variant asked for the first time is loaded from its
+ *  cached binary, or else compiled and linked from the
+ *  sources, which waits on the driver. A variant that fails
+ *  to build is remembered as 0, so it is not built again
+ *  every frame.
+ ***********************************************************/
+GLuint ShaderProgramCache::GetProgram(unsigned int features)
+{
+	std::unordered_map<unsigned int, GLuint>::const_iterator found = m_programs.find(features);
+	if (found != m_programs.end())
+	{
+		return(found->second);
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	GLuint program = LoadBinary(features);
+	bool bFromBinary = (program != 0);
+	if (bFromBinary == false)
+	{
+		GLuint shaders[2] = { 0, 0 };
+		program = StartBuild(m_vertexSource, m_fragmentSource, features, shaders);
+
+		GLint bLinked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+		if (bLinked == GL_FALSE)
+		{
+			ReportBuildFailure(program, shaders);
+			glDeleteProgram(program);
+			program = 0;
+		}
+		glDeleteShader(shaders[0]);
+		glDeleteShader(shaders[1]);
+
+		if (program != 0)
+		{
+			StoreBinary(features, program);
+			m_compiledCount++;
+		}
+	}
+	m_programs[features] = program;
+
+	if (program != 0)
+	{
+		std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - startTime;
+		std::cout << "Built shader variant 0x" << std::hex << features << std::dec
+			<< (bFromBinary ? " from the program cache in " : " from source in ")
+			<< buildTime.count() << " ms" << std::endl;
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  ReplacePrograms()
+ *
+ *  This method is used for swapping in a rebuilt set of
+ *  variants along with the sources they were built from,
+ *  after the shader files were edited. The old programs
+ *  and binaries are freed, and the binaries of the new
+ *  programs are kept for the cache file.
+ ***********************************************************/
+void ShaderProgramCache::ReplacePrograms(
+	const std::string& vertexSource,
+	const std::string& fragmentSource,
+	const std::unordered_map<unsigned int, GLuint>& programs)
+{
+	Clear();
+	m_vertexSource = vertexSource;
+	m_fragmentSource = fragmentSource;
+	m_programs = programs;
+	m_compiledCount += (int)programs.size();
+
+	for (std::unordered_map<unsigned int, GLuint>::const_iterator i = m_programs.begin(); i != m_programs.end(); ++i)
+	{
+		StoreBinary(i->first, i->second);
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for freeing every program and the
+ *  binaries kept for the cache file.
+ ***********************************************************/
+void ShaderProgramCache::Clear()
+{
+	for (std::unordered_map<unsigned int, GLuint>::const_iterator i = m_programs.begin(); i != m_programs.end(); ++i)
+	{
+		if (i->second != 0)
+		{
+			glDeleteProgram(i->second);
+		}
+	}
+	m_programs.clear();
+	m_binaries.clear();
+}
+
+/***********************************************************
+ *  GetFeatureSets()
+ *
+ *  This method is used for getting the feature bits of
+ *  every variant built so far, so they can be rebuilt.
+ ***********************************************************/
+void ShaderProgramCache::GetFeatureSets(std::vector<unsigned int>& featureSets) const
+{
+	featureSets.clear();
+	for (std::unordered_map<unsigned int, GLuint>::const_iterator i = m_programs.begin(); i != m_programs.end(); ++i)
+	{
+		featureSets.push_back(i->first);
+	}
+	std::sort(featureSets.begin(), featureSets.end());
+}
+
+/***********************************************************
+ *  GetSourceHash()
+ *
+ *  This method is used for hashing the shader sources along
+ *  with the driver strings, since a program binary is only
+ *  valid for the driver that built it.
+ ***********************************************************/
+unsigned long long ShaderProgramCache::GetSourceHash() const
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = HashString(hash, m_vertexSource.c_str());
+	hash = HashString(hash, m_fragmentSource.c_str());
+	hash = HashString(hash, (const char*)glGetString(GL_VENDOR));
+	hash = HashString(hash, (const char*)glGetString(GL_RENDERER));
+	hash = HashString(hash, (const char*)glGetString(GL_VERSION));
+
+	return(hash);
+}
+
+/***********************************************************
+ *  LoadBinary()
+ *
+ *  This method is used for building a variant from its
+ *  cached binary. The driver may still refuse a binary,
+ *  after an update for instance, in which case the variant
+ *  is compiled from source instead.
+ ***********************************************************/
+GLuint ShaderProgramCache::LoadBinary(unsigned int features)
+{
+	std::unordered_map<unsigned int, PROGRAM_BINARY>::iterator found = m_binaries.find(features);
+	if ((m_bBinariesSupported == false) || (found == m_binaries.end()))
+	{
+		return(0);
+	}
+
+	const PROGRAM_BINARY& binary = found->second;
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, binary.format, binary.data.data(), (GLsizei)binary.data.size());
+
+	GLint bLinked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &bLinked);
+	if (bLinked == GL_FALSE)
+	{
+		glDeleteProgram(program);
+		m_binaries.erase(found);
+		return(0);
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  StoreBinary()
+ *
+ *  This method is used for reading back the binary of a
+ *  linked variant, to be written into the cache file.
+ ***********************************************************/
+void ShaderProgramCache::StoreBinary(unsigned int features, GLuint program)
+{
+	if ((m_bBinariesSupported == false) || (program == 0))
+	{
+		return;
+	}
+
+	GLint binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+	{
+		return;
+	}
+
+	PROGRAM_BINARY binary;
+	binary.data.resize((size_t)binaryLength);
+	GLsizei writtenLength = 0;
+	glGetProgramBinary(program, binaryLength, &writtenLength, &binary.format, binary.data.data());
+	if (writtenLength <= 0)
+	{
+		return;
+	}
+	binary.data.resize((size_t)writtenLength);
+
+	m_binaries[features] = binary;
+}
+
+/***********************************************************
+ *  LoadBinaryCache()
+ *
+ *  This method is used for reading the program binaries of
+ *  an earlier run. The file is ignored as a whole when the
+ *  shader sources or the driver have changed since then.
+ ***********************************************************/
+void ShaderProgramCache::LoadBinaryCache(const std::string& filename)
+{
+	if (m_bBinariesSupported == false)
+	{
+		return;
+	}
+
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+	{
+		return;
+	}
+
+	PROGRAM_CACHE_HEADER header;
+	if ((!file.read((char*)&header, sizeof(header))) ||
+		(memcmp(header.identifier, PROGRAM_CACHE_IDENTIFIER, sizeof(header.identifier)) != 0) ||
+		(header.version != PROGRAM_CACHE_VERSION))
+	{
+		std::cout << "Ignoring damaged program cache " << filename << std::endl;
+		return;
+	}
+	if (header.sourceHash != GetSourceHash())
+	{
+		// the shaders or the driver changed, so every
+		// variant is compiled again and the file rewritten
+		return;
+	}
+
+	for (uint32_t i = 0; i < header.programCount; i++)
+	{
+		PROGRAM_CACHE_ENTRY entry;
+		PROGRAM_BINARY binary;
+		if ((!file.read((char*)&entry, sizeof(entry))) ||
+			(entry.byteLength == 0) || (entry.byteLength > 64 * 1024 * 1024))
+		{
+			std::cout << "Ignoring damaged program cache " << filename << std::endl;
+			m_binaries.clear();
+			return;
+		}
+		binary.format = (GLenum)entry.format;
+		binary.data.resize(entry.byteLength);
+		if (!file.read((char*)binary.data.data(), entry.byteLength))
+		{
+			std::cout << "Ignoring damaged program cache " << filename << std::endl;
+			m_binaries.clear();
+			return;
+		}
+		m_binaries[entry.features] = binary;
+	}
+}
+
+/***********************************************************
+ *  SaveBinaryCache()
+ *
+ *  This method is used for writing the binaries of every
+ *  variant built in this run, or loaded from the cache,
+ *  for the next run.
+ ***********************************************************/
+void ShaderProgramCache::SaveBinaryCache(const std::string& filename) const
+{
+	if ((m_bBinariesSupported == false) || (m_binaries.empty()))
+	{
+		return;
+	}
+	// nothing new to write
+	if (m_compiledCount == 0)
+	{
+		return;
+	}
+
+	std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write program cache " << filename << std::endl;
+		return;
+	}
+
+	PROGRAM_CACHE_HEADER header;
+	memcpy(header.identifier, PROGRAM_CACHE_IDENTIFIER, sizeof(header.identifier));
+	header.version = PROGRAM_CACHE_VERSION;
+	header.programCount = (uint32_t)m_binaries.size();
+	header.sourceHash = GetSourceHash();
+	file.write((const char*)&header, sizeof(header));
+
+	for (std::unordered_map<unsigned int, PROGRAM_BINARY>::const_iterator i = m_binaries.begin(); i != m_binaries.end(); ++i)
+	{
+		PROGRAM_CACHE_ENTRY entry;
+		entry.features = i->first;
+		entry.format = (uint32_t)i->second.format;
+		entry.byteLength = (uint32_t)i->second.data.size();
+		entry.padding = 0;
+		file.write((const char*)&entry, sizeof(entry));
+		file.write((const char*)i->second.data.data(), i->second.data.size());
+	}
+
+	std::cout << "INFO: Wrote " << m_binaries.size() << " shader variants into " << filename << std::endl;
+}
@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderprogramcache.h
+// ============
+// build the variants of the scene shader program with their features
+// fixed at compile time, and keep the linked programs between runs
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  ShaderProgramCache
+ *
+ *  This class builds the scene shader program once for
+ *  every set of features a draw needs, by defining them at
+ *  the top of the shader sources, so the fragment shader
+ *  has no branches or light loops left to decide at run
+ *  time. The variants are kept by their feature bits and
+ *  built on first use. The linked program binaries are
+ *  written into a cache file, when the driver supports it,
+ *  and reused by later runs with the same shader sources
+ *  and driver, which skips compiling altogether.
+ ***********************************************************/
+class ShaderProgramCache
+{
+public:
+	// constructor
+	ShaderProgramCache();
+	// destructor
+	~ShaderProgramCache();
+
+	// the features a variant can be built with
+	enum FEATURE_BITS
+	{
+		FEATURE_TEXTURED = 0x01,
+		FEATURE_LIGHTING = 0x02,
+		FEATURE_DIRECTIONAL_LIGHT = 0x04,
+		FEATURE_SPOT_LIGHT = 0x08,
+		FEATURE_LOCAL_LIGHTS = 0x10,
+		FEATURE_SHADOWS = 0x20
+	};
+	// the number of point lights is kept in the bits from here up
+	static const int POINT_LIGHT_SHIFT = 6;
+
+	// read the shader sources the variants are built from
+	bool LoadSources(const std::string& vertexFile, const std::string& fragmentFile);
+	// get the program of a variant, building it if needed
+	GLuint GetProgram(unsigned int features);
+	// replace the sources and all the variants with a rebuilt
+	// set, freeing the old programs
+	void ReplacePrograms(
+		const std::string& vertexSource,
+		const std::string& fragmentSource,
+		const std::unordered_map<unsigned int, GLuint>& programs);
+	// free every program
+	void Clear();
+
+	// feature bits of every variant built so far
+	void GetFeatureSets(std::vector<unsigned int>& featureSets) const;
+	// the shader files the variants are built from
+	const std::string& GetVertexFile() const { return(m_vertexFile); }
+	const std::string& GetFragmentFile() const { return(m_fragmentFile); }
+
+	// read and write the linked program binaries
+	void LoadBinaryCache(const std::string& filename);
+	void SaveBinaryCache(const std::string& filename) const;
+
+	// start compiling and linking a variant without waiting on it
+	static GLuint StartBuild(
+		const std::string& vertexSource,
+		const std::string& fragmentSource,
+		unsigned int features,
+		GLuint shaders[2]);
+	// print the error log of a build that failed to link
+	static void ReportBuildFailure(GLuint program, const GLuint shaders[2]);
+	// add the defines of a variant after the version line
+	static std::string AddFeatureDefines(const std::string& source, unsigned int features);
+	// read a whole shader file
+	static bool ReadSourceFile(const std::string& filename, std::string& source);
+
+private:
+	// a linked program binary and its driver format
+	struct PROGRAM_BINARY
+	{
+		GLenum format;
+		std::vector<unsigned char> data;
+	};
+
+	// the shader files and their contents
+	std::string m_vertexFile;
+	std::string m_fragmentFile;
+	std::string m_vertexSource;
+	std::string m_fragmentSource;
+	// built programs indexed by feature bits
+	std::unordered_map<unsigned int, GLuint> m_programs;
+	// program binaries indexed by feature bits, from the cache
+	// file or from the programs built since
+	std::unordered_map<unsigned int, PROGRAM_BINARY> m_binaries;
+	// whether the driver can hand out program binaries
+	bool m_bBinariesSupported;
+	// variants built from source rather than from the cache file
+	int m_compiledCount;
+
+	// build a variant from its binary, returning 0 if it cannot be
+	GLuint LoadBinary(unsigned int features);
+	// keep the binary of a linked variant for the cache file
+	void StoreBinary(unsigned int features, GLuint program);
+	// hash of the sources and the driver the binaries belong to
+	unsigned long long GetSourceHash() const;
+};
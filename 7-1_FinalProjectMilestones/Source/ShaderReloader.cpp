@@ -0,0 +1,161 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderreloader.cpp
+// ============
+// rebuild the scene shader variants from their edited files and swap them
+// in only once they have all linked
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderReloader.h"
+
+#include <iostream>
+#include <unordered_map>
+
+/***********************************************************
+ *  ShaderReloader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderReloader::ShaderReloader(ShaderProgramCache* pProgramCache)
+{
+	m_pProgramCache = pProgramCache;
+
+	// let the driver compile on its own threads, so a build
+	// can be checked without waiting on it
+	m_bParallelCompile = (GLEW_KHR_parallel_shader_compile == GL_TRUE);
+	if (m_bParallelCompile == true)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+}
+
+/***********************************************************
+ *  ~ShaderReloader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderReloader::~ShaderReloader()
+{
+	DeletePending();
+	m_pProgramCache = NULL;
+}
+
+/***********************************************************
+ *  IsShaderFile()
+ *
+ *  This method is used for checking whether a file is one
+ *  of the shader files the variants are built from.
+ ***********************************************************/
+bool ShaderReloader::IsShaderFile(const std::string& filename) const
+{
+	return((filename == m_pProgramCache->GetVertexFile()) ||
+		(filename == m_pProgramCache->GetFragmentFile()));
+}
+
+/***********************************************************
+ *  DeletePending()
+ *
+ *  This method is used for freeing the variants being built
+ *  and their shaders.
+ ***********************************************************/
+void ShaderReloader::DeletePending()
+{
+	for (int i = 0; i < (int)m_pendingBuilds.size(); i++)
+	{
+		PENDING_BUILD& build = m_pendingBuilds[i];
+		glDeleteShader(build.shaders[0]);
+		glDeleteShader(build.shaders[1]);
+		if (build.program != 0)
+		{
+			glDeleteProgram(build.program);
+		}
+	}
+	m_pendingBuilds.clear();
+}
+
+/***********************************************************
+ *  BeginReload()
+ *
+ *  This method is used for starting to rebuild every
+ *  variant in use from the current shader files. Any
+ *  rebuild still in progress is dropped, as its files have
+ *  changed again.
+ ***********************************************************/
+void ShaderReloader::BeginReload()
+{
+	DeletePending();
+	m_reloadStart = std::chrono::steady_clock::now();
+
+	if ((ShaderProgramCache::ReadSourceFile(m_pProgramCache->GetVertexFile(), m_vertexSource) == false) ||
+		(ShaderProgramCache::ReadSourceFile(m_pProgramCache->GetFragmentFile(), m_fragmentSource) == false))
+	{
+		std::cout << "Keeping the current shader program" << std::endl;
+		return;
+	}
+
+	std::vector<unsigned int> featureSets;
+	m_pProgramCache->GetFeatureSets(featureSets);
+	for (int i = 0; i < (int)featureSets.size(); i++)
+	{
+		PENDING_BUILD build;
+		build.features = featureSets[i];
+		build.program = ShaderProgramCache::StartBuild(m_vertexSource, m_fragmentSource, build.features, build.shaders);
+		m_pendingBuilds.push_back(build);
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for checking the rebuild once per
+ *  frame. Until the driver reports every variant complete
+ *  nothing is waited on. A set that linked replaces the
+ *  variants in the program cache, which frees the old ones;
+ *  the caller then forgets the uniform state of the old
+ *  programs. A failed set is reported and dropped.
+ ***********************************************************/
+bool ShaderReloader::Update()
+{
+	if (m_pendingBuilds.empty())
+	{
+		return(false);
+	}
+
+	for (int i = 0; (m_bParallelCompile == true) && (i < (int)m_pendingBuilds.size()); i++)
+	{
+		GLint bComplete = GL_FALSE;
+		glGetProgramiv(m_pendingBuilds[i].program, GL_COMPLETION_STATUS_KHR, &bComplete);
+		if (bComplete == GL_FALSE)
+		{
+			return(false);
+		}
+	}
+
+	std::unordered_map<unsigned int, GLuint> programs;
+	for (int i = 0; i < (int)m_pendingBuilds.size(); i++)
+	{
+		const PENDING_BUILD& build = m_pendingBuilds[i];
+		GLint bLinked = GL_FALSE;
+		glGetProgramiv(build.program, GL_LINK_STATUS, &bLinked);
+		if (bLinked == GL_FALSE)
+		{
+			ShaderProgramCache::ReportBuildFailure(build.program, build.shaders);
+			std::cout << "Keeping the current shader program" << std::endl;
+			DeletePending();
+			return(false);
+		}
+		programs[build.features] = build.program;
+	}
+
+	// the linked programs keep their code once the shaders are gone
+	for (int i = 0; i < (int)m_pendingBuilds.size(); i++)
+	{
+		m_pendingBuilds[i].program = 0;
+	}
+	DeletePending();
+	m_pProgramCache->ReplacePrograms(m_vertexSource, m_fragmentSource, programs);
+
+	std::chrono::duration<double, std::milli> reloadTime = std::chrono::steady_clock::now() - m_reloadStart;
+	std::cout << "INFO: " << programs.size() << " shader variants reloaded in " << reloadTime.count() << " ms" << std::endl;
+
+	return(true);
+}
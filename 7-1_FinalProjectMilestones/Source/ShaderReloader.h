@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderreloader.h
+// ============
+// rebuild the scene shader variants from their edited files and swap them
+// in only once they have all linked
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderProgramCache.h"
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderReloader
+ *
+ *  This class rebuilds every shader variant in the program
+ *  cache from the shader files while the old variants keep
+ *  drawing. When the driver compiles in the background, the
+ *  builds are checked once per frame and never waited on.
+ *  Once all of them have linked they replace the old set
+ *  together, while a single failure to compile or link
+ *  throws the whole set away with its error log, leaving
+ *  the old variants in use.
+ ***********************************************************/
+class ShaderReloader
+{
+public:
+	// constructor
+	ShaderReloader(ShaderProgramCache* pProgramCache);
+	// destructor
+	~ShaderReloader();
+
+	// whether a file is one of the shader files
+	bool IsShaderFile(const std::string& filename) const;
+
+	// start rebuilding the variants from the current shader
+	// files, replacing any rebuild still in progress
+	void BeginReload();
+	// swap in the finished rebuild if it linked; returns true
+	// on the call that replaced the variants
+	bool Update();
+
+private:
+	// one variant being built
+	struct PENDING_BUILD
+	{
+		unsigned int features;
+		GLuint program;
+		GLuint shaders[2];
+	};
+
+	// program cache holding the variants in use
+	ShaderProgramCache* m_pProgramCache;
+	// the sources being built and their variants
+	std::string m_vertexSource;
+	std::string m_fragmentSource;
+	std::vector<PENDING_BUILD> m_pendingBuilds;
+	// whether the driver compiles and links in the background
+	bool m_bParallelCompile;
+	// time the rebuild was started, for the reload report
+	std::chrono::steady_clock::time_point m_reloadStart;
+
+	// free the variants being built and their shaders
+	void DeletePending();
+};
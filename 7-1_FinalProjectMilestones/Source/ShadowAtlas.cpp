@@ -0,0 +1,681 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowatlas.cpp
+// ============
+// render the shadow maps of the directional and point lights into one depth
+// atlas, caching the shadows of the objects that do not move
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowAtlas.h"
+#include "Frustum.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the directional tile fills a quarter of the atlas, and the
+	// point light faces are laid out in the other three quarters
+	const int SHADOW_ATLAS_SIZE = 4096;
+	const int DIRECTIONAL_TILE_SIZE = SHADOW_ATLAS_SIZE / 2;
+	const int POINT_TILE_SIZE = SHADOW_ATLAS_SIZE / 8;
+	const int POINT_TILES_PER_ROW = DIRECTIONAL_TILE_SIZE / POINT_TILE_SIZE;
+	const int POINT_TILES_PER_QUARTER = POINT_TILES_PER_ROW * POINT_TILES_PER_ROW;
+
+	static_assert(TOTAL_POINT_LIGHTS * POINT_SHADOW_FACES <= 3 * POINT_TILES_PER_QUARTER,
+		"the point light faces must fit in the shadow atlas");
+
+	// the point light views start this close to the light
+	const float POINT_SHADOW_NEAR = 0.05f;
+	// depth offset of the shadow casters, against shadow acne
+	const float SHADOW_OFFSET_FACTOR = 2.0f;
+	const float SHADOW_OFFSET_UNITS = 4.0f;
+
+	// the look and up directions of the cube faces, in the
+	// order +X -X +Y -Y +Z -Z the shader picks the faces in
+	const glm::vec3 FACE_DIRECTIONS[POINT_SHADOW_FACES] =
+	{
+		glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 FACE_UPS[POINT_SHADOW_FACES] =
+	{
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f)
+	};
+
+	/***********************************************************
+	 *  GetAtlasMatrix()
+	 *
+	 *  Returns the matrix that takes normalized device
+	 *  coordinates of a tile view to the atlas coordinates and
+	 *  depth the tile holds them at.
+	 ***********************************************************/
+	glm::mat4 GetAtlasMatrix(int x, int y, int size)
+	{
+		float scale = 0.5f * size / SHADOW_ATLAS_SIZE;
+
+		glm::mat4 atlas(1.0f);
+		atlas[0][0] = scale;
+		atlas[1][1] = scale;
+		atlas[2][2] = 0.5f;
+		atlas[3][0] = (float)x / SHADOW_ATLAS_SIZE + scale;
+		atlas[3][1] = (float)y / SHADOW_ATLAS_SIZE + scale;
+		atlas[3][2] = 0.5f;
+		return(atlas);
+	}
+
+	/***********************************************************
+	 *  GetTileBounds()
+	 *
+	 *  Returns the atlas coordinates of the centers of the
+	 *  first and last texels of a tile, which filtering can
+	 *  sample around without reading a neighbouring tile.
+	 ***********************************************************/
+	glm::vec4 GetTileBounds(int x, int y, int size)
+	{
+		return(glm::vec4(
+			(x + 0.5f) / SHADOW_ATLAS_SIZE,
+			(y + 0.5f) / SHADOW_ATLAS_SIZE,
+			(x + size - 0.5f) / SHADOW_ATLAS_SIZE,
+			(y + size - 0.5f) / SHADOW_ATLAS_SIZE));
+	}
+}
+
+/***********************************************************
+ *  ShadowAtlas()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowAtlas::ShadowAtlas()
+{
+	// the directional tile, then every face of every point light
+	for (int tile = 0; tile < TILE_COUNT; tile++)
+	{
+		SHADOW_TILE& shadowTile = m_tiles[tile];
+		if (tile == 0)
+		{
+			shadowTile.x = 0;
+			shadowTile.y = 0;
+			shadowTile.size = DIRECTIONAL_TILE_SIZE;
+		}
+		else
+		{
+			int quarter = 1 + (tile - 1) / POINT_TILES_PER_QUARTER;
+			int slot = (tile - 1) % POINT_TILES_PER_QUARTER;
+			shadowTile.x = (quarter % 2) * DIRECTIONAL_TILE_SIZE + (slot % POINT_TILES_PER_ROW) * POINT_TILE_SIZE;
+			shadowTile.y = (quarter / 2) * DIRECTIONAL_TILE_SIZE + (slot / POINT_TILES_PER_ROW) * POINT_TILE_SIZE;
+			shadowTile.size = POINT_TILE_SIZE;
+		}
+		shadowTile.view = glm::mat4(1.0f);
+		shadowTile.projection = glm::mat4(1.0f);
+		shadowTile.bActive = false;
+		shadowTile.bStaticDirty = false;
+		shadowTile.bHasDynamic = false;
+	}
+
+	m_bDirectionalActive = false;
+	m_directionToLight = glm::vec3(0.0f);
+	m_pointLightCount = 0;
+	for (int light = 0; light < TOTAL_POINT_LIGHTS; light++)
+	{
+		m_pointPositions[light] = glm::vec3(0.0f);
+	}
+
+	m_staticTexture = 0;
+	m_staticFramebuffer = 0;
+	m_dynamicTexture = 0;
+	m_dynamicFramebuffer = 0;
+	m_boundTexture = 0;
+	m_casterBuffer = 0;
+	m_shadowBuffer = 0;
+	m_sceneMinimum = glm::vec3(0.0f);
+	m_sceneMaximum = glm::vec3(0.0f);
+	m_bStaticDirty = true;
+	m_bDynamicDirty = true;
+	m_bBlockDirty = true;
+	m_staticTileCount = 0;
+	m_dynamicTileCount = 0;
+}
+
+/***********************************************************
+ *  ~ShadowAtlas()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowAtlas::~ShadowAtlas()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the cached atlas, the
+ *  buffer of the shadow casters and the uniform buffer of
+ *  the shadow block, which is attached to its binding
+ *  point. The atlas for the dynamic objects is only made
+ *  once the scene has some.
+ ***********************************************************/
+void ShadowAtlas::Create()
+{
+	CreateAtlas(m_staticTexture, m_staticFramebuffer);
+
+	glGenBuffers(1, &m_casterBuffer);
+
+	SHADOW_BLOCK shadowBlock = SHADOW_BLOCK();
+	glGenBuffers(1, &m_shadowBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_shadowBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(SHADOW_BLOCK), &shadowBlock, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_BLOCK_BINDING, m_shadowBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_bStaticDirty = true;
+	m_bBlockDirty = true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the atlas textures,
+ *  their framebuffers and the buffers.
+ ***********************************************************/
+void ShadowAtlas::Destroy()
+{
+	GLuint* textures[2] = { &m_staticTexture, &m_dynamicTexture };
+	GLuint* framebuffers[2] = { &m_staticFramebuffer, &m_dynamicFramebuffer };
+	GLuint* buffers[2] = { &m_casterBuffer, &m_shadowBuffer };
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (*framebuffers[i] != 0)
+		{
+			glDeleteFramebuffers(1, framebuffers[i]);
+			*framebuffers[i] = 0;
+		}
+		if (*textures[i] != 0)
+		{
+			glDeleteTextures(1, textures[i]);
+			*textures[i] = 0;
+		}
+		if (*buffers[i] != 0)
+		{
+			glDeleteBuffers(1, buffers[i]);
+			*buffers[i] = 0;
+		}
+	}
+	m_boundTexture = 0;
+}
+
+/***********************************************************
+ *  CreateAtlas()
+ *
+ *  This method is used for making a depth texture the size
+ *  of the atlas, set up to be sampled with depth compares,
+ *  and a framebuffer that renders into it.
+ ***********************************************************/
+void ShadowAtlas::CreateAtlas(GLuint& texture, GLuint& framebuffer)
+{
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+	// the linear filter blends the results of four depth compares
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "The shadow atlas framebuffer is not complete" << std::endl;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for passing in the lights as they
+ *  were sent to the shader. Only the tiles of the lights
+ *  that were switched or moved are marked to be rendered
+ *  again; a change of color keeps every cached tile.
+ ***********************************************************/
+void ShadowAtlas::SetLights(const LIGHT_BLOCK& lights, int pointLightCount)
+{
+	bool bDirectionalActive = (lights.directionalLight.bActive != 0);
+	if ((bDirectionalActive != m_bDirectionalActive) ||
+		((bDirectionalActive == true) && (lights.directionalLight.direction != m_directionToLight)))
+	{
+		m_bDirectionalActive = bDirectionalActive;
+		m_directionToLight = lights.directionalLight.direction;
+		m_tiles[0].bActive = bDirectionalActive;
+		m_tiles[0].bStaticDirty = bDirectionalActive;
+		m_bBlockDirty = true;
+	}
+
+	for (int light = 0; light < TOTAL_POINT_LIGHTS; light++)
+	{
+		bool bActive = (light < pointLightCount);
+		bool bWasActive = (light < m_pointLightCount);
+		if ((bActive != bWasActive) ||
+			((bActive == true) && (lights.pointLights[light].position != m_pointPositions[light])))
+		{
+			m_pointPositions[light] = lights.pointLights[light].position;
+			for (int face = 0; face < POINT_SHADOW_FACES; face++)
+			{
+				SHADOW_TILE& tile = m_tiles[1 + light * POINT_SHADOW_FACES + face];
+				tile.bActive = bActive;
+				tile.bStaticDirty = bActive;
+			}
+			m_bBlockDirty = true;
+		}
+	}
+	m_pointLightCount = pointLightCount;
+}
+
+/***********************************************************
+ *  BuildCasters()
+ *
+ *  This method is used for sorting the scene nodes into
+ *  runs of one mesh, the static nodes first and then the
+ *  dynamic ones, and sending their model matrices into the
+ *  caster buffer. The bounds of the whole scene are found
+ *  along the way.
+ ***********************************************************/
+void ShadowAtlas::BuildCasters(const SceneGraph& sceneGraph)
+{
+	const SceneGraph::WORLD_BOUNDS& bounds = sceneGraph.GetWorldBounds();
+	int nodeCount = sceneGraph.GetNodeCount();
+
+	m_casters.clear();
+	m_staticRuns.clear();
+	m_dynamicRuns.clear();
+	m_dynamicNodes.clear();
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		bool bDynamic = (pass == 1);
+		std::vector<CASTER_RUN>& runs = bDynamic ? m_dynamicRuns : m_staticRuns;
+		if ((bDynamic == true) && (sceneGraph.GetDynamicCount() == 0))
+		{
+			break;
+		}
+
+		for (int meshID = 0; meshID < SceneGraph::MESH_COUNT; meshID++)
+		{
+			CASTER_RUN run;
+			run.meshID = meshID;
+			run.firstInstance = (int)m_casters.size();
+			run.instanceCount = 0;
+
+			for (int node = 0; node < nodeCount; node++)
+			{
+				if ((sceneGraph.GetMeshID(node) != meshID) || (sceneGraph.IsDynamic(node) != bDynamic))
+				{
+					continue;
+				}
+
+				PrimitiveMeshes::INSTANCE_DATA caster;
+				caster.model = sceneGraph.GetModelMatrix(node);
+				caster.materialIndex = 0;
+				caster.textureLayer = -1;
+				caster.padding[0] = 0;
+				caster.padding[1] = 0;
+				m_casters.push_back(caster);
+				run.instanceCount++;
+
+				if (bDynamic == true)
+				{
+					m_dynamicNodes.push_back(node);
+				}
+			}
+
+			if (run.instanceCount > 0)
+			{
+				runs.push_back(run);
+			}
+		}
+	}
+
+	m_sceneMinimum = glm::vec3(0.0f);
+	m_sceneMaximum = glm::vec3(0.0f);
+	for (int node = 0; node < nodeCount; node++)
+	{
+		glm::vec3 center(bounds.centerX[node], bounds.centerY[node], bounds.centerZ[node]);
+		glm::vec3 extents(bounds.extentX[node], bounds.extentY[node], bounds.extentZ[node]);
+		m_sceneMinimum = (node == 0) ? center - extents : glm::min(m_sceneMinimum, center - extents);
+		m_sceneMaximum = (node == 0) ? center + extents : glm::max(m_sceneMaximum, center + extents);
+	}
+
+	if (m_casters.empty() == false)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_casterBuffer);
+		// orphan the old storage, as the instance buffer does
+		glBufferData(GL_ARRAY_BUFFER, m_casters.size() * sizeof(PrimitiveMeshes::INSTANCE_DATA), NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, m_casters.size() * sizeof(PrimitiveMeshes::INSTANCE_DATA), &m_casters[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+/***********************************************************
+ *  FitTileViews()
+ *
+ *  This method is used for setting up the light views of
+ *  the tiles that are rendered again. The directional view
+ *  is an orthographic box around the scene bounds, and the
+ *  cube faces of a point light reach as far as the corner
+ *  of the scene furthest from it. The tiles that are kept
+ *  keep the views they were rendered with.
+ ***********************************************************/
+void ShadowAtlas::FitTileViews()
+{
+	glm::vec3 center = 0.5f * (m_sceneMinimum + m_sceneMaximum);
+	float radius = std::max(0.5f * glm::length(m_sceneMaximum - m_sceneMinimum), 0.01f);
+
+	SHADOW_TILE& directionalTile = m_tiles[0];
+	if ((directionalTile.bActive == true) && (directionalTile.bStaticDirty == true))
+	{
+		glm::vec3 up = (std::fabs(m_directionToLight.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		directionalTile.view = glm::lookAt(center + m_directionToLight * (2.0f * radius), center, up);
+		directionalTile.projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+		m_bBlockDirty = true;
+	}
+
+	for (int light = 0; light < m_pointLightCount; light++)
+	{
+		const glm::vec3& position = m_pointPositions[light];
+		glm::vec3 furthest = glm::max(glm::abs(position - m_sceneMinimum), glm::abs(m_sceneMaximum - position));
+		float farDistance = 1.01f * glm::length(furthest) + POINT_SHADOW_NEAR;
+
+		for (int face = 0; face < POINT_SHADOW_FACES; face++)
+		{
+			SHADOW_TILE& tile = m_tiles[1 + light * POINT_SHADOW_FACES + face];
+			if (tile.bStaticDirty == false)
+			{
+				continue;
+			}
+
+			tile.view = glm::lookAt(position, position + FACE_DIRECTIONS[face], FACE_UPS[face]);
+			tile.projection = glm::perspective(glm::radians(90.0f), 1.0f, POINT_SHADOW_NEAR, farDistance);
+			m_bBlockDirty = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  UploadShadowBlock()
+ *
+ *  This method is used for sending the matrices that take
+ *  a world position to its place in the atlas, and the
+ *  bounds of every tile, into the shadow block.
+ ***********************************************************/
+void ShadowAtlas::UploadShadowBlock()
+{
+	SHADOW_BLOCK shadowBlock = SHADOW_BLOCK();
+
+	for (int tile = 0; tile < TILE_COUNT; tile++)
+	{
+		const SHADOW_TILE& shadowTile = m_tiles[tile];
+		if (shadowTile.bActive == false)
+		{
+			continue;
+		}
+
+		glm::mat4 matrix = GetAtlasMatrix(shadowTile.x, shadowTile.y, shadowTile.size) * shadowTile.projection * shadowTile.view;
+		glm::vec4 bounds = GetTileBounds(shadowTile.x, shadowTile.y, shadowTile.size);
+		if (tile == 0)
+		{
+			shadowBlock.directionalMatrix = matrix;
+			shadowBlock.directionalTile = bounds;
+		}
+		else
+		{
+			shadowBlock.pointMatrices[tile - 1] = matrix;
+			shadowBlock.pointTiles[tile - 1] = bounds;
+		}
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_shadowBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SHADOW_BLOCK), &shadowBlock);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_bBlockDirty = false;
+}
+
+/***********************************************************
+ *  TouchesDynamic()
+ *
+ *  This method is used for testing whether the bounds of
+ *  any dynamic object lie in the light view of a tile.
+ ***********************************************************/
+bool ShadowAtlas::TouchesDynamic(const SceneGraph& sceneGraph, int tile) const
+{
+	const SceneGraph::WORLD_BOUNDS& bounds = sceneGraph.GetWorldBounds();
+
+	Frustum frustum;
+	frustum.ExtractPlanes(m_tiles[tile].projection * m_tiles[tile].view);
+	for (size_t i = 0; i < m_dynamicNodes.size(); i++)
+	{
+		int node = m_dynamicNodes[i];
+		if (frustum.TestBounds(
+			glm::vec3(bounds.centerX[node], bounds.centerY[node], bounds.centerZ[node]),
+			glm::vec3(bounds.extentX[node], bounds.extentY[node], bounds.extentZ[node]),
+			bounds.radius[node]) == true)
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  DrawTile()
+ *
+ *  This method is used for drawing runs of shadow casters
+ *  into one tile of the bound atlas, with the light view of
+ *  the tile. The directional view clamps the depth of the
+ *  casters in front of it instead of clipping them.
+ ***********************************************************/
+void ShadowAtlas::DrawTile(
+	int tile,
+	bool bClear,
+	const std::vector<CASTER_RUN>& runs,
+	PrimitiveMeshes* pMeshes,
+	UniformCache* pUniformCache)
+{
+	const SHADOW_TILE& shadowTile = m_tiles[tile];
+
+	glViewport(shadowTile.x, shadowTile.y, shadowTile.size, shadowTile.size);
+	if (bClear == true)
+	{
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(shadowTile.x, shadowTile.y, shadowTile.size, shadowTile.size);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glDisable(GL_SCISSOR_TEST);
+	}
+
+	if (tile == 0)
+	{
+		glEnable(GL_DEPTH_CLAMP);
+	}
+	else
+	{
+		glDisable(GL_DEPTH_CLAMP);
+	}
+
+	pUniformCache->SetMat4(UniformCache::UNIFORM_VIEW, shadowTile.view);
+	pUniformCache->SetMat4(UniformCache::UNIFORM_PROJECTION, shadowTile.projection);
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		pMeshes->DrawInstanced(runs[i].meshID, 0, runs[i].firstInstance, runs[i].instanceCount, m_casterBuffer);
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for bringing the atlas up to date.
+ *  The stale tiles of the cache are rendered with the
+ *  static casters. When the scene has dynamic objects, the
+ *  tiles that were rendered, or that a dynamic object is in
+ *  or was in before it moved, are copied into the dynamic
+ *  atlas and get the dynamic casters drawn over them. The
+ *  other tiles are left as they are, so a frame where
+ *  nothing changed draws nothing at all.
+ ***********************************************************/
+bool ShadowAtlas::Update(
+	const SceneGraph& sceneGraph,
+	PrimitiveMeshes* pMeshes,
+	UniformCache* pUniformCache,
+	GLuint depthProgram)
+{
+	m_staticTileCount = 0;
+	m_dynamicTileCount = 0;
+
+	if (m_bStaticDirty == true)
+	{
+		for (int tile = 0; tile < TILE_COUNT; tile++)
+		{
+			m_tiles[tile].bStaticDirty = m_tiles[tile].bActive;
+		}
+		BuildCasters(sceneGraph);
+		m_bStaticDirty = false;
+		m_bDynamicDirty = true;
+	}
+	else if (m_bDynamicDirty == true)
+	{
+		BuildCasters(sceneGraph);
+	}
+
+	bool bStaticStale = false;
+	for (int tile = 0; tile < TILE_COUNT; tile++)
+	{
+		bStaticStale = bStaticStale || m_tiles[tile].bStaticDirty;
+	}
+	bool bUseDynamic = (m_dynamicRuns.empty() == false);
+	bool bCopyAll = (bUseDynamic == true) && (m_dynamicTexture == 0);
+
+	if (bStaticStale == true)
+	{
+		FitTileViews();
+	}
+	if (m_bBlockDirty == true)
+	{
+		UploadShadowBlock();
+	}
+
+	bool bDrawn = false;
+	if ((bStaticStale == true) || ((bUseDynamic == true) && ((m_bDynamicDirty == true) || (bCopyAll == true))))
+	{
+		GLint previousFramebuffer = 0;
+		GLint previousViewport[4] = { 0, 0, 0, 0 };
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+		pUniformCache->UseProgram(depthProgram);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(SHADOW_OFFSET_FACTOR, SHADOW_OFFSET_UNITS);
+
+		// render the stale tiles of the cache with the static casters
+		bool bRedrawn[TILE_COUNT];
+		glBindFramebuffer(GL_FRAMEBUFFER, m_staticFramebuffer);
+		for (int tile = 0; tile < TILE_COUNT; tile++)
+		{
+			bRedrawn[tile] = m_tiles[tile].bStaticDirty;
+			if (m_tiles[tile].bStaticDirty == true)
+			{
+				DrawTile(tile, true, m_staticRuns, pMeshes, pUniformCache);
+				m_tiles[tile].bStaticDirty = false;
+				m_staticTileCount++;
+			}
+		}
+
+		// copy the cached tiles that changed, or that dynamic
+		// casters are in or were in, and draw the casters over them
+		if (bUseDynamic == true)
+		{
+			if (bCopyAll == true)
+			{
+				CreateAtlas(m_dynamicTexture, m_dynamicFramebuffer);
+			}
+
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staticFramebuffer);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_dynamicFramebuffer);
+			for (int tile = 0; tile < TILE_COUNT; tile++)
+			{
+				SHADOW_TILE& shadowTile = m_tiles[tile];
+				if (shadowTile.bActive == false)
+				{
+					continue;
+				}
+
+				// a tile drawn again is tested too, since the dynamic
+				// casters may have moved in or out of it since the test
+				bool bTouches = shadowTile.bHasDynamic;
+				if ((bRedrawn[tile] == true) || (m_bDynamicDirty == true))
+				{
+					bTouches = TouchesDynamic(sceneGraph, tile);
+				}
+				if ((bRedrawn[tile] == false) && (bCopyAll == false) &&
+					((m_bDynamicDirty == false) || ((bTouches == false) && (shadowTile.bHasDynamic == false))))
+				{
+					continue;
+				}
+
+				glBlitFramebuffer(
+					shadowTile.x, shadowTile.y, shadowTile.x + shadowTile.size, shadowTile.y + shadowTile.size,
+					shadowTile.x, shadowTile.y, shadowTile.x + shadowTile.size, shadowTile.y + shadowTile.size,
+					GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+				if (bTouches == true)
+				{
+					DrawTile(tile, false, m_dynamicRuns, pMeshes, pUniformCache);
+				}
+				shadowTile.bHasDynamic = bTouches;
+				m_dynamicTileCount++;
+			}
+		}
+
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glDisable(GL_DEPTH_CLAMP);
+		glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+		glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+		bDrawn = true;
+	}
+	m_bDynamicDirty = false;
+
+	// the shader reads the atlas holding every shadow
+	GLuint texture = (bUseDynamic == true) ? m_dynamicTexture : m_staticTexture;
+	if (texture != m_boundTexture)
+	{
+		glActiveTexture(GL_TEXTURE0 + SHADOW_ATLAS_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glActiveTexture(GL_TEXTURE0);
+		m_boundTexture = texture;
+	}
+
+	return(bDrawn);
+}
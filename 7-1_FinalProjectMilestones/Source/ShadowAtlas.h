@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowatlas.h
+// ============
+// render the shadow maps of the directional and point lights into one depth
+// atlas, caching the shadows of the objects that do not move
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderBlocks.h"
+#include "SceneGraph.h"
+#include "PrimitiveMeshes.h"
+#include "UniformCache.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  ShadowAtlas
+ *
+ *  This class holds one depth texture that every shadow map
+ *  is a tile of: a large tile for the directional light and
+ *  a tile for each cube face of each point light. The tiles
+ *  are rendered with only the static objects and kept, and
+ *  are rendered again only when a light or a static object
+ *  changes. When the scene has dynamic objects, a second
+ *  atlas gets a copy of the cached tiles with the dynamic
+ *  objects drawn over them, and only the tiles a dynamic
+ *  object touches, now or before it moved, are copied and
+ *  drawn again. The shader reads the tiles through the
+ *  ShadowBlock uniform block.
+ ***********************************************************/
+class ShadowAtlas
+{
+public:
+	// constructor
+	ShadowAtlas();
+	// destructor
+	~ShadowAtlas();
+
+	// create and free the atlas textures and buffers
+	void Create();
+	void Destroy();
+
+	// set the lights that cast shadows, as they are sent in the
+	// light block, with the active point lights first
+	void SetLights(const LIGHT_BLOCK& lights, int pointLightCount);
+	// a static object changed, so every cached tile is stale
+	void InvalidateStatic() { m_bStaticDirty = true; }
+	// a dynamic object moved, so its shadows must be drawn again
+	void InvalidateDynamic() { m_bDynamicDirty = true; }
+
+	// draw the tiles that are out of date and bind the atlas to
+	// its texture unit; returns true when anything was drawn,
+	// which leaves the view and projection uniforms changed
+	bool Update(
+		const SceneGraph& sceneGraph,
+		PrimitiveMeshes* pMeshes,
+		UniformCache* pUniformCache,
+		GLuint depthProgram);
+
+	// tiles drawn into the cached atlas and over it with the
+	// dynamic objects by the last update
+	int GetStaticTileCount() const { return(m_staticTileCount); }
+	int GetDynamicTileCount() const { return(m_dynamicTileCount); }
+
+private:
+	// one shadow map in the atlas
+	struct SHADOW_TILE
+	{
+		// position and size in the atlas, in texels
+		int x;
+		int y;
+		int size;
+		// the view of the light the tile is rendered with
+		glm::mat4 view;
+		glm::mat4 projection;
+		// whether the tile has a light casting into it
+		bool bActive;
+		// set when the cached tile must be rendered again
+		bool bStaticDirty;
+		// set when a dynamic object was drawn into the tile
+		bool bHasDynamic;
+	};
+
+	// a run of shadow casters of one mesh in the caster buffer
+	struct CASTER_RUN
+	{
+		int meshID;
+		int firstInstance;
+		int instanceCount;
+	};
+
+	// the directional tile comes first, then the point faces
+	static const int TILE_COUNT = 1 + TOTAL_POINT_LIGHTS * POINT_SHADOW_FACES;
+	SHADOW_TILE m_tiles[TILE_COUNT];
+
+	// the lights the tiles were set up for
+	bool m_bDirectionalActive;
+	glm::vec3 m_directionToLight;
+	int m_pointLightCount;
+	glm::vec3 m_pointPositions[TOTAL_POINT_LIGHTS];
+
+	// the cached atlas of the static objects, and the atlas the
+	// dynamic objects are drawn into, made once they are needed
+	GLuint m_staticTexture;
+	GLuint m_staticFramebuffer;
+	GLuint m_dynamicTexture;
+	GLuint m_dynamicFramebuffer;
+	// the atlas bound for the shader to read
+	GLuint m_boundTexture;
+	// the shadow casters, static runs first, and their buffer
+	std::vector<PrimitiveMeshes::INSTANCE_DATA> m_casters;
+	std::vector<CASTER_RUN> m_staticRuns;
+	std::vector<CASTER_RUN> m_dynamicRuns;
+	std::vector<int> m_dynamicNodes;
+	GLuint m_casterBuffer;
+	// the uniform buffer holding the shadow block
+	GLuint m_shadowBuffer;
+
+	// world bounds of the whole scene the tiles are fitted to
+	glm::vec3 m_sceneMinimum;
+	glm::vec3 m_sceneMaximum;
+
+	// set when the cache or the dynamic shadows are stale
+	bool m_bStaticDirty;
+	bool m_bDynamicDirty;
+	// set when the tile views changed since the last upload
+	bool m_bBlockDirty;
+	// tiles drawn by the last update
+	int m_staticTileCount;
+	int m_dynamicTileCount;
+
+	// make a depth texture the size of the atlas and its framebuffer
+	void CreateAtlas(GLuint& texture, GLuint& framebuffer);
+	// sort the nodes into the static and dynamic caster runs
+	void BuildCasters(const SceneGraph& sceneGraph);
+	// fit the views of the tiles to render again around the scene
+	void FitTileViews();
+	// send the atlas matrices and bounds of the tiles to the shader
+	void UploadShadowBlock();
+	// whether a dynamic object lies in the view of a tile
+	bool TouchesDynamic(const SceneGraph& sceneGraph, int tile) const;
+	// draw runs of casters into a tile of the bound atlas,
+	// clearing the tile first when asked to
+	void DrawTile(
+		int tile,
+		bool bClear,
+		const std::vector<CASTER_RUN>& runs,
+		PrimitiveMeshes* pMeshes,
+		UniformCache* pUniformCache);
+};
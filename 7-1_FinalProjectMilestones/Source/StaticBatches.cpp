@@ -0,0 +1,401 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatches.cpp
+// ============
+// merge the geometry of the objects that never move into large world space
+// buffers, so they can be drawn with a handful of draw calls
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticBatches.h"
+#include "ShaderProgramCache.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+
+// declaration of the global variables and defines
+namespace
+{
+	// nodes with more triangles than this are left to the render
+	// queue, where their level of detail can drop with distance
+	const int MAX_BAKED_NODE_TRIANGLES = 512;
+	// vertices in one chunk, kept low enough that the chunks
+	// are still worth culling one by one
+	const size_t MAX_CHUNK_VERTICES = 32768;
+
+	// a static node and the values it is sorted by
+	struct BAKE_ENTRY
+	{
+		int node;
+		int shaderVariant;
+		uint32_t mortonCode;
+	};
+
+	/***********************************************************
+	 *  SpreadBits()
+	 *
+	 *  Spread the low 10 bits of a value out to every third
+	 *  bit, so three of them can be interleaved into a Morton
+	 *  code that keeps nearby positions close in the order.
+	 ***********************************************************/
+	uint32_t SpreadBits(uint32_t value)
+	{
+		value &= 0x3FF;
+		value = (value | (value << 16)) & 0x030000FF;
+		value = (value | (value << 8)) & 0x0300F00F;
+		value = (value | (value << 4)) & 0x030C30C3;
+		value = (value | (value << 2)) & 0x09249249;
+		return(value);
+	}
+}
+
+/***********************************************************
+ *  StaticBatches()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticBatches::StaticBatches()
+{
+	m_modelBuffer = 0;
+	m_bakedNodeCount = 0;
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  ~StaticBatches()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StaticBatches::~StaticBatches()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for baking the static nodes into
+ *  chunks. The nodes are sorted by their shader variant
+ *  and then along a Morton curve through their centers, so
+ *  each chunk covers a compact part of the scene. The model
+ *  matrices must be up to date. Nodes that moved since an
+ *  earlier build are left out.
+ ***********************************************************/
+void StaticBatches::Build(const SceneGraph& sceneGraph, const PrimitiveMeshes& meshes)
+{
+	FreeChunks();
+
+	int nodeCount = sceneGraph.GetNodeCount();
+	m_bakedFlags.assign(nodeCount, 0);
+	m_movedFlags.resize(nodeCount, 0);
+	m_bakedNodeCount = 0;
+	m_bDirty = false;
+
+	const SceneGraph::WORLD_BOUNDS& bounds = sceneGraph.GetWorldBounds();
+	std::vector<BAKE_ENTRY> entries;
+	glm::vec3 sceneMinimum(FLT_MAX);
+	glm::vec3 sceneMaximum(-FLT_MAX);
+	for (int node = 0; node < nodeCount; node++)
+	{
+		if (CanBake(sceneGraph, meshes, node) == false)
+		{
+			continue;
+		}
+
+		BAKE_ENTRY entry;
+		entry.node = node;
+		entry.shaderVariant = (sceneGraph.GetTextureSlot(node) >= 0) ? ShaderProgramCache::FEATURE_TEXTURED : 0;
+		entry.mortonCode = 0;
+		entries.push_back(entry);
+
+		glm::vec3 center(bounds.centerX[node], bounds.centerY[node], bounds.centerZ[node]);
+		sceneMinimum = glm::min(sceneMinimum, center);
+		sceneMaximum = glm::max(sceneMaximum, center);
+	}
+	if (entries.empty())
+	{
+		return;
+	}
+
+	glm::vec3 sceneSize = glm::max(sceneMaximum - sceneMinimum, glm::vec3(1.0e-6f));
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		int node = entries[i].node;
+		uint32_t cellX = (uint32_t)((bounds.centerX[node] - sceneMinimum.x) / sceneSize.x * 1023.0f);
+		uint32_t cellY = (uint32_t)((bounds.centerY[node] - sceneMinimum.y) / sceneSize.y * 1023.0f);
+		uint32_t cellZ = (uint32_t)((bounds.centerZ[node] - sceneMinimum.z) / sceneSize.z * 1023.0f);
+		entries[i].mortonCode = SpreadBits(cellX) | (SpreadBits(cellY) << 1) | (SpreadBits(cellZ) << 2);
+	}
+
+	std::sort(entries.begin(), entries.end(),
+		[](const BAKE_ENTRY& a, const BAKE_ENTRY& b)
+		{
+			if (a.shaderVariant != b.shaderVariant)
+				return(a.shaderVariant < b.shaderVariant);
+			if (a.mortonCode != b.mortonCode)
+				return(a.mortonCode < b.mortonCode);
+			return(a.node < b.node);
+		});
+
+	// every chunk reads the same identity model matrix, since
+	// its vertices are already in world space
+	glm::mat4 identity(1.0f);
+	glGenBuffers(1, &m_modelBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_modelBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4), &identity[0][0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::vector<PrimitiveMeshes::MESH_VERTEX> vertices;
+	std::vector<GLuint> indices;
+	std::vector<GLint> vertexStates;
+	size_t first = 0;
+	while (first < entries.size())
+	{
+		vertices.clear();
+		indices.clear();
+		vertexStates.clear();
+
+		// append nodes of the same variant until the chunk is full
+		size_t last = first;
+		while ((last < entries.size()) && (entries[last].shaderVariant == entries[first].shaderVariant))
+		{
+			int node = entries[last].node;
+			const PrimitiveMeshes::MESH_DATA& mesh = meshes.GetMeshData(sceneGraph.GetMeshID(node));
+			if ((!vertices.empty()) && (vertices.size() + mesh.vertices.size() > MAX_CHUNK_VERTICES))
+			{
+				break;
+			}
+
+			// objects without a defined material use the first one
+			GLint materialIndex = std::max(sceneGraph.GetMaterialID(node), 0);
+			GLint textureLayer = sceneGraph.GetTextureSlot(node);
+
+			// the vertex shader passes the object normals on as they
+			// are, so they are kept as they are here too, and a node
+			// looks the same baked or drawn through the queue
+			const glm::mat4& model = sceneGraph.GetModelMatrix(node);
+			GLuint baseVertex = (GLuint)vertices.size();
+			for (size_t v = 0; v < mesh.vertices.size(); v++)
+			{
+				PrimitiveMeshes::MESH_VERTEX vertex = mesh.vertices[v];
+				glm::vec4 position = model * glm::vec4(vertex.position, 1.0f);
+				vertex.position = glm::vec3(position.x, position.y, position.z);
+				vertices.push_back(vertex);
+				vertexStates.push_back(materialIndex);
+				vertexStates.push_back(textureLayer);
+			}
+			for (size_t i = 0; i < mesh.indices.size(); i++)
+			{
+				indices.push_back(baseVertex + mesh.indices[i]);
+			}
+
+			m_bakedFlags[node] = 1;
+			last++;
+		}
+
+		STATIC_CHUNK chunk;
+		UploadChunk(vertices, indices, vertexStates, chunk);
+		chunk.shaderVariant = entries[first].shaderVariant;
+		glm::vec3 minimum;
+		glm::vec3 maximum;
+		PrimitiveMeshes::ComputeBounds(&vertices[0], (int)vertices.size(), minimum, maximum);
+		chunk.center = (minimum + maximum) * 0.5f;
+		chunk.extents = (maximum - minimum) * 0.5f;
+		chunk.radius = glm::length(chunk.extents);
+		chunk.nodeCount = (int)(last - first);
+		chunk.triangleCount = (int)indices.size() / 3;
+		m_chunks.push_back(chunk);
+
+		m_bakedNodeCount += chunk.nodeCount;
+		first = last;
+	}
+
+	// every chunk is drawn until the first test against a view
+	m_visibleChunks.assign(m_chunks.size(), 1);
+}
+
+/***********************************************************
+ *  UploadChunk()
+ *
+ *  This method is used for uploading the merged geometry of
+ *  a chunk with the vertex layout of the basic shapes, and
+ *  then pointing the material and texture attributes at
+ *  the per-vertex states instead of an instance, and the
+ *  model matrix at the shared identity one.
+ ***********************************************************/
+void StaticBatches::UploadChunk(
+	const std::vector<PrimitiveMeshes::MESH_VERTEX>& vertices,
+	const std::vector<GLuint>& indices,
+	const std::vector<GLint>& vertexStates,
+	STATIC_CHUNK& chunk)
+{
+	chunk.mesh.vao = 0;
+	chunk.mesh.vbo = 0;
+	chunk.mesh.ibo = 0;
+	chunk.mesh.indexCount = 0;
+	PrimitiveMeshes::UploadMesh(&vertices[0], (int)vertices.size(), &indices[0], (int)indices.size(), chunk.mesh);
+
+	glGenBuffers(1, &chunk.stateBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, chunk.stateBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexStates.size() * sizeof(GLint), &vertexStates[0], GL_STATIC_DRAW);
+
+	glBindVertexArray(chunk.mesh.vao);
+	glVertexAttribDivisor(PrimitiveMeshes::INSTANCE_MATERIAL_ATTRIBUTE, 0);
+	glVertexAttribIPointer(PrimitiveMeshes::INSTANCE_MATERIAL_ATTRIBUTE, 1, GL_INT, 2 * sizeof(GLint), (void*)0);
+	glVertexAttribDivisor(PrimitiveMeshes::INSTANCE_TEXTURE_ATTRIBUTE, 0);
+	glVertexAttribIPointer(PrimitiveMeshes::INSTANCE_TEXTURE_ATTRIBUTE, 1, GL_INT, 2 * sizeof(GLint), (void*)sizeof(GLint));
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_modelBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(
+			PrimitiveMeshes::INSTANCE_MODEL_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+			(void*)(column * sizeof(glm::vec4)));
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the chunks and forgetting
+ *  which nodes were baked and which moved.
+ ***********************************************************/
+void StaticBatches::Destroy()
+{
+	FreeChunks();
+	m_bakedFlags.clear();
+	m_movedFlags.clear();
+	m_bakedNodeCount = 0;
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  FreeChunks()
+ *
+ *  This method is used for freeing the OpenGL objects of
+ *  the chunks and the model matrix buffer.
+ ***********************************************************/
+void StaticBatches::FreeChunks()
+{
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		PrimitiveMeshes::FreeMesh(m_chunks[i].mesh);
+		glDeleteBuffers(1, &m_chunks[i].stateBuffer);
+	}
+	m_chunks.clear();
+	m_visibleChunks.clear();
+
+	if (m_modelBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_modelBuffer);
+		m_modelBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  CanBake()
+ *
+ *  This method is used for deciding whether a node can be
+ *  merged into a chunk. Dynamic nodes and nodes that moved
+ *  since the last build keep being drawn through the
+ *  queue, as do blended nodes, which must be sorted by
+ *  depth, and nodes with meshes too detailed to bake.
+ ***********************************************************/
+bool StaticBatches::CanBake(const SceneGraph& sceneGraph, const PrimitiveMeshes& meshes, int node) const
+{
+	if ((m_movedFlags[node] != 0) ||
+		(sceneGraph.IsDynamic(node) == true) ||
+		(sceneGraph.IsBlended(node) == true))
+	{
+		return(false);
+	}
+
+	int meshID = sceneGraph.GetMeshID(node);
+	if ((meshID < 0) || (meshID >= SceneGraph::MESH_COUNT))
+	{
+		return(false);
+	}
+
+	const PrimitiveMeshes::MESH_DATA& mesh = meshes.GetMeshData(meshID);
+	return((!mesh.indices.empty()) && ((int)mesh.indices.size() / 3 <= MAX_BAKED_NODE_TRIANGLES));
+}
+
+/***********************************************************
+ *  RemoveNodes()
+ *
+ *  This method is used for taking nodes that moved out of
+ *  the chunks for good. The chunks still hold them where
+ *  they were baked until they are built again, which must
+ *  happen before the next draw when this returns true.
+ ***********************************************************/
+bool StaticBatches::RemoveNodes(const std::vector<int>& nodes)
+{
+	bool bRemoved = false;
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		int node = nodes[i];
+		if (node >= (int)m_movedFlags.size())
+		{
+			continue;
+		}
+
+		m_movedFlags[node] = 1;
+		if (IsBaked(node) == true)
+		{
+			m_bakedFlags[node] = 0;
+			m_bakedNodeCount--;
+			bRemoved = true;
+		}
+	}
+
+	if (bRemoved == true)
+	{
+		m_bDirty = true;
+	}
+
+	return(bRemoved);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for testing the bounds of every
+ *  chunk against the view frustum.
+ ***********************************************************/
+int StaticBatches::Cull(const Frustum& frustum)
+{
+	int visibleCount = 0;
+
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		const STATIC_CHUNK& chunk = m_chunks[i];
+		bool bVisible = frustum.TestBounds(chunk.center, chunk.extents, chunk.radius);
+
+		m_visibleChunks[i] = bVisible ? 1 : 0;
+		if (bVisible == true)
+		{
+			visibleCount++;
+		}
+	}
+
+	return(visibleCount);
+}
+
+/***********************************************************
+ *  DrawChunk()
+ *
+ *  This method is used for drawing one chunk with the bound
+ *  shader program. Its layout already points at all of its
+ *  attributes, so nothing needs setting up first.
+ ***********************************************************/
+void StaticBatches::DrawChunk(int chunk) const
+{
+	const STATIC_CHUNK& staticChunk = m_chunks[chunk];
+
+	glBindVertexArray(staticChunk.mesh.vao);
+	glDrawElements(GL_TRIANGLES, staticChunk.mesh.indexCount, GL_UNSIGNED_INT, NULL);
+	glBindVertexArray(0);
+}
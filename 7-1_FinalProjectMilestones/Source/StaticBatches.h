@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatches.h
+// ============
+// merge the geometry of the objects that never move into large world space
+// buffers, so they can be drawn with a handful of draw calls
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneGraph.h"
+#include "PrimitiveMeshes.h"
+#include "Frustum.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  StaticBatches
+ *
+ *  This class bakes the static opaque scene nodes into a
+ *  few merged meshes. The vertices of every node are moved
+ *  into world space once, and the nodes sharing a shader
+ *  variant are appended into chunks in spatial order, each
+ *  drawn with a single call. The material and texture
+ *  layer the queue reads per instance are stored with
+ *  every vertex instead, so one chunk can hold any number
+ *  of them. The chunks are kept to a bounded size so they
+ *  can still be culled against the view. Nodes with many
+ *  triangles are left to the render queue, where their
+ *  level of detail can still drop, and nodes that move
+ *  after baking are taken out so they are drawn through
+ *  the queue instead.
+ ***********************************************************/
+class StaticBatches
+{
+public:
+	// constructor
+	StaticBatches();
+	// destructor
+	~StaticBatches();
+
+	// one merged mesh of nodes that share a shader variant
+	struct STATIC_CHUNK
+	{
+		PrimitiveMeshes::GL_MESH mesh;
+		// material and texture layer of every vertex
+		GLuint stateBuffer;
+		int shaderVariant;
+		// world bounds of the merged vertices
+		glm::vec3 center;
+		glm::vec3 extents;
+		float radius;
+		int nodeCount;
+		int triangleCount;
+	};
+
+	// merge the static nodes of the scene into chunks, in place
+	// of any already built
+	void Build(const SceneGraph& sceneGraph, const PrimitiveMeshes& meshes);
+	// free the chunks, leaving every node to the render queue
+	void Destroy();
+
+	// take the nodes that moved out of the chunks; returns true
+	// when any of them were baked, so the chunks must be built again
+	bool RemoveNodes(const std::vector<int>& nodes);
+	bool IsDirty() const { return(m_bDirty); }
+
+	// whether a node is drawn as part of a chunk
+	bool IsBaked(int node) const { return((node < (int)m_bakedFlags.size()) && (m_bakedFlags[node] != 0)); }
+	int GetBakedNodeCount() const { return(m_bakedNodeCount); }
+
+	// test the chunks against the view frustum and return the
+	// number that may be visible
+	int Cull(const Frustum& frustum);
+
+	// accessors for the chunks and the result of the last test
+	int GetChunkCount() const { return((int)m_chunks.size()); }
+	const STATIC_CHUNK& GetChunk(int chunk) const { return(m_chunks[chunk]); }
+	bool IsChunkVisible(int chunk) const { return(m_visibleChunks[chunk] != 0); }
+	// draw one chunk with the bound shader program
+	void DrawChunk(int chunk) const;
+
+private:
+	// the merged meshes and the result of the last culling
+	std::vector<STATIC_CHUNK> m_chunks;
+	std::vector<unsigned char> m_visibleChunks;
+	// the one identity model matrix every chunk is drawn with
+	GLuint m_modelBuffer;
+
+	// per-node flags of the nodes in a chunk, and of the nodes
+	// that moved since baking and are kept out of the chunks
+	std::vector<unsigned char> m_bakedFlags;
+	std::vector<unsigned char> m_movedFlags;
+	int m_bakedNodeCount;
+	// set when baked nodes moved since the chunks were built
+	bool m_bDirty;
+
+	// free the OpenGL objects of the chunks
+	void FreeChunks();
+	// upload the merged geometry of a chunk and set up its layout
+	void UploadChunk(
+		const std::vector<PrimitiveMeshes::MESH_VERTEX>& vertices,
+		const std::vector<GLuint>& indices,
+		const std::vector<GLint>& vertexStates,
+		STATIC_CHUNK& chunk);
+	// whether a node can be merged into a chunk
+	bool CanBake(const SceneGraph& sceneGraph, const PrimitiveMeshes& meshes, int node) const;
+};
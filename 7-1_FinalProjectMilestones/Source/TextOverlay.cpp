@@ -0,0 +1,435 @@
+///////////////////////////////////////////////////////////////////////////////
+// textoverlay.cpp
+// ============
+// draw lines of text over the rendered frame with a small built-in font
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextOverlay.h"
+
+#include <cctype>
+#include <cstddef>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the font covers the printable ASCII characters, and the
+	// last cell is filled in completely for drawing boxes
+	const int FIRST_GLYPH = 32;
+	const int GLYPH_COUNT = 96;
+	const int SOLID_GLYPH = 127;
+	// texels of a font cell, including a blank column and row
+	const int CELL_WIDTH = 6;
+	const int CELL_HEIGHT = 8;
+	// screen pixels per font texel
+	const float TEXT_SCALE = 2.0f;
+
+	// one character of the font, the five low bits of each row
+	// are its pixels with the leftmost one in the highest bit
+	struct FONT_GLYPH
+	{
+		char character;
+		unsigned char rows[7];
+	};
+
+	// the characters in the font, lower case letters are drawn
+	// with the upper case ones and the others are left blank
+	const FONT_GLYPH g_FontGlyphs[] =
+	{
+		{ '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+		{ '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+		{ '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+		{ '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+		{ '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+		{ '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+		{ '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+		{ '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+		{ '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+		{ '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+		{ 'A', { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } },
+		{ 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+		{ 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+		{ 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+		{ 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+		{ 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+		{ 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+		{ 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+		{ 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+		{ 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+		{ 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+		{ 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+		{ 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+		{ 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+		{ 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+		{ 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+		{ 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+		{ 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+		{ 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+		{ 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+		{ 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+		{ 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+		{ 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+		{ 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+		{ 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+		{ 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+		{ '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+		{ ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+		{ ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+		{ '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+		{ '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+		{ '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+		{ '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } },
+		{ '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+		{ '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+		{ '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+		{ ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+		{ '[', { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E } },
+		{ ']', { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E } },
+		{ '<', { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 } },
+		{ '>', { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 } }
+	};
+
+	const char* const g_TextVertexShader =
+		"#version 330 core\n"
+		"layout (location = 0) in vec2 inVertexPosition;\n"
+		"layout (location = 1) in vec2 inTextureCoordinate;\n"
+		"layout (location = 2) in vec4 inColor;\n"
+		"uniform vec2 screenSize;\n"
+		"out vec2 fragmentTextureCoordinate;\n"
+		"out vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"    vec2 clip = inVertexPosition / screenSize * 2.0 - 1.0;\n"
+		"    gl_Position = vec4(clip.x, -clip.y, 0.0, 1.0);\n"
+		"    fragmentTextureCoordinate = inTextureCoordinate;\n"
+		"    fragmentColor = inColor;\n"
+		"}\n";
+
+	const char* const g_TextFragmentShader =
+		"#version 330 core\n"
+		"in vec2 fragmentTextureCoordinate;\n"
+		"in vec4 fragmentColor;\n"
+		"uniform sampler2D fontTexture;\n"
+		"out vec4 outFragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"    float coverage = texture(fontTexture, fragmentTextureCoordinate).r;\n"
+		"    outFragmentColor = vec4(fragmentColor.rgb, fragmentColor.a * coverage);\n"
+		"}\n";
+
+	/***********************************************************
+	 *  CompileShader()
+	 *
+	 *  Compiles one stage of the overlay shader program and
+	 *  returns 0 when it fails.
+	 ***********************************************************/
+	GLuint CompileShader(GLenum type, const char* source)
+	{
+		GLuint shaderID = glCreateShader(type);
+		glShaderSource(shaderID, 1, &source, NULL);
+		glCompileShader(shaderID);
+
+		GLint success = 0;
+		glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+		if (success == 0)
+		{
+			char infoLog[512];
+			glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+			std::cout << "Text overlay shader failed to compile\n" << infoLog << std::endl;
+			glDeleteShader(shaderID);
+			return(0);
+		}
+
+		return(shaderID);
+	}
+}
+
+/***********************************************************
+ *  TextOverlay()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextOverlay::TextOverlay()
+{
+	m_programID = 0;
+	m_vao = 0;
+	m_vbo = 0;
+	m_fontTexture = 0;
+	m_screenSizeLocation = -1;
+	m_fontLocation = -1;
+}
+
+/***********************************************************
+ *  ~TextOverlay()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextOverlay::~TextOverlay()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for building the font texture from
+ *  the font table, compiling the overlay shader program and
+ *  creating the vertex buffer. It returns false when the
+ *  shaders do not compile.
+ ***********************************************************/
+bool TextOverlay::Create()
+{
+	Destroy();
+
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, g_TextVertexShader);
+	GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, g_TextFragmentShader);
+	if ((vertexShader == 0) || (fragmentShader == 0))
+	{
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return(false);
+	}
+
+	m_programID = glCreateProgram();
+	glAttachShader(m_programID, vertexShader);
+	glAttachShader(m_programID, fragmentShader);
+	glLinkProgram(m_programID);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint success = 0;
+	glGetProgramiv(m_programID, GL_LINK_STATUS, &success);
+	if (success == 0)
+	{
+		std::cout << "Text overlay shader failed to link" << std::endl;
+		Destroy();
+		return(false);
+	}
+	m_screenSizeLocation = glGetUniformLocation(m_programID, "screenSize");
+	m_fontLocation = glGetUniformLocation(m_programID, "fontTexture");
+
+	// lay the characters out in a single row of cells
+	int textureWidth = GLYPH_COUNT * CELL_WIDTH;
+	std::vector<unsigned char> texels(textureWidth * CELL_HEIGHT, 0);
+	for (int i = 0; i < (int)(sizeof(g_FontGlyphs) / sizeof(g_FontGlyphs[0])); i++)
+	{
+		int cellX = (g_FontGlyphs[i].character - FIRST_GLYPH) * CELL_WIDTH;
+		for (int row = 0; row < 7; row++)
+		{
+			for (int column = 0; column < 5; column++)
+			{
+				if (g_FontGlyphs[i].rows[row] & (0x10 >> column))
+				{
+					texels[row * textureWidth + cellX + column] = 255;
+				}
+			}
+		}
+	}
+	int solidX = (SOLID_GLYPH - FIRST_GLYPH) * CELL_WIDTH;
+	for (int row = 0; row < CELL_HEIGHT; row++)
+	{
+		for (int column = 0; column < CELL_WIDTH; column++)
+		{
+			texels[row * textureWidth + solidX + column] = 255;
+		}
+	}
+
+	// keep the texture bound to the first unit for the scene
+	GLint previousTexture = 0;
+	glActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+
+	glGenTextures(1, &m_fontTexture);
+	glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, textureWidth, CELL_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+
+	glGenVertexArrays(1, &m_vao);
+	glGenBuffers(1, &m_vbo);
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TEXT_VERTEX), (void*)offsetof(TEXT_VERTEX, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TEXT_VERTEX), (void*)offsetof(TEXT_VERTEX, textureCoordinate));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(TEXT_VERTEX), (void*)offsetof(TEXT_VERTEX, color));
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the OpenGL objects.
+ ***********************************************************/
+void TextOverlay::Destroy()
+{
+	if (m_vbo != 0)
+	{
+		glDeleteBuffers(1, &m_vbo);
+		m_vbo = 0;
+	}
+	if (m_vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+	}
+	if (m_fontTexture != 0)
+	{
+		glDeleteTextures(1, &m_fontTexture);
+		m_fontTexture = 0;
+	}
+	if (m_programID != 0)
+	{
+		glDeleteProgram(m_programID);
+		m_programID = 0;
+	}
+	m_vertices.clear();
+}
+
+/***********************************************************
+ *  GetCharacterWidth()
+ *
+ *  This method is used for getting the advance of one
+ *  character in screen pixels.
+ ***********************************************************/
+float TextOverlay::GetCharacterWidth() const
+{
+	return(CELL_WIDTH * TEXT_SCALE);
+}
+
+/***********************************************************
+ *  GetLineHeight()
+ *
+ *  This method is used for getting the height of one line
+ *  of text in screen pixels.
+ ***********************************************************/
+float TextOverlay::GetLineHeight() const
+{
+	return((CELL_HEIGHT + 2) * TEXT_SCALE);
+}
+
+/***********************************************************
+ *  AddGlyph()
+ *
+ *  This method is used for queueing the two triangles that
+ *  draw one font cell.
+ ***********************************************************/
+void TextOverlay::AddGlyph(float x, float y, float width, float height, int glyph, const glm::vec4& color)
+{
+	// sample the middle of the solid cell so boxes have no edges
+	float u0 = (float)(glyph - FIRST_GLYPH) / GLYPH_COUNT;
+	float u1 = (float)(glyph - FIRST_GLYPH + 1) / GLYPH_COUNT;
+	float v0 = 0.0f;
+	float v1 = 1.0f;
+	if (glyph == SOLID_GLYPH)
+	{
+		u0 = u1 = (glyph - FIRST_GLYPH + 0.5f) / GLYPH_COUNT;
+		v0 = v1 = 0.5f;
+	}
+
+	TEXT_VERTEX corners[4] =
+	{
+		{ glm::vec2(x, y), glm::vec2(u0, v0), color },
+		{ glm::vec2(x + width, y), glm::vec2(u1, v0), color },
+		{ glm::vec2(x + width, y + height), glm::vec2(u1, v1), color },
+		{ glm::vec2(x, y + height), glm::vec2(u0, v1), color }
+	};
+	m_vertices.push_back(corners[0]);
+	m_vertices.push_back(corners[1]);
+	m_vertices.push_back(corners[2]);
+	m_vertices.push_back(corners[0]);
+	m_vertices.push_back(corners[2]);
+	m_vertices.push_back(corners[3]);
+}
+
+/***********************************************************
+ *  AddText()
+ *
+ *  This method is used for queueing a line of text. Lower
+ *  case letters are drawn in upper case.
+ ***********************************************************/
+void TextOverlay::AddText(float x, float y, const std::string& text, const glm::vec4& color)
+{
+	float cellWidth = CELL_WIDTH * TEXT_SCALE;
+	float cellHeight = CELL_HEIGHT * TEXT_SCALE;
+	for (int i = 0; i < (int)text.size(); i++)
+	{
+		int glyph = toupper((unsigned char)text[i]);
+		if ((glyph > FIRST_GLYPH) && (glyph < SOLID_GLYPH))
+		{
+			AddGlyph(x + i * cellWidth, y, cellWidth, cellHeight, glyph, color);
+		}
+	}
+}
+
+/***********************************************************
+ *  AddBox()
+ *
+ *  This method is used for queueing a filled rectangle,
+ *  usually a translucent panel behind the text.
+ ***********************************************************/
+void TextOverlay::AddBox(float x, float y, float width, float height, const glm::vec4& color)
+{
+	AddGlyph(x, y, width, height, SOLID_GLYPH, color);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing everything queued since
+ *  the last draw over the frame. The shader program, the
+ *  texture of the first unit and the depth test of the
+ *  scene are put back afterwards.
+ ***********************************************************/
+void TextOverlay::Draw(int screenWidth, int screenHeight)
+{
+	if ((m_programID == 0) || m_vertices.empty())
+	{
+		m_vertices.clear();
+		return;
+	}
+
+	GLint previousProgram = 0;
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	GLboolean bDepthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean bBlend = glIsEnabled(GL_BLEND);
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glUseProgram(m_programID);
+	glUniform2f(m_screenSizeLocation, (float)screenWidth, (float)screenHeight);
+	glUniform1i(m_fontLocation, 0);
+	glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(TEXT_VERTEX), m_vertices.data(), GL_STREAM_DRAW);
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)m_vertices.size());
+	glBindVertexArray(0);
+	m_vertices.clear();
+
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+	glUseProgram((GLuint)previousProgram);
+	if (bDepthTest == GL_TRUE)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	if (bBlend == GL_FALSE)
+	{
+		glDisable(GL_BLEND);
+	}
+}
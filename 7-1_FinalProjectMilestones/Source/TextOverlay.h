@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// textoverlay.h
+// ============
+// draw lines of text over the rendered frame with a small built-in font
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextOverlay
+ *
+ *  This class draws text in screen pixels on top of the
+ *  frame, for debugging displays such as the profiler
+ *  summary. The font is a 5x7 pixel font built into the
+ *  code, so it needs no files, and it has its own small
+ *  shader program so the scene shaders stay untouched.
+ ***********************************************************/
+class TextOverlay
+{
+public:
+	// constructor
+	TextOverlay();
+	// destructor
+	~TextOverlay();
+
+	// create and free the font texture, shader and buffers
+	bool Create();
+	void Destroy();
+
+	// queue a line of text with its top left corner in pixels
+	void AddText(float x, float y, const std::string& text, const glm::vec4& color);
+	// queue a filled box behind the text
+	void AddBox(float x, float y, float width, float height, const glm::vec4& color);
+	// draw everything queued since the last draw
+	void Draw(int screenWidth, int screenHeight);
+
+	// pixel size of one character cell at the overlay scale
+	float GetCharacterWidth() const;
+	float GetLineHeight() const;
+
+private:
+	// one vertex of a character quad
+	struct TEXT_VERTEX
+	{
+		glm::vec2 position;
+		glm::vec2 textureCoordinate;
+		glm::vec4 color;
+	};
+
+	GLuint m_programID;
+	GLuint m_vao;
+	GLuint m_vbo;
+	GLuint m_fontTexture;
+	GLint m_screenSizeLocation;
+	GLint m_fontLocation;
+	// vertices queued for the next draw
+	std::vector<TEXT_VERTEX> m_vertices;
+
+	// queue the quad of one font cell
+	void AddGlyph(float x, float y, float width, float height, int glyph, const glm::vec4& color);
+};
@@ -0,0 +1,580 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecooker.cpp
+// ============
+// convert texture images offline into block compressed mip chains that are
+// uploaded without decoding, and the layout of the cooked texture files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCooker.h"
+
+#include <GL/glew.h>
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// bytes in one compressed 4x4 block of each format
+	const int BC1_BLOCK_BYTES = 8;
+	const int BC3_BLOCK_BYTES = 16;
+
+	/***********************************************************
+	 *  PackColor565()
+	 *
+	 *  Rounds an 8 bit per channel color to 5:6:5 bits.
+	 ***********************************************************/
+	uint16_t PackColor565(const float* color)
+	{
+		int red = (int)(std::min(255.0f, std::max(0.0f, color[0])) * 31.0f / 255.0f + 0.5f);
+		int green = (int)(std::min(255.0f, std::max(0.0f, color[1])) * 63.0f / 255.0f + 0.5f);
+		int blue = (int)(std::min(255.0f, std::max(0.0f, color[2])) * 31.0f / 255.0f + 0.5f);
+		return((uint16_t)((red << 11) | (green << 5) | blue));
+	}
+
+	/***********************************************************
+	 *  UnpackColor565()
+	 *
+	 *  Expands a 5:6:5 color back to 8 bits per channel the
+	 *  way the GPU does.
+	 ***********************************************************/
+	void UnpackColor565(uint16_t packed, int* color)
+	{
+		int red = (packed >> 11) & 31;
+		int green = (packed >> 5) & 63;
+		int blue = packed & 31;
+		color[0] = (red << 3) | (red >> 2);
+		color[1] = (green << 2) | (green >> 4);
+		color[2] = (blue << 3) | (blue >> 2);
+	}
+
+	/***********************************************************
+	 *  CompressColorBlock()
+	 *
+	 *  Writes the 8 byte color part of a block. The two end
+	 *  colors are the pixels furthest apart along the main
+	 *  axis of the block colors, found by power iteration on
+	 *  their covariance, and each pixel takes the nearest of
+	 *  the four colors between them.
+	 ***********************************************************/
+	void CompressColorBlock(const unsigned char* block, unsigned char* output)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				mean[c] += block[i * 4 + c] / 16.0f;
+			}
+		}
+
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float r = block[i * 4 + 0] - mean[0];
+			float g = block[i * 4 + 1] - mean[1];
+			float b = block[i * 4 + 2] - mean[2];
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+			float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+			float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+			float length = std::max(std::max(fabsf(x), fabsf(y)), fabsf(z));
+			if (length <= 0.0f)
+			{
+				break;
+			}
+			axis[0] = x / length;
+			axis[1] = y / length;
+			axis[2] = z / length;
+		}
+
+		int minimumPixel = 0;
+		int maximumPixel = 0;
+		float minimumProjection = 0.0f;
+		float maximumProjection = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float projection =
+				block[i * 4 + 0] * axis[0] +
+				block[i * 4 + 1] * axis[1] +
+				block[i * 4 + 2] * axis[2];
+			if ((i == 0) || (projection < minimumProjection))
+			{
+				minimumProjection = projection;
+				minimumPixel = i;
+			}
+			if ((i == 0) || (projection > maximumProjection))
+			{
+				maximumProjection = projection;
+				maximumPixel = i;
+			}
+		}
+
+		float endColors[2][3];
+		for (int c = 0; c < 3; c++)
+		{
+			endColors[0][c] = block[maximumPixel * 4 + c];
+			endColors[1][c] = block[minimumPixel * 4 + c];
+		}
+		uint16_t color0 = PackColor565(endColors[0]);
+		uint16_t color1 = PackColor565(endColors[1]);
+		// the larger value first selects the four color mode
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			int palette[4][3];
+			UnpackColor565(color0, palette[0]);
+			UnpackColor565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = 0;
+				for (int p = 0; p < 4; p++)
+				{
+					int distance = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						int difference = block[i * 4 + c] - palette[p][c];
+						distance += difference * difference;
+					}
+					if ((p == 0) || (distance < bestDistance))
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint32_t)bestIndex << (i * 2);
+			}
+		}
+
+		output[0] = (unsigned char)(color0 & 0xFF);
+		output[1] = (unsigned char)(color0 >> 8);
+		output[2] = (unsigned char)(color1 & 0xFF);
+		output[3] = (unsigned char)(color1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			output[4 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+		}
+	}
+
+	/***********************************************************
+	 *  CompressAlphaBlock()
+	 *
+	 *  Writes the 8 byte alpha part of a BC3 block, with the
+	 *  largest and smallest alpha as the end values and the
+	 *  six values between them.
+	 ***********************************************************/
+	void CompressAlphaBlock(const unsigned char* block, unsigned char* output)
+	{
+		int alpha0 = 0;
+		int alpha1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			alpha0 = std::max(alpha0, (int)block[i * 4 + 3]);
+			alpha1 = std::min(alpha1, (int)block[i * 4 + 3]);
+		}
+
+		uint64_t indices = 0;
+		if (alpha0 != alpha1)
+		{
+			int palette[8];
+			palette[0] = alpha0;
+			palette[1] = alpha1;
+			for (int p = 1; p < 7; p++)
+			{
+				palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = 256;
+				for (int p = 0; p < 8; p++)
+				{
+					int distance = abs(block[i * 4 + 3] - palette[p]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint64_t)bestIndex << (i * 3);
+			}
+		}
+
+		output[0] = (unsigned char)alpha0;
+		output[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; i++)
+		{
+			output[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+		}
+	}
+
+	/***********************************************************
+	 *  CookTexture()
+	 *
+	 *  Cooks one image file and adds its sizes to the totals.
+	 ***********************************************************/
+	bool CookTexture(
+		const std::string& imagePath,
+		size_t& totalUncompressed,
+		size_t& totalCooked)
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		unsigned char* image = stbi_load(imagePath.c_str(), &width, &height, &channels, 4);
+		if (NULL == image)
+		{
+			std::cout << "Could not load image:" << imagePath << std::endl;
+			return(false);
+		}
+
+		std::vector<unsigned char> level(image, image + (size_t)width * height * 4);
+		stbi_image_free(image);
+
+		// the alpha is only kept when some of it is not opaque
+		bool bAlpha = false;
+		for (size_t i = 3; (i < level.size()) && (bAlpha == false); i += 4)
+		{
+			bAlpha = (level[i] != 255);
+		}
+
+		COOKED_TEXTURE_HEADER header;
+		memcpy(header.identifier, COOKED_TEXTURE_IDENTIFIER, sizeof(header.identifier));
+		header.version = COOKED_TEXTURE_VERSION;
+		header.glInternalFormat = bAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		header.width = (uint32_t)width;
+		header.height = (uint32_t)height;
+		header.levelCount = 1;
+		header.sourceChannels = (uint32_t)channels;
+		for (int size = std::max(width, height); size > 1; size /= 2)
+		{
+			header.levelCount++;
+		}
+
+		// compress every level of the mip chain
+		std::vector<COOKED_TEXTURE_LEVEL> levelIndex(header.levelCount);
+		std::vector<std::vector<unsigned char> > levelBlocks(header.levelCount);
+		std::vector<unsigned char> nextLevel;
+		uint64_t offset = sizeof(COOKED_TEXTURE_HEADER) + header.levelCount * sizeof(COOKED_TEXTURE_LEVEL);
+		int levelWidth = width;
+		int levelHeight = height;
+		size_t uncompressedSize = 0;
+		for (uint32_t i = 0; i < header.levelCount; i++)
+		{
+			CompressBlocks(level.data(), levelWidth, levelHeight, bAlpha, levelBlocks[i]);
+			uncompressedSize += (size_t)levelWidth * levelHeight * 4;
+
+			offset = (offset + COOKED_LEVEL_ALIGNMENT - 1) / COOKED_LEVEL_ALIGNMENT * COOKED_LEVEL_ALIGNMENT;
+			levelIndex[i].byteOffset = offset;
+			levelIndex[i].byteLength = levelBlocks[i].size();
+			offset += levelBlocks[i].size();
+
+			if (i + 1 < header.levelCount)
+			{
+				DownsampleLevel(level, levelWidth, levelHeight, nextLevel);
+				level.swap(nextLevel);
+				levelWidth = std::max(1, levelWidth / 2);
+				levelHeight = std::max(1, levelHeight / 2);
+			}
+		}
+
+		std::string cookedPath = GetCookedTexturePath(imagePath);
+		std::ofstream file(cookedPath.c_str(), std::ios::binary);
+		if (!file)
+		{
+			std::cout << "Could not write cooked texture " << cookedPath << std::endl;
+			return(false);
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)levelIndex.data(), levelIndex.size() * sizeof(COOKED_TEXTURE_LEVEL));
+		for (uint32_t i = 0; i < header.levelCount; i++)
+		{
+			static const char padding[COOKED_LEVEL_ALIGNMENT] = { 0 };
+			file.write(padding, (std::streamsize)(levelIndex[i].byteOffset - (uint64_t)file.tellp()));
+			file.write((const char*)levelBlocks[i].data(), levelBlocks[i].size());
+		}
+		if (!file)
+		{
+			std::cout << "Could not write cooked texture " << cookedPath << std::endl;
+			return(false);
+		}
+
+		std::cout << "INFO: Cooked " << imagePath << " - " << width << "x" << height << ", "
+			<< header.levelCount << " levels, " << (bAlpha ? "BC3" : "BC1") << ", "
+			<< uncompressedSize / 1024 << " KB uncompressed, "
+			<< offset / 1024 << " KB cooked" << std::endl;
+
+		totalUncompressed += uncompressedSize;
+		totalCooked += (size_t)offset;
+
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  GetCookedTexturePath()
+ *
+ *  Returns the path of an image with its extension replaced
+ *  by the cooked texture extension.
+ ***********************************************************/
+std::string GetCookedTexturePath(const std::string& imagePath)
+{
+	size_t extension = imagePath.find_last_of('.');
+	size_t directory = imagePath.find_last_of("/\\");
+	if ((extension == std::string::npos) ||
+		((directory != std::string::npos) && (extension < directory)))
+	{
+		return(imagePath + COOKED_TEXTURE_EXTENSION);
+	}
+
+	return(imagePath.substr(0, extension) + COOKED_TEXTURE_EXTENSION);
+}
+
+/***********************************************************
+ *  CompressBlocks()
+ *
+ *  Compresses a level of RGBA pixels block by block, in
+ *  rows of blocks from the first row of pixels.
+ ***********************************************************/
+void CompressBlocks(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	bool bAlpha,
+	std::vector<unsigned char>& blocks)
+{
+	int blocksWide = (width + 3) / 4;
+	int blocksHigh = (height + 3) / 4;
+	int blockBytes = bAlpha ? BC3_BLOCK_BYTES : BC1_BLOCK_BYTES;
+	blocks.resize((size_t)blocksWide * blocksHigh * blockBytes);
+
+	unsigned char block[16 * 4];
+	unsigned char* output = blocks.data();
+	for (int blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksWide; blockX++)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				int pixelY = std::min(blockY * 4 + y, height - 1);
+				for (int x = 0; x < 4; x++)
+				{
+					int pixelX = std::min(blockX * 4 + x, width - 1);
+					memcpy(&block[(y * 4 + x) * 4], &pixels[((size_t)pixelY * width + pixelX) * 4], 4);
+				}
+			}
+
+			if (bAlpha == true)
+			{
+				CompressAlphaBlock(block, output);
+				CompressColorBlock(block, output + 8);
+			}
+			else
+			{
+				CompressColorBlock(block, output);
+			}
+			output += blockBytes;
+		}
+	}
+}
+
+/***********************************************************
+ *  DownsampleLevel()
+ *
+ *  Builds the next smaller mip level by averaging each
+ *  2x2 group of pixels, repeating the last row or column
+ *  of levels with an odd size.
+ ***********************************************************/
+void DownsampleLevel(
+	const std::vector<unsigned char>& source,
+	int width,
+	int height,
+	std::vector<unsigned char>& destination)
+{
+	int nextWidth = std::max(1, width / 2);
+	int nextHeight = std::max(1, height / 2);
+	destination.resize((size_t)nextWidth * nextHeight * 4);
+
+	for (int y = 0; y < nextHeight; y++)
+	{
+		int y0 = std::min(y * 2, height - 1);
+		int y1 = std::min(y * 2 + 1, height - 1);
+		for (int x = 0; x < nextWidth; x++)
+		{
+			int x0 = std::min(x * 2, width - 1);
+			int x1 = std::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < 4; c++)
+			{
+				int sum =
+					source[((size_t)y0 * width + x0) * 4 + c] +
+					source[((size_t)y0 * width + x1) * 4 + c] +
+					source[((size_t)y1 * width + x0) * 4 + c] +
+					source[((size_t)y1 * width + x1) * 4 + c];
+				destination[((size_t)y * nextWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  DecompressBlocks()
+ *
+ *  Expands a level of BC1 or BC3 blocks back into RGBA
+ *  pixels, the way the GPU decodes them.
+ ***********************************************************/
+void DecompressBlocks(
+	const unsigned char* blocks,
+	int width,
+	int height,
+	bool bAlpha,
+	std::vector<unsigned char>& pixels)
+{
+	int blocksWide = (width + 3) / 4;
+	int blocksHigh = (height + 3) / 4;
+	int blockBytes = bAlpha ? BC3_BLOCK_BYTES : BC1_BLOCK_BYTES;
+	pixels.resize((size_t)width * height * 4);
+
+	const unsigned char* input = blocks;
+	for (int blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksWide; blockX++)
+		{
+			int alphaPalette[8];
+			uint64_t alphaIndices = 0;
+			if (bAlpha == true)
+			{
+				alphaPalette[0] = input[0];
+				alphaPalette[1] = input[1];
+				for (int i = 0; i < 6; i++)
+				{
+					alphaPalette[2 + i] = (alphaPalette[0] > alphaPalette[1]) ?
+						((6 - i) * alphaPalette[0] + (1 + i) * alphaPalette[1]) / 7 :
+						((i < 4) ? ((4 - i) * alphaPalette[0] + (1 + i) * alphaPalette[1]) / 5 : ((i == 4) ? 0 : 255));
+				}
+				for (int i = 0; i < 6; i++)
+				{
+					alphaIndices |= (uint64_t)input[2 + i] << (i * 8);
+				}
+			}
+
+			const unsigned char* color = input + (bAlpha ? 8 : 0);
+			uint16_t color0 = (uint16_t)(color[0] | (color[1] << 8));
+			uint16_t color1 = (uint16_t)(color[2] | (color[3] << 8));
+			int palette[4][4];
+			UnpackColor565(color0, palette[0]);
+			UnpackColor565(color1, palette[1]);
+			palette[0][3] = 255;
+			palette[1][3] = 255;
+			palette[2][3] = 255;
+			palette[3][3] = 255;
+			for (int c = 0; c < 3; c++)
+			{
+				// BC3 colors always use the four color mode
+				if ((color0 > color1) || (bAlpha == true))
+				{
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+				else
+				{
+					palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+					palette[3][c] = 0;
+				}
+			}
+			if ((color0 <= color1) && (bAlpha == false))
+			{
+				palette[3][3] = 0;
+			}
+			uint32_t indices = (uint32_t)(color[4] | (color[5] << 8) | (color[6] << 16) | ((uint32_t)color[7] << 24));
+
+			for (int y = 0; y < 4; y++)
+			{
+				int pixelY = blockY * 4 + y;
+				for (int x = 0; (x < 4) && (pixelY < height); x++)
+				{
+					int pixelX = blockX * 4 + x;
+					if (pixelX >= width)
+					{
+						continue;
+					}
+					int i = y * 4 + x;
+					unsigned char* pixel = &pixels[((size_t)pixelY * width + pixelX) * 4];
+					const int* entry = palette[(indices >> (i * 2)) & 3];
+					pixel[0] = (unsigned char)entry[0];
+					pixel[1] = (unsigned char)entry[1];
+					pixel[2] = (unsigned char)entry[2];
+					pixel[3] = (unsigned char)((bAlpha == true) ? alphaPalette[(alphaIndices >> (i * 3)) & 7] : entry[3]);
+				}
+			}
+			input += blockBytes;
+		}
+	}
+}
+
+/***********************************************************
+ *  RunTextureCooker()
+ *
+ *  Cooks each image into a file next to it, holding the
+ *  whole mip chain in BC1, or BC3 for images with alpha,
+ *  and reports the video memory the cooked textures save
+ *  over the uncompressed ones.
+ ***********************************************************/
+bool RunTextureCooker(const std::vector<std::string>& imagePaths)
+{
+	// the cooked levels are stored bottom row first, as
+	// OpenGL expects, the same as the loaded images
+	stbi_set_flip_vertically_on_load(true);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t totalUncompressed = 0;
+	size_t totalCooked = 0;
+	bool bSuccess = true;
+	for (int i = 0; i < (int)imagePaths.size(); i++)
+	{
+		if (CookTexture(imagePaths[i], totalUncompressed, totalCooked) == false)
+		{
+			bSuccess = false;
+		}
+	}
+	std::chrono::duration<double> cookTime = std::chrono::steady_clock::now() - start;
+
+	if (totalCooked > 0)
+	{
+		std::cout << "INFO: Cooked " << imagePaths.size() << " textures in " << cookTime.count() << " s, "
+			<< totalUncompressed / (1024.0 * 1024.0) << " MB uncompressed with mips, "
+			<< totalCooked / (1024.0 * 1024.0) << " MB cooked ("
+			<< (double)totalUncompressed / totalCooked << "x smaller)" << std::endl;
+	}
+
+	return(bSuccess);
+}
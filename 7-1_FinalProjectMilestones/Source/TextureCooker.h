@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecooker.h
+// ============
+// convert texture images offline into block compressed mip chains that are
+// uploaded without decoding, and the layout of the cooked texture files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// file name extension of the cooked textures, which are written
+// next to the image they were cooked from
+const char* const COOKED_TEXTURE_EXTENSION = ".ctex";
+// first bytes of every cooked texture file
+const char COOKED_TEXTURE_IDENTIFIER[8] = { 'C', 'T', 'E', 'X', ' ', '1', '\r', '\n' };
+const uint32_t COOKED_TEXTURE_VERSION = 1;
+// the level data starts on this alignment within the file
+const uint32_t COOKED_LEVEL_ALIGNMENT = 16;
+
+// the start of a cooked texture file, laid out like a KTX2
+// header with an OpenGL format instead of a Vulkan one; the
+// level index follows, largest level first
+struct COOKED_TEXTURE_HEADER
+{
+	char identifier[8];
+	uint32_t version;
+	uint32_t glInternalFormat;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t sourceChannels;
+};
+
+// where one mip level is stored in the file
+struct COOKED_TEXTURE_LEVEL
+{
+	uint64_t byteOffset;
+	uint64_t byteLength;
+};
+
+static_assert(sizeof(COOKED_TEXTURE_HEADER) == 32, "cooked texture header must not be padded");
+static_assert(sizeof(COOKED_TEXTURE_LEVEL) == 16, "cooked texture level must not be padded");
+
+// the name of the cooked file for an image file
+std::string GetCookedTexturePath(const std::string& imagePath);
+
+// cook each image file, returning false when any of them failed
+bool RunTextureCooker(const std::vector<std::string>& imagePaths);
+
+// compress RGBA pixels into BC1 blocks, or BC3 blocks when the
+// alpha is kept; blocks past the edges repeat the edge pixels
+void CompressBlocks(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	bool bAlpha,
+	std::vector<unsigned char>& blocks);
+// expand BC1 or BC3 blocks back into RGBA pixels
+void DecompressBlocks(
+	const unsigned char* blocks,
+	int width,
+	int height,
+	bool bAlpha,
+	std::vector<unsigned char>& pixels);
+
+// build the next smaller mip level of RGBA pixels
+void DownsampleLevel(
+	const std::vector<unsigned char>& source,
+	int width,
+	int height,
+	std::vector<unsigned char>& destination);
@@ -0,0 +1,853 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture images on worker threads and stream them into the layers
+// of a texture array through pixel buffer objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+#include "TextureCooker.h"
+
+#ifndef STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#endif
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// bytes of finished layers uploaded per frame, so a burst of
+	// finished images does not stall a single frame; at least
+	// one layer is always uploaded
+	const size_t UPLOAD_BYTES_PER_FRAME = 16 * 1024 * 1024;
+	// color of the placeholder shown until the image is ready
+	const unsigned char PLACEHOLDER_PIXEL[4] = { 128, 128, 128, 255 };
+	// bytes in one compressed 4x4 block of each format
+	const int BC1_BLOCK_BYTES = 8;
+	const int BC3_BLOCK_BYTES = 16;
+	// alpha part of a BC3 block that is opaque everywhere
+	const unsigned char OPAQUE_ALPHA_BLOCK[8] = { 255, 255, 0, 0, 0, 0, 0, 0 };
+
+	/***********************************************************
+	 *  IsCookedFileCurrent()
+	 *
+	 *  Checks that a cooked file is not older than the image
+	 *  it was cooked from, so an edited image is not hidden
+	 *  behind a stale cooked file.
+	 ***********************************************************/
+	bool IsCookedFileCurrent(const std::string& imagePath, const std::string& cookedPath)
+	{
+		struct stat imageStatus;
+		struct stat cookedStatus;
+		if (stat(cookedPath.c_str(), &cookedStatus) != 0)
+		{
+			return(false);
+		}
+		if (stat(imagePath.c_str(), &imageStatus) != 0)
+		{
+			// only the cooked file was shipped
+			return(true);
+		}
+
+		return(cookedStatus.st_mtime >= imageStatus.st_mtime);
+	}
+
+	/***********************************************************
+	 *  ResampleImage()
+	 *
+	 *  Scales RGBA pixels to a new size with bilinear
+	 *  filtering, clamping at the edges.
+	 ***********************************************************/
+	void ResampleImage(
+		const std::vector<unsigned char>& source,
+		int width,
+		int height,
+		int newWidth,
+		int newHeight,
+		std::vector<unsigned char>& destination)
+	{
+		destination.resize((size_t)newWidth * newHeight * 4);
+
+		float scaleX = (float)width / newWidth;
+		float scaleY = (float)height / newHeight;
+		for (int y = 0; y < newHeight; y++)
+		{
+			float sourceY = std::max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+			int y0 = std::min((int)sourceY, height - 1);
+			int y1 = std::min(y0 + 1, height - 1);
+			float fractionY = sourceY - y0;
+			for (int x = 0; x < newWidth; x++)
+			{
+				float sourceX = std::max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+				int x0 = std::min((int)sourceX, width - 1);
+				int x1 = std::min(x0 + 1, width - 1);
+				float fractionX = sourceX - x0;
+				for (int c = 0; c < 4; c++)
+				{
+					float top =
+						source[((size_t)y0 * width + x0) * 4 + c] * (1.0f - fractionX) +
+						source[((size_t)y0 * width + x1) * 4 + c] * fractionX;
+					float bottom =
+						source[((size_t)y1 * width + x0) * 4 + c] * (1.0f - fractionX) +
+						source[((size_t)y1 * width + x1) * 4 + c] * fractionX;
+					destination[((size_t)y * newWidth + x) * 4 + c] =
+						(unsigned char)(top * (1.0f - fractionY) + bottom * fractionY + 0.5f);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader()
+{
+	m_textureArray = 0;
+	m_layerCount = 0;
+	m_levelCount = 1;
+	for (int size = LAYER_SIZE; size > 1; size /= 2)
+	{
+		m_levelCount++;
+	}
+	m_bCompressed = false;
+	m_pendingCount = 0;
+	m_batchCount = 0;
+	m_cookedCount = 0;
+	m_bStartupReported = false;
+	m_bStopping = false;
+	m_pixelBuffers[0] = 0;
+	m_pixelBuffers[1] = 0;
+	m_nextPixelBuffer = 0;
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	Shutdown();
+}
+
+/***********************************************************
+ *  GetLevelBytes()
+ *
+ *  This method is used for getting the size in bytes of one
+ *  layer of a level of the array.
+ ***********************************************************/
+size_t TextureLoader::GetLevelBytes(int level) const
+{
+	size_t size = (size_t)std::max(1, LAYER_SIZE >> level);
+	if (m_bCompressed == true)
+	{
+		size_t blocks = (size + 3) / 4;
+		return(blocks * blocks * BC3_BLOCK_BYTES);
+	}
+
+	return(size * size * 4);
+}
+
+/***********************************************************
+ *  CreateTextureArray()
+ *
+ *  This method is used for creating the texture array that
+ *  holds the requested images, with the full mip chain and
+ *  a placeholder in every layer, so it can be bound once
+ *  and drawn with right away. The array is block compressed
+ *  when the driver takes the S3TC formats, so the cooked
+ *  textures keep their size in video memory.
+ ***********************************************************/
+GLuint TextureLoader::CreateTextureArray(int layerCount)
+{
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	if (layerCount > maxLayers)
+	{
+		std::cout << "Only " << maxLayers << " of the " << layerCount << " textures fit in the texture array" << std::endl;
+		layerCount = maxLayers;
+	}
+	if (layerCount <= 0)
+	{
+		return(0);
+	}
+
+	m_layerCount = layerCount;
+	m_filenames.assign(layerCount, std::string());
+	m_layerGenerations.assign(layerCount, 0);
+	// the cooked textures are stored in the S3TC formats
+	m_bCompressed = (GLEW_EXT_texture_compression_s3tc == GL_TRUE);
+
+	glGenTextures(1, &m_textureArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_levelCount - 1);
+
+	// one layer of placeholder texels, reused for every layer
+	std::vector<unsigned char> placeholder;
+	if (m_bCompressed == true)
+	{
+		unsigned char pixels[16 * 4];
+		for (int i = 0; i < 16; i++)
+		{
+			memcpy(&pixels[i * 4], PLACEHOLDER_PIXEL, 4);
+		}
+		std::vector<unsigned char> block;
+		CompressBlocks(pixels, 4, 4, true, block);
+		for (size_t i = 0; i < GetLevelBytes(0); i += block.size())
+		{
+			placeholder.insert(placeholder.end(), block.begin(), block.end());
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < GetLevelBytes(0); i += 4)
+		{
+			placeholder.insert(placeholder.end(), PLACEHOLDER_PIXEL, PLACEHOLDER_PIXEL + 4);
+		}
+	}
+
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		GLsizei size = std::max(1, LAYER_SIZE >> level);
+		if (m_bCompressed == true)
+		{
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+				size, size, layerCount, 0, (GLsizei)(GetLevelBytes(level) * layerCount), NULL);
+		}
+		else
+		{
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8,
+				size, size, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+
+		for (int layer = 0; layer < layerCount; layer++)
+		{
+			if (m_bCompressed == true)
+			{
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size, size, 1,
+					GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, (GLsizei)GetLevelBytes(level), placeholder.data());
+			}
+			else
+			{
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size, size, 1,
+					GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+			}
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return(m_textureArray);
+}
+
+/***********************************************************
+ *  StartWorkers()
+ *
+ *  This method is used for starting one decode thread per
+ *  core, leaving one core for the OpenGL thread.
+ ***********************************************************/
+void TextureLoader::StartWorkers()
+{
+	// every image is loaded bottom row first, as OpenGL expects;
+	// this is set before any worker starts decoding
+	stbi_set_flip_vertically_on_load(true);
+
+	int workerCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&TextureLoader::WorkerLoop, this));
+	}
+
+	glGenBuffers(2, m_pixelBuffers);
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for stopping the worker threads once
+ *  they finish the file they are decoding, and for freeing
+ *  the pixel buffers and any layers never uploaded. The
+ *  texture array belongs to the caller.
+ ***********************************************************/
+void TextureLoader::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+		m_jobs.clear();
+	}
+	m_jobReady.notify_all();
+	for (int i = 0; i < (int)m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+	m_results.clear();
+
+	if (m_pixelBuffers[0] != 0)
+	{
+		glDeleteBuffers(2, m_pixelBuffers);
+		m_pixelBuffers[0] = 0;
+		m_pixelBuffers[1] = 0;
+	}
+	m_textureArray = 0;
+	m_layerCount = 0;
+	m_pendingCount = 0;
+	m_bStartupReported = false;
+	m_bStopping = false;
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by each worker thread, building the
+ *  layers of the queued files and handing them back.
+ ***********************************************************/
+void TextureLoader::WorkerLoop()
+{
+	while (true)
+	{
+		DECODE_JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobReady.wait(lock, [this]() { return(m_bStopping || !m_jobs.empty()); });
+			if (m_bStopping == true)
+			{
+				return;
+			}
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		DECODE_RESULT result;
+		BuildLayer(job, result);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_results.push_back(std::move(result));
+		}
+		m_resultReady.notify_one();
+	}
+}
+
+/***********************************************************
+ *  BuildLayer()
+ *
+ *  This method is used for building the mip chain of a
+ *  layer from the contents in memory, or else from the
+ *  cooked file next to the image, or else from the image
+ *  file itself. It runs on the worker threads.
+ ***********************************************************/
+void TextureLoader::BuildLayer(const DECODE_JOB& job, DECODE_RESULT& result) const
+{
+	result.layer = job.layer;
+	result.generation = job.generation;
+	result.levelData.clear();
+	result.bCooked = false;
+	result.width = 0;
+	result.height = 0;
+	result.channels = 0;
+
+	unsigned char* pixels = NULL;
+	if (NULL != job.data)
+	{
+		// the contents are read in place, never copied
+		if (job.bCooked == false)
+		{
+			pixels = stbi_load_from_memory(job.data, (int)job.size, &result.width, &result.height, &result.channels, 4);
+		}
+		else if ((m_bCompressed == true) &&
+			(IsCookedDataValid(job.filename, job.data, job.size) == true) &&
+			(BuildLayerFromCooked(job.filename, job.data, job.size, result) == true))
+		{
+			return;
+		}
+	}
+
+	// otherwise the file is read from disk, and a cooked
+	// file needs no decoding at all
+	if (NULL == pixels)
+	{
+		std::string cookedPath = GetCookedTexturePath(job.filename);
+		std::vector<unsigned char> cookedData;
+		if ((m_bCompressed == true) &&
+			(IsCookedFileCurrent(job.filename, cookedPath) == true) &&
+			(ReadCookedFile(cookedPath, cookedData) == true) &&
+			(BuildLayerFromCooked(job.filename, cookedData.data(), cookedData.size(), result) == true))
+		{
+			return;
+		}
+		pixels = stbi_load(job.filename.c_str(), &result.width, &result.height, &result.channels, 4);
+	}
+
+	if (NULL != pixels)
+	{
+		BuildLayerFromPixels(pixels, result.width, result.height, result);
+		stbi_image_free(pixels);
+	}
+}
+
+/***********************************************************
+ *  BuildLayerFromPixels()
+ *
+ *  This method is used for resampling RGBA pixels of any
+ *  size to the layer size and building their mip chain,
+ *  block compressing every level when the array is
+ *  compressed. Large images are halved first, so the
+ *  bilinear filter does not skip any of their pixels.
+ ***********************************************************/
+void TextureLoader::BuildLayerFromPixels(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	DECODE_RESULT& result) const
+{
+	std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * 4);
+	std::vector<unsigned char> nextLevel;
+	while ((width >= 2 * LAYER_SIZE) && (height >= 2 * LAYER_SIZE))
+	{
+		DownsampleLevel(level, width, height, nextLevel);
+		level.swap(nextLevel);
+		width /= 2;
+		height /= 2;
+	}
+	if ((width != LAYER_SIZE) || (height != LAYER_SIZE))
+	{
+		ResampleImage(level, width, height, LAYER_SIZE, LAYER_SIZE, nextLevel);
+		level.swap(nextLevel);
+	}
+
+	std::vector<unsigned char> blocks;
+	for (int i = 0; i < m_levelCount; i++)
+	{
+		int size = std::max(1, LAYER_SIZE >> i);
+		if (m_bCompressed == true)
+		{
+			CompressBlocks(level.data(), size, size, true, blocks);
+			result.levelData.insert(result.levelData.end(), blocks.begin(), blocks.end());
+		}
+		else
+		{
+			result.levelData.insert(result.levelData.end(), level.begin(), level.end());
+		}
+
+		if (i + 1 < m_levelCount)
+		{
+			DownsampleLevel(level, size, size, nextLevel);
+			level.swap(nextLevel);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildLayerFromCooked()
+ *
+ *  This method is used for building the mip chain of a
+ *  layer from a checked cooked file. When the file has a
+ *  level of the layer size its levels are used from there
+ *  down, with an opaque alpha part added to BC1 blocks to
+ *  match the BC3 array, so nothing is decoded. Any other
+ *  file is decompressed and resampled like an image. It
+ *  returns false for a format the array cannot hold, or
+ *  for a level reaching past the end of the data.
+ ***********************************************************/
+bool TextureLoader::BuildLayerFromCooked(
+	const std::string& filename,
+	const unsigned char* data,
+	size_t size,
+	DECODE_RESULT& result) const
+{
+	const COOKED_TEXTURE_HEADER* header = (const COOKED_TEXTURE_HEADER*)data;
+	const COOKED_TEXTURE_LEVEL* levels = (const COOKED_TEXTURE_LEVEL*)(header + 1);
+	bool bAlpha = (header->glInternalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+	if ((bAlpha == false) && (header->glInternalFormat != GL_COMPRESSED_RGB_S3TC_DXT1_EXT))
+	{
+		return(false);
+	}
+
+	result.bCooked = true;
+	result.width = (int)header->width;
+	result.height = (int)header->height;
+	result.channels = (int)header->sourceChannels;
+
+	// the level with the size of the layer, if there is one
+	int firstLevel = -1;
+	for (int i = 0; i < (int)header->levelCount; i++)
+	{
+		if (((header->width >> i) == (uint32_t)LAYER_SIZE) &&
+			((header->height >> i) == (uint32_t)LAYER_SIZE) &&
+			((int)header->levelCount - i >= m_levelCount))
+		{
+			firstLevel = i;
+		}
+	}
+
+	int blockBytes = bAlpha ? BC3_BLOCK_BYTES : BC1_BLOCK_BYTES;
+	for (int i = 0; (firstLevel >= 0) && (i < m_levelCount); i++)
+	{
+		const COOKED_TEXTURE_LEVEL& level = levels[firstLevel + i];
+		if (level.byteLength != GetLevelBytes(i) / BC3_BLOCK_BYTES * blockBytes)
+		{
+			firstLevel = -1;
+			break;
+		}
+		if ((level.byteOffset > size) || (level.byteLength > size - level.byteOffset))
+		{
+			std::cout << "Ignoring damaged cooked texture " << filename << std::endl;
+			result.levelData.clear();
+			return(false);
+		}
+
+		const unsigned char* blocks = data + level.byteOffset;
+		if (bAlpha == true)
+		{
+			result.levelData.insert(result.levelData.end(), blocks, blocks + level.byteLength);
+			continue;
+		}
+		for (uint64_t offset = 0; offset < level.byteLength; offset += BC1_BLOCK_BYTES)
+		{
+			result.levelData.insert(result.levelData.end(), OPAQUE_ALPHA_BLOCK, OPAQUE_ALPHA_BLOCK + 8);
+			result.levelData.insert(result.levelData.end(), blocks + offset, blocks + offset + BC1_BLOCK_BYTES);
+		}
+	}
+	if (firstLevel >= 0)
+	{
+		return(true);
+	}
+
+	result.levelData.clear();
+	size_t blocksWide = (header->width + 3) / 4;
+	size_t blocksHigh = (header->height + 3) / 4;
+	if ((levels[0].byteLength < blocksWide * blocksHigh * blockBytes) ||
+		(levels[0].byteOffset > size) ||
+		(levels[0].byteLength > size - levels[0].byteOffset))
+	{
+		std::cout << "Ignoring damaged cooked texture " << filename << std::endl;
+		return(false);
+	}
+	std::vector<unsigned char> pixels;
+	DecompressBlocks(data + levels[0].byteOffset, (int)header->width, (int)header->height, bAlpha, pixels);
+	BuildLayerFromPixels(pixels.data(), (int)header->width, (int)header->height, result);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Request()
+ *
+ *  This method is used for queueing an image file for a
+ *  worker to build into a layer of the array. The layer
+ *  holds its placeholder, or its previous image when it is
+ *  being reloaded, until then.
+ ***********************************************************/
+void TextureLoader::Request(int layer, const std::string& filename)
+{
+	DECODE_JOB job;
+	job.layer = layer;
+	job.filename = filename;
+	job.data = NULL;
+	job.size = 0;
+	job.bCooked = false;
+
+	QueueRequest(job);
+}
+
+/***********************************************************
+ *  RequestMemory()
+ *
+ *  This method is used for queueing an image or cooked file
+ *  whose contents are already in memory. The worker reads
+ *  them in place, so they must stay valid until the layer
+ *  has been uploaded. The file name is used for messages,
+ *  and for loading from disk when the contents cannot be
+ *  used.
+ ***********************************************************/
+void TextureLoader::RequestMemory(
+	int layer,
+	const std::string& filename,
+	const unsigned char* data,
+	size_t size,
+	bool bCooked)
+{
+	DECODE_JOB job;
+	job.layer = layer;
+	job.filename = filename;
+	job.data = data;
+	job.size = size;
+	job.bCooked = bCooked;
+
+	QueueRequest(job);
+}
+
+/***********************************************************
+ *  QueueRequest()
+ *
+ *  This method is used for handing the job of a request to
+ *  the workers, starting them on the first request.
+ ***********************************************************/
+void TextureLoader::QueueRequest(DECODE_JOB& job)
+{
+	if ((job.layer < 0) || (job.layer >= m_layerCount))
+	{
+		return;
+	}
+
+	if (m_workers.empty())
+	{
+		StartWorkers();
+	}
+	if (m_pendingCount == 0)
+	{
+		m_requestTime = std::chrono::steady_clock::now();
+		m_batchCount = 0;
+		m_cookedCount = 0;
+	}
+
+	m_filenames[job.layer] = job.filename;
+	job.generation = ++m_layerGenerations[job.layer];
+	m_pendingCount++;
+	m_batchCount++;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+	}
+	m_jobReady.notify_one();
+}
+
+/***********************************************************
+ *  UploadResult()
+ *
+ *  This method is used for replacing the placeholder of a
+ *  layer with its finished mip chain. The levels are copied
+ *  into a pixel buffer, which is orphaned first so the copy
+ *  never waits on an upload still in flight, and each level
+ *  of the layer is specified from its offset.
+ ***********************************************************/
+void TextureLoader::UploadResult(const DECODE_RESULT& result)
+{
+	const std::string& filename = m_filenames[result.layer];
+	m_pendingCount--;
+
+	// a newer request for the layer replaces this one
+	if (result.generation != m_layerGenerations[result.layer])
+	{
+		return;
+	}
+	if (result.levelData.empty())
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return;
+	}
+
+	std::cout << "Successfully loaded " << (result.bCooked ? "cooked image:" : "image:") << filename
+		<< ", width:" << result.width << ", height:" << result.height << ", channels:" << result.channels
+		<< ", layer:" << result.layer << std::endl;
+
+	GLuint pixelBuffer = m_pixelBuffers[m_nextPixelBuffer];
+	m_nextPixelBuffer = 1 - m_nextPixelBuffer;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, result.levelData.size(), NULL, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER,
+		0,
+		result.levelData.size(),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	const unsigned char* source = (const unsigned char*)0;
+	if (NULL != mapped)
+	{
+		memcpy(mapped, result.levelData.data(), result.levelData.size());
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+	else
+	{
+		// upload straight from the finished levels instead
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		source = result.levelData.data();
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+	size_t offset = 0;
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		GLsizei size = std::max(1, LAYER_SIZE >> level);
+		size_t levelBytes = GetLevelBytes(level);
+		if (m_bCompressed == true)
+		{
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, result.layer, size, size, 1,
+				GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, (GLsizei)levelBytes, source + offset);
+		}
+		else
+		{
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, result.layer, size, size, 1,
+				GL_RGBA, GL_UNSIGNED_BYTE, source + offset);
+		}
+		offset += levelBytes;
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (result.bCooked == true)
+	{
+		m_cookedCount++;
+	}
+}
+
+/***********************************************************
+ *  ReadCookedFile()
+ *
+ *  This method is used for reading a whole cooked texture
+ *  file and checking that its header and level index fit
+ *  the file. It runs on the worker threads.
+ ***********************************************************/
+bool TextureLoader::ReadCookedFile(const std::string& filename, std::vector<unsigned char>& data)
+{
+	std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return(false);
+	}
+
+	std::streamoff fileSize = file.tellg();
+	if (fileSize < (std::streamoff)sizeof(COOKED_TEXTURE_HEADER))
+	{
+		return(false);
+	}
+	data.resize((size_t)fileSize);
+	file.seekg(0);
+	if (!file.read((char*)data.data(), fileSize))
+	{
+		return(false);
+	}
+
+	return(IsCookedDataValid(filename, data.data(), data.size()));
+}
+
+/***********************************************************
+ *  IsCookedDataValid()
+ *
+ *  This method is used for checking that the header and the
+ *  level index of a cooked texture file in memory fit the
+ *  file. It runs on the worker threads.
+ ***********************************************************/
+bool TextureLoader::IsCookedDataValid(const std::string& filename, const unsigned char* data, size_t size)
+{
+	const COOKED_TEXTURE_HEADER* header = (const COOKED_TEXTURE_HEADER*)data;
+	if ((size < sizeof(COOKED_TEXTURE_HEADER)) ||
+		(memcmp(header->identifier, COOKED_TEXTURE_IDENTIFIER, sizeof(header->identifier)) != 0) ||
+		(header->version != COOKED_TEXTURE_VERSION) ||
+		(header->levelCount == 0) || (header->levelCount > 32) ||
+		(sizeof(COOKED_TEXTURE_HEADER) + header->levelCount * sizeof(COOKED_TEXTURE_LEVEL) > size))
+	{
+		std::cout << "Ignoring damaged cooked texture " << filename << std::endl;
+		return(false);
+	}
+
+	const COOKED_TEXTURE_LEVEL* levels = (const COOKED_TEXTURE_LEVEL*)(header + 1);
+	for (uint32_t i = 0; i < header->levelCount; i++)
+	{
+		if ((levels[i].byteOffset > size) ||
+			(levels[i].byteLength > size - levels[i].byteOffset))
+		{
+			std::cout << "Ignoring damaged cooked texture " << filename << std::endl;
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for uploading the layers the workers
+ *  have finished, once per frame, until the byte budget of
+ *  the frame is used up. It reports the load time once the
+ *  last layer of the startup load is in, and the latency of
+ *  each later reload the same way.
+ ***********************************************************/
+void TextureLoader::Update()
+{
+	if (m_pendingCount == 0)
+	{
+		return;
+	}
+
+	size_t uploadedBytes = 0;
+	while (uploadedBytes < UPLOAD_BYTES_PER_FRAME)
+	{
+		DECODE_RESULT result;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_results.empty())
+			{
+				break;
+			}
+			result = std::move(m_results.front());
+			m_results.pop_front();
+		}
+
+		uploadedBytes += result.levelData.size();
+		UploadResult(result);
+	}
+
+	if ((m_pendingCount == 0) && (m_bStartupReported == true))
+	{
+		std::chrono::duration<double, std::milli> reloadTime = std::chrono::steady_clock::now() - m_requestTime;
+		std::cout << "INFO: " << m_batchCount << " textures reloaded in " << reloadTime.count() << " ms" << std::endl;
+	}
+	else if (m_pendingCount == 0)
+	{
+		size_t arrayBytes = 0;
+		size_t uncompressedBytes = 0;
+		for (int level = 0; level < m_levelCount; level++)
+		{
+			size_t size = (size_t)std::max(1, LAYER_SIZE >> level);
+			arrayBytes += GetLevelBytes(level) * m_layerCount;
+			uncompressedBytes += size * size * 4 * m_layerCount;
+		}
+
+		std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - m_requestTime;
+		std::cout << "INFO: " << m_batchCount << " textures loaded in " << loadTime.count() << " ms, "
+			<< m_cookedCount << " from cooked files, into a " << (m_bCompressed ? "BC3" : "RGBA8")
+			<< " texture array using " << arrayBytes / (1024.0 * 1024.0) << " MB of video memory instead of "
+			<< uncompressedBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+		m_bStartupReported = true;
+	}
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for waiting on the workers and
+ *  uploading every remaining layer, for runs that must
+ *  draw the same frames every time.
+ ***********************************************************/
+void TextureLoader::Finish()
+{
+	while (m_pendingCount > 0)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_resultReady.wait(lock, [this]() { return(!m_results.empty()); });
+		}
+		Update();
+	}
+}
@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture images on worker threads and stream them into the layers
+// of a texture array through pixel buffer objects
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class creates a single texture array holding every
+ *  scene texture as one layer, each a placeholder at first,
+ *  while a pool of worker threads decodes the files. The
+ *  workers resample each image to the layer size and build
+ *  its mip chain, block compressing it when the array is
+ *  compressed, and the finished layers are uploaded on the
+ *  OpenGL thread through pixel buffer objects, a few per
+ *  frame. An image with a cooked file next to it is read
+ *  from that instead, and a cooked mip chain that fits the
+ *  layer is uploaded without decoding. Images already in
+ *  memory, such as those in a mapped scene package, are
+ *  read in place without a copy. A layer can be requested
+ *  again at any time to reload it from its file, and it
+ *  keeps its current image until the new one is uploaded.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor
+	TextureLoader();
+	// destructor
+	~TextureLoader();
+
+	// width and height of every layer of the texture array
+	static const int LAYER_SIZE = 1024;
+
+	// create the texture array with a placeholder in every layer
+	GLuint CreateTextureArray(int layerCount);
+	// queue an image file for decoding into a layer
+	void Request(int layer, const std::string& filename);
+	// queue an image or cooked file already in memory for a layer;
+	// it must stay valid until the layer is uploaded
+	void RequestMemory(
+		int layer,
+		const std::string& filename,
+		const unsigned char* data,
+		size_t size,
+		bool bCooked);
+	// upload the finished layers, up to the per-frame budget
+	void Update();
+	// block until every requested layer is uploaded
+	void Finish();
+	// stop the workers and free the pixel buffers
+	void Shutdown();
+
+	// whether every requested layer has been uploaded or failed
+	bool IsIdle() const { return(m_pendingCount == 0); }
+
+private:
+	// a file waiting for a worker
+	struct DECODE_JOB
+	{
+		int layer;
+		std::string filename;
+		// the file contents when they are already in memory
+		const unsigned char* data;
+		size_t size;
+		bool bCooked;
+		// the request count of the layer when this was queued
+		int generation;
+	};
+
+	// the mip chain of a layer, laid out level after level in
+	// the format of the array, or empty when the file failed
+	struct DECODE_RESULT
+	{
+		int layer;
+		int generation;
+		std::vector<unsigned char> levelData;
+		bool bCooked;
+		// the size and channels of the source image, for the report
+		int width;
+		int height;
+		int channels;
+	};
+
+	// the array holding all the layers, and its format
+	GLuint m_textureArray;
+	int m_layerCount;
+	int m_levelCount;
+	bool m_bCompressed;
+	// the file names of the requested layers
+	std::vector<std::string> m_filenames;
+	// how many times each layer has been requested, so only the
+	// latest of several requests for a layer is uploaded
+	std::vector<int> m_layerGenerations;
+	// requests that have not been uploaded yet
+	int m_pendingCount;
+	// requests since the loader was last idle, and the uploads
+	// among them that got their pixels from a cooked file
+	int m_batchCount;
+	int m_cookedCount;
+	// whether the first batch, the startup load, has been reported
+	bool m_bStartupReported;
+
+	// worker threads and the queues shared with them
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_jobReady;
+	std::condition_variable m_resultReady;
+	std::deque<DECODE_JOB> m_jobs;
+	std::deque<DECODE_RESULT> m_results;
+	bool m_bStopping;
+
+	// pixel buffers used in turn for the uploads
+	GLuint m_pixelBuffers[2];
+	int m_nextPixelBuffer;
+
+	// time of the first request since the loader was last idle,
+	// for the load and reload reports
+	std::chrono::steady_clock::time_point m_requestTime;
+
+	// start the worker threads on the first request
+	void StartWorkers();
+	// hand the job of a request to the workers
+	void QueueRequest(DECODE_JOB& job);
+	// decode queued files until the loader stops
+	void WorkerLoop();
+	// build the mip chain of a layer from a decoded or cooked file
+	void BuildLayer(const DECODE_JOB& job, DECODE_RESULT& result) const;
+	// build the mip chain of a layer from RGBA pixels of any size
+	void BuildLayerFromPixels(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		DECODE_RESULT& result) const;
+	// use the levels of a cooked file that fit the layer size
+	bool BuildLayerFromCooked(
+		const std::string& filename,
+		const unsigned char* data,
+		size_t size,
+		DECODE_RESULT& result) const;
+	// copy the mip chain of a finished layer into the array
+	void UploadResult(const DECODE_RESULT& result);
+	// bytes of one level of the array
+	size_t GetLevelBytes(int level) const;
+	// read a cooked file, returning false when it is missing or damaged
+	static bool ReadCookedFile(const std::string& filename, std::vector<unsigned char>& data);
+	// check that the header and level index of a cooked file fit it
+	static bool IsCookedDataValid(const std::string& filename, const unsigned char* data, size_t size);
+};
@@ -0,0 +1,314 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.cpp
+// ============
+// resolve the shader uniform locations once and skip uploads of values
+// that the shader already holds
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformCache.h"
+#include "ShaderBlocks.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// shader names of the uniforms, in UNIFORM_ID order
+	const char* g_UniformNames[UniformCache::UNIFORM_COUNT] =
+	{
+		"view",
+		"projection",
+		"viewPosition",
+		"objectColor",
+		"objectTextures",
+		"UVscale",
+		"localLights",
+		"lightClusters",
+		"clusterLights",
+		"clusterTileScale",
+		"clusterDepthPlane",
+		"clusterSliceScale",
+		"shadowAtlas"
+	};
+}
+
+/***********************************************************
+ *  UniformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformCache::UniformCache()
+{
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_values[i].bValid = false;
+		m_values[i].type = TYPE_INT;
+		m_values[i].count = 0;
+	}
+	m_activeProgram = -1;
+
+	m_frameUploads = 0;
+	m_frameSkipped = 0;
+	m_lastFrameUploads = 0;
+	m_lastFrameSkipped = 0;
+	m_totalUploads = 0;
+	m_totalSkipped = 0;
+}
+
+/***********************************************************
+ *  ~UniformCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformCache::~UniformCache()
+{
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for making a shader program active
+ *  and sending it the latest value of every uniform that
+ *  it does not hold yet. A program used for the first time
+ *  has the locations of all the uniforms looked up, and its
+ *  uniform blocks attached to their binding points.
+ ***********************************************************/
+void UniformCache::UseProgram(GLuint programID)
+{
+	if (programID == 0)
+	{
+		return;
+	}
+	if ((m_activeProgram >= 0) && (m_programs[m_activeProgram].programID == programID))
+	{
+		return;
+	}
+
+	glUseProgram(programID);
+
+	m_activeProgram = -1;
+	for (int i = 0; i < (int)m_programs.size(); i++)
+	{
+		if (m_programs[i].programID == programID)
+		{
+			m_activeProgram = i;
+		}
+	}
+
+	if (m_activeProgram < 0)
+	{
+		PROGRAM_UNIFORMS program;
+		program.programID = programID;
+		for (int i = 0; i < UNIFORM_COUNT; i++)
+		{
+			program.locations[i] = glGetUniformLocation(programID, g_UniformNames[i]);
+			// a new program holds none of the shadowed values
+			program.shadows[i].bValid = false;
+		}
+
+		// the material, light and shadow blocks are read from fixed binding points
+		GLuint blockIndex = glGetUniformBlockIndex(programID, "MaterialBlock");
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(programID, blockIndex, MATERIAL_BLOCK_BINDING);
+		}
+		blockIndex = glGetUniformBlockIndex(programID, "LightBlock");
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(programID, blockIndex, LIGHT_BLOCK_BINDING);
+		}
+		blockIndex = glGetUniformBlockIndex(programID, "ShadowBlock");
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(programID, blockIndex, SHADOW_BLOCK_BINDING);
+		}
+
+		m_programs.push_back(program);
+		m_activeProgram = (int)m_programs.size() - 1;
+	}
+
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		if (m_values[i].bValid == true)
+		{
+			SendValue((UNIFORM_ID)i);
+		}
+	}
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting every program and its
+ *  shadow copies, after the programs have been rebuilt, so
+ *  that the programs used next are resolved again and sent
+ *  every value. The latest values themselves are kept.
+ ***********************************************************/
+void UniformCache::Invalidate()
+{
+	m_programs.clear();
+	m_activeProgram = -1;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for keeping the upload counters of
+ *  the frame that just completed and resetting them for
+ *  the next frame.
+ ***********************************************************/
+void UniformCache::BeginFrame()
+{
+	m_lastFrameUploads = m_frameUploads;
+	m_lastFrameSkipped = m_frameSkipped;
+	m_frameUploads = 0;
+	m_frameSkipped = 0;
+}
+
+/***********************************************************
+ *  SetValue()
+ *
+ *  This method is used for keeping the latest value set for
+ *  a uniform, and sending it to the active program.
+ ***********************************************************/
+void UniformCache::SetValue(UNIFORM_ID uniform, VALUE_TYPE type, const float* values, int count)
+{
+	UNIFORM_VALUE& value = m_values[uniform];
+	value.bValid = true;
+	value.type = type;
+	value.count = count;
+	memcpy(value.values, values, count * sizeof(float));
+
+	SendValue(uniform);
+}
+
+/***********************************************************
+ *  SendValue()
+ *
+ *  This method is used for comparing the latest value of a
+ *  uniform against the shadow copy of the active program,
+ *  and uploading it when the program does not hold it.
+ ***********************************************************/
+void UniformCache::SendValue(UNIFORM_ID uniform)
+{
+	if (m_activeProgram < 0)
+	{
+		return;
+	}
+
+	PROGRAM_UNIFORMS& program = m_programs[m_activeProgram];
+	GLint location = program.locations[uniform];
+	const UNIFORM_VALUE& value = m_values[uniform];
+	UNIFORM_VALUE& shadow = program.shadows[uniform];
+
+	// uniforms the shader does not use never need uploading
+	if (location < 0)
+	{
+		return;
+	}
+
+	if ((shadow.bValid == true) &&
+		(shadow.count == value.count) &&
+		(memcmp(shadow.values, value.values, value.count * sizeof(float)) == 0))
+	{
+		m_frameSkipped++;
+		m_totalSkipped++;
+		return;
+	}
+
+	shadow = value;
+	m_frameUploads++;
+	m_totalUploads++;
+
+	switch (value.type)
+	{
+	case TYPE_INT:
+	{
+		int intValue;
+		memcpy(&intValue, value.values, sizeof(int));
+		glUniform1i(location, intValue);
+		break;
+	}
+	case TYPE_FLOAT:
+		glUniform1f(location, value.values[0]);
+		break;
+	case TYPE_VEC2:
+		glUniform2fv(location, 1, value.values);
+		break;
+	case TYPE_VEC3:
+		glUniform3fv(location, 1, value.values);
+		break;
+	case TYPE_VEC4:
+		glUniform4fv(location, 1, value.values);
+		break;
+	case TYPE_MAT4:
+		glUniformMatrix4fv(location, 1, GL_FALSE, value.values);
+		break;
+	}
+}
+
+/***********************************************************
+ *  SetInt()
+ *
+ *  This method is used for setting an integer, boolean or
+ *  sampler uniform value.
+ ***********************************************************/
+void UniformCache::SetInt(UNIFORM_ID uniform, int value)
+{
+	float shadowValue;
+	memcpy(&shadowValue, &value, sizeof(float));
+
+	SetValue(uniform, TYPE_INT, &shadowValue, 1);
+}
+
+/***********************************************************
+ *  SetFloat()
+ *
+ *  This method is used for setting a float uniform value.
+ ***********************************************************/
+void UniformCache::SetFloat(UNIFORM_ID uniform, float value)
+{
+	SetValue(uniform, TYPE_FLOAT, &value, 1);
+}
+
+/***********************************************************
+ *  SetVec2()
+ *
+ *  This method is used for setting a vec2 uniform value.
+ ***********************************************************/
+void UniformCache::SetVec2(UNIFORM_ID uniform, const glm::vec2& value)
+{
+	SetValue(uniform, TYPE_VEC2, glm::value_ptr(value), 2);
+}
+
+/***********************************************************
+ *  SetVec3()
+ *
+ *  This method is used for setting a vec3 uniform value.
+ ***********************************************************/
+void UniformCache::SetVec3(UNIFORM_ID uniform, const glm::vec3& value)
+{
+	SetValue(uniform, TYPE_VEC3, glm::value_ptr(value), 3);
+}
+
+/***********************************************************
+ *  SetVec4()
+ *
+ *  This method is used for setting a vec4 uniform value.
+ ***********************************************************/
+void UniformCache::SetVec4(UNIFORM_ID uniform, const glm::vec4& value)
+{
+	SetValue(uniform, TYPE_VEC4, glm::value_ptr(value), 4);
+}
+
+/***********************************************************
+ *  SetMat4()
+ *
+ *  This method is used for setting a mat4 uniform value.
+ ***********************************************************/
+void UniformCache::SetMat4(UNIFORM_ID uniform, const glm::mat4& value)
+{
+	SetValue(uniform, TYPE_MAT4, glm::value_ptr(value), 16);
+}
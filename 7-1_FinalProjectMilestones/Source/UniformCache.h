@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.h
+// ============
+// resolve the shader uniform locations once and skip uploads of values
+// that the shader already holds
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  UniformCache
+ *
+ *  This class holds the latest value set for each of the
+ *  per-draw shader uniforms, and for every shader program
+ *  it has used, the uniform locations, resolved once, and
+ *  a shadow copy of the last value sent to each uniform so
+ *  that redundant uploads can be skipped. Switching to a
+ *  program sends it only the values it does not hold yet,
+ *  so the variants of the scene program can be swapped
+ *  between draws without setting every value again.
+ ***********************************************************/
+class UniformCache
+{
+public:
+	// constructor
+	UniformCache();
+	// destructor
+	~UniformCache();
+
+	// the uniforms that are set while rendering
+	enum UNIFORM_ID
+	{
+		UNIFORM_VIEW = 0,
+		UNIFORM_PROJECTION,
+		UNIFORM_VIEW_POSITION,
+		UNIFORM_OBJECT_COLOR,
+		UNIFORM_OBJECT_TEXTURES,
+		UNIFORM_UV_SCALE,
+		UNIFORM_LOCAL_LIGHTS,
+		UNIFORM_LIGHT_CLUSTERS,
+		UNIFORM_CLUSTER_LIGHTS,
+		UNIFORM_CLUSTER_TILE_SCALE,
+		UNIFORM_CLUSTER_DEPTH_PLANE,
+		UNIFORM_CLUSTER_SLICE_SCALE,
+		UNIFORM_SHADOW_ATLAS,
+		UNIFORM_COUNT
+	};
+
+	// make a shader program active and send it the latest values;
+	// a program used the first time has its uniform locations
+	// resolved and its uniform blocks attached to their binding
+	// points
+	void UseProgram(GLuint programID);
+	// forget every program, after they have been rebuilt, so the
+	// next ones used are resolved and sent every value again
+	void Invalidate();
+
+	// send a value to a uniform, unless it already holds it
+	void SetInt(UNIFORM_ID uniform, int value);
+	void SetFloat(UNIFORM_ID uniform, float value);
+	void SetVec2(UNIFORM_ID uniform, const glm::vec2& value);
+	void SetVec3(UNIFORM_ID uniform, const glm::vec3& value);
+	void SetVec4(UNIFORM_ID uniform, const glm::vec4& value);
+	void SetMat4(UNIFORM_ID uniform, const glm::mat4& value);
+
+	// start counting the uploads for a new frame
+	void BeginFrame();
+	// upload counters for the last completed frame
+	int GetFrameUploadCount() const { return(m_lastFrameUploads); }
+	int GetFrameSkippedCount() const { return(m_lastFrameSkipped); }
+	// upload counters since the cache was created
+	long long GetTotalUploadCount() const { return(m_totalUploads); }
+	long long GetTotalSkippedCount() const { return(m_totalSkipped); }
+
+private:
+	// the kinds of uniform values
+	enum VALUE_TYPE
+	{
+		TYPE_INT = 0,
+		TYPE_FLOAT,
+		TYPE_VEC2,
+		TYPE_VEC3,
+		TYPE_VEC4,
+		TYPE_MAT4
+	};
+
+	// a uniform value, as set or as last sent to a program
+	struct UNIFORM_VALUE
+	{
+		bool bValid;
+		VALUE_TYPE type;
+		int count;
+		float values[16];
+	};
+
+	// the uniform locations of a program and its shadow copies
+	struct PROGRAM_UNIFORMS
+	{
+		GLuint programID;
+		GLint locations[UNIFORM_COUNT];
+		UNIFORM_VALUE shadows[UNIFORM_COUNT];
+	};
+
+	// the latest value set for every uniform
+	UNIFORM_VALUE m_values[UNIFORM_COUNT];
+	// every program used so far, and the index of the active one
+	std::vector<PROGRAM_UNIFORMS> m_programs;
+	int m_activeProgram;
+
+	// upload counters
+	int m_frameUploads;
+	int m_frameSkipped;
+	int m_lastFrameUploads;
+	int m_lastFrameSkipped;
+	long long m_totalUploads;
+	long long m_totalSkipped;
+
+	// keep a newly set value and send it to the active program
+	void SetValue(UNIFORM_ID uniform, VALUE_TYPE type, const float* values, int count);
+	// send the latest value to the active program, unless it
+	// holds it already or does not use the uniform
+	void SendValue(UNIFORM_ID uniform);
+};
@@ -1,46 +1,66 @@
-///////////////////////////////////////////////////////////////////////////////
-// viewmanager.h
-// ============
-// manage the viewing of 3D objects within the viewport - camera, projection
-//
-//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
-//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
-///////////////////////////////////////////////////////////////////////////////
-
-#pragma once
-
-#include "ShaderManager.h"
-#include "camera.h"
-
-// GLFW library
-#include "GLFW/glfw3.h" 
-
-class ViewManager
-{
-public:
-	// constructor
-	ViewManager(
-		ShaderManager* pShaderManager);
-	// destructor
-	~ViewManager();
-
-	// mouse position callback for mouse interaction with the 3D scene
-	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
-	// mouse scroll wheel callback for camera speed interaction
-	static void Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double xoffset, double yoffset);
-private:
-	// pointer to shader manager object
-	ShaderManager* m_pShaderManager;
-	// active OpenGL display window
-	GLFWwindow* m_pWindow;
-
-	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
-
-public:
-	// create the initial OpenGL display window
-	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
-	
-	// prepare the conversion from 3D object display to 2D scene display
-	void PrepareSceneView();
+///////////////////////////////////////////////////////////////////////////////
+// viewmanager.h
+// ============
+// manage the viewing of 3D objects within the viewport - camera, projection
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "UniformCache.h"
+#include "camera.h"
+
+// GLFW library
+#include "GLFW/glfw3.h" 
+
+class ViewManager
+{
+public:
+	// constructor
+	ViewManager(
+		ShaderManager* pShaderManager,
+		UniformCache* pUniformCache);
+	// destructor
+	~ViewManager();
+
+	// mouse position callback for mouse interaction with the 3D scene
+	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
+	// mouse scroll wheel callback for camera speed interaction
+	static void Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double xoffset, double yoffset);
+private:
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the cached shader uniforms
+	UniformCache* m_pUniformCache;
+	// active OpenGL display window
+	GLFWwindow* m_pWindow;
+	// size of the image being rendered, for the aspect ratio
+	int m_renderWidth;
+	int m_renderHeight;
+	// view and projection matrices of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+
+	// process keyboard events for interaction with the 3D scene
+	void ProcessKeyboardEvents();
+
+public:
+	// create the initial OpenGL display window
+	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	
+	// prepare the conversion from 3D object display to 2D scene display
+	void PrepareSceneView();
+
+	// set the size of the image being rendered
+	void SetRenderSize(int width, int height);
+	// place the camera directly, as a scripted path does
+	void SetCameraPose(const glm::vec3& position, const glm::vec3& front);
+
+	// accessors for the current frame view
+	const glm::mat4& GetViewMatrix() const { return(m_viewMatrix); }
+	const glm::mat4& GetProjectionMatrix() const { return(m_projectionMatrix); }
+	Camera* GetCamera() const;
 };
\ No newline at end of file
@@ -0,0 +1,247 @@
+#version 330 core
+// the scene fragment shader as it was before the texture was sampled
+// once per fragment, kept as the baseline of the --bench-shading
+// comparison; it samples the texture for every light term and works
+// out the light directions per fragment, as it used to
+out vec4 fragmentColor;
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+flat in int fragmentMaterialIndex;
+flat in int fragmentTextureLayer;
+
+// the std140 layouts of these blocks are mirrored in ShaderBlocks.h
+struct Material {
+    vec3 diffuseColor;
+    float shininess;
+    vec3 specularColor;
+}; 
+
+struct DirectionalLight {
+    vec3 direction;
+    bool bActive;
+	
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+    bool bActive;
+    
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    float cutOff;
+    vec3 direction;
+    float outerCutOff;
+  
+    vec3 ambient;
+    float constant;
+    vec3 diffuse;
+    float linear;
+    vec3 specular;       
+    float quadratic;
+
+    bool bActive;
+};
+
+#define TOTAL_POINT_LIGHTS 5
+#define MAX_MATERIALS 256
+
+// the features of this variant, defined by the program cache
+// when it builds the shader; the defaults turn everything on
+#ifndef TEXTURED
+#define TEXTURED 1
+#endif
+#ifndef LIGHTING
+#define LIGHTING 1
+#endif
+#ifndef DIRECTIONAL_LIGHT
+#define DIRECTIONAL_LIGHT 1
+#endif
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 1
+#endif
+// the active point lights come first in the light block
+#ifndef POINT_LIGHT_COUNT
+#define POINT_LIGHT_COUNT TOTAL_POINT_LIGHTS
+#endif
+
+// all the object materials, selected by the instance material index
+layout(std140) uniform MaterialBlock
+{
+    Material materials[MAX_MATERIALS];
+};
+
+// all the light sources, updated together
+layout(std140) uniform LightBlock
+{
+    DirectionalLight directionalLight;
+    PointLight pointLights[TOTAL_POINT_LIGHTS];
+    SpotLight spotLight;
+};
+
+uniform vec4 objectColor = vec4(1.0f);
+uniform vec3 viewPosition;
+// all the object textures, selected by the instance texture layer
+uniform sampler2DArray objectTextures;
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+
+// material of the object being drawn
+Material material;
+
+// function prototypes
+vec4 SampleObjectTexture(vec2 textureCoordinate);
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+
+void main()
+{    
+    material = materials[fragmentMaterialIndex];
+
+#if LIGHTING
+    vec3 phongResult = vec3(0.0f);
+    // properties
+    vec3 norm = normalize(fragmentVertexNormal);
+    vec3 viewDir = normalize(viewPosition - fragmentPosition);
+    
+    // == =====================================================
+    // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
+    // For each phase, a calculate function is defined that calculates the corresponding color
+    // per light source. In the main() function we take all the calculated colors and sum them 
+    // up for this fragment's final color.
+    // == =====================================================
+    // phase 1: directional lighting
+#if DIRECTIONAL_LIGHT
+    phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
+#endif
+    // phase 2: point lights, only the active ones
+    for(int i = 0; i < POINT_LIGHT_COUNT; i++)
+    {
+        phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);   
+    } 
+    // phase 3: spot light
+#if SPOT_LIGHT
+    phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
+#endif
+    
+#if TEXTURED
+    fragmentColor = vec4(phongResult, (SampleObjectTexture(fragmentTextureCoordinate)).a);
+#else
+    fragmentColor = vec4(phongResult, objectColor.a);
+#endif
+#else
+#if TEXTURED
+    fragmentColor = SampleObjectTexture(fragmentTextureCoordinate * UVscale);
+#else
+    fragmentColor = objectColor;
+#endif
+#endif
+}
+
+// samples the texture layer of the object being drawn.
+vec4 SampleObjectTexture(vec2 textureCoordinate)
+{
+    return texture(objectTextures, vec3(textureCoordinate, float(fragmentTextureLayer)));
+}
+
+// calculates the color when using a directional light.
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
+{
+    vec3 ambient = vec3(0.0f);
+    vec3 diffuse = vec3(0.0f);
+    vec3 specular = vec3(0.0f);
+
+    vec3 lightDirection = normalize(light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDirection), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDirection, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // combine results
+#if TEXTURED
+    ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+    diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+    specular = light.specular * spec * material.specularColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+#else
+    ambient = light.ambient * vec3(objectColor);
+    diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
+    specular = light.specular * spec * material.specularColor * vec3(objectColor);
+#endif
+    
+    return (ambient + diffuse + specular);
+}
+
+// calculates the color when using a point light.
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 ambient = vec3(0.0f);
+    vec3 diffuse = vec3(0.0f);
+    vec3 specular= vec3(0.0f);
+
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    // Calculate specular component
+    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+   
+    // combine results
+#if TEXTURED
+    ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+    diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+    specular = light.specular * specularComponent * material.specularColor;
+#else
+    ambient = light.ambient * vec3(objectColor);
+    diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
+    specular = light.specular * specularComponent * material.specularColor;
+#endif
+    
+    return (ambient + diffuse + specular);
+}
+
+// calculates the color when using a spot light.
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 ambient = vec3(0.0f);
+    vec3 diffuse = vec3(0.0f);
+    vec3 specular = vec3(0.0f);
+
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    // spotlight intensity
+    float theta = dot(lightDir, normalize(light.direction)); 
+    float epsilon = 1.0 / light.cutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    // combine results
+#if TEXTURED
+    ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+    diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+    specular = light.specular * spec * material.specularColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+#else
+    ambient = light.ambient * vec3(objectColor);
+    diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
+    specular = light.specular * spec * material.specularColor * vec3(objectColor);
+#endif
+    
+    ambient *= attenuation * intensity;
+    diffuse *= attenuation * intensity;
+    specular *= attenuation * intensity;
+    return (ambient + diffuse + specular);
+}
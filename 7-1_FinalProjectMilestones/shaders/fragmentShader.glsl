@@ -1,225 +1,349 @@
-#version 330 core
-out vec4 fragmentColor;
-
-in vec3 fragmentPosition;
-in vec3 fragmentVertexNormal;
-in vec2 fragmentTextureCoordinate;
-
-struct Material {
-    vec3 diffuseColor;
-    vec3 specularColor;
-    float shininess;
-}; 
-
-struct DirectionalLight {
-    vec3 direction;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    bool bActive;
-};
-
-struct PointLight {
-    vec3 position;
-    
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    bool bActive;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
-
-    bool bActive;
-};
-
-#define TOTAL_POINT_LIGHTS 5
-
-uniform bool bUseTexture=false;
-uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
-uniform vec3 viewPosition;
-uniform DirectionalLight directionalLight;
-uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
-uniform SpotLight spotLight;
-uniform Material material;
-uniform sampler2D objectTexture;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
-
-// function prototypes
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-
-void main()
-{    
-    if(bUseLighting == true)
-    {
-        vec3 phongResult = vec3(0.0f);
-        // properties
-        vec3 norm = normalize(fragmentVertexNormal);
-        vec3 viewDir = normalize(viewPosition - fragmentPosition);
-    
-        // == =====================================================
-        // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
-        // For each phase, a calculate function is defined that calculates the corresponding color
-        // per light source. In the main() function we take all the calculated colors and sum them 
-        // up for this fragment's final color.
-        // == =====================================================
-        // phase 1: directional lighting
-        if(directionalLight.bActive == true)
-        {
-            phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
-        }
-        // phase 2: point lights
-        for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
-        {
-	    if(pointLights[i].bActive == true)
-            {
-                phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);   
-            }
-        } 
-        // phase 3: spot light
-        if(spotLight.bActive == true)
-        {
-            phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
-        }
-    
-        if(bUseTexture == true)
-        {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinate)).a);
-        }
-        else
-        {
-            fragmentColor = vec4(phongResult, objectColor.a);
-        }
-    }
-    else
-    {
-        if(bUseTexture == true)
-        {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
-        }
-        else
-        {
-            fragmentColor = objectColor;
-        }
-    }
-}
-
-// calculates the color when using a directional light.
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
-{
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
-
-    vec3 lightDirection = normalize(-light.direction);
-    // diffuse shading
-    float diff = max(dot(normal, lightDirection), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDirection, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
-    
-    return (ambient + diffuse + specular);
-}
-
-// calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular= vec3(0.0f);
-
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    // Calculate specular component
-    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-   
-    // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * specularComponent * material.specularColor;
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * specularComponent * material.specularColor;
-    }
-    
-    return (ambient + diffuse + specular);
-}
-
-// calculates the color when using a spot light.
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
-
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    // spotlight intensity
-    float theta = dot(lightDir, normalize(-light.direction)); 
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-    // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
-    
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
-    return (ambient + diffuse + specular);
-}
+#version 330 core
+out vec4 fragmentColor;
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+flat in int fragmentMaterialIndex;
+flat in int fragmentTextureLayer;
+
+// the std140 layouts of these blocks are mirrored in ShaderBlocks.h
+struct Material {
+    vec3 diffuseColor;
+    float shininess;
+    vec3 specularColor;
+}; 
+
+// the light directions point towards the lights and are normalized,
+// and the spot light cut off holds the scale of its falloff; both
+// are worked out once on the CPU instead of in every fragment
+struct DirectionalLight {
+    vec3 direction;
+    bool bActive;
+	
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+    bool bActive;
+    
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    float cutOffScale;
+    vec3 direction;
+    float outerCutOff;
+  
+    vec3 ambient;
+    float constant;
+    vec3 diffuse;
+    float linear;
+    vec3 specular;       
+    float quadratic;
+
+    bool bActive;
+};
+
+#define TOTAL_POINT_LIGHTS 5
+#define MAX_MATERIALS 256
+// the view frustum is split into this grid of light clusters
+#define CLUSTER_COLUMNS 16
+#define CLUSTER_ROWS 9
+#define CLUSTER_SLICES 24
+// a point light has a shadow tile for every face of its cube
+#define POINT_SHADOW_FACES 6
+// the shadow lookups are moved this far off the surface, scaled
+// by the distance to a point light, against shadow acne
+#define SHADOW_NORMAL_OFFSET 0.02
+#define POINT_SHADOW_NORMAL_OFFSET 0.003
+
+// the features of this variant, defined by the program cache
+// when it builds the shader; the defaults turn everything on
+#ifndef TEXTURED
+#define TEXTURED 1
+#endif
+#ifndef LIGHTING
+#define LIGHTING 1
+#endif
+#ifndef DIRECTIONAL_LIGHT
+#define DIRECTIONAL_LIGHT 1
+#endif
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 1
+#endif
+#ifndef LOCAL_LIGHTS
+#define LOCAL_LIGHTS 0
+#endif
+#ifndef SHADOWS
+#define SHADOWS 0
+#endif
+// the active point lights come first in the light block
+#ifndef POINT_LIGHT_COUNT
+#define POINT_LIGHT_COUNT TOTAL_POINT_LIGHTS
+#endif
+
+// all the object materials, selected by the instance material index
+layout(std140) uniform MaterialBlock
+{
+    Material materials[MAX_MATERIALS];
+};
+
+// all the light sources, updated together
+layout(std140) uniform LightBlock
+{
+    DirectionalLight directionalLight;
+    PointLight pointLights[TOTAL_POINT_LIGHTS];
+    SpotLight spotLight;
+};
+
+uniform vec4 objectColor = vec4(1.0f);
+uniform vec3 viewPosition;
+// all the object textures, selected by the instance texture layer
+uniform sampler2DArray objectTextures;
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+
+#if SHADOWS
+// the shadow maps of the directional and point lights, all tiles
+// of one depth atlas; the matrices take a world position to its
+// atlas coordinates and depth, and the tiles hold the bounds the
+// coordinates are kept in, with the faces of each point light in
+// the order +X -X +Y -Y +Z -Z
+layout(std140) uniform ShadowBlock
+{
+    mat4 directionalShadowMatrix;
+    vec4 directionalShadowTile;
+    mat4 pointShadowMatrices[TOTAL_POINT_LIGHTS * POINT_SHADOW_FACES];
+    vec4 pointShadowTiles[TOTAL_POINT_LIGHTS * POINT_SHADOW_FACES];
+};
+uniform sampler2DShadow shadowAtlas;
+#endif
+
+#if LOCAL_LIGHTS
+// the local lights, three texels each: the position and radius,
+// the diffuse color and the specular color
+uniform samplerBuffer localLights;
+// the offset and count of the light list of every cluster
+uniform usamplerBuffer lightClusters;
+// the light lists of all the clusters, one after another
+uniform usamplerBuffer clusterLights;
+// turns the window position into a cluster column and row
+uniform vec2 clusterTileScale;
+// gives the view depth of a world position
+uniform vec4 clusterDepthPlane;
+// turns the log of the view depth into a cluster slice
+uniform vec2 clusterSliceScale;
+#endif
+
+// material of the object being drawn
+Material material;
+
+// function prototypes
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 baseColor, vec3 normal, vec3 viewDir, float shadow);
+vec3 CalcPointLight(PointLight light, vec3 baseColor, vec3 normal, vec3 fragPos, vec3 viewDir, float shadow);
+#if SHADOWS
+float CalcDirectionalShadow(vec3 fragPos, vec3 normal);
+float CalcPointShadow(int light, vec3 fragPos, vec3 normal);
+#endif
+vec3 CalcSpotLight(SpotLight light, vec3 baseColor, vec3 normal, vec3 fragPos, vec3 viewDir);
+#if LOCAL_LIGHTS
+vec3 CalcLocalLight(int light, vec3 baseColor, vec3 normal, vec3 fragPos, vec3 viewDir);
+#endif
+
+void main()
+{    
+    // the texture is sampled once, and every light term uses that color
+#if TEXTURED
+    vec4 baseColor = texture(objectTextures, vec3(fragmentTextureCoordinate * UVscale, float(fragmentTextureLayer)));
+#else
+    vec4 baseColor = objectColor;
+#endif
+
+#if LIGHTING
+    material = materials[fragmentMaterialIndex];
+
+    vec3 phongResult = vec3(0.0f);
+    // properties
+    vec3 norm = normalize(fragmentVertexNormal);
+    vec3 viewDir = normalize(viewPosition - fragmentPosition);
+    
+    // == =====================================================
+    // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
+    // For each phase, a calculate function is defined that calculates the corresponding color
+    // per light source. In the main() function we take all the calculated colors and sum them 
+    // up for this fragment's final color.
+    // == =====================================================
+    // phase 1: directional lighting
+#if DIRECTIONAL_LIGHT
+#if SHADOWS
+    float directionalShadow = CalcDirectionalShadow(fragmentPosition, norm);
+#else
+    float directionalShadow = 1.0;
+#endif
+    phongResult += CalcDirectionalLight(directionalLight, baseColor.rgb, norm, viewDir, directionalShadow);
+#endif
+    // phase 2: point lights, only the active ones
+    for(int i = 0; i < POINT_LIGHT_COUNT; i++)
+    {
+#if SHADOWS
+        float pointShadow = CalcPointShadow(i, fragmentPosition, norm);
+#else
+        float pointShadow = 1.0;
+#endif
+        phongResult += CalcPointLight(pointLights[i], baseColor.rgb, norm, fragmentPosition, viewDir, pointShadow);   
+    } 
+    // phase 3: spot light
+#if SPOT_LIGHT
+    phongResult += CalcSpotLight(spotLight, baseColor.rgb, norm, fragmentPosition, viewDir);    
+#endif
+    // phase 4: the local lights listed for the cluster of this fragment
+#if LOCAL_LIGHTS
+    ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterTileScale), ivec2(CLUSTER_COLUMNS - 1, CLUSTER_ROWS - 1));
+    float viewDepth = dot(clusterDepthPlane.xyz, fragmentPosition) + clusterDepthPlane.w;
+    int slice = clamp(int(floor(log(max(viewDepth, 0.0001)) * clusterSliceScale.x + clusterSliceScale.y)), 0, CLUSTER_SLICES - 1);
+    uvec2 lightList = texelFetch(lightClusters, (slice * CLUSTER_ROWS + tile.y) * CLUSTER_COLUMNS + tile.x).xy;
+    for(uint i = 0u; i < lightList.y; i++)
+    {
+        int light = int(texelFetch(clusterLights, int(lightList.x + i)).r);
+        phongResult += CalcLocalLight(light, baseColor.rgb, norm, fragmentPosition, viewDir);
+    }
+#endif
+    
+    fragmentColor = vec4(phongResult, baseColor.a);
+#else
+    fragmentColor = baseColor;
+#endif
+}
+
+// calculates the color when using a directional light; the shadow
+// dims all but the ambient term.
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 baseColor, vec3 normal, vec3 viewDir, float shadow)
+{
+    // diffuse shading
+    float diff = max(dot(normal, light.direction), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-light.direction, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // combine results
+    vec3 ambient = light.ambient * baseColor;
+    vec3 diffuse = light.diffuse * diff * material.diffuseColor * baseColor;
+    vec3 specular = light.specular * spec * material.specularColor * baseColor;
+    
+    return (ambient + (diffuse + specular) * shadow);
+}
+
+// calculates the color when using a point light; the shadow dims
+// all but the ambient term.
+vec3 CalcPointLight(PointLight light, vec3 baseColor, vec3 normal, vec3 fragPos, vec3 viewDir, float shadow)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    // Calculate specular component
+    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+   
+    // combine results
+    vec3 ambient = light.ambient * baseColor;
+    vec3 diffuse = light.diffuse * diff * material.diffuseColor * baseColor;
+    vec3 specular = light.specular * specularComponent * material.specularColor;
+    
+    return (ambient + (diffuse + specular) * shadow);
+}
+
+#if SHADOWS
+// calculates how much of the directional light reaches a position,
+// from 0 in full shadow to 1 in full light.
+float CalcDirectionalShadow(vec3 fragPos, vec3 normal)
+{
+    vec4 shadowCoord = directionalShadowMatrix * vec4(fragPos + normal * SHADOW_NORMAL_OFFSET, 1.0);
+    shadowCoord.xy = clamp(shadowCoord.xy, directionalShadowTile.xy, directionalShadowTile.zw);
+    return texture(shadowAtlas, vec3(shadowCoord.xy, min(shadowCoord.z, 1.0)));
+}
+
+// calculates how much of a point light reaches a position, from
+// the tile of the cube face the position is seen through.
+float CalcPointShadow(int light, vec3 fragPos, vec3 normal)
+{
+    vec3 lightVector = fragPos - pointLights[light].position;
+    vec3 offsetPos = fragPos + normal * (POINT_SHADOW_NORMAL_OFFSET * length(lightVector));
+    vec3 faceVector = offsetPos - pointLights[light].position;
+    vec3 axisLength = abs(faceVector);
+    int face;
+    if ((axisLength.x >= axisLength.y) && (axisLength.x >= axisLength.z))
+    {
+        face = (faceVector.x > 0.0) ? 0 : 1;
+    }
+    else if (axisLength.y >= axisLength.z)
+    {
+        face = (faceVector.y > 0.0) ? 2 : 3;
+    }
+    else
+    {
+        face = (faceVector.z > 0.0) ? 4 : 5;
+    }
+
+    int tile = light * POINT_SHADOW_FACES + face;
+    vec4 shadowCoord = pointShadowMatrices[tile] * vec4(offsetPos, 1.0);
+    shadowCoord.xyz /= shadowCoord.w;
+    shadowCoord.xy = clamp(shadowCoord.xy, pointShadowTiles[tile].xy, pointShadowTiles[tile].zw);
+    return texture(shadowAtlas, vec3(shadowCoord.xy, min(shadowCoord.z, 1.0)));
+}
+#endif
+
+// calculates the color when using a spot light.
+vec3 CalcSpotLight(SpotLight light, vec3 baseColor, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightVector = light.position - fragPos;
+    float distance = length(lightVector);
+    vec3 lightDir = lightVector / distance;
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // attenuation
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    // spotlight intensity
+    float theta = dot(lightDir, light.direction); 
+    float intensity = clamp((theta - light.outerCutOff) * light.cutOffScale, 0.0, 1.0);
+    // combine results
+    vec3 ambient = light.ambient * baseColor;
+    vec3 diffuse = light.diffuse * diff * material.diffuseColor * baseColor;
+    vec3 specular = light.specular * spec * material.specularColor * baseColor;
+    
+    return ((ambient + diffuse + specular) * (attenuation * intensity));
+}
+
+#if LOCAL_LIGHTS
+// calculates the color when using a local light, which fades out
+// smoothly before its radius.
+vec3 CalcLocalLight(int light, vec3 baseColor, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec4 positionRadius = texelFetch(localLights, light * 3);
+    vec3 lightVector = positionRadius.xyz - fragPos;
+    float distanceSquared = dot(lightVector, lightVector);
+    // attenuation
+    float falloff = clamp(1.0 - distanceSquared / (positionRadius.w * positionRadius.w), 0.0, 1.0);
+    falloff *= falloff;
+
+    vec3 lightDir = lightVector * inversesqrt(max(distanceSquared, 0.0001));
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // combine results
+    vec3 diffuse = texelFetch(localLights, light * 3 + 1).rgb * diff * material.diffuseColor * baseColor;
+    vec3 specular = texelFetch(localLights, light * 3 + 2).rgb * spec * material.specularColor;
+
+    return ((diffuse + specular) * falloff);
+}
+#endif
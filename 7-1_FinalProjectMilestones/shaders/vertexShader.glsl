@@ -1,20 +1,27 @@
-#version 330 core
-layout (location = 0) in vec3 inVertexPosition;
-layout (location = 1) in vec3 inVertexNormal;
-layout (location = 2) in vec2 inTextureCoordinate;
-
-out vec3 fragmentPosition;
-out vec3 fragmentVertexNormal;
-out vec2 fragmentTextureCoordinate;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
-   fragmentTextureCoordinate = inTextureCoordinate;
-}
\ No newline at end of file
+#version 330 core
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+// per-instance values, advanced once per instance
+layout (location = 3) in mat4 inInstanceModel;
+layout (location = 7) in int inInstanceMaterial;
+layout (location = 8) in int inInstanceTextureLayer;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out int fragmentMaterialIndex;
+flat out int fragmentTextureLayer;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+   fragmentPosition = vec3(inInstanceModel * vec4(inVertexPosition, 1.0));
+   gl_Position = projection * view * inInstanceModel * vec4(inVertexPosition, 1.0f);
+   fragmentVertexNormal = inVertexNormal;
+   fragmentTextureCoordinate = inTextureCoordinate;
+   fragmentMaterialIndex = inInstanceMaterial;
+   fragmentTextureLayer = inInstanceTextureLayer;
+}